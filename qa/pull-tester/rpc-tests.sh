@@ -43,6 +43,7 @@ testScripts=(
     'walletbackup.py'
     'key_import_export.py'
     'nodehandling.py'
+    'nettotals.py'
     'reindex.py'
     'decodescript.py'
     'blockchain.py'
@@ -0,0 +1,69 @@
+#!/usr/bin/env python2
+# Copyright (c) 2018 The Zcash developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#
+# Test per-message byte accounting and the -maxuploadtarget settings
+# reported by getpeerinfo and getnettotals.
+#
+
+from test_framework.test_framework import BitcoinTestFramework
+from test_framework.util import assert_equal, initialize_chain, \
+    start_nodes, connect_nodes_bi
+
+class NetTotalsTest(BitcoinTestFramework):
+
+    def setup_chain(self):
+        print("Initializing test directory "+self.options.tmpdir)
+        initialize_chain(self.options.tmpdir)
+
+    def setup_network(self, split=False):
+        self.nodes = start_nodes(2, self.options.tmpdir, extra_args=[
+            ['-maxuploadtarget=1', '-maxuploadtimeframe=2'],
+            [],
+        ])
+        connect_nodes_bi(self.nodes, 0, 1)
+        self.is_network_split = False
+        self.sync_all()
+
+    def run_test(self):
+        self.nodes[1].generate(1)
+        self.sync_all()
+
+        # Per-peer counters include the handshake and the relayed block.
+        peers = self.nodes[0].getpeerinfo()
+        assert_equal(len(peers), 1)
+        sent = peers[0]['bytessent_per_msg']
+        recv = peers[0]['bytesrecv_per_msg']
+        for msg in ['version', 'verack']:
+            assert(sent[msg] > 0)
+            assert(recv[msg] > 0)
+        assert(recv['block'] > 0)
+        assert('*other*' not in recv)
+
+        # Totals cover at least what this peer has exchanged.
+        totals = self.nodes[0].getnettotals()
+        for msg, n in sent.items():
+            assert(totals['totalbytessent_per_msg'][msg] >= n)
+        for msg, n in recv.items():
+            assert(totals['totalbytesrecv_per_msg'][msg] >= n)
+
+        # A 1 MiB target is below the buffer kept for relaying new blocks,
+        # so historical blocks are not served.
+        target = totals['uploadtarget']
+        assert_equal(target['timeframe'], 2 * 60 * 60)
+        assert_equal(target['target'], 1024 * 1024)
+        assert_equal(target['serve_historical_blocks'], False)
+        assert(target['time_left_in_cycle'] <= 2 * 60 * 60)
+
+        # Without a target nothing is limited.
+        target = self.nodes[1].getnettotals()['uploadtarget']
+        assert_equal(target['target'], 0)
+        assert_equal(target['target_reached'], False)
+        assert_equal(target['serve_historical_blocks'], True)
+        assert_equal(target['bytes_left_in_cycle'], 0)
+        assert_equal(target['time_left_in_cycle'], 0)
+
+if __name__ == '__main__':
+    NetTotalsTest().main()
@@ -216,6 +216,9 @@ case "$1" in
             listunspent)
                 zcash_rpc zcbenchmark listunspent 10
                 ;;
+            checkqueue)
+                zcash_rpc zcbenchmark checkqueue 10 "${@:3}"
+                ;;
             *)
                 zcashd_stop
                 echo "Bad arguments to time."
@@ -6,12 +6,65 @@
 
 #include <hash.h>
 #include <uint256.h>
+#include <support/cleanse.h>
+#include <utilstrencodings.h>
 
 #include <assert.h>
+#include <stdint.h>
 #include <string.h>
 
 /** All alphanumeric characters except for "0", "I", "O", and "l" */
 static const char* pszBase58 = "123456789ABCDEFGHJKLMNPQRSTUVWXYZabcdefghijkmnopqrstuvwxyz";
+static const int8_t mapBase58[256] = {
+    -1,-1,-1,-1,-1,-1,-1,-1, -1,-1,-1,-1,-1,-1,-1,-1,
+    -1,-1,-1,-1,-1,-1,-1,-1, -1,-1,-1,-1,-1,-1,-1,-1,
+    -1,-1,-1,-1,-1,-1,-1,-1, -1,-1,-1,-1,-1,-1,-1,-1,
+    -1, 0, 1, 2, 3, 4, 5, 6,  7, 8,-1,-1,-1,-1,-1,-1,
+    -1, 9,10,11,12,13,14,15, 16,-1,17,18,19,20,21,-1,
+    22,23,24,25,26,27,28,29, 30,31,32,-1,-1,-1,-1,-1,
+    -1,33,34,35,36,37,38,39, 40,41,42,43,-1,44,45,46,
+    47,48,49,50,51,52,53,54, 55,56,57,-1,-1,-1,-1,-1,
+    -1,-1,-1,-1,-1,-1,-1,-1, -1,-1,-1,-1,-1,-1,-1,-1,
+    -1,-1,-1,-1,-1,-1,-1,-1, -1,-1,-1,-1,-1,-1,-1,-1,
+    -1,-1,-1,-1,-1,-1,-1,-1, -1,-1,-1,-1,-1,-1,-1,-1,
+    -1,-1,-1,-1,-1,-1,-1,-1, -1,-1,-1,-1,-1,-1,-1,-1,
+    -1,-1,-1,-1,-1,-1,-1,-1, -1,-1,-1,-1,-1,-1,-1,-1,
+    -1,-1,-1,-1,-1,-1,-1,-1, -1,-1,-1,-1,-1,-1,-1,-1,
+    -1,-1,-1,-1,-1,-1,-1,-1, -1,-1,-1,-1,-1,-1,-1,-1,
+    -1,-1,-1,-1,-1,-1,-1,-1, -1,-1,-1,-1,-1,-1,-1,-1,
+};
+
+/**
+ * The conversions below work on 32-bit limbs instead of single digits: the
+ * encoder keeps its result in base 58^5 and consumes four input bytes per
+ * step, and the decoder keeps its result in base 2^32 and consumes five
+ * base58 digits per step. Both are still quadratic in the length, but do
+ * about twenty times fewer multiplications than digit-by-digit conversion,
+ * and need no heap allocation for inputs the size of keys and addresses.
+ */
+static const uint32_t BASE58_POW5 = 58 * 58 * 58 * 58 * 58;
+
+/** Limb buffer on the stack for typical sizes, and on the heap otherwise. */
+class CLimbBuffer
+{
+private:
+    uint32_t stackLimbs[32];
+    std::vector<uint32_t> heapLimbs;
+    uint32_t* limbs;
+
+public:
+    CLimbBuffer(size_t n)
+    {
+        if (n <= ARRAYLEN(stackLimbs)) {
+            limbs = stackLimbs;
+        } else {
+            heapLimbs.resize(n);
+            limbs = heapLimbs.data();
+        }
+    }
+
+    uint32_t& operator[](size_t i) { return limbs[i]; }
+};
 
 bool DecodeBase58(const char* psz, std::vector<unsigned char>& vch)
 {
@@ -24,38 +77,48 @@ bool DecodeBase58(const char* psz, std::vector<unsigned char>& vch)
         zeroes++;
         psz++;
     }
-    // Allocate enough space in big-endian base256 representation.
-    std::vector<unsigned char> b256(strlen(psz) * 733 / 1000 + 1); // log(58) / log(256), rounded up.
-    // Process the characters.
+    // Allocate enough little-endian base 2^32 limbs.
+    CLimbBuffer limbs(strlen(psz) * 733 / 4000 + 1); // log(58) / log(2^32), rounded up.
+    size_t nLimbs = 0;
+    // Process the characters, up to five at a time.
     while (*psz && !isspace(*psz)) {
-        // Decode base58 character
-        const char* ch = strchr(pszBase58, *psz);
-        if (ch == NULL)
-            return false;
-        // Apply "b256 = b256 * 58 + ch".
-        int carry = ch - pszBase58;
-        for (std::vector<unsigned char>::reverse_iterator it = b256.rbegin(); it != b256.rend(); it++) {
-            carry += 58 * (*it);
-            *it = carry % 256;
-            carry /= 256;
+        uint64_t carry = 0;
+        uint64_t mul = 1;
+        for (int i = 0; i < 5 && *psz && !isspace(*psz); i++, psz++) {
+            int digit = mapBase58[(uint8_t)*psz];
+            if (digit == -1)
+                return false;
+            carry = carry * 58 + digit;
+            mul *= 58;
+        }
+        // Apply "limbs = limbs * mul + carry".
+        for (size_t i = 0; i < nLimbs; i++) {
+            carry += limbs[i] * mul;
+            limbs[i] = (uint32_t)carry;
+            carry >>= 32;
+        }
+        while (carry) {
+            limbs[nLimbs++] = (uint32_t)carry;
+            carry >>= 32;
         }
-        assert(carry == 0);
-        psz++;
     }
     // Skip trailing spaces.
     while (isspace(*psz))
         psz++;
     if (*psz != 0)
         return false;
-    // Skip leading zeroes in b256.
-    std::vector<unsigned char>::iterator it = b256.begin();
-    while (it != b256.end() && *it == 0)
-        it++;
-    // Copy result into output vector.
-    vch.reserve(zeroes + (b256.end() - it));
-    vch.assign(zeroes, 0x00);
-    while (it != b256.end())
-        vch.push_back(*(it++));
+    // Copy result into output vector, skipping the leading zero bytes of the top limb.
+    int nTopBytes = 0;
+    if (nLimbs > 0) {
+        for (uint32_t top = limbs[nLimbs - 1]; top; top >>= 8)
+            nTopBytes++;
+    }
+    vch.assign(zeroes + (nLimbs > 0 ? nLimbs * 4 - 4 + nTopBytes : 0), 0x00);
+    std::vector<unsigned char>::iterator it = vch.begin() + zeroes;
+    for (size_t i = nLimbs; i-- > 0;) {
+        for (int shift = (i == nLimbs - 1 ? nTopBytes : 4) * 8 - 8; shift >= 0; shift -= 8)
+            *(it++) = limbs[i] >> shift;
+    }
     return true;
 }
 
@@ -67,30 +130,48 @@ std::string EncodeBase58(const unsigned char* pbegin, const unsigned char* pend)
         pbegin++;
         zeroes++;
     }
-    // Allocate enough space in big-endian base58 representation.
-    std::vector<unsigned char> b58((pend - pbegin) * 138 / 100 + 1); // log(256) / log(58), rounded up.
-    // Process the bytes.
+    // Allocate enough little-endian base 58^5 limbs.
+    CLimbBuffer limbs((pend - pbegin) * 138 / 500 + 1); // log(256) / log(58^5), rounded up.
+    size_t nLimbs = 0;
+    // Process the bytes, up to four at a time, so that each step ends on a
+    // multiple of four from the end.
     while (pbegin != pend) {
-        int carry = *pbegin;
-        // Apply "b58 = b58 * 256 + ch".
-        for (std::vector<unsigned char>::reverse_iterator it = b58.rbegin(); it != b58.rend(); it++) {
-            carry += 256 * (*it);
-            *it = carry % 58;
-            carry /= 58;
+        int nBytes = (pend - pbegin) % 4;
+        if (nBytes == 0)
+            nBytes = 4;
+        uint64_t carry = 0;
+        for (int i = 0; i < nBytes; i++)
+            carry = (carry << 8) | *(pbegin++);
+        // Apply "limbs = limbs * 256^nBytes + carry".
+        for (size_t i = 0; i < nLimbs; i++) {
+            carry += (uint64_t)limbs[i] << (8 * nBytes);
+            limbs[i] = carry % BASE58_POW5;
+            carry /= BASE58_POW5;
+        }
+        while (carry) {
+            limbs[nLimbs++] = carry % BASE58_POW5;
+            carry /= BASE58_POW5;
         }
-        assert(carry == 0);
-        pbegin++;
     }
-    // Skip leading zeroes in base58 result.
-    std::vector<unsigned char>::iterator it = b58.begin();
-    while (it != b58.end() && *it == 0)
-        it++;
-    // Translate the result into a string.
+    // Translate the result into a string, skipping the leading zeroes of the
+    // top limb.
     std::string str;
-    str.reserve(zeroes + (b58.end() - it));
+    str.reserve(zeroes + nLimbs * 5);
     str.assign(zeroes, '1');
-    while (it != b58.end())
-        str += pszBase58[*(it++)];
+    char digits[5];
+    for (size_t i = nLimbs; i-- > 0;) {
+        uint32_t limb = limbs[i];
+        for (int j = 4; j >= 0; j--) {
+            digits[j] = pszBase58[limb % 58];
+            limb /= 58;
+        }
+        int nSkip = 0;
+        if (i == nLimbs - 1) {
+            while (digits[nSkip] == '1')
+                nSkip++;
+        }
+        str.append(digits + nSkip, 5 - nSkip);
+    }
     return str;
 }
 
@@ -104,13 +185,29 @@ bool DecodeBase58(const std::string& str, std::vector<unsigned char>& vchRet)
     return DecodeBase58(str.c_str(), vchRet);
 }
 
-std::string EncodeBase58Check(const std::vector<unsigned char>& vchIn)
+std::string EncodeBase58Check(const unsigned char* pbegin, const unsigned char* pend)
 {
     // add 4-byte hash check to the end
-    std::vector<unsigned char> vch(vchIn);
-    uint256 hash = Hash(vch.begin(), vch.end());
-    vch.insert(vch.end(), (unsigned char*)&hash, (unsigned char*)&hash + 4);
-    return EncodeBase58(vch);
+    uint256 hash = Hash(pbegin, pend);
+    size_t size = pend - pbegin;
+    unsigned char stackBuf[128];
+    std::vector<unsigned char> heapBuf;
+    unsigned char* buf = stackBuf;
+    if (size + 4 > sizeof(stackBuf)) {
+        heapBuf.resize(size + 4);
+        buf = heapBuf.data();
+    }
+    if (size > 0)
+        memcpy(buf, pbegin, size);
+    memcpy(buf + size, hash.begin(), 4);
+    std::string ret = EncodeBase58(buf, buf + size + 4);
+    memory_cleanse(buf, size + 4);
+    return ret;
+}
+
+std::string EncodeBase58Check(const std::vector<unsigned char>& vchIn)
+{
+    return EncodeBase58Check(vchIn.data(), vchIn.data() + vchIn.size());
 }
 
 bool DecodeBase58Check(const char* psz, std::vector<unsigned char>& vchRet)
@@ -24,17 +24,13 @@ const int8_t CHARSET_REV[128] = {
      1,  0,  3, 16, 11, 28, 12, 14,  6,  4,  2, -1, -1, -1, -1, -1
 };
 
-/** Concatenate two byte arrays. */
-data Cat(data x, const data& y)
-{
-    x.insert(x.end(), y.begin(), y.end());
-    return x;
-}
-
-/** This function will compute what 6 5-bit values to XOR into the last 6 input values, in order to
+/** PolyMod computes what 6 5-bit values to XOR into the last 6 input values, in order to
  *  make the checksum 0. These 6 values are packed together in a single 30-bit integer. The higher
- *  bits correspond to earlier values. */
-uint32_t PolyMod(const data& v)
+ *  bits correspond to earlier values. It is computed one value at a time, starting from
+ *  POLYMOD_INIT, with PolyModStep, so that inputs never have to be concatenated. */
+const uint32_t POLYMOD_INIT = 1;
+
+inline uint32_t PolyModStep(uint32_t c, uint8_t v_i)
 {
     // The input is interpreted as a list of coefficients of a polynomial over F = GF(32), with an
     // implicit 1 in front. If the input is [v0,v1,v2,v3,v4], that polynomial is v(x) =
@@ -60,9 +56,8 @@ uint32_t PolyMod(const data& v)
     // polynomial constructed from just the values of v that were processed so far, mod g(x). In
     // the above example, `c` initially corresponds to 1 mod (x), and after processing 2 inputs of
     // v, it corresponds to x^2 + v0*x + v1 mod g(x). As 1 mod g(x) = 1, that is the starting value
-    // for `c`.
-    uint32_t c = 1;
-    for (auto v_i : v) {
+    // for `c` (POLYMOD_INIT).
+    {
         // We want to update `c` to correspond to a polynomial with one extra term. If the initial
         // value of `c` consists of the coefficients of c(x) = f(x) mod g(x), we modify it to
         // correspond to c'(x) = (f(x) * x + v_i) mod g(x), where v_i is the next input to
@@ -99,43 +94,19 @@ inline unsigned char LowerCase(unsigned char c)
     return (c >= 'A' && c <= 'Z') ? (c - 'A') + 'a' : c;
 }
 
-/** Expand a HRP for use in checksum computation. */
-data ExpandHRP(const std::string& hrp)
+/** Feed the expansion of a HRP into a PolyMod computation: the high bits of each character, a
+ *  zero, then the low bits of each character. */
+uint32_t PolyModHRP(const std::string& hrp)
 {
-    data ret;
-    ret.reserve(hrp.size() + 90);
-    ret.resize(hrp.size() * 2 + 1);
+    uint32_t c = POLYMOD_INIT;
     for (size_t i = 0; i < hrp.size(); ++i) {
-        unsigned char c = hrp[i];
-        ret[i] = c >> 5;
-        ret[i + hrp.size() + 1] = c & 0x1f;
+        c = PolyModStep(c, (unsigned char)hrp[i] >> 5);
     }
-    ret[hrp.size()] = 0;
-    return ret;
-}
-
-/** Verify a checksum. */
-bool VerifyChecksum(const std::string& hrp, const data& values)
-{
-    // PolyMod computes what value to xor into the final values to make the checksum 0. However,
-    // if we required that the checksum was 0, it would be the case that appending a 0 to a valid
-    // list of values would result in a new valid list. For that reason, Bech32 requires the
-    // resulting checksum to be 1 instead.
-    return PolyMod(Cat(ExpandHRP(hrp), values)) == 1;
-}
-
-/** Create a checksum. */
-data CreateChecksum(const std::string& hrp, const data& values)
-{
-    data enc = Cat(ExpandHRP(hrp), values);
-    enc.resize(enc.size() + 6); // Append 6 zeroes
-    uint32_t mod = PolyMod(enc) ^ 1; // Determine what to XOR into those 6 zeroes.
-    data ret(6);
-    for (size_t i = 0; i < 6; ++i) {
-        // Convert the 5-bit groups in mod to checksum values.
-        ret[i] = (mod >> (5 * (5 - i))) & 31;
+    c = PolyModStep(c, 0);
+    for (size_t i = 0; i < hrp.size(); ++i) {
+        c = PolyModStep(c, (unsigned char)hrp[i] & 0x1f);
     }
-    return ret;
+    return c;
 }
 
 } // namespace
@@ -145,15 +116,26 @@ namespace bech32
 
 /** Encode a Bech32 string. */
 std::string Encode(const std::string& hrp, const data& values) {
-    data checksum = CreateChecksum(hrp, values);
-    data combined = Cat(values, checksum);
-    std::string ret = hrp + '1';
-    ret.reserve(ret.size() + combined.size());
-    for (auto c : combined) {
-        if (c >= 32) {
+    uint32_t c = PolyModHRP(hrp);
+    std::string ret;
+    ret.reserve(hrp.size() + 1 + values.size() + 6);
+    ret += hrp;
+    ret += '1';
+    for (auto v : values) {
+        if (v >= 32) {
             return "";
         }
-        ret += CHARSET[c];
+        c = PolyModStep(c, v);
+        ret += CHARSET[v];
+    }
+    // Determine what to XOR into 6 appended zeroes, and append that as the checksum.
+    for (size_t i = 0; i < 6; ++i) {
+        c = PolyModStep(c, 0);
+    }
+    uint32_t mod = c ^ 1;
+    for (size_t i = 0; i < 6; ++i) {
+        // Convert the 5-bit groups in mod to checksum values.
+        ret += CHARSET[(mod >> (5 * (5 - i))) & 31];
     }
     return ret;
 }
@@ -172,23 +154,30 @@ std::pair<std::string, data> Decode(const std::string& str) {
     if (str.size() > 90 || pos == str.npos || pos == 0 || pos + 7 > str.size()) {
         return {};
     }
+    std::string hrp(pos, 0);
+    for (size_t i = 0; i < pos; ++i) {
+        hrp[i] = LowerCase(str[i]);
+    }
+    uint32_t c = PolyModHRP(hrp);
     data values(str.size() - 1 - pos);
     for (size_t i = 0; i < str.size() - 1 - pos; ++i) {
-        unsigned char c = str[i + pos + 1];
-        int8_t rev = (c < 33 || c > 126) ? -1 : CHARSET_REV[c];
+        unsigned char ch = str[i + pos + 1];
+        int8_t rev = (ch < 33 || ch > 126) ? -1 : CHARSET_REV[ch];
         if (rev == -1) {
             return {};
         }
         values[i] = rev;
+        c = PolyModStep(c, rev);
     }
-    std::string hrp;
-    for (size_t i = 0; i < pos; ++i) {
-        hrp += LowerCase(str[i]);
-    }
-    if (!VerifyChecksum(hrp, values)) {
+    // PolyMod computes what value to xor into the final values to make the checksum 0. However,
+    // if we required that the checksum was 0, it would be the case that appending a 0 to a valid
+    // list of values would result in a new valid list. For that reason, Bech32 requires the
+    // resulting checksum to be 1 instead.
+    if (c != 1) {
         return {};
     }
-    return {hrp, data(values.begin(), values.end() - 6)};
+    values.resize(values.size() - 6);
+    return {std::move(hrp), std::move(values)};
 }
 
 } // namespace bech32
@@ -0,0 +1,246 @@
+// Copyright (c) 2018 The Zcash developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "blockfilter.h"
+
+#include "crypto/common.h"
+#include "hash.h"
+#include "primitives/block.h"
+#include "script/script.h"
+#include "streams.h"
+#include "version.h"
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+namespace {
+
+/** Appends bits to a byte vector, most significant bit first. */
+class BitWriter
+{
+private:
+    std::vector<unsigned char>& vch;
+    unsigned char nBuffer;
+    int nBits;
+
+public:
+    BitWriter(std::vector<unsigned char>& vchIn) : vch(vchIn), nBuffer(0), nBits(0) {}
+
+    void Write(uint64_t nValue, int nCount)
+    {
+        while (nCount > 0) {
+            int nChunk = std::min(8 - nBits, nCount);
+            nBuffer |= ((nValue >> (nCount - nChunk)) & ((1U << nChunk) - 1)) << (8 - nBits - nChunk);
+            nBits += nChunk;
+            nCount -= nChunk;
+            if (nBits == 8)
+                Flush();
+        }
+    }
+
+    /** Writes out a partial byte, padded with zeros. */
+    void Flush()
+    {
+        if (nBits == 0)
+            return;
+        vch.push_back(nBuffer);
+        nBuffer = 0;
+        nBits = 0;
+    }
+};
+
+class BitReader
+{
+private:
+    const unsigned char* p;
+    const unsigned char* pend;
+    int nBits;
+
+public:
+    BitReader(const unsigned char* pbegin, const unsigned char* pendIn) : p(pbegin), pend(pendIn), nBits(0) {}
+
+    uint64_t Read(int nCount)
+    {
+        uint64_t nValue = 0;
+        while (nCount > 0) {
+            if (p == pend)
+                throw std::ios_base::failure("BitReader::Read(): end of data");
+            int nChunk = std::min(8 - nBits, nCount);
+            nValue = (nValue << nChunk) | ((*p >> (8 - nBits - nChunk)) & ((1U << nChunk) - 1));
+            nBits += nChunk;
+            nCount -= nChunk;
+            if (nBits == 8) {
+                p++;
+                nBits = 0;
+            }
+        }
+        return nValue;
+    }
+};
+
+void GolombRiceEncode(BitWriter& writer, uint8_t P, uint64_t x)
+{
+    // The quotient is written in unary, terminated by a zero bit
+    uint64_t q = x >> P;
+    while (q > 0) {
+        int nCount = std::min<uint64_t>(q, 64);
+        writer.Write(std::numeric_limits<uint64_t>::max(), nCount);
+        q -= nCount;
+    }
+    writer.Write(0, 1);
+    writer.Write(x, P);
+}
+
+uint64_t GolombRiceDecode(BitReader& reader, uint8_t P)
+{
+    uint64_t q = 0;
+    while (reader.Read(1) == 1)
+        q++;
+    return (q << P) + reader.Read(P);
+}
+
+/** Maps x uniformly into [0, n), as (x * n) / 2^64. */
+uint64_t MapIntoRange(uint64_t x, uint64_t n)
+{
+#ifdef __SIZEOF_INT128__
+    return (uint64_t)(((unsigned __int128)x * n) >> 64);
+#else
+    uint64_t a = x >> 32, b = x & 0xffffffff;
+    uint64_t c = n >> 32, d = n & 0xffffffff;
+    uint64_t ac = a * c, ad = a * d, bc = b * c, bd = b * d;
+    uint64_t mid34 = (bd >> 32) + (bc & 0xffffffff) + (ad & 0xffffffff);
+    return ac + (bc >> 32) + (ad >> 32) + (mid34 >> 32);
+#endif
+}
+
+}
+
+GCSFilter::GCSFilter(uint64_t nSipK0In, uint64_t nSipK1In) :
+    GCSFilter(nSipK0In, nSipK1In, ElementSet())
+{
+}
+
+GCSFilter::GCSFilter(uint64_t nSipK0In, uint64_t nSipK1In, const std::vector<unsigned char>& vchEncodedIn) :
+    nSipK0(nSipK0In), nSipK1(nSipK1In), vchEncoded(vchEncodedIn)
+{
+    CSpanReader s(SER_NETWORK, PROTOCOL_VERSION, vchEncoded.data(), vchEncoded.data() + vchEncoded.size());
+    uint64_t nCount = ReadCompactSize(s);
+    if (nCount > std::numeric_limits<uint32_t>::max())
+        throw std::ios_base::failure("GCSFilter: element count too large");
+    nN = nCount;
+    nF = (uint64_t)nN * M;
+}
+
+GCSFilter::GCSFilter(uint64_t nSipK0In, uint64_t nSipK1In, const ElementSet& elements) :
+    nSipK0(nSipK0In), nSipK1(nSipK1In)
+{
+    if (elements.size() > std::numeric_limits<uint32_t>::max())
+        throw std::invalid_argument("GCSFilter: too many elements");
+    nN = elements.size();
+    nF = (uint64_t)nN * M;
+
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    WriteCompactSize(ss, nN);
+    vchEncoded.assign(ss.begin(), ss.end());
+
+    BitWriter writer(vchEncoded);
+    uint64_t nLast = 0;
+    for (uint64_t nValue : BuildHashedSet(elements)) {
+        GolombRiceEncode(writer, P, nValue - nLast);
+        nLast = nValue;
+    }
+    writer.Flush();
+}
+
+uint64_t GCSFilter::HashToRange(const Element& element) const
+{
+    uint64_t nHash = CSipHasher(nSipK0, nSipK1).Write(element.data(), element.size()).Finalize();
+    return MapIntoRange(nHash, nF);
+}
+
+std::vector<uint64_t> GCSFilter::BuildHashedSet(const ElementSet& elements) const
+{
+    std::vector<uint64_t> vHashed;
+    vHashed.reserve(elements.size());
+    for (const Element& element : elements)
+        vHashed.push_back(HashToRange(element));
+    std::sort(vHashed.begin(), vHashed.end());
+    return vHashed;
+}
+
+bool GCSFilter::MatchInternal(const std::vector<uint64_t>& vQuery) const
+{
+    CSpanReader s(SER_NETWORK, PROTOCOL_VERSION, vchEncoded.data(), vchEncoded.data() + vchEncoded.size());
+    ReadCompactSize(s);
+    BitReader reader(s.data(), s.data() + s.size());
+
+    std::vector<uint64_t>::const_iterator it = vQuery.begin();
+    uint64_t nValue = 0;
+    for (uint32_t i = 0; i < nN && it != vQuery.end(); i++) {
+        nValue += GolombRiceDecode(reader, P);
+        while (it != vQuery.end() && *it < nValue)
+            ++it;
+        if (it != vQuery.end() && *it == nValue)
+            return true;
+    }
+    return false;
+}
+
+bool GCSFilter::Match(const Element& element) const
+{
+    if (nN == 0)
+        return false;
+    return MatchInternal(std::vector<uint64_t>(1, HashToRange(element)));
+}
+
+bool GCSFilter::MatchAny(const ElementSet& elements) const
+{
+    if (nN == 0 || elements.empty())
+        return false;
+    return MatchInternal(BuildHashedSet(elements));
+}
+
+static GCSFilter::ElementSet BlockFilterElements(const CBlock& block)
+{
+    GCSFilter::ElementSet elements;
+    for (const CTransaction& tx : block.vtx) {
+        for (const CTxOut& txout : tx.vout) {
+            const CScript& script = txout.scriptPubKey;
+            if (script.empty() || script[0] == OP_RETURN)
+                continue;
+            elements.insert(BlockFilter::ScriptElement(script));
+        }
+        if (tx.IsCoinBase())
+            continue;
+        for (const CTxIn& txin : tx.vin)
+            elements.insert(BlockFilter::OutPointElement(txin.prevout));
+    }
+    return elements;
+}
+
+BlockFilter::BlockFilter(const CBlock& block) :
+    hashBlock(block.GetHash()),
+    filter(ReadLE64(hashBlock.begin()), ReadLE64(hashBlock.begin() + 8), BlockFilterElements(block))
+{
+}
+
+BlockFilter::BlockFilter(const uint256& hashBlockIn, const std::vector<unsigned char>& vchEncoded) :
+    hashBlock(hashBlockIn),
+    filter(ReadLE64(hashBlock.begin()), ReadLE64(hashBlock.begin() + 8), vchEncoded)
+{
+}
+
+GCSFilter::Element BlockFilter::ScriptElement(const CScript& script)
+{
+    return GCSFilter::Element(script.begin(), script.end());
+}
+
+GCSFilter::Element BlockFilter::OutPointElement(const COutPoint& outpoint)
+{
+    GCSFilter::Element element(outpoint.hash.begin(), outpoint.hash.end());
+    element.resize(element.size() + 4);
+    WriteLE32(&element[32], outpoint.n);
+    return element;
+}
@@ -0,0 +1,105 @@
+// Copyright (c) 2018 The Zcash developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef ZCASH_BLOCKFILTER_H
+#define ZCASH_BLOCKFILTER_H
+
+#include "uint256.h"
+
+#include <set>
+#include <stdint.h>
+#include <vector>
+
+class CBlock;
+class COutPoint;
+class CScript;
+
+/**
+ * A Golomb-coded set: a compact, probabilistic encoding of a set of byte
+ * strings that supports membership queries with a false positive rate of
+ * about 1/M and no false negatives.
+ *
+ * Elements are hashed with SipHash into [0, N * M), sorted, and the
+ * differences between consecutive values are Golomb-Rice coded with
+ * parameter P. The encoding is the CompactSize element count followed by
+ * the bit stream, as in BIP 158. The block filters built on it are not BIP
+ * 158 filters, though; see BlockFilter.
+ */
+class GCSFilter
+{
+public:
+    typedef std::vector<unsigned char> Element;
+    typedef std::set<Element> ElementSet;
+
+    static const uint8_t P = 19;
+    static const uint32_t M = 784931;
+
+private:
+    uint64_t nSipK0;
+    uint64_t nSipK1;
+    uint32_t nN;
+    uint64_t nF;
+    std::vector<unsigned char> vchEncoded;
+
+    uint64_t HashToRange(const Element& element) const;
+    std::vector<uint64_t> BuildHashedSet(const ElementSet& elements) const;
+
+    /** Checks the filter against a sorted list of hashed query values. */
+    bool MatchInternal(const std::vector<uint64_t>& vQuery) const;
+
+public:
+    /** Constructs an empty filter. */
+    GCSFilter(uint64_t nSipK0In = 0, uint64_t nSipK1In = 0);
+
+    /** Constructs a filter from its encoding. Throws std::ios_base::failure
+     *  if the element count can't be read. */
+    GCSFilter(uint64_t nSipK0In, uint64_t nSipK1In, const std::vector<unsigned char>& vchEncodedIn);
+
+    /** Builds a filter holding the given elements. */
+    GCSFilter(uint64_t nSipK0In, uint64_t nSipK1In, const ElementSet& elements);
+
+    uint32_t GetN() const { return nN; }
+    const std::vector<unsigned char>& GetEncoded() const { return vchEncoded; }
+
+    /** Checks whether the element may be in the set. A malformed encoding
+     *  throws std::ios_base::failure. */
+    bool Match(const Element& element) const;
+
+    /** Checks whether any of the elements may be in the set. This is much
+     *  faster than calling Match for each of them. */
+    bool MatchAny(const ElementSet& elements) const;
+};
+
+/**
+ * The transparent filter of a block. It holds every output script the block
+ * creates, other than empty and OP_RETURN scripts, and every outpoint it
+ * spends. BIP 158 filters hold the scripts of the spent outputs instead,
+ * which would need the undo data to build; a wallet knows the outpoints of
+ * its own outputs, so it can match those. The filter is keyed by the block hash, so that a wallet's query
+ * collides with a different set of false positives in each block.
+ */
+class BlockFilter
+{
+private:
+    uint256 hashBlock;
+    GCSFilter filter;
+
+public:
+    BlockFilter() {}
+
+    /** Builds the filter of a block. */
+    explicit BlockFilter(const CBlock& block);
+
+    /** Reconstructs the filter of a block from its encoding. */
+    BlockFilter(const uint256& hashBlockIn, const std::vector<unsigned char>& vchEncoded);
+
+    const uint256& GetBlockHash() const { return hashBlock; }
+    const GCSFilter& GetFilter() const { return filter; }
+    const std::vector<unsigned char>& GetEncoded() const { return filter.GetEncoded(); }
+
+    static GCSFilter::Element ScriptElement(const CScript& script);
+    static GCSFilter::Element OutPointElement(const COutPoint& outpoint);
+};
+
+#endif // ZCASH_BLOCKFILTER_H
@@ -6,9 +6,12 @@
 #define BITCOIN_CHECKQUEUE_H
 
 #include <algorithm>
+#include <atomic>
+#include <deque>
 #include <vector>
 
 #include <boost/foreach.hpp>
+#include <boost/scoped_array.hpp>
 #include <boost/thread/condition_variable.hpp>
 #include <boost/thread/locks.hpp>
 #include <boost/thread/mutex.hpp>
@@ -16,6 +19,23 @@
 template <typename T>
 class CCheckQueueControl;
 
+/**
+ * Runs a batch of checks taken from a CCheckQueue, stopping at the first
+ * failure. Check types whose checks are cheaper to run together can provide
+ * an overload for std::vector<T>&, which is found by argument-dependent lookup.
+ */
+template <typename T>
+bool RunChecks(std::vector<T>& vChecks)
+{
+    BOOST_FOREACH (T& check, vChecks)
+        if (!check())
+            return false;
+    return true;
+}
+
+/** The maximum number of threads (including the master) that can work on one CCheckQueue. */
+static const int MAX_CHECKQUEUE_PARTICIPANTS = 128;
+
 /** 
  * Queue for verifications that have to be performed.
   * The verifications are represented by a type T, which must provide an
@@ -25,12 +45,25 @@ class CCheckQueueControl;
   * onto the queue, where they are processed by N-1 worker threads. When
   * the master is done adding work, it temporarily joins the worker pool
   * as an N'th worker, until all jobs are done.
+  *
+  * Every participant owns a deque of pending checks guarded by its own
+  * mutex. The master spreads added checks over all deques, participants
+  * take batches from the back of their own deque, and steal from the front
+  * of other participants' deques when their own runs dry. The shared mutex
+  * is only used to sleep and wake up, so it is not contended while there
+  * is work to do.
   */
 template <typename T>
 class CCheckQueue
 {
 private:
-    //! Mutex to protect the inner state
+    //! Pending checks owned by one participant. Slot 0 belongs to the master.
+    struct Slot {
+        boost::mutex mutex;
+        std::deque<T> checks;
+    };
+
+    //! Mutex protecting the sleep/wake-up protocol and worker registration
     boost::mutex mutex;
 
     //! Worker threads block on this when out of work
@@ -39,96 +72,133 @@ private:
     //! Master thread blocks on this when out of work
     boost::condition_variable condMaster;
 
-    //! The queue of elements to be processed.
-    //! As the order of booleans doesn't matter, it is used as a LIFO (stack)
-    std::vector<T> queue;
+    //! Per-participant queues. Only the first nSlots are in use.
+    boost::scoped_array<Slot> slots;
 
-    //! The number of workers (including the master) that are idle.
-    int nIdle;
+    //! The number of slots in use (the master plus registered workers).
+    std::atomic<int> nSlots;
 
-    //! The total number of workers (including the master).
-    int nTotal;
+    //! The number of workers (excluding the master) that are idle.
+    int nIdle;
 
     //! The temporary evaluation result.
-    bool fAllOk;
+    std::atomic<bool> fAllOk;
 
     /**
      * Number of verifications that haven't completed yet.
      * This includes elements that are no longer queued, but still in the
-     * worker's own batches.
+     * participants' own batches.
      */
-    unsigned int nTodo;
+    std::atomic<unsigned int> nTodo;
 
-    //! Whether we're shutting down.
-    bool fQuit;
+    //! Number of verifications still sitting in one of the slots.
+    std::atomic<unsigned int> nQueued;
 
     //! The maximum number of elements to be processed in one batch
     unsigned int nBatchSize;
 
+    //! Slot that receives the next added check (only used by the master).
+    int nNextSlot;
+
+    int RegisterWorker()
+    {
+        boost::unique_lock<boost::mutex> lock(mutex);
+        int nSlot = nSlots.load();
+        assert(nSlot < MAX_CHECKQUEUE_PARTICIPANTS);
+        nSlots++;
+        return nSlot;
+    }
+
+    //! Move up to nMax checks from slot into vChecks, from the back (own slot) or front (stealing).
+    unsigned int Take(Slot& slot, std::vector<T>& vChecks, bool fSteal)
+    {
+        boost::unique_lock<boost::mutex> lock(slot.mutex);
+        unsigned int nSize = slot.checks.size();
+        if (nSize == 0)
+            return 0;
+        // Decide how many work units to process now.
+        // * Take at most half of what is there (rounded up), so other participants
+        //   can steal the rest and all of them finish approximately simultaneously.
+        // * Don't do batches smaller than 1 (duh), or larger than nBatchSize.
+        unsigned int nNow = std::max(1U, std::min(nBatchSize, (nSize + 1) / 2));
+        vChecks.resize(nNow);
+        for (unsigned int i = 0; i < nNow; i++) {
+            // Swap jobs out of the slot instead of copying, to keep the lock short.
+            if (fSteal) {
+                vChecks[i].swap(slot.checks.front());
+                slot.checks.pop_front();
+            } else {
+                vChecks[i].swap(slot.checks.back());
+                slot.checks.pop_back();
+            }
+        }
+        nQueued -= nNow;
+        return nNow;
+    }
+
+    //! Get a batch from our own slot, or steal one from another participant.
+    unsigned int Fetch(int nOwn, std::vector<T>& vChecks)
+    {
+        unsigned int nNow = Take(slots[nOwn], vChecks, false);
+        if (nNow)
+            return nNow;
+        int nTotal = nSlots.load();
+        for (int i = 1; i < nTotal; i++) {
+            nNow = Take(slots[(nOwn + i) % nTotal], vChecks, true);
+            if (nNow)
+                return nNow;
+        }
+        return 0;
+    }
+
     /** Internal function that does bulk of the verification work. */
     bool Loop(bool fMaster = false)
     {
-        boost::condition_variable& cond = fMaster ? condMaster : condWorker;
+        int nOwn = fMaster ? 0 : RegisterWorker();
         std::vector<T> vChecks;
         vChecks.reserve(nBatchSize);
-        unsigned int nNow = 0;
-        bool fOk = true;
         do {
-            {
+            unsigned int nNow = Fetch(nOwn, vChecks);
+            if (nNow == 0) {
                 boost::unique_lock<boost::mutex> lock(mutex);
-                // first do the clean-up of the previous loop run (allowing us to do it in the same critsect)
-                if (nNow) {
-                    fAllOk &= fOk;
-                    nTodo -= nNow;
-                    if (nTodo == 0 && !fMaster)
-                        // We processed the last element; inform the master it can exit and return the result
-                        condMaster.notify_one();
-                } else {
-                    // first iteration
-                    nTotal++;
-                }
-                // logically, the do loop starts here
-                while (queue.empty()) {
-                    if ((fMaster || fQuit) && nTodo == 0) {
-                        nTotal--;
+                if (fMaster) {
+                    while (nQueued == 0 && nTodo != 0)
+                        condMaster.wait(lock);
+                    if (nTodo == 0) {
                         bool fRet = fAllOk;
                         // reset the status for new work later
-                        if (fMaster)
-                            fAllOk = true;
+                        fAllOk = true;
                         // return the current status
                         return fRet;
                     }
-                    nIdle++;
-                    cond.wait(lock); // wait
-                    nIdle--;
-                }
-                // Decide how many work units to process now.
-                // * Do not try to do everything at once, but aim for increasingly smaller batches so
-                //   all workers finish approximately simultaneously.
-                // * Try to account for idle jobs which will instantly start helping.
-                // * Don't do batches smaller than 1 (duh), or larger than nBatchSize.
-                nNow = std::max(1U, std::min(nBatchSize, (unsigned int)queue.size() / (nTotal + nIdle + 1)));
-                vChecks.resize(nNow);
-                for (unsigned int i = 0; i < nNow; i++) {
-                    // We want the lock on the mutex to be as short as possible, so swap jobs from the global
-                    // queue to the local batch vector instead of copying.
-                    vChecks[i].swap(queue.back());
-                    queue.pop_back();
+                } else {
+                    while (nQueued == 0) {
+                        nIdle++;
+                        condWorker.wait(lock); // wait
+                        nIdle--;
+                    }
                 }
-                // Check whether we need to do work at all
-                fOk = fAllOk;
+                continue;
             }
+            // Check whether we need to do work at all
+            bool fOk = fAllOk;
             // execute work
-            BOOST_FOREACH (T& check, vChecks)
-                if (fOk)
-                    fOk = check();
+            if (fOk)
+                fOk = RunChecks(vChecks);
             vChecks.clear();
+            if (!fOk)
+                fAllOk = false;
+            if (nTodo.fetch_sub(nNow) == nNow && !fMaster) {
+                // We processed the last element; inform the master it can exit and return the result
+                boost::unique_lock<boost::mutex> lock(mutex);
+                condMaster.notify_one();
+            }
         } while (true);
     }
 
 public:
     //! Create a new check queue
-    CCheckQueue(unsigned int nBatchSizeIn) : nIdle(0), nTotal(0), fAllOk(true), nTodo(0), fQuit(false), nBatchSize(nBatchSizeIn) {}
+    CCheckQueue(unsigned int nBatchSizeIn) : slots(new Slot[MAX_CHECKQUEUE_PARTICIPANTS]), nSlots(1), nIdle(0), fAllOk(true), nTodo(0), nQueued(0), nBatchSize(nBatchSizeIn), nNextSlot(0) {}
 
     //! Worker thread
     void Thread()
@@ -145,15 +215,35 @@ public:
     //! Add a batch of checks to the queue
     void Add(std::vector<T>& vChecks)
     {
-        boost::unique_lock<boost::mutex> lock(mutex);
-        BOOST_FOREACH (T& check, vChecks) {
-            queue.push_back(T());
-            check.swap(queue.back());
-        }
+        if (vChecks.empty())
+            return;
+        // Account for the checks before they become visible, so that nTodo
+        // can't reach zero while some of them are still pending.
         nTodo += vChecks.size();
+        nQueued += vChecks.size();
+
+        // Spread the checks over the participants in runs of up to nBatchSize,
+        // continuing where the previous call left off.
+        int nTotal = nSlots.load();
+        size_t nPos = 0;
+        while (nPos < vChecks.size()) {
+            size_t nRun = std::min<size_t>(nBatchSize, vChecks.size() - nPos);
+            Slot& slot = slots[nNextSlot % nTotal];
+            nNextSlot = (nNextSlot + 1) % nTotal;
+            boost::unique_lock<boost::mutex> lock(slot.mutex);
+            for (size_t i = nPos; i < nPos + nRun; i++) {
+                slot.checks.push_back(T());
+                vChecks[i].swap(slot.checks.back());
+            }
+            nPos += nRun;
+        }
+
+        boost::unique_lock<boost::mutex> lock(mutex);
+        if (nIdle == 0)
+            return;
         if (vChecks.size() == 1)
             condWorker.notify_one();
-        else if (vChecks.size() > 1)
+        else
             condWorker.notify_all();
     }
 
@@ -164,7 +254,7 @@ public:
     bool IsIdle()
     {
         boost::unique_lock<boost::mutex> lock(mutex);
-        return (nTotal == nIdle && nTodo == 0 && fAllOk == true);
+        return (nTodo == 0 && nQueued == 0 && fAllOk == true);
     }
 
 };
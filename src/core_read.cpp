@@ -92,11 +92,11 @@ CScript ParseScript(const std::string& s)
 
 bool DecodeHexTx(CTransaction& tx, const std::string& strHexTx)
 {
-    if (!IsHex(strHexTx))
+    vector<unsigned char> txData;
+    if (!TryParseHex(strHexTx, txData))
         return false;
 
-    vector<unsigned char> txData(ParseHex(strHexTx));
-    CDataStream ssData(txData, SER_NETWORK, PROTOCOL_VERSION);
+    CSpanReader ssData(SER_NETWORK, PROTOCOL_VERSION, txData.data(), txData.data() + txData.size());
     try {
         ssData >> tx;
     }
@@ -109,11 +109,11 @@ bool DecodeHexTx(CTransaction& tx, const std::string& strHexTx)
 
 bool DecodeHexBlk(CBlock& block, const std::string& strHexBlk)
 {
-    if (!IsHex(strHexBlk))
+    std::vector<unsigned char> blockData;
+    if (!TryParseHex(strHexBlk, blockData))
         return false;
 
-    std::vector<unsigned char> blockData(ParseHex(strHexBlk));
-    CDataStream ssBlock(blockData, SER_NETWORK, PROTOCOL_VERSION);
+    CSpanReader ssBlock(SER_NETWORK, PROTOCOL_VERSION, blockData.data(), blockData.data() + blockData.size());
     try {
         ssBlock >> block;
     }
@@ -147,7 +147,8 @@ vector<unsigned char> ParseHexUV(const UniValue& v, const string& strName)
     string strHex;
     if (v.isStr())
         strHex = v.getValStr();
-    if (!IsHex(strHex))
+    vector<unsigned char> vch;
+    if (!TryParseHex(strHex, vch))
         throw runtime_error(strName+" must be hexadecimal string (not '"+strHex+"')");
-    return ParseHex(strHex);
+    return vch;
 }
@@ -119,6 +119,7 @@ string ScriptToAsmStr(const CScript& script, const bool fAttemptSighashDecode)
 string EncodeHexTx(const CTransaction& tx)
 {
     CDataStream ssTx(SER_NETWORK, PROTOCOL_VERSION);
+    ssTx.reserve(tx.GetTotalSize());
     ssTx << tx;
     return HexStr(ssTx.begin(), ssTx.end());
 }
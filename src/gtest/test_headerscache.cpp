@@ -0,0 +1,119 @@
+#include <gtest/gtest.h>
+
+#include "chain.h"
+#include "headerscache.h"
+#include "primitives/block.h"
+#include "streams.h"
+#include "version.h"
+
+static CBlockHeader MakeHeader(uint32_t nNonceSeed)
+{
+    CBlockHeader header;
+    header.nVersion = 4;
+    header.nTime = 1477641360 + nNonceSeed;
+    header.nBits = 0x1f07ffff;
+    header.nNonce = ArithToUint256(arith_uint256(nNonceSeed));
+    header.nSolution = std::vector<unsigned char>(1344, nNonceSeed & 0xff);
+    return header;
+}
+
+class HeadersCacheTest : public ::testing::Test {
+protected:
+    std::vector<CBlockHeader> headers;
+    std::vector<uint256> hashes;
+    std::vector<CBlockIndex*> chain;
+
+    virtual void SetUp() {
+        for (int i = 0; i < 20; i++) {
+            headers.push_back(MakeHeader(i));
+        }
+        hashes.resize(headers.size());
+        for (size_t i = 0; i < headers.size(); i++) {
+            if (i > 0) {
+                headers[i].hashPrevBlock = hashes[i - 1];
+            }
+            hashes[i] = headers[i].GetHash();
+            CBlockIndex* pindex = new CBlockIndex(headers[i]);
+            pindex->phashBlock = &hashes[i];
+            pindex->pprev = i > 0 ? chain[i - 1] : NULL;
+            pindex->nHeight = i;
+            chain.push_back(pindex);
+        }
+    }
+
+    virtual void TearDown() {
+        for (size_t i = 0; i < chain.size(); i++) {
+            delete chain[i];
+        }
+    }
+};
+
+TEST_F(HeadersCacheTest, EntryMatchesBlockSerialization) {
+    CHeadersCache cache(8);
+    for (size_t i = 0; i < chain.size(); i++) {
+        CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+        ss << CBlock(headers[i]);
+        std::vector<unsigned char> expected(ss.begin(), ss.end());
+        EXPECT_EQ(expected, cache.Get(chain[i]));
+        EXPECT_EQ(0, expected.back());
+    }
+    EXPECT_EQ(0u, cache.Hits());
+    EXPECT_EQ(chain.size(), cache.Misses());
+}
+
+TEST_F(HeadersCacheTest, HitsAndReplacement) {
+    CHeadersCache cache(8);
+    cache.Get(chain[3]);
+    cache.Get(chain[3]);
+    EXPECT_EQ(1u, cache.Hits());
+    EXPECT_EQ(1u, cache.Misses());
+
+    // Height 11 shares a slot with height 3.
+    cache.Get(chain[11]);
+    cache.Get(chain[3]);
+    EXPECT_EQ(1u, cache.Hits());
+    EXPECT_EQ(3u, cache.Misses());
+
+    // A different block at the same height replaces the entry.
+    CBlockHeader fork = MakeHeader(1000);
+    fork.hashPrevBlock = hashes[2];
+    uint256 forkHash = fork.GetHash();
+    CBlockIndex forkIndex(fork);
+    forkIndex.phashBlock = &forkHash;
+    forkIndex.pprev = chain[2];
+    forkIndex.nHeight = 3;
+
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << CBlock(fork);
+    EXPECT_EQ(std::vector<unsigned char>(ss.begin(), ss.end()), cache.Get(&forkIndex));
+    EXPECT_EQ(4u, cache.Misses());
+
+    cache.Clear();
+    EXPECT_EQ(0u, cache.Hits());
+    cache.Get(chain[3]);
+    EXPECT_EQ(1u, cache.Misses());
+}
+
+TEST_F(HeadersCacheTest, MessageMatchesBlockVector) {
+    CHeadersCache cache(16);
+    std::vector<CBlock> vBlocks;
+    CSerializedHeaders vSerialized;
+    for (size_t i = 2; i < 18; i++) {
+        vBlocks.push_back(headers[i]);
+        vSerialized.vEntries.push_back(&cache.Get(chain[i]));
+    }
+
+    CDataStream ssExpected(SER_NETWORK, PROTOCOL_VERSION);
+    ssExpected << vBlocks;
+    CDataStream ssActual(SER_NETWORK, PROTOCOL_VERSION);
+    ssActual << vSerialized;
+    EXPECT_EQ(ssExpected.str(), ssActual.str());
+
+    // The payload can be read back as a "headers" message.
+    std::vector<CBlock> vRead;
+    ssActual >> vRead;
+    ASSERT_EQ(vBlocks.size(), vRead.size());
+    for (size_t i = 0; i < vRead.size(); i++) {
+        EXPECT_EQ(vBlocks[i].GetHash(), vRead[i].GetHash());
+    }
+}
@@ -13,6 +13,10 @@ public:
     MOCK_METHOD1(GetHeader, std::pair<bool, std::string>(const std::string& hdr));
     MOCK_METHOD2(WriteHeader, void(const std::string& hdr, const std::string& value));
     MOCK_METHOD2(WriteReply, void(int nStatus, const std::string& strReply));
+    MOCK_METHOD1(PeekBody, std::string(size_t nMaxSize));
+    MOCK_METHOD0(ReadBody, std::string());
+    MOCK_METHOD1(IsConnectionAuthorized, bool(const std::string& strAuth));
+    MOCK_METHOD1(SetConnectionAuthorized, void(const std::string& strAuth));
 
     MockHTTPRequest() : HTTPRequest(nullptr) {}
     void CleanUp() {
@@ -51,6 +55,10 @@ TEST(HTTPRPC, FailsWithBadAuth) {
         .WillRepeatedly(Return(HTTPRequest::POST));
     EXPECT_CALL(req, GetHeader("authorization"))
         .WillRepeatedly(Return(std::make_pair(true, "Basic spam:eggs")));
+    EXPECT_CALL(req, IsConnectionAuthorized("Basic spam:eggs"))
+        .WillRepeatedly(Return(false));
+    EXPECT_CALL(req, SetConnectionAuthorized(::testing::_))
+        .Times(0);
     EXPECT_CALL(req, GetPeer())
         .WillRepeatedly(Return(CService("127.0.0.1:1337")));
     EXPECT_CALL(req, WriteHeader("WWW-Authenticate", "Basic realm=\"jsonrpc\""))
@@ -60,3 +68,100 @@ TEST(HTTPRPC, FailsWithBadAuth) {
     EXPECT_FALSE(HTTPReq_JSONRPC(&req, ""));
     req.CleanUp();
 }
+
+TEST(HTTPRPC, CachesAuthOnConnection) {
+    std::string strSaved = strRPCUserColonPass;
+    strRPCUserColonPass = "spam:eggs";
+    std::string strAuth = "Basic " + EncodeBase64("spam:eggs");
+
+    MockHTTPRequest req;
+    EXPECT_CALL(req, GetRequestMethod())
+        .WillRepeatedly(Return(HTTPRequest::POST));
+    EXPECT_CALL(req, GetHeader("authorization"))
+        .WillRepeatedly(Return(std::make_pair(true, strAuth)));
+    EXPECT_CALL(req, GetHeader("content-type"))
+        .WillRepeatedly(Return(std::make_pair(false, "")));
+    EXPECT_CALL(req, GetHeader("accept"))
+        .WillRepeatedly(Return(std::make_pair(false, "")));
+    EXPECT_CALL(req, IsConnectionAuthorized(strAuth))
+        .WillOnce(Return(false));
+    EXPECT_CALL(req, SetConnectionAuthorized(strAuth))
+        .Times(1);
+    EXPECT_CALL(req, ReadBody())
+        .WillOnce(Return(""));
+    EXPECT_CALL(req, WriteHeader("Content-Type", "application/json"))
+        .Times(1);
+    EXPECT_CALL(req, WriteReply(HTTP_INTERNAL_SERVER_ERROR, ::testing::_))
+        .Times(1);
+    EXPECT_FALSE(HTTPReq_JSONRPC(&req, ""));
+    req.CleanUp();
+
+    strRPCUserColonPass = strSaved;
+}
+
+TEST(HTTPRPC, SkipsAuthCheckOnAuthorizedConnection) {
+    // Credentials that don't match are accepted, because the connection was
+    // already authorized with them
+    MockHTTPRequest req;
+    EXPECT_CALL(req, GetRequestMethod())
+        .WillRepeatedly(Return(HTTPRequest::POST));
+    EXPECT_CALL(req, GetHeader("authorization"))
+        .WillRepeatedly(Return(std::make_pair(true, "Basic spam:eggs")));
+    EXPECT_CALL(req, GetHeader("content-type"))
+        .WillRepeatedly(Return(std::make_pair(false, "")));
+    EXPECT_CALL(req, GetHeader("accept"))
+        .WillRepeatedly(Return(std::make_pair(false, "")));
+    EXPECT_CALL(req, IsConnectionAuthorized("Basic spam:eggs"))
+        .WillOnce(Return(true));
+    EXPECT_CALL(req, SetConnectionAuthorized(::testing::_))
+        .Times(0);
+    EXPECT_CALL(req, ReadBody())
+        .WillOnce(Return(""));
+    EXPECT_CALL(req, WriteHeader("Content-Type", "application/json"))
+        .Times(1);
+    EXPECT_CALL(req, WriteReply(HTTP_INTERNAL_SERVER_ERROR, ::testing::_))
+        .Times(1);
+    EXPECT_FALSE(HTTPReq_JSONRPC(&req, ""));
+    req.CleanUp();
+}
+
+TEST(HTTPRPC, PeekRPCMethod) {
+    EXPECT_EQ("getblockcount", PeekRPCMethod("{\"jsonrpc\": \"1.0\", \"id\":\"curltest\", \"method\": \"getblockcount\", \"params\": [] }"));
+    EXPECT_EQ("help", PeekRPCMethod(" \n{\"method\"\t:\"help\"}"));
+    EXPECT_EQ("", PeekRPCMethod(""));
+    EXPECT_EQ("", PeekRPCMethod("[{\"method\":\"help\"}]"));
+    EXPECT_EQ("", PeekRPCMethod("{\"method\":1}"));
+    EXPECT_EQ("", PeekRPCMethod("{\"method\":\"getblo"));
+}
+
+TEST(HTTPRPC, SelectsQueueByMethod) {
+    MockHTTPRequest req;
+    EXPECT_CALL(req, GetRequestMethod())
+        .WillRepeatedly(Return(HTTPRequest::POST));
+    EXPECT_CALL(req, GetHeader("content-type"))
+        .WillRepeatedly(Return(std::make_pair(false, "")));
+    EXPECT_CALL(req, PeekBody(MAX_RPC_METHOD_PEEK))
+        .WillOnce(Return("{\"method\":\"getblockcount\",\"params\":[]}"))
+        .WillOnce(Return("{\"method\":\"getbalance\",\"params\":[]}"))
+        .WillOnce(Return("{\"method\":\"getblock\",\"params\":[\"1\"]}"))
+        .WillOnce(Return("{\"method\":\"nosuchmethod\"}"));
+    EXPECT_EQ(HTTP_FAST_RPC_QUEUE, HTTPReq_JSONRPCQueue(&req));
+    EXPECT_EQ(HTTP_WALLET_RPC_QUEUE, HTTPReq_JSONRPCQueue(&req));
+    EXPECT_EQ("", HTTPReq_JSONRPCQueue(&req));
+    EXPECT_EQ("", HTTPReq_JSONRPCQueue(&req));
+    req.CleanUp();
+}
+
+TEST(HTTPRPC, LeavesCBORAndGETOnDefaultQueue) {
+    MockHTTPRequest req;
+    EXPECT_CALL(req, GetRequestMethod())
+        .WillOnce(Return(HTTPRequest::GET))
+        .WillOnce(Return(HTTPRequest::POST));
+    EXPECT_CALL(req, GetHeader("content-type"))
+        .WillOnce(Return(std::make_pair(true, CBOR_CONTENT_TYPE)));
+    EXPECT_CALL(req, PeekBody(::testing::_))
+        .Times(0);
+    EXPECT_EQ("", HTTPReq_JSONRPCQueue(&req));
+    EXPECT_EQ("", HTTPReq_JSONRPCQueue(&req));
+    req.CleanUp();
+}
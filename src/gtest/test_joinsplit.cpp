@@ -523,6 +523,19 @@ TEST(joinsplit, full_api_test)
     test_full_api(params);
 }
 
+TEST(joinsplit, resident_proving_key)
+{
+    ASSERT_FALSE(params->isProvingKeyLoaded());
+    params->loadProvingKey();
+    ASSERT_TRUE(params->isProvingKeyLoaded());
+
+    // Proofs made with the resident key must verify like streamed ones
+    test_full_api(params);
+
+    params->unloadProvingKey();
+    ASSERT_FALSE(params->isProvingKeyLoaded());
+}
+
 TEST(joinsplit, note_plaintexts)
 {
     uint252 a_sk = uint252(uint256S("f6da8716682d600f74fc16bd0187faad6a26b4aa4c24d5c055b216d94516840e"));
@@ -0,0 +1,44 @@
+// Copyright (c) 2018 The Zcash developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "headerscache.h"
+
+#include "chain.h"
+#include "primitives/block.h"
+#include "streams.h"
+#include "version.h"
+
+#include <assert.h>
+
+CHeadersCache::CHeadersCache(size_t nCapacity) : vEntries(nCapacity), nHits(0), nMisses(0)
+{
+    assert(nCapacity > 0);
+}
+
+const std::vector<unsigned char>& CHeadersCache::Get(const CBlockIndex* pindex)
+{
+    assert(pindex && pindex->nHeight >= 0);
+    Entry& entry = vEntries[pindex->nHeight % vEntries.size()];
+    if (entry.pindex == pindex) {
+        nHits++;
+        return entry.vch;
+    }
+
+    nMisses++;
+    // Serialize as a CBlock so the trailing transaction count is included.
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << CBlock(pindex->GetBlockHeader());
+    entry.vch.assign(ss.begin(), ss.end());
+    entry.pindex = pindex;
+    return entry.vch;
+}
+
+void CHeadersCache::Clear()
+{
+    for (size_t i = 0; i < vEntries.size(); i++) {
+        vEntries[i] = Entry();
+    }
+    nHits = 0;
+    nMisses = 0;
+}
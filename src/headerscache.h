@@ -0,0 +1,76 @@
+// Copyright (c) 2018 The Zcash developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef ZCASH_HEADERSCACHE_H
+#define ZCASH_HEADERSCACHE_H
+
+#include "serialize.h"
+
+#include <vector>
+
+class CBlockIndex;
+
+/**
+ * Cache of block headers in their "headers" message wire format (the header
+ * followed by a zero transaction count), so that getheaders responses can be
+ * assembled without rebuilding and reserializing each CBlockHeader and its
+ * Equihash solution.
+ *
+ * The cache is direct-mapped by height. Each slot remembers the CBlockIndex it
+ * was built from, so entries belonging to a block that has since been
+ * reorganized out of the active chain are simply rebuilt on the next lookup.
+ *
+ * References returned by Get() stay valid until a later lookup maps to the same
+ * slot, so up to Capacity() consecutive heights can be collected at once.
+ *
+ * Not thread-safe; callers must hold cs_main. The cache must be cleared
+ * whenever CBlockIndex entries are freed.
+ */
+class CHeadersCache
+{
+private:
+    struct Entry {
+        const CBlockIndex* pindex;
+        std::vector<unsigned char> vch;
+
+        Entry() : pindex(NULL) {}
+    };
+
+    std::vector<Entry> vEntries;
+    uint64_t nHits;
+    uint64_t nMisses;
+
+public:
+    explicit CHeadersCache(size_t nCapacity);
+
+    /** Returns the serialized "headers" entry for pindex. */
+    const std::vector<unsigned char>& Get(const CBlockIndex* pindex);
+
+    void Clear();
+
+    size_t Capacity() const { return vEntries.size(); }
+    uint64_t Hits() const { return nHits; }
+    uint64_t Misses() const { return nMisses; }
+};
+
+/**
+ * A "headers" message payload built from pre-serialized entries. Serializes
+ * identically to std::vector<CBlock> holding the same headers.
+ */
+class CSerializedHeaders
+{
+public:
+    std::vector<const std::vector<unsigned char>*> vEntries;
+
+    template<typename Stream>
+    void Serialize(Stream& s) const {
+        WriteCompactSize(s, vEntries.size());
+        for (size_t i = 0; i < vEntries.size(); i++) {
+            const std::vector<unsigned char>& vch = *vEntries[i];
+            s.write((const char*)vch.data(), vch.size());
+        }
+    }
+};
+
+#endif // ZCASH_HEADERSCACHE_H
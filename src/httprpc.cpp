@@ -3,6 +3,7 @@
 #include "chainparams.h"
 #include "httpserver.h"
 #include "key_io.h"
+#include "rpccbor.h"
 #include "rpcprotocol.h"
 #include "rpcserver.h"
 #include "random.h"
@@ -16,6 +17,25 @@
 /** WWW-Authenticate to present with 401 Unauthorized response */
 static const char* WWW_AUTH_HEADER_DATA = "Basic realm=\"jsonrpc\"";
 
+/** Work queue for calls that return at once, so that they stay responsive
+ * while slow calls back up the other queues */
+static const char* const HTTP_FAST_RPC_QUEUE = "fastrpc";
+/** Work queue for calls in the wallet category */
+static const char* const HTTP_WALLET_RPC_QUEUE = "wallet";
+/** Calls that only read a little state, served by HTTP_FAST_RPC_QUEUE */
+static const char* const fastRPCMethods[] = {
+    "getbestblockhash",
+    "getblockcount",
+    "getconnectioncount",
+    "getdifficulty",
+    "getrpcqueueinfo",
+    "getschedulerinfo",
+    "help",
+    "ping",
+};
+/** How much of a request body is searched for the method name */
+static const size_t MAX_RPC_METHOD_PEEK = 4096;
+
 /** Simple one-shot callback timer to be used by the RPC mechanism to e.g.
  * re-lock the wallet.
  */
@@ -58,7 +78,7 @@ static std::string strRPCUserColonPass;
 /* Stored RPC timer interface (for unregistration) */
 static HTTPRPCTimerInterface* httpRPCTimerInterface = 0;
 
-static void JSONErrorReply(HTTPRequest* req, const UniValue& objError, const UniValue& id)
+static void JSONErrorReply(HTTPRequest* req, const UniValue& objError, const UniValue& id, bool fCBOR)
 {
     // Send error reply from json-rpc error object
     int nStatus = HTTP_INTERNAL_SERVER_ERROR;
@@ -69,12 +89,68 @@ static void JSONErrorReply(HTTPRequest* req, const UniValue& objError, const Uni
     else if (code == RPC_METHOD_NOT_FOUND)
         nStatus = HTTP_NOT_FOUND;
 
+    if (fCBOR) {
+        req->WriteHeader("Content-Type", CBOR_CONTENT_TYPE);
+        req->WriteReply(nStatus, CBORRPCReply("", NullUniValue, objError, id));
+        return;
+    }
+
     std::string strReply = JSONRPCReply(NullUniValue, objError, id);
 
     req->WriteHeader("Content-Type", "application/json");
     req->WriteReply(nStatus, strReply);
 }
 
+/** Returns whether the header value lists CBOR among its media types. */
+static bool HasCBORMediaType(const std::pair<bool, std::string>& header)
+{
+    return header.first && header.second.find(CBOR_CONTENT_TYPE) != std::string::npos;
+}
+
+/** Returns the method a JSON-RPC request body names, if the body is an object
+ * and the method comes near its start. This only picks a work queue, so it
+ * doesn't parse the request: a body it can't make sense of goes to the
+ * default queue, and the handler rejects it there if it is invalid.
+ */
+static std::string PeekRPCMethod(const std::string& strBody)
+{
+    static const char* const WHITESPACE = " \t\r\n";
+    size_t pos = strBody.find_first_not_of(WHITESPACE);
+    if (pos == std::string::npos || strBody[pos] != '{')
+        return "";
+    pos = strBody.find("\"method\"", pos);
+    if (pos == std::string::npos)
+        return "";
+    pos = strBody.find_first_not_of(WHITESPACE, pos + 8);
+    if (pos == std::string::npos || strBody[pos] != ':')
+        return "";
+    pos = strBody.find_first_not_of(WHITESPACE, pos + 1);
+    if (pos == std::string::npos || strBody[pos] != '"')
+        return "";
+    size_t end = strBody.find('"', pos + 1);
+    if (end == std::string::npos)
+        return "";
+    return strBody.substr(pos + 1, end - pos - 1);
+}
+
+/** Picks the work queue for a JSON-RPC request */
+static std::string HTTPReq_JSONRPCQueue(HTTPRequest* req)
+{
+    if (req->GetRequestMethod() != HTTPRequest::POST || HasCBORMediaType(req->GetHeader("content-type")))
+        return "";
+    std::string strMethod = PeekRPCMethod(req->PeekBody(MAX_RPC_METHOD_PEEK));
+    if (strMethod.empty())
+        return "";
+    for (size_t i = 0; i < ARRAYLEN(fastRPCMethods); i++) {
+        if (strMethod == fastRPCMethods[i])
+            return HTTP_FAST_RPC_QUEUE;
+    }
+    const CRPCCommand* pcmd = tableRPC[strMethod];
+    if (pcmd && pcmd->category == "wallet")
+        return HTTP_WALLET_RPC_QUEUE;
+    return "";
+}
+
 static bool RPCAuthorized(const std::string& strAuth)
 {
     if (strRPCUserColonPass.empty()) // Belt-and-suspenders measure if InitRPCAuthentication was not called
@@ -102,24 +178,40 @@ static bool HTTPReq_JSONRPC(HTTPRequest* req, const std::string &)
         return false;
     }
 
-    if (!RPCAuthorized(authHeader.second)) {
-        LogPrintf("ThreadRPCServer incorrect password attempt from %s\n", req->GetPeer().ToString());
+    if (!req->IsConnectionAuthorized(authHeader.second)) {
+        if (!RPCAuthorized(authHeader.second)) {
+            LogPrintf("ThreadRPCServer incorrect password attempt from %s\n", req->GetPeer().ToString());
 
-        /* Deter brute-forcing
-           If this results in a DoS the user really
-           shouldn't have their RPC port exposed. */
-        MilliSleep(250);
+            /* Deter brute-forcing
+               If this results in a DoS the user really
+               shouldn't have their RPC port exposed. */
+            MilliSleep(250);
 
-        req->WriteHeader("WWW-Authenticate", WWW_AUTH_HEADER_DATA);
-        req->WriteReply(HTTP_UNAUTHORIZED);
-        return false;
+            req->WriteHeader("WWW-Authenticate", WWW_AUTH_HEADER_DATA);
+            req->WriteReply(HTTP_UNAUTHORIZED);
+            return false;
+        }
+        // Later requests on this keep-alive connection skip the check
+        req->SetConnectionAuthorized(authHeader.second);
     }
 
+    // Requests may be sent as CBOR instead of JSON, and replies are sent as
+    // CBOR if the request was, or if the client asks for it.
+    bool fCBORRequest = HasCBORMediaType(req->GetHeader("content-type"));
+    bool fCBORReply = fCBORRequest || HasCBORMediaType(req->GetHeader("accept"));
+
     JSONRequest jreq;
     try {
+        // CBOR replies carry serialized data as bytes, so have the handlers
+        // return it that way rather than as hex
+        RPCRawBytesScope rawBytesScope(fCBORReply);
+
         // Parse request
         UniValue valRequest;
-        if (!valRequest.read(req->ReadBody()))
+        if (fCBORRequest) {
+            if (!DecodeCBOR(req->ReadBody(), valRequest))
+                throw JSONRPCError(RPC_PARSE_ERROR, "Parse error");
+        } else if (!valRequest.read(req->ReadBody()))
             throw JSONRPCError(RPC_PARSE_ERROR, "Parse error");
 
         std::string strReply;
@@ -130,21 +222,27 @@ static bool HTTPReq_JSONRPC(HTTPRequest* req, const std::string &)
             UniValue result = tableRPC.execute(jreq.strMethod, jreq.params);
 
             // Send reply
-            strReply = JSONRPCReply(result, NullUniValue, jreq.id);
+            if (fCBORReply)
+                strReply = CBORRPCReply(jreq.strMethod, result, NullUniValue, jreq.id);
+            else
+                strReply = JSONRPCReply(result, NullUniValue, jreq.id);
 
         // array of requests
-        } else if (valRequest.isArray())
-            strReply = JSONRPCExecBatch(valRequest.get_array());
-        else
+        } else if (valRequest.isArray()) {
+            if (fCBORReply)
+                strReply = CBORRPCBatchReply(valRequest, JSONRPCExecBatchReplies(valRequest.get_array()));
+            else
+                strReply = JSONRPCExecBatch(valRequest.get_array());
+        } else
             throw JSONRPCError(RPC_PARSE_ERROR, "Top-level object parse error");
 
-        req->WriteHeader("Content-Type", "application/json");
+        req->WriteHeader("Content-Type", fCBORReply ? CBOR_CONTENT_TYPE : "application/json");
         req->WriteReply(HTTP_OK, strReply);
     } catch (const UniValue& objError) {
-        JSONErrorReply(req, objError, jreq.id);
+        JSONErrorReply(req, objError, jreq.id, fCBORReply);
         return false;
     } catch (const std::exception& e) {
-        JSONErrorReply(req, JSONRPCError(RPC_PARSE_ERROR, e.what()), jreq.id);
+        JSONErrorReply(req, JSONRPCError(RPC_PARSE_ERROR, e.what()), jreq.id, fCBORReply);
         return false;
     }
     return true;
@@ -173,7 +271,9 @@ bool StartHTTPRPC()
     if (!InitRPCAuthentication())
         return false;
 
-    RegisterHTTPHandler("/", true, HTTPReq_JSONRPC);
+    RegisterHTTPWorkQueue(HTTP_FAST_RPC_QUEUE, 1);
+    RegisterHTTPWorkQueue(HTTP_WALLET_RPC_QUEUE, 1);
+    RegisterHTTPHandler("/", true, HTTPReq_JSONRPC, HTTP_DEFAULT_QUEUE, HTTPReq_JSONRPCQueue);
 
     assert(EventBase());
     httpRPCTimerInterface = new HTTPRPCTimerInterface(EventBase());
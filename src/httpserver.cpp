@@ -11,6 +11,7 @@
 #include "rpcprotocol.h" // For HTTP status codes
 #include "sync.h"
 #include "ui_interface.h"
+#include "utilstrencodings.h"
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -24,6 +25,7 @@
 #include <event2/http.h>
 #include <event2/thread.h>
 #include <event2/buffer.h>
+#include <event2/bufferevent.h>
 #include <event2/util.h>
 #include <event2/keyvalq_struct.h>
 
@@ -60,6 +62,11 @@ private:
 
 /** Simple work queue for distributing work over multiple threads.
  * Work items are simply callable objects.
+ *
+ * The queue runs its own pool of worker threads. It keeps at least
+ * minThreads of them, starts another whenever more items are waiting than
+ * there are idle threads, up to maxThreads, and lets the extra ones exit
+ * after they have been idle for HTTP_WORKER_IDLE_TIMEOUT seconds.
  */
 template <typename WorkItem>
 class WorkQueue
@@ -69,33 +76,74 @@ private:
     CWaitableCriticalSection cs;
     CConditionVariable cond;
     /* XXX in C++11 we can use std::unique_ptr here and avoid manual cleanup */
-    std::deque<WorkItem*> queue;
+    /** Items with the time in microseconds they were queued */
+    std::deque<std::pair<WorkItem*, int64_t> > queue;
+    const std::string name;
     bool running;
+    bool started;
     size_t maxDepth;
+    int minThreads;
+    int maxThreads;
     int numThreads;
+    int numIdle;
+    uint64_t numProcessed;
+    uint64_t numRejected;
+    int64_t totalWaitMicros;
+    int64_t maxWaitMicros;
 
     /** RAII object to keep track of number of running worker threads */
     class ThreadCounter
     {
     public:
         WorkQueue &wq;
-        ThreadCounter(WorkQueue &w): wq(w)
+        bool counted;
+        ThreadCounter(WorkQueue &w): wq(w), counted(true)
         {
-            boost::lock_guard<boost::mutex> lock(wq.cs);
-            wq.numThreads += 1;
         }
         ~ThreadCounter()
         {
-            boost::lock_guard<boost::mutex> lock(wq.cs);
+            if (counted) {
+                boost::lock_guard<boost::mutex> lock(wq.cs);
+                Release();
+            }
+        }
+        /** Stop counting this thread. wq.cs must be held. */
+        void Release()
+        {
             wq.numThreads -= 1;
             wq.cond.notify_all();
+            counted = false;
         }
     };
 
+    static void ThreadMain(WorkQueue* wq)
+    {
+        RenameThread("zcash-httpworker");
+        wq->Run();
+    }
+
+    /** Start a worker thread. cs must be held. */
+    void AddThread()
+    {
+        numThreads += 1;
+        boost::thread worker(boost::bind(&WorkQueue::ThreadMain, this));
+        worker.detach();
+    }
+
 public:
-    WorkQueue(size_t maxDepth) : running(true),
-                                 maxDepth(maxDepth),
-                                 numThreads(0)
+    WorkQueue(const std::string& name, size_t maxDepth, int minThreads, int maxThreads) :
+        name(name),
+        running(true),
+        started(false),
+        maxDepth(maxDepth),
+        minThreads(minThreads),
+        maxThreads(std::max(minThreads, maxThreads)),
+        numThreads(0),
+        numIdle(0),
+        numProcessed(0),
+        numRejected(0),
+        totalWaitMicros(0),
+        maxWaitMicros(0)
     {
     }
     /*( Precondition: worker threads have all stopped
@@ -104,18 +152,31 @@ public:
     ~WorkQueue()
     {
         while (!queue.empty()) {
-            delete queue.front();
+            delete queue.front().first;
             queue.pop_front();
         }
     }
+    /** Start the minimum number of worker threads */
+    void Start()
+    {
+        boost::unique_lock<boost::mutex> lock(cs);
+        started = true;
+        while (numThreads < minThreads)
+            AddThread();
+    }
     /** Enqueue a work item */
     bool Enqueue(WorkItem* item)
     {
         boost::unique_lock<boost::mutex> lock(cs);
         if (queue.size() >= maxDepth) {
+            numRejected++;
             return false;
         }
-        queue.push_back(item);
+        queue.push_back(std::make_pair(item, GetTimeMicros()));
+        if (started && running && queue.size() > (size_t)numIdle && numThreads < maxThreads) {
+            LogPrint("http", "HTTP: %d requests waiting on the %s queue, starting worker thread %d\n", queue.size(), name, numThreads + 1);
+            AddThread();
+        }
         cond.notify_one();
         return true;
     }
@@ -127,12 +188,33 @@ public:
             WorkItem* i = 0;
             {
                 boost::unique_lock<boost::mutex> lock(cs);
-                while (running && queue.empty())
-                    cond.wait(lock);
+                bool fTimedOut = false;
+                numIdle += 1;
+                while (running && queue.empty() && !fTimedOut) {
+                    if (numThreads > minThreads)
+                        fTimedOut = cond.wait_for(lock, boost::chrono::seconds(HTTP_WORKER_IDLE_TIMEOUT)) == boost::cv_status::timeout;
+                    else
+                        cond.wait(lock);
+                }
+                numIdle -= 1;
                 if (!running)
                     break;
-                i = queue.front();
+                if (queue.empty()) {
+                    // Idle for too long; let the pool shrink back. The count
+                    // drops before the lock is released, so that other idle
+                    // threads don't also leave and go below the minimum.
+                    if (numThreads > minThreads) {
+                        count.Release();
+                        break;
+                    }
+                    continue;
+                }
+                i = queue.front().first;
+                int64_t waitMicros = GetTimeMicros() - queue.front().second;
                 queue.pop_front();
+                numProcessed++;
+                totalWaitMicros += waitMicros;
+                maxWaitMicros = std::max(maxWaitMicros, waitMicros);
             }
             (*i)();
             delete i;
@@ -159,20 +241,42 @@ public:
         boost::unique_lock<boost::mutex> lock(cs);
         return queue.size();
     }
+
+    HTTPWorkQueueStats GetStats()
+    {
+        boost::unique_lock<boost::mutex> lock(cs);
+        HTTPWorkQueueStats stats;
+        stats.name = name;
+        stats.nThreads = numThreads;
+        stats.nIdleThreads = numIdle;
+        stats.nMinThreads = minThreads;
+        stats.nMaxThreads = maxThreads;
+        stats.nDepth = queue.size();
+        stats.nMaxDepth = maxDepth;
+        stats.nProcessed = numProcessed;
+        stats.nRejected = numRejected;
+        stats.nTotalWaitMicros = totalWaitMicros;
+        stats.nMaxWaitMicros = maxWaitMicros;
+        return stats;
+    }
 };
 
 struct HTTPPathHandler
 {
     HTTPPathHandler() {}
-    HTTPPathHandler(std::string prefix, bool exactMatch, HTTPRequestHandler handler):
-        prefix(prefix), exactMatch(exactMatch), handler(handler)
+    HTTPPathHandler(std::string prefix, bool exactMatch, HTTPRequestHandler handler, std::string queue, HTTPQueueSelector selector):
+        prefix(prefix), exactMatch(exactMatch), handler(handler), queue(queue), selector(selector)
     {
     }
     std::string prefix;
     bool exactMatch;
     HTTPRequestHandler handler;
+    std::string queue;
+    HTTPQueueSelector selector;
 };
 
+const std::string HTTP_DEFAULT_QUEUE = "rpc";
+
 /** HTTP module state */
 
 //! libevent event loop
@@ -181,12 +285,16 @@ static struct event_base* eventBase = 0;
 struct evhttp* eventHTTP = 0;
 //! List of subnets to allow RPC connections from
 static std::vector<CSubNet> rpc_allow_subnets;
-//! Work queue for handling longer requests off the event loop thread
-static WorkQueue<HTTPClosure>* workQueue = 0;
+//! Work queues for handling longer requests off the event loop thread, by name
+static std::map<std::string, WorkQueue<HTTPClosure>*> workQueues;
 //! Handlers for (sub)paths
 std::vector<HTTPPathHandler> pathHandlers;
 //! Bound listening sockets
 std::vector<evhttp_bound_socket *> boundSockets;
+//! Open client connections, from their first request until they close, with
+//! the Authorization header a request on the connection was last accepted with
+static std::map<struct evhttp_connection*, std::string> mapConnectionAuth;
+static CCriticalSection cs_mapConnectionAuth;
 
 /** Check if a network address is allowed to access the HTTP server */
 static bool ClientAllowed(const CNetAddr& netaddr)
@@ -246,6 +354,41 @@ static std::string RequestMethodString(HTTPRequest::RequestMethod m)
     }
 }
 
+/** Callback to forget a client connection when it closes */
+static void http_connection_close_cb(struct evhttp_connection* evcon, void* arg)
+{
+    LOCK(cs_mapConnectionAuth);
+    mapConnectionAuth.erase(evcon);
+}
+
+/** Start tracking the connection of a request, if this is its first */
+static void TrackConnection(struct evhttp_request* req)
+{
+    struct evhttp_connection* evcon = evhttp_request_get_connection(req);
+    if (!evcon)
+        return;
+    {
+        LOCK(cs_mapConnectionAuth);
+        if (!mapConnectionAuth.insert(std::make_pair(evcon, std::string())).second)
+            return;
+    }
+    evhttp_connection_set_closecb(evcon, http_connection_close_cb, NULL);
+
+    // Clients keep connections open and wait for each reply before sending
+    // the next request, so don't let Nagle's algorithm hold back the tail
+    // of a reply.
+    struct bufferevent* bev = evhttp_connection_get_bufferevent(evcon);
+    evutil_socket_t fd = bev ? bufferevent_getfd(bev) : -1;
+    if (fd != -1) {
+        int set = 1;
+#ifdef WIN32
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, (const char*)&set, sizeof(int));
+#else
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, (void*)&set, sizeof(int));
+#endif
+    }
+}
+
 /** HTTP request callback */
 static void http_request_cb(struct evhttp_request* req, void* arg)
 {
@@ -260,6 +403,8 @@ static void http_request_cb(struct evhttp_request* req, void* arg)
         return;
     }
 
+    TrackConnection(req);
+
     // Early reject unknown HTTP methods
     if (hreq->GetRequestMethod() == HTTPRequest::UNKNOWN) {
         hreq->WriteReply(HTTP_BADMETHOD);
@@ -285,9 +430,17 @@ static void http_request_cb(struct evhttp_request* req, void* arg)
 
     // Dispatch to worker thread
     if (i != iend) {
+        std::string queue;
+        if (!i->selector.empty())
+            queue = i->selector(hreq.get());
+        if (queue.empty())
+            queue = i->queue;
+        std::map<std::string, WorkQueue<HTTPClosure>*>::iterator it = workQueues.find(queue);
+        if (it == workQueues.end())
+            it = workQueues.find(HTTP_DEFAULT_QUEUE);
+        assert(it != workQueues.end());
         std::unique_ptr<HTTPWorkItem> item(new HTTPWorkItem(hreq.release(), path, i->handler));
-        assert(workQueue);
-        if (workQueue->Enqueue(item.get()))
+        if (it->second->Enqueue(item.get()))
             item.release(); /* if true, queue took ownership */
         else
             item->req->WriteReply(HTTP_INTERNAL, "Work queue depth exceeded");
@@ -352,13 +505,6 @@ static bool HTTPBindAddresses(struct evhttp* http)
     return !boundSockets.empty();
 }
 
-/** Simple wrapper to set thread name and run work queue */
-static void HTTPWorkQueueRun(WorkQueue<HTTPClosure>* queue)
-{
-    RenameThread("zcash-httpworker");
-    queue->Run();
-}
-
 /** libevent event log callback */
 static void libevent_log_cb(int severity, const char *msg)
 {
@@ -429,27 +575,33 @@ bool InitHTTPServer()
     }
 
     LogPrint("http", "Initialized HTTP server\n");
-    int workQueueDepth = std::max((long)GetArg("-rpcworkqueue", DEFAULT_HTTP_WORKQUEUE), 1L);
-    LogPrintf("HTTP: creating work queue of depth %d\n", workQueueDepth);
-
-    workQueue = new WorkQueue<HTTPClosure>(workQueueDepth);
     eventBase = base;
     eventHTTP = http;
+
+    RegisterHTTPWorkQueue(HTTP_DEFAULT_QUEUE, std::max((long)GetArg("-rpcthreads", DEFAULT_HTTP_THREADS), 1L));
     return true;
 }
 
+void RegisterHTTPWorkQueue(const std::string &name, int nMinThreads)
+{
+    assert(!workQueues.count(name));
+    int workQueueDepth = std::max((long)GetArg("-rpcworkqueue", DEFAULT_HTTP_WORKQUEUE), 1L);
+    int maxThreads = std::max((long)GetArg("-rpcmaxthreads", DEFAULT_HTTP_MAX_THREADS), 1L);
+    LogPrintf("HTTP: creating %s work queue of depth %d\n", name, workQueueDepth);
+    workQueues[name] = new WorkQueue<HTTPClosure>(name, workQueueDepth, nMinThreads, maxThreads);
+}
+
 boost::thread threadHTTP;
 
 bool StartHTTPServer()
 {
     LogPrint("http", "Starting HTTP server\n");
-    int rpcThreads = std::max((long)GetArg("-rpcthreads", DEFAULT_HTTP_THREADS), 1L);
-    LogPrintf("HTTP: starting %d worker threads\n", rpcThreads);
     threadHTTP = boost::thread(boost::bind(&ThreadHTTP, eventBase, eventHTTP));
 
-    for (int i = 0; i < rpcThreads; i++) {
-        boost::thread rpc_worker(HTTPWorkQueueRun, workQueue);
-        rpc_worker.detach();
+    for (std::map<std::string, WorkQueue<HTTPClosure>*>::iterator it = workQueues.begin(); it != workQueues.end(); ++it) {
+        HTTPWorkQueueStats stats = it->second->GetStats();
+        LogPrintf("HTTP: starting %d worker threads for the %s queue (up to %d)\n", stats.nMinThreads, it->first, stats.nMaxThreads);
+        it->second->Start();
     }
     return true;
 }
@@ -465,17 +617,20 @@ void InterruptHTTPServer()
         // Reject requests on current connections
         evhttp_set_gencb(eventHTTP, http_reject_request_cb, NULL);
     }
-    if (workQueue)
-        workQueue->Interrupt();
+    for (std::map<std::string, WorkQueue<HTTPClosure>*>::iterator it = workQueues.begin(); it != workQueues.end(); ++it)
+        it->second->Interrupt();
 }
 
 void StopHTTPServer()
 {
     LogPrint("http", "Stopping HTTP server\n");
-    if (workQueue) {
+    if (!workQueues.empty()) {
         LogPrint("http", "Waiting for HTTP worker threads to exit\n");
-        workQueue->WaitExit();
-        delete workQueue;
+        for (std::map<std::string, WorkQueue<HTTPClosure>*>::iterator it = workQueues.begin(); it != workQueues.end(); ++it) {
+            it->second->WaitExit();
+            delete it->second;
+        }
+        workQueues.clear();
     }
     if (eventBase) {
         LogPrint("http", "Waiting for HTTP event thread to exit\n");
@@ -497,6 +652,10 @@ void StopHTTPServer()
         evhttp_free(eventHTTP);
         eventHTTP = 0;
     }
+    {
+        LOCK(cs_mapConnectionAuth);
+        mapConnectionAuth.clear();
+    }
     if (eventBase) {
         event_base_free(eventBase);
         eventBase = 0;
@@ -509,6 +668,14 @@ struct event_base* EventBase()
     return eventBase;
 }
 
+std::vector<HTTPWorkQueueStats> GetHTTPWorkQueueStats()
+{
+    std::vector<HTTPWorkQueueStats> vStats;
+    for (std::map<std::string, WorkQueue<HTTPClosure>*>::iterator it = workQueues.begin(); it != workQueues.end(); ++it)
+        vStats.push_back(it->second->GetStats());
+    return vStats;
+}
+
 static void httpevent_callback_fn(evutil_socket_t, short, void* data)
 {
     // Static handler: simply call inner handler
@@ -560,6 +727,37 @@ std::pair<bool, std::string> HTTPRequest::GetHeader(const std::string& hdr)
         return std::make_pair(false, "");
 }
 
+std::string HTTPRequest::PeekBody(size_t nMaxSize)
+{
+    struct evbuffer* buf = evhttp_request_get_input_buffer(req);
+    if (!buf)
+        return "";
+    size_t size = std::min(evbuffer_get_length(buf), nMaxSize);
+    const char* data = (const char*)evbuffer_pullup(buf, size);
+    if (!data)
+        return "";
+    return std::string(data, size);
+}
+
+bool HTTPRequest::IsConnectionAuthorized(const std::string& strAuth)
+{
+    struct evhttp_connection* evcon = evhttp_request_get_connection(req);
+    LOCK(cs_mapConnectionAuth);
+    std::map<struct evhttp_connection*, std::string>::const_iterator it = mapConnectionAuth.find(evcon);
+    if (it == mapConnectionAuth.end() || it->second.empty())
+        return false;
+    return TimingResistantEqual(it->second, strAuth);
+}
+
+void HTTPRequest::SetConnectionAuthorized(const std::string& strAuth)
+{
+    struct evhttp_connection* evcon = evhttp_request_get_connection(req);
+    LOCK(cs_mapConnectionAuth);
+    std::map<struct evhttp_connection*, std::string>::iterator it = mapConnectionAuth.find(evcon);
+    if (it != mapConnectionAuth.end())
+        it->second = strAuth;
+}
+
 std::string HTTPRequest::ReadBody()
 {
     struct evbuffer* buf = evhttp_request_get_input_buffer(req);
@@ -646,10 +844,11 @@ HTTPRequest::RequestMethod HTTPRequest::GetRequestMethod()
     }
 }
 
-void RegisterHTTPHandler(const std::string &prefix, bool exactMatch, const HTTPRequestHandler &handler)
+void RegisterHTTPHandler(const std::string &prefix, bool exactMatch, const HTTPRequestHandler &handler,
+                         const std::string &queue, const HTTPQueueSelector &selector)
 {
-    LogPrint("http", "Registering HTTP handler for %s (exactmatch %d)\n", prefix, exactMatch);
-    pathHandlers.push_back(HTTPPathHandler(prefix, exactMatch, handler));
+    LogPrint("http", "Registering HTTP handler for %s (exactmatch %d) on the %s queue\n", prefix, exactMatch, queue);
+    pathHandlers.push_back(HTTPPathHandler(prefix, exactMatch, handler, queue, selector));
 }
 
 void UnregisterHTTPHandler(const std::string &prefix, bool exactMatch)
@@ -7,12 +7,16 @@
 
 #include <string>
 #include <stdint.h>
+#include <vector>
 #include <boost/thread.hpp>
 #include <boost/scoped_ptr.hpp>
 #include <boost/function.hpp>
 
 static const int DEFAULT_HTTP_THREADS=4;
+static const int DEFAULT_HTTP_MAX_THREADS=16;
 static const int DEFAULT_HTTP_WORKQUEUE=16;
+//! Seconds a worker thread beyond a queue's minimum waits for work before exiting
+static const int HTTP_WORKER_IDLE_TIMEOUT=60;
 static const int DEFAULT_HTTP_SERVER_TIMEOUT=30;
 
 struct evhttp_request;
@@ -36,11 +40,27 @@ void StopHTTPServer();
 
 /** Handler for requests to a certain HTTP path */
 typedef boost::function<void(HTTPRequest* req, const std::string &)> HTTPRequestHandler;
+/** Picks the work queue for a request, or returns an empty string to use the
+ * handler's own queue. It runs on the event loop thread, so it must be quick
+ * and must not consume the request body.
+ */
+typedef boost::function<std::string(HTTPRequest* req)> HTTPQueueSelector;
+/** Name of the work queue that requests go to by default */
+extern const std::string HTTP_DEFAULT_QUEUE;
+/** Create a work queue with its own pool of worker threads.
+ * The pool starts with nMinThreads threads and grows up to -rpcmaxthreads
+ * while requests are waiting. Call this between InitHTTPServer and
+ * StartHTTPServer.
+ */
+void RegisterHTTPWorkQueue(const std::string &name, int nMinThreads);
 /** Register handler for prefix.
  * If multiple handlers match a prefix, the first-registered one will
- * be invoked.
+ * be invoked. Its requests are run on the named work queue, or on the one
+ * picked by selector.
  */
-void RegisterHTTPHandler(const std::string &prefix, bool exactMatch, const HTTPRequestHandler &handler);
+void RegisterHTTPHandler(const std::string &prefix, bool exactMatch, const HTTPRequestHandler &handler,
+                         const std::string &queue = HTTP_DEFAULT_QUEUE,
+                         const HTTPQueueSelector &selector = HTTPQueueSelector());
 /** Unregister handler for prefix */
 void UnregisterHTTPHandler(const std::string &prefix, bool exactMatch);
 
@@ -49,6 +69,28 @@ void UnregisterHTTPHandler(const std::string &prefix, bool exactMatch);
  */
 struct event_base* EventBase();
 
+/** State of a work queue */
+struct HTTPWorkQueueStats
+{
+    std::string name;
+    int nThreads;
+    int nIdleThreads;
+    int nMinThreads;
+    int nMaxThreads;
+    size_t nDepth;
+    size_t nMaxDepth;
+    //! Requests taken off the queue by a worker
+    uint64_t nProcessed;
+    //! Requests refused because the queue was full
+    uint64_t nRejected;
+    //! Time requests spent waiting in the queue
+    int64_t nTotalWaitMicros;
+    int64_t nMaxWaitMicros;
+};
+
+/** Return the state of every work queue */
+std::vector<HTTPWorkQueueStats> GetHTTPWorkQueueStats();
+
 /** In-flight HTTP request.
  * Thin C++ wrapper around evhttp_request.
  */
@@ -91,13 +133,32 @@ public:
      */
     virtual std::pair<bool, std::string> GetHeader(const std::string& hdr);
 
+    /**
+     * Return up to the first nMaxSize bytes of the request body, without
+     * consuming them.
+     */
+    virtual std::string PeekBody(size_t nMaxSize);
+
     /**
      * Read request body.
      *
      * @note As this consumes the underlying buffer, call this only once.
      * Repeated calls will return an empty string.
      */
-    std::string ReadBody();
+    virtual std::string ReadBody();
+
+    /**
+     * Whether an earlier request on the same connection was accepted with
+     * this Authorization header, so that keep-alive clients don't have their
+     * credentials checked from scratch on every request.
+     */
+    virtual bool IsConnectionAuthorized(const std::string& strAuth);
+
+    /**
+     * Remember that requests on this connection carrying this Authorization
+     * header are accepted, until the connection closes.
+     */
+    virtual void SetConnectionAuthorized(const std::string& strAuth);
 
     /**
      * Write output header.
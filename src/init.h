@@ -20,6 +20,8 @@ class thread_group;
 
 extern CWallet* pwalletMain;
 extern ZCJoinSplit* pzcashParams;
+/** The scheduler AppInit2 started, for RPC to report on. NULL outside of it. */
+extern CScheduler* pschedulerMain;
 
 void StartShutdown();
 bool ShutdownRequested();
@@ -16,9 +16,20 @@
 #include <assert.h>
 #include <string.h>
 #include <algorithm>
+#include <map>
 
 namespace
 {
+/** Base58Check-encodes prefix || [pbegin, pend) from a stack buffer. */
+std::string EncodeBase58CheckWithPrefix(const std::vector<unsigned char>& prefix, const unsigned char* pbegin, const unsigned char* pend)
+{
+    unsigned char buf[128];
+    assert(prefix.size() + (pend - pbegin) <= sizeof(buf));
+    std::copy(prefix.begin(), prefix.end(), buf);
+    std::copy(pbegin, pend, buf + prefix.size());
+    return EncodeBase58Check(buf, buf + prefix.size() + (pend - pbegin));
+}
+
 class DestinationEncoder : public boost::static_visitor<std::string>
 {
 private:
@@ -29,16 +40,12 @@ public:
 
     std::string operator()(const CKeyID& id) const
     {
-        std::vector<unsigned char> data = m_params.Base58Prefix(CChainParams::PUBKEY_ADDRESS);
-        data.insert(data.end(), id.begin(), id.end());
-        return EncodeBase58Check(data);
+        return EncodeBase58CheckWithPrefix(m_params.Base58Prefix(CChainParams::PUBKEY_ADDRESS), id.begin(), id.end());
     }
 
     std::string operator()(const CScriptID& id) const
     {
-        std::vector<unsigned char> data = m_params.Base58Prefix(CChainParams::SCRIPT_ADDRESS);
-        data.insert(data.end(), id.begin(), id.end());
-        return EncodeBase58Check(data);
+        return EncodeBase58CheckWithPrefix(m_params.Base58Prefix(CChainParams::SCRIPT_ADDRESS), id.begin(), id.end());
     }
 
     std::string operator()(const CNoDestination& no) const { return {}; }
@@ -80,9 +87,8 @@ public:
     {
         CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
         ss << zaddr;
-        std::vector<unsigned char> data = m_params.Base58Prefix(CChainParams::ZCPAYMENT_ADDRRESS);
-        data.insert(data.end(), ss.begin(), ss.end());
-        return EncodeBase58Check(data);
+        const unsigned char* pbegin = (const unsigned char*)&ss.begin()[0];
+        return EncodeBase58CheckWithPrefix(m_params.Base58Prefix(CChainParams::ZCPAYMENT_ADDRRESS), pbegin, pbegin + ss.size());
     }
 
     std::string operator()(const libzcash::SaplingPaymentAddress& zaddr) const
@@ -255,6 +261,22 @@ CTxDestination DecodeDestination(const std::string& str)
     return DecodeDestination(str, Params());
 }
 
+std::vector<std::string> EncodeDestinations(const std::vector<CTxDestination>& dests)
+{
+    DestinationEncoder encoder(Params());
+    std::map<CTxDestination, std::string> encoded;
+    std::vector<std::string> ret;
+    ret.reserve(dests.size());
+    for (const CTxDestination& dest : dests) {
+        auto it = encoded.find(dest);
+        if (it == encoded.end()) {
+            it = encoded.emplace(dest, boost::apply_visitor(encoder, dest)).first;
+        }
+        ret.push_back(it->second);
+    }
+    return ret;
+}
+
 bool IsValidDestinationString(const std::string& str, const CChainParams& params)
 {
     return IsValidDestination(DecodeDestination(str, params));
@@ -270,6 +292,27 @@ std::string EncodePaymentAddress(const libzcash::PaymentAddress& zaddr)
     return boost::apply_visitor(PaymentAddressEncoder(Params()), zaddr);
 }
 
+std::vector<std::string> EncodePaymentAddresses(const std::vector<libzcash::PaymentAddress>& zaddrs)
+{
+    PaymentAddressEncoder encoder(Params());
+    // InvalidEncoding has no strict ordering, so only valid addresses are memoized
+    std::map<libzcash::PaymentAddress, std::string> encoded;
+    std::vector<std::string> ret;
+    ret.reserve(zaddrs.size());
+    for (const libzcash::PaymentAddress& zaddr : zaddrs) {
+        if (!IsValidPaymentAddress(zaddr)) {
+            ret.push_back(std::string());
+            continue;
+        }
+        auto it = encoded.find(zaddr);
+        if (it == encoded.end()) {
+            it = encoded.emplace(zaddr, boost::apply_visitor(encoder, zaddr)).first;
+        }
+        ret.push_back(it->second);
+    }
+    return ret;
+}
+
 libzcash::PaymentAddress DecodePaymentAddress(const std::string& str)
 {
     std::vector<unsigned char> data;
@@ -14,6 +14,7 @@
 #include <zcash/Address.hpp>
 
 #include <string>
+#include <vector>
 
 CKey DecodeSecret(const std::string& str);
 std::string EncodeSecret(const CKey& key);
@@ -25,11 +26,16 @@ std::string EncodeExtPubKey(const CExtPubKey& extpubkey);
 
 std::string EncodeDestination(const CTxDestination& dest);
 CTxDestination DecodeDestination(const std::string& str);
+/** Encode a list of destinations, e.g. for an RPC result. Repeated
+ *  destinations are only encoded once. */
+std::vector<std::string> EncodeDestinations(const std::vector<CTxDestination>& dests);
 bool IsValidDestinationString(const std::string& str);
 bool IsValidDestinationString(const std::string& str, const CChainParams& params);
 
 std::string EncodePaymentAddress(const libzcash::PaymentAddress& zaddr);
 libzcash::PaymentAddress DecodePaymentAddress(const std::string& str);
+/** Encode a list of payment addresses; see EncodeDestinations. */
+std::vector<std::string> EncodePaymentAddresses(const std::vector<libzcash::PaymentAddress>& zaddrs);
 bool IsValidPaymentAddressString(const std::string& str);
 
 std::string EncodeViewingKey(const libzcash::ViewingKey& vk);
@@ -10,17 +10,20 @@
 #include "addrman.h"
 #include "alert.h"
 #include "arith_uint256.h"
+#include "blockfilter.h"
 #include "chainparams.h"
 #include "checkpoints.h"
 #include "checkqueue.h"
 #include "consensus/upgrades.h"
 #include "consensus/validation.h"
 #include "deprecation.h"
+#include "headerscache.h"
 #include "init.h"
 #include "merkleblock.h"
 #include "metrics.h"
 #include "net.h"
 #include "pow.h"
+#include "primitives/block_view.h"
 #include "txdb.h"
 #include "txmempool.h"
 #include "ui_interface.h"
@@ -150,6 +153,15 @@ namespace {
      *  or if we allocate more file space when we're in prune mode
      */
     bool fCheckForPruning = false;
+    /** Block index entries of the blocks stored in each blk/rev file, so
+     *  that pruning a file does not have to scan mapBlockIndex. */
+    std::vector<std::vector<CBlockIndex*> > vBlockIndexByFile;
+
+    /** Set while ThreadPruneBlockFiles is running; pruning is then left to it. */
+    bool fPruneInBackground = false;
+    boost::mutex csPruneThread;
+    boost::condition_variable condPruneThread;
+    bool fPruneRequested = false;
 
     /**
      * Every received block is assigned a unique and increasing identifier, so we
@@ -189,6 +201,9 @@ namespace {
     boost::scoped_ptr<CRollingBloomFilter> recentRejects;
     uint256 hashRecentRejectsChainTip;
 
+    /** Pre-serialized headers used to answer getheaders requests. Protected by cs_main. */
+    boost::scoped_ptr<CHeadersCache> headersCache;
+
     /** Blocks that are in flight, and that are in the queue to be downloaded. Protected by cs_main. */
     struct QueuedBlock {
         uint256 hash;
@@ -197,7 +212,9 @@ namespace {
         bool fValidatedHeaders;  //! Whether this block has validated headers at the time of request.
         int64_t nTimeDisconnect; //! The timeout for this block request (for disconnecting a slow peer)
     };
-    map<uint256, pair<NodeId, list<QueuedBlock>::iterator> > mapBlocksInFlight;
+    /** The peer each block in flight was requested from; the request itself is in the peer's
+     *  vBlocksInFlight. Protected by cs_main. */
+    boost::unordered_map<uint256, CNodeState*, BlockHasher> mapBlocksInFlight;
 
     /** Number of blocks in flight with validated headers. */
     int nQueuedValidatedHeaders = 0;
@@ -225,17 +242,28 @@ struct CBlockReject {
     uint256 hashBlock;
 };
 
+} // anon namespace
+
 /**
  * Maintain validation-specific state about nodes, protected by cs_main, instead
  * by CNode's own locks. This simplifies asynchronous operation, where
  * processing of incoming data is done after the ProcessMessage call returns,
  * and we're no longer holding the node's locks.
+ *
+ * The state is allocated along with the node and reached through
+ * CNode::pNodeState, so handling a message doesn't look it up by id. The
+ * misbehavior score has a lock of its own, so that a peer can be punished
+ * without cs_main.
  */
 struct CNodeState {
+    //! The peer's id
+    const NodeId id;
     //! The peer's address
     CService address;
     //! Whether we have a fully established connection.
     bool fCurrentlyConnected;
+    //! Protects nMisbehavior and fShouldBan.
+    CCriticalSection cs_misbehavior;
     //! Accumulated misbehaviour score for this peer.
     int nMisbehavior;
     //! Whether this peer should be disconnected and banned (unless whitelisted).
@@ -254,13 +282,15 @@ struct CNodeState {
     bool fSyncStarted;
     //! Since when we're stalling block download progress (in microseconds), or 0.
     int64_t nStallingSince;
-    list<QueuedBlock> vBlocksInFlight;
+    //! Blocks requested from this peer, oldest first. There are at most
+    //! MAX_BLOCKS_IN_TRANSIT_PER_PEER of them, so they are kept in a flat vector.
+    std::vector<QueuedBlock> vBlocksInFlight;
     int nBlocksInFlight;
     int nBlocksInFlightValidHeaders;
     //! Whether we consider this a preferred download peer.
     bool fPreferredDownload;
 
-    CNodeState() {
+    CNodeState(NodeId idIn) : id(idIn) {
         fCurrentlyConnected = false;
         nMisbehavior = 0;
         fShouldBan = false;
@@ -275,15 +305,22 @@ struct CNodeState {
     }
 };
 
-/** Map maintaining per-node state. Requires cs_main. */
-map<NodeId, CNodeState> mapNodeState;
+namespace {
+
+/** Per-node state by id, for callers that don't have the CNode. Requires cs_main. */
+map<NodeId, CNodeState*> mapNodeState;
 
 // Requires cs_main.
 CNodeState *State(NodeId pnode) {
-    map<NodeId, CNodeState>::iterator it = mapNodeState.find(pnode);
+    map<NodeId, CNodeState*>::iterator it = mapNodeState.find(pnode);
     if (it == mapNodeState.end())
         return NULL;
-    return &it->second;
+    return it->second;
+}
+
+// Fields other than the misbehavior score still require cs_main.
+CNodeState *State(const CNode *pnode) {
+    return pnode->pNodeState;
 }
 
 int GetHeight()
@@ -308,11 +345,13 @@ int64_t GetBlockTimeout(int64_t nTime, int nValidatedQueuedBefore, const Consens
     return nTime + 500000 * consensusParams.nPowTargetSpacing * (4 + nValidatedQueuedBefore);
 }
 
-void InitializeNode(NodeId nodeid, const CNode *pnode) {
+void InitializeNode(NodeId nodeid, CNode *pnode) {
     LOCK(cs_main);
-    CNodeState &state = mapNodeState.insert(std::make_pair(nodeid, CNodeState())).first->second;
-    state.name = pnode->addrName;
-    state.address = pnode->addr;
+    CNodeState *state = new CNodeState(nodeid);
+    state->name = pnode->addrName;
+    state->address = pnode->addr;
+    mapNodeState[nodeid] = state;
+    pnode->pNodeState = state;
 }
 
 void FinalizeNode(NodeId nodeid) {
@@ -322,7 +361,12 @@ void FinalizeNode(NodeId nodeid) {
     if (state->fSyncStarted)
         nSyncStarted--;
 
-    if (state->nMisbehavior == 0 && state->fCurrentlyConnected) {
+    bool fMisbehaved;
+    {
+        LOCK(state->cs_misbehavior);
+        fMisbehaved = state->nMisbehavior != 0;
+    }
+    if (!fMisbehaved && state->fCurrentlyConnected) {
         AddressCurrentlyConnected(state->address);
     }
 
@@ -332,17 +376,23 @@ void FinalizeNode(NodeId nodeid) {
     nPreferredDownload -= state->fPreferredDownload;
 
     mapNodeState.erase(nodeid);
+    delete state;
 }
 
 // Requires cs_main.
 // Returns a bool indicating whether we requested this block.
 bool MarkBlockAsReceived(const uint256& hash) {
-    map<uint256, pair<NodeId, list<QueuedBlock>::iterator> >::iterator itInFlight = mapBlocksInFlight.find(hash);
+    boost::unordered_map<uint256, CNodeState*, BlockHasher>::iterator itInFlight = mapBlocksInFlight.find(hash);
     if (itInFlight != mapBlocksInFlight.end()) {
-        CNodeState *state = State(itInFlight->second.first);
-        nQueuedValidatedHeaders -= itInFlight->second.second->fValidatedHeaders;
-        state->nBlocksInFlightValidHeaders -= itInFlight->second.second->fValidatedHeaders;
-        state->vBlocksInFlight.erase(itInFlight->second.second);
+        CNodeState *state = itInFlight->second;
+        for (std::vector<QueuedBlock>::iterator it = state->vBlocksInFlight.begin(); it != state->vBlocksInFlight.end(); ++it) {
+            if (it->hash == hash) {
+                nQueuedValidatedHeaders -= it->fValidatedHeaders;
+                state->nBlocksInFlightValidHeaders -= it->fValidatedHeaders;
+                state->vBlocksInFlight.erase(it);
+                break;
+            }
+        }
         state->nBlocksInFlight--;
         state->nStallingSince = 0;
         mapBlocksInFlight.erase(itInFlight);
@@ -352,8 +402,7 @@ bool MarkBlockAsReceived(const uint256& hash) {
 }
 
 // Requires cs_main.
-void MarkBlockAsInFlight(NodeId nodeid, const uint256& hash, const Consensus::Params& consensusParams, CBlockIndex *pindex = NULL) {
-    CNodeState *state = State(nodeid);
+void MarkBlockAsInFlight(CNodeState *state, const uint256& hash, const Consensus::Params& consensusParams, CBlockIndex *pindex = NULL) {
     assert(state != NULL);
 
     // Make sure it's not listed somewhere already.
@@ -362,15 +411,14 @@ void MarkBlockAsInFlight(NodeId nodeid, const uint256& hash, const Consensus::Pa
     int64_t nNow = GetTimeMicros();
     QueuedBlock newentry = {hash, pindex, nNow, pindex != NULL, GetBlockTimeout(nNow, nQueuedValidatedHeaders, consensusParams)};
     nQueuedValidatedHeaders += newentry.fValidatedHeaders;
-    list<QueuedBlock>::iterator it = state->vBlocksInFlight.insert(state->vBlocksInFlight.end(), newentry);
+    state->vBlocksInFlight.push_back(newentry);
     state->nBlocksInFlight++;
     state->nBlocksInFlightValidHeaders += newentry.fValidatedHeaders;
-    mapBlocksInFlight[hash] = std::make_pair(nodeid, it);
+    mapBlocksInFlight[hash] = state;
 }
 
 /** Check whether the last unknown block a peer advertized is not yet known. */
-void ProcessBlockAvailability(NodeId nodeid) {
-    CNodeState *state = State(nodeid);
+void ProcessBlockAvailability(CNodeState *state) {
     assert(state != NULL);
 
     if (!state->hashLastUnknownBlock.IsNull()) {
@@ -384,11 +432,10 @@ void ProcessBlockAvailability(NodeId nodeid) {
 }
 
 /** Update tracking information about which blocks a peer is assumed to have. */
-void UpdateBlockAvailability(NodeId nodeid, const uint256 &hash) {
-    CNodeState *state = State(nodeid);
+void UpdateBlockAvailability(CNodeState *state, const uint256 &hash) {
     assert(state != NULL);
 
-    ProcessBlockAvailability(nodeid);
+    ProcessBlockAvailability(state);
 
     BlockMap::iterator it = mapBlockIndex.find(hash);
     if (it != mapBlockIndex.end() && it->second->nChainWork > 0) {
@@ -422,16 +469,15 @@ CBlockIndex* LastCommonAncestor(CBlockIndex* pa, CBlockIndex* pb) {
 
 /** Update pindexLastCommonBlock and add not-in-flight missing successors to vBlocks, until it has
  *  at most count entries. */
-void FindNextBlocksToDownload(NodeId nodeid, unsigned int count, std::vector<CBlockIndex*>& vBlocks, NodeId& nodeStaller) {
+void FindNextBlocksToDownload(CNodeState *state, unsigned int count, std::vector<CBlockIndex*>& vBlocks, NodeId& nodeStaller) {
     if (count == 0)
         return;
 
     vBlocks.reserve(vBlocks.size() + count);
-    CNodeState *state = State(nodeid);
     assert(state != NULL);
 
     // Make sure pindexBestKnownBlock is up to date, we'll need it.
-    ProcessBlockAvailability(nodeid);
+    ProcessBlockAvailability(state);
 
     if (state->pindexBestKnownBlock == NULL || state->pindexBestKnownBlock->nChainWork < chainActive.Tip()->nChainWork) {
         // This peer has nothing interesting.
@@ -486,7 +532,7 @@ void FindNextBlocksToDownload(NodeId nodeid, unsigned int count, std::vector<CBl
                 // The block is not already downloaded, and not yet in flight.
                 if (pindex->nHeight > nWindowEnd) {
                     // We reached the end of the window.
-                    if (vBlocks.size() == 0 && waitingfor != nodeid) {
+                    if (vBlocks.size() == 0 && waitingfor != state->id) {
                         // We aren't able to fetch anything, but we would be if the download window was one larger.
                         nodeStaller = waitingfor;
                     }
@@ -498,7 +544,7 @@ void FindNextBlocksToDownload(NodeId nodeid, unsigned int count, std::vector<CBl
                 }
             } else if (waitingfor == -1) {
                 // This is the first already-in-flight block.
-                waitingfor = mapBlocksInFlight[pindex->GetBlockHash()].first;
+                waitingfor = mapBlocksInFlight[pindex->GetBlockHash()]->id;
             }
         }
     }
@@ -511,7 +557,10 @@ bool GetNodeStateStats(NodeId nodeid, CNodeStateStats &stats) {
     CNodeState *state = State(nodeid);
     if (state == NULL)
         return false;
-    stats.nMisbehavior = state->nMisbehavior;
+    {
+        LOCK(state->cs_misbehavior);
+        stats.nMisbehavior = state->nMisbehavior;
+    }
     stats.nSyncHeight = state->pindexBestKnownBlock ? state->pindexBestKnownBlock->nHeight : -1;
     stats.nCommonHeight = state->pindexLastCommonBlock ? state->pindexLastCommonBlock->nHeight : -1;
     BOOST_FOREACH(const QueuedBlock& queue, state->vBlocksInFlight) {
@@ -559,6 +608,7 @@ CBlockIndex* FindForkInGlobalIndex(const CChain& chain, const CBlockLocator& loc
 
 CCoinsViewCache *pcoinsTip = NULL;
 CBlockTreeDB *pblocktree = NULL;
+CBlockFilterDB *pblockfilterdb = NULL;
 
 //////////////////////////////////////////////////////////////////////////////
 //
@@ -578,7 +628,7 @@ bool AddOrphanTx(const CTransaction& tx, NodeId peer) EXCLUSIVE_LOCKS_REQUIRED(c
     // have been mined or received.
     // 10,000 orphans, each of which is at most 5,000 bytes big is
     // at most 500 megabytes of orphans:
-    unsigned int sz = GetSerializeSize(tx, SER_NETWORK, tx.nVersion);
+    unsigned int sz = tx.GetTotalSize();
     if (sz > 5000)
     {
         LogPrint("mempool", "ignoring large orphan tx (size: %u, hash: %s)\n", sz, hash.ToString());
@@ -950,7 +1000,7 @@ bool ContextualCheckTransaction(const CTransaction& tx, CValidationState &state,
     if (!saplingActive) {
         // Size limits
         BOOST_STATIC_ASSERT(MAX_BLOCK_SIZE > MAX_TX_SIZE_BEFORE_SAPLING); // sanity
-        if (::GetSerializeSize(tx, SER_NETWORK, PROTOCOL_VERSION) > MAX_TX_SIZE_BEFORE_SAPLING)
+        if (tx.GetTotalSize() > MAX_TX_SIZE_BEFORE_SAPLING)
             return state.DoS(100, error("ContextualCheckTransaction(): size limits failed"),
                             REJECT_INVALID, "bad-txns-oversize");
     }
@@ -1065,7 +1115,12 @@ bool CheckTransaction(const CTransaction& tx, CValidationState &state,
     }
 }
 
-bool CheckTransactionWithoutProofVerification(const CTransaction& tx, CValidationState &state)
+/**
+ * The context-free checks, shared by CTransaction and CTransactionView, which
+ * have the same members. nTxSize is the serialized size of the transaction.
+ */
+template <typename Tx>
+static bool CheckTransactionFields(const Tx& tx, size_t nTxSize, CValidationState &state)
 {
     // Basic checks that don't depend on any context
 
@@ -1125,13 +1180,13 @@ bool CheckTransactionWithoutProofVerification(const CTransaction& tx, CValidatio
     // Size limits
     BOOST_STATIC_ASSERT(MAX_BLOCK_SIZE >= MAX_TX_SIZE_AFTER_SAPLING); // sanity
     BOOST_STATIC_ASSERT(MAX_TX_SIZE_AFTER_SAPLING > MAX_TX_SIZE_BEFORE_SAPLING); // sanity
-    if (::GetSerializeSize(tx, SER_NETWORK, PROTOCOL_VERSION) > MAX_TX_SIZE_AFTER_SAPLING)
+    if (nTxSize > MAX_TX_SIZE_AFTER_SAPLING)
         return state.DoS(100, error("CheckTransaction(): size limits failed"),
                          REJECT_INVALID, "bad-txns-oversize");
 
     // Check for negative or overflow output values
     CAmount nValueOut = 0;
-    BOOST_FOREACH(const CTxOut& txout, tx.vout)
+    for (const auto& txout : tx.vout)
     {
         if (txout.nValue < 0)
             return state.DoS(100, error("CheckTransaction(): txout.nValue negative"),
@@ -1168,7 +1223,7 @@ bool CheckTransactionWithoutProofVerification(const CTransaction& tx, CValidatio
     }
 
     // Ensure that joinsplit values are well-formed
-    BOOST_FOREACH(const JSDescription& joinsplit, tx.vjoinsplit)
+    for (const auto& joinsplit : tx.vjoinsplit)
     {
         if (joinsplit.vpub_old < 0) {
             return state.DoS(100, error("CheckTransaction(): joinsplit.vpub_old negative"),
@@ -1208,7 +1263,7 @@ bool CheckTransactionWithoutProofVerification(const CTransaction& tx, CValidatio
     // to the value pool.
     {
         CAmount nValueIn = 0;
-        for (std::vector<JSDescription>::const_iterator it(tx.vjoinsplit.begin()); it != tx.vjoinsplit.end(); ++it)
+        for (auto it = tx.vjoinsplit.begin(); it != tx.vjoinsplit.end(); ++it)
         {
             nValueIn += it->vpub_new;
 
@@ -1222,7 +1277,7 @@ bool CheckTransactionWithoutProofVerification(const CTransaction& tx, CValidatio
 
     // Check for duplicate inputs
     set<COutPoint> vInOutPoints;
-    BOOST_FOREACH(const CTxIn& txin, tx.vin)
+    for (const auto& txin : tx.vin)
     {
         if (vInOutPoints.count(txin.prevout))
             return state.DoS(100, error("CheckTransaction(): duplicate inputs"),
@@ -1233,7 +1288,7 @@ bool CheckTransactionWithoutProofVerification(const CTransaction& tx, CValidatio
     // Check for duplicate joinsplit nullifiers in this transaction
     {
         set<uint256> vJoinSplitNullifiers;
-        BOOST_FOREACH(const JSDescription& joinsplit, tx.vjoinsplit)
+        for (const auto& joinsplit : tx.vjoinsplit)
         {
             BOOST_FOREACH(const uint256& nf, joinsplit.nullifiers)
             {
@@ -1249,7 +1304,7 @@ bool CheckTransactionWithoutProofVerification(const CTransaction& tx, CValidatio
     // Check for duplicate sapling nullifiers in this transaction
     {
         set<uint256> vSaplingNullifiers;
-        BOOST_FOREACH(const SpendDescription& spend_desc, tx.vShieldedSpend)
+        for (const auto& spend_desc : tx.vShieldedSpend)
         {
             if (vSaplingNullifiers.count(spend_desc.nullifier))
                 return state.DoS(100, error("CheckTransaction(): duplicate nullifiers"),
@@ -1280,7 +1335,7 @@ bool CheckTransactionWithoutProofVerification(const CTransaction& tx, CValidatio
     }
     else
     {
-        BOOST_FOREACH(const CTxIn& txin, tx.vin)
+        for (const auto& txin : tx.vin)
             if (txin.prevout.IsNull())
                 return state.DoS(10, error("CheckTransaction(): prevout is null"),
                                  REJECT_INVALID, "bad-txns-prevout-null");
@@ -1289,6 +1344,16 @@ bool CheckTransactionWithoutProofVerification(const CTransaction& tx, CValidatio
     return true;
 }
 
+bool CheckTransactionWithoutProofVerification(const CTransaction& tx, CValidationState &state)
+{
+    return CheckTransactionFields(tx, tx.GetTotalSize(), state);
+}
+
+bool CheckTransactionWithoutProofVerification(const CTransactionView& tx, CValidationState &state)
+{
+    return CheckTransactionFields(tx, tx.GetSerializeSize(), state);
+}
+
 CAmount GetMinRelayFee(const CTransaction& tx, unsigned int nBytes, bool fAllowFree)
 {
     {
@@ -1820,16 +1885,12 @@ void CheckForkWarningConditionsOnNewFork(CBlockIndex* pindexNewForkTip)
     CheckForkWarningConditions();
 }
 
-// Requires cs_main.
-void Misbehaving(NodeId pnode, int howmuch)
+void static Misbehaving(CNodeState *state, int howmuch)
 {
-    if (howmuch == 0)
-        return;
-
-    CNodeState *state = State(pnode);
-    if (state == NULL)
+    if (howmuch == 0 || state == NULL)
         return;
 
+    LOCK(state->cs_misbehavior);
     state->nMisbehavior += howmuch;
     int banscore = GetArg("-banscore", 100);
     if (state->nMisbehavior >= banscore && state->nMisbehavior - howmuch < banscore)
@@ -1840,6 +1901,17 @@ void Misbehaving(NodeId pnode, int howmuch)
         LogPrintf("%s: %s (%d -> %d)\n", __func__, state->name, state->nMisbehavior-howmuch, state->nMisbehavior);
 }
 
+// Requires cs_main.
+void Misbehaving(NodeId pnode, int howmuch)
+{
+    Misbehaving(State(pnode), howmuch);
+}
+
+void Misbehaving(CNode *pnode, int howmuch)
+{
+    Misbehaving(State(pnode), howmuch);
+}
+
 void static InvalidChainFound(CBlockIndex* pindexNew)
 {
     if (!pindexBestInvalid || pindexNew->nChainWork > pindexBestInvalid->nChainWork)
@@ -1920,6 +1992,50 @@ bool CScriptCheck::operator()() {
     return true;
 }
 
+bool CScriptCheck::operator()(CSignatureBatch& batch) {
+    const CScript &scriptSig = ptxTo->vin[nIn].scriptSig;
+    size_t nBatched = batch.size();
+    if (!VerifyScript(scriptSig, scriptPubKey, nFlags, BatchingTransactionSignatureChecker(ptxTo, nIn, amount, batch, *txdata), consensusBranchId, &error)) {
+        batch.resize(nBatched);
+        return (*this)();
+    }
+    return true;
+}
+
+bool CScriptCheck::IsBatchable() const {
+    if (cacheStore)
+        return false;
+    txnouttype whichType;
+    std::vector<std::vector<unsigned char> > vSolutions;
+    return Solver(scriptPubKey, whichType, vSolutions) && (whichType == TX_PUBKEYHASH || whichType == TX_PUBKEY);
+}
+
+bool RunChecks(std::vector<CScriptCheck>& vChecks)
+{
+    CSignatureBatch batch;
+    std::vector<CScriptCheck*> vDeferred;
+    BOOST_FOREACH(CScriptCheck& check, vChecks) {
+        if (!check.IsBatchable()) {
+            if (!check())
+                return false;
+        } else {
+            size_t nBatched = batch.size();
+            if (!check(batch))
+                return false;
+            if (batch.size() != nBatched)
+                vDeferred.push_back(&check);
+        }
+    }
+    if (batch.Verify())
+        return true;
+    // Find and report the failing check the slow way
+    BOOST_FOREACH(CScriptCheck* pcheck, vDeferred) {
+        if (!(*pcheck)())
+            return false;
+    }
+    return true;
+}
+
 int GetSpendHeight(const CCoinsViewCache& inputs)
 {
     LOCK(cs_main);
@@ -2511,7 +2627,7 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
         }
 
         vPos.push_back(std::make_pair(tx.GetHash(), pos));
-        pos.nTxOffset += ::GetSerializeSize(tx, SER_DISK, CLIENT_VERSION);
+        pos.nTxOffset += tx.GetTotalSize();
     }
 
     view.PushAnchor(sprout_tree);
@@ -2583,6 +2699,10 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
         if (!pblocktree->WriteTxIndex(vPos))
             return AbortNode(state, "Failed to write transaction index");
 
+    if (pblockfilterdb)
+        if (!pblockfilterdb->WriteFilter(BlockFilter(block)))
+            return AbortNode(state, "Failed to write block filter");
+
     // add this block to the view's block chain
     view.SetBestBlock(pindex->GetBlockHash());
 
@@ -2613,7 +2733,13 @@ enum FlushStateMode {
  * if they're too large, if it's been a while since the last write,
  * or always and in all cases if we're in prune mode and are deleting files.
  */
-bool static FlushStateToDisk(CValidationState &state, FlushStateMode mode) {
+/**
+ * If psetFilesToUnlink is set, the files that were pruned are returned in it
+ * for the caller to delete once it has released cs_main. Otherwise they are
+ * deleted here. While the pruning thread is running, other callers only wake
+ * it up instead of pruning themselves.
+ */
+bool static FlushStateToDisk(CValidationState &state, FlushStateMode mode, std::set<int>* psetFilesToUnlink = NULL) {
     LOCK2(cs_main, cs_LastBlockFile);
     static int64_t nLastWrite = 0;
     static int64_t nLastFlush = 0;
@@ -2621,7 +2747,11 @@ bool static FlushStateToDisk(CValidationState &state, FlushStateMode mode) {
     std::set<int> setFilesToPrune;
     bool fFlushForPrune = false;
     try {
-    if (fPruneMode && fCheckForPruning && !fReindex) {
+    if (fPruneMode && fCheckForPruning && !fReindex && fPruneInBackground && !psetFilesToUnlink) {
+        boost::lock_guard<boost::mutex> lock(csPruneThread);
+        fPruneRequested = true;
+        condPruneThread.notify_one();
+    } else if (fPruneMode && fCheckForPruning && !fReindex) {
         FindFilesToPrune(setFilesToPrune);
         fCheckForPruning = false;
         if (!setFilesToPrune.empty()) {
@@ -2680,8 +2810,12 @@ bool static FlushStateToDisk(CValidationState &state, FlushStateMode mode) {
             }
         }
         // Finally remove any pruned files
-        if (fFlushForPrune)
-            UnlinkPrunedFiles(setFilesToPrune);
+        if (fFlushForPrune) {
+            if (psetFilesToUnlink)
+                psetFilesToUnlink->insert(setFilesToPrune.begin(), setFilesToPrune.end());
+            else
+                UnlinkPrunedFiles(setFilesToPrune);
+        }
         nLastWrite = nNow;
     }
     // Flush best chain related state. This can only be done if the blocks / block index write was also done.
@@ -2720,6 +2854,39 @@ void PruneAndFlush() {
     FlushStateToDisk(state, FLUSH_STATE_NONE);
 }
 
+void PruneAndFlush(std::set<int>& setFilesToUnlink) {
+    CValidationState state;
+    fCheckForPruning = true;
+    FlushStateToDisk(state, FLUSH_STATE_NONE, &setFilesToUnlink);
+}
+
+void ThreadPruneBlockFiles()
+{
+    {
+        LOCK(cs_main);
+        fPruneInBackground = true;
+    }
+    try {
+        while (true) {
+            {
+                boost::unique_lock<boost::mutex> lock(csPruneThread);
+                while (!fPruneRequested)
+                    condPruneThread.wait(lock);
+                fPruneRequested = false;
+            }
+            std::set<int> setFilesToUnlink;
+            PruneAndFlush(setFilesToUnlink);
+            // The block index no longer refers to these files, so they can be
+            // deleted without holding cs_main.
+            UnlinkPrunedFiles(setFilesToUnlink);
+        }
+    } catch (const boost::thread_interrupted&) {
+        LOCK(cs_main);
+        fPruneInBackground = false;
+        throw;
+    }
+}
+
 /** Update chainActive and related internal data structures. */
 void static UpdateTip(CBlockIndex *pindexNew) {
     const CChainParams& chainParams = Params();
@@ -3267,6 +3434,9 @@ bool ReceivedBlockTransactions(const CBlock &block, CValidationState& state, CBl
     pindexNew->nDataPos = pos.nPos;
     pindexNew->nUndoPos = 0;
     pindexNew->nStatus |= BLOCK_HAVE_DATA;
+    if (vBlockIndexByFile.size() <= (unsigned int)pos.nFile)
+        vBlockIndexByFile.resize(pos.nFile + 1);
+    vBlockIndexByFile[pos.nFile].push_back(pindexNew);
     pindexNew->RaiseValidity(BLOCK_VALID_TRANSACTIONS);
     setDirtyBlockIndex.insert(pindexNew);
 
@@ -3464,7 +3634,7 @@ bool CheckBlock(const CBlock& block, CValidationState& state,
     // because we receive the wrong transactions for it.
 
     // Size limits
-    if (block.vtx.empty() || block.vtx.size() > MAX_BLOCK_SIZE || ::GetSerializeSize(block, SER_NETWORK, PROTOCOL_VERSION) > MAX_BLOCK_SIZE)
+    if (block.vtx.empty() || block.vtx.size() > MAX_BLOCK_SIZE || block.GetTotalSize() > MAX_BLOCK_SIZE)
         return state.DoS(100, error("CheckBlock(): size limits failed"),
                          REJECT_INVALID, "bad-blk-length");
 
@@ -3681,7 +3851,7 @@ bool AcceptBlock(CBlock& block, CValidationState& state, CBlockIndex** ppindex,
 
     // Write block to history file
     try {
-        unsigned int nBlockSize = ::GetSerializeSize(block, SER_DISK, CLIENT_VERSION);
+        unsigned int nBlockSize = block.GetTotalSize();
         CDiskBlockPos blockPos;
         if (dbp != NULL)
             blockPos = *dbp;
@@ -3789,9 +3959,11 @@ uint64_t CalculateCurrentUsage()
 /* Prune a block file (modify associated database entries)*/
 void PruneOneBlockFile(const int fileNumber)
 {
-    for (BlockMap::iterator it = mapBlockIndex.begin(); it != mapBlockIndex.end(); ++it) {
-        CBlockIndex* pindex = it->second;
-        if (pindex->nFile == fileNumber) {
+    std::vector<CBlockIndex*> vBlockIndex;
+    if ((unsigned int)fileNumber < vBlockIndexByFile.size())
+        vBlockIndex.swap(vBlockIndexByFile[fileNumber]);
+    BOOST_FOREACH(CBlockIndex* pindex, vBlockIndex) {
+        if (pindex->nFile == fileNumber && (pindex->nStatus & BLOCK_HAVE_DATA)) {
             pindex->nStatus &= ~BLOCK_HAVE_DATA;
             pindex->nStatus &= ~BLOCK_HAVE_UNDO;
             pindex->nFile = 0;
@@ -3965,6 +4137,11 @@ bool static LoadBlockIndexDB()
     {
         CBlockIndex* pindex = item.second;
         pindex->nChainWork = (pindex->pprev ? pindex->pprev->nChainWork : 0) + GetBlockProof(*pindex);
+        if (pindex->nStatus & BLOCK_HAVE_DATA) {
+            if (vBlockIndexByFile.size() <= (unsigned int)pindex->nFile)
+                vBlockIndexByFile.resize(pindex->nFile + 1);
+            vBlockIndexByFile[pindex->nFile].push_back(pindex);
+        }
         // We can link the chain of blocks for which we've received transactions at some point.
         // Pruned nodes may have deleted the block.
         if (pindex->nTx > 0) {
@@ -4335,6 +4512,7 @@ void UnloadBlockIndex()
     nSyncStarted = 0;
     mapBlocksUnlinked.clear();
     vinfoBlockFile.clear();
+    vBlockIndexByFile.clear();
     nLastBlockFile = 0;
     nBlockSequenceId = 1;
     mapBlockSource.clear();
@@ -4343,8 +4521,22 @@ void UnloadBlockIndex()
     nPreferredDownload = 0;
     setDirtyBlockIndex.clear();
     setDirtyFileInfo.clear();
-    mapNodeState.clear();
+    // Connected peers keep their state, but forget everything that points
+    // into the block index.
+    BOOST_FOREACH(const PAIRTYPE(NodeId, CNodeState*)& item, mapNodeState) {
+        CNodeState *state = item.second;
+        state->pindexBestKnownBlock = NULL;
+        state->hashLastUnknownBlock.SetNull();
+        state->pindexLastCommonBlock = NULL;
+        state->fSyncStarted = false;
+        state->nStallingSince = 0;
+        state->vBlocksInFlight.clear();
+        state->nBlocksInFlight = 0;
+        state->nBlocksInFlightValidHeaders = 0;
+        nPreferredDownload += state->fPreferredDownload;
+    }
     recentRejects.reset(NULL);
+    headersCache.reset(NULL);
 
     BOOST_FOREACH(BlockMap::value_type& entry, mapBlockIndex) {
         delete entry.second;
@@ -4368,6 +4560,7 @@ bool InitBlockIndex() {
 
     // Initialize global variables that cannot be constructed at startup.
     recentRejects.reset(new CRollingBloomFilter(120000, 0.000001));
+    headersCache.reset(new CHeadersCache(std::max<int64_t>(GetArg("-headerscache", DEFAULT_HEADERS_CACHE_SIZE), MAX_HEADERS_RESULTS)));
 
     // Check whether we're already initialized
     if (chainActive.Genesis() != NULL)
@@ -4383,7 +4576,7 @@ bool InitBlockIndex() {
         try {
             CBlock &block = const_cast<CBlock&>(Params().GenesisBlock());
             // Start new block file
-            unsigned int nBlockSize = ::GetSerializeSize(block, SER_DISK, CLIENT_VERSION);
+            unsigned int nBlockSize = block.GetTotalSize();
             CDiskBlockPos blockPos;
             CValidationState state;
             if (!FindBlockPos(state, blockPos, nBlockSize+8, 0, block.GetBlockTime()))
@@ -4836,6 +5029,18 @@ void static ProcessGetData(CNode* pfrom)
                         }
                     }
                 }
+                // Disconnect node in case we have reached the outbound limit for serving historical blocks,
+                // so that the remaining upload budget goes to relaying new blocks and transactions.
+                // Never disconnect whitelisted nodes.
+                static const int nOneWeek = 7 * 24 * 60 * 60; // assume > 1 week = historical
+                if (send && CNode::OutboundTargetReached(true) && ( ((pindexBestHeader != NULL) && (pindexBestHeader->GetBlockTime() - mi->second->GetBlockTime() > nOneWeek)) || inv.type == MSG_FILTERED_BLOCK) && !pfrom->fWhitelisted)
+                {
+                    LogPrint("net", "historical block serving limit reached, disconnect peer=%d\n", pfrom->GetId());
+
+                    //disconnect node
+                    pfrom->fDisconnect = true;
+                    send = false;
+                }
                 // Pruned nodes may have deleted the block, so check whether
                 // it's available before trying to send.
                 if (send && (mi->second->nStatus & BLOCK_HAVE_DATA))
@@ -4897,7 +5102,7 @@ void static ProcessGetData(CNode* pfrom)
                     CTransaction tx;
                     if (mempool.lookup(inv.hash, tx)) {
                         CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
-                        ss.reserve(1000);
+                        ss.reserve(tx.GetTotalSize());
                         ss << tx;
                         pfrom->PushMessage("tx", ss);
                         pushed = true;
@@ -4947,7 +5152,7 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
         if (pfrom->nVersion != 0)
         {
             pfrom->PushMessage("reject", strCommand, REJECT_DUPLICATE, string("Duplicate version message"));
-            Misbehaving(pfrom->GetId(), 1);
+            Misbehaving(pfrom, 1);
             return false;
         }
 
@@ -5015,7 +5220,7 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
         pfrom->fClient = !(pfrom->nServices & NODE_NETWORK);
 
         // Potentially mark this peer as a preferred download peer.
-        UpdatePreferredDownload(pfrom, State(pfrom->GetId()));
+        UpdatePreferredDownload(pfrom, State(pfrom));
 
         // Change version
         pfrom->PushMessage("verack");
@@ -5080,7 +5285,7 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
     else if (pfrom->nVersion == 0)
     {
         // Must have a version message before anything else
-        Misbehaving(pfrom->GetId(), 1);
+        Misbehaving(pfrom, 1);
         return false;
     }
 
@@ -5092,7 +5297,7 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
         // Mark this node as currently connected, so we update its timestamp later.
         if (pfrom->fNetworkNode) {
             LOCK(cs_main);
-            State(pfrom->GetId())->fCurrentlyConnected = true;
+            State(pfrom)->fCurrentlyConnected = true;
         }
     }
 
@@ -5123,7 +5328,7 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
             return true;
         if (vAddr.size() > 1000)
         {
-            Misbehaving(pfrom->GetId(), 20);
+            Misbehaving(pfrom, 20);
             return error("message addr size() = %u", vAddr.size());
         }
 
@@ -5186,7 +5391,7 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
         vRecv >> vInv;
         if (vInv.size() > MAX_INV_SZ)
         {
-            Misbehaving(pfrom->GetId(), 20);
+            Misbehaving(pfrom, 20);
             return error("message inv size() = %u", vInv.size());
         }
 
@@ -5208,7 +5413,7 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
                 pfrom->AskFor(inv);
 
             if (inv.type == MSG_BLOCK) {
-                UpdateBlockAvailability(pfrom->GetId(), inv.hash);
+                UpdateBlockAvailability(State(pfrom), inv.hash);
                 if (!fAlreadyHave && !fImporting && !fReindex && !mapBlocksInFlight.count(inv.hash)) {
                     // First request the headers preceding the announced block. In the normal fully-synced
                     // case where a new block is announced that succeeds the current tip (no reorganization),
@@ -5219,13 +5424,13 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
                     // doing this will result in the received block being rejected as an orphan in case it is
                     // not a direct successor.
                     pfrom->PushMessage("getheaders", chainActive.GetLocator(pindexBestHeader), inv.hash);
-                    CNodeState *nodestate = State(pfrom->GetId());
+                    CNodeState *nodestate = State(pfrom);
                     if (chainActive.Tip()->GetBlockTime() > GetAdjustedTime() - chainparams.GetConsensus().nPowTargetSpacing * 20 &&
                         nodestate->nBlocksInFlight < MAX_BLOCKS_IN_TRANSIT_PER_PEER) {
                         vToFetch.push_back(inv);
                         // Mark block as in flight already, even though the actual "getdata" message only goes out
                         // later (within the same cs_main lock, though).
-                        MarkBlockAsInFlight(pfrom->GetId(), inv.hash, chainparams.GetConsensus());
+                        MarkBlockAsInFlight(nodestate, inv.hash, chainparams.GetConsensus());
                     }
                     LogPrint("net", "getheaders (%d) %s to peer=%d\n", pindexBestHeader->nHeight, inv.hash.ToString(), pfrom->id);
                 }
@@ -5235,7 +5440,7 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
             GetMainSignals().Inventory(inv.hash);
 
             if (pfrom->nSendSize > (SendBufferSize() * 2)) {
-                Misbehaving(pfrom->GetId(), 50);
+                Misbehaving(pfrom, 50);
                 return error("send buffer size() = %u", pfrom->nSendSize);
             }
         }
@@ -5251,7 +5456,7 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
         vRecv >> vInv;
         if (vInv.size() > MAX_INV_SZ)
         {
-            Misbehaving(pfrom->GetId(), 20);
+            Misbehaving(pfrom, 20);
             return error("message getdata size() = %u", vInv.size());
         }
 
@@ -5330,13 +5535,14 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
                 pindex = chainActive.Next(pindex);
         }
 
-        // we must use CBlocks, as CBlockHeaders won't include the 0x00 nTx count at the end
-        vector<CBlock> vHeaders;
+        // Cached entries already include the 0x00 nTx count that follows each header
+        assert(headersCache);
+        CSerializedHeaders vHeaders;
         int nLimit = MAX_HEADERS_RESULTS;
         LogPrint("net", "getheaders %d to %s from peer=%d\n", (pindex ? pindex->nHeight : -1), hashStop.ToString(), pfrom->id);
         for (; pindex; pindex = chainActive.Next(pindex))
         {
-            vHeaders.push_back(pindex->GetBlockHeader());
+            vHeaders.vEntries.push_back(&headersCache->Get(pindex));
             if (--nLimit <= 0 || pindex->GetBlockHash() == hashStop)
                 break;
         }
@@ -5348,10 +5554,11 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
     {
         vector<uint256> vWorkQueue;
         vector<uint256> vEraseQueue;
-        CTransaction tx;
-        vRecv >> tx;
+        // Hash and check the transaction inside the message buffer, and only
+        // copy it out once it is known to be new and well-formed.
+        const CTransactionView txView((const unsigned char*)vRecv.data(), (const unsigned char*)vRecv.data() + vRecv.size());
 
-        CInv inv(MSG_TX, tx.GetHash());
+        CInv inv(MSG_TX, txView.GetHash());
         pfrom->AddInventoryKnown(inv);
 
         LOCK(cs_main);
@@ -5362,10 +5569,17 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
         pfrom->setAskFor.erase(inv.hash);
         mapAlreadyAskedFor.erase(inv);
 
-        if (!AlreadyHave(inv) && AcceptToMemoryPool(mempool, state, tx, true, &fMissingInputs))
+        bool fNew = !AlreadyHave(inv) && CheckTransactionWithoutProofVerification(txView, state);
+        CTransaction tx;
+        if (fNew || pfrom->fWhitelisted) {
+            tx = txView.ToTransaction();
+        }
+
+        if (fNew && AcceptToMemoryPool(mempool, state, tx, true, &fMissingInputs))
         {
             mempool.check(pcoinsTip);
-            RelayTransaction(tx);
+            // Relay the bytes we received rather than serializing tx again
+            RelayTransaction(tx, CDataStream((const char*)txView.begin(), (const char*)txView.end(), SER_NETWORK, PROTOCOL_VERSION));
             vWorkQueue.push_back(inv.hash);
 
             LogPrint("mempool", "AcceptToMemoryPool: peer=%d %s: accepted %s (poolsz %u)\n",
@@ -5439,7 +5653,7 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
                 LogPrint("mempool", "mapOrphan overflow, removed %u tx\n", nEvicted);
         } else {
             assert(recentRejects);
-            recentRejects->insert(tx.GetHash());
+            recentRejects->insert(inv.hash);
 
             if (pfrom->fWhitelisted) {
                 // Always relay transactions received from whitelisted peers, even
@@ -5456,20 +5670,20 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
                     RelayTransaction(tx);
                 } else {
                     LogPrintf("Not relaying invalid transaction %s from whitelisted peer=%d (%s (code %d))\n",
-                        tx.GetHash().ToString(), pfrom->id, state.GetRejectReason(), state.GetRejectCode());
+                        inv.hash.ToString(), pfrom->id, state.GetRejectReason(), state.GetRejectCode());
                 }
             }
         }
         int nDoS = 0;
         if (state.IsInvalid(nDoS))
         {
-            LogPrint("mempool", "%s from peer=%d %s was not accepted into the memory pool: %s\n", tx.GetHash().ToString(),
+            LogPrint("mempool", "%s from peer=%d %s was not accepted into the memory pool: %s\n", inv.hash.ToString(),
                 pfrom->id, pfrom->cleanSubVer,
                 state.GetRejectReason());
             pfrom->PushMessage("reject", strCommand, state.GetRejectCode(),
                                state.GetRejectReason().substr(0, MAX_REJECT_MESSAGE_LENGTH), inv.hash);
             if (nDoS > 0)
-                Misbehaving(pfrom->GetId(), nDoS);
+                Misbehaving(pfrom, nDoS);
         }
     }
 
@@ -5481,7 +5695,7 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
         // Bypass the normal CBlock deserialization, as we don't want to risk deserializing 2000 full blocks.
         unsigned int nCount = ReadCompactSize(vRecv);
         if (nCount > MAX_HEADERS_RESULTS) {
-            Misbehaving(pfrom->GetId(), 20);
+            Misbehaving(pfrom, 20);
             return error("headers message size = %u", nCount);
         }
         headers.resize(nCount);
@@ -5501,21 +5715,21 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
         BOOST_FOREACH(const CBlockHeader& header, headers) {
             CValidationState state;
             if (pindexLast != NULL && header.hashPrevBlock != pindexLast->GetBlockHash()) {
-                Misbehaving(pfrom->GetId(), 20);
+                Misbehaving(pfrom, 20);
                 return error("non-continuous headers sequence");
             }
             if (!AcceptBlockHeader(header, state, &pindexLast)) {
                 int nDoS;
                 if (state.IsInvalid(nDoS)) {
                     if (nDoS > 0)
-                        Misbehaving(pfrom->GetId(), nDoS);
+                        Misbehaving(pfrom, nDoS);
                     return error("invalid header received");
                 }
             }
         }
 
         if (pindexLast)
-            UpdateBlockAvailability(pfrom->GetId(), pindexLast->GetBlockHash());
+            UpdateBlockAvailability(State(pfrom), pindexLast->GetBlockHash());
 
         if (nCount == MAX_HEADERS_RESULTS && pindexLast) {
             // Headers message had its maximum size; the peer may have more headers.
@@ -5530,14 +5744,31 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
 
     else if (strCommand == "block" && !fImporting && !fReindex) // Ignore blocks received while importing
     {
-        CBlock block;
-        vRecv >> block;
+        const CBlockView blockView((const unsigned char*)vRecv.data(), (const unsigned char*)vRecv.data() + vRecv.size());
 
-        CInv inv(MSG_BLOCK, block.GetHash());
+        CInv inv(MSG_BLOCK, blockView.GetHash());
         LogPrint("net", "received block %s peer=%d\n", inv.hash.ToString(), pfrom->id);
 
         pfrom->AddInventoryKnown(inv);
 
+        {
+            // A block whose data we already have would only be checked again
+            // and then ignored by AcceptBlock, so don't copy it out. A copy
+            // with the same header but different transactions still goes
+            // through CheckBlock below, so the peer that sent it is penalized.
+            LOCK(cs_main);
+            BlockMap::iterator mi = mapBlockIndex.find(inv.hash);
+            if (mi != mapBlockIndex.end() && (mi->second->nStatus & BLOCK_HAVE_DATA)) {
+                bool mutated;
+                uint256 hashMerkleRoot = blockView.BuildMerkleRoot(&mutated);
+                if (hashMerkleRoot == blockView.header.hashMerkleRoot && !mutated) {
+                    MarkBlockAsReceived(inv.hash);
+                    return true;
+                }
+            }
+        }
+
+        CBlock block = blockView.ToBlock();
         CValidationState state;
         // Process all blocks from whitelisted peers, even if not requested,
         // unless we're still syncing with the network.
@@ -5549,10 +5780,8 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
         if (state.IsInvalid(nDoS)) {
             pfrom->PushMessage("reject", strCommand, state.GetRejectCode(),
                                state.GetRejectReason().substr(0, MAX_REJECT_MESSAGE_LENGTH), inv.hash);
-            if (nDoS > 0) {
-                LOCK(cs_main);
-                Misbehaving(pfrom->GetId(), nDoS);
-            }
+            if (nDoS > 0)
+                Misbehaving(pfrom, nDoS);
         }
 
     }
@@ -5582,6 +5811,13 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
 
     else if (strCommand == "mempool")
     {
+        if (CNode::OutboundTargetReached(false) && !pfrom->fWhitelisted)
+        {
+            LogPrint("net", "mempool request with bandwidth limit reached, disconnect peer=%d\n", pfrom->GetId());
+            pfrom->fDisconnect = true;
+            return true;
+        }
+
         LOCK2(cs_main, pfrom->cs_filter);
 
         std::vector<uint256> vtxid;
@@ -5711,7 +5947,7 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
                 // This isn't a Misbehaving(100) (immediate ban) because the
                 // peer might be an older or different implementation with
                 // a different signature key, etc.
-                Misbehaving(pfrom->GetId(), 10);
+                Misbehaving(pfrom, 10);
             }
         }
     }
@@ -5722,7 +5958,7 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
                strCommand == "filteradd"))
     {
         if (pfrom->nVersion >= NO_BLOOM_VERSION) {
-            Misbehaving(pfrom->GetId(), 100);
+            Misbehaving(pfrom, 100);
             return false;
         } else if (GetBoolArg("-enforcenodebloom", false)) {
             pfrom->fDisconnect = true;
@@ -5738,7 +5974,7 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
 
         if (!filter.IsWithinSizeConstraints())
             // There is no excuse for sending a too-large filter
-            Misbehaving(pfrom->GetId(), 100);
+            Misbehaving(pfrom, 100);
         else
         {
             LOCK(pfrom->cs_filter);
@@ -5759,13 +5995,13 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
         // and thus, the maximum size any matched object can have) in a filteradd message
         if (vData.size() > MAX_SCRIPT_ELEMENT_SIZE)
         {
-            Misbehaving(pfrom->GetId(), 100);
+            Misbehaving(pfrom, 100);
         } else {
             LOCK(pfrom->cs_filter);
             if (pfrom->pfilter)
                 pfrom->pfilter->insert(vData);
             else
-                Misbehaving(pfrom->GetId(), 100);
+                Misbehaving(pfrom, 100);
         }
     }
 
@@ -5978,6 +6214,28 @@ bool SendMessages(CNode* pto, bool fSendTrickle)
             }
         }
 
+        // Punishing a peer only needs its own lock, so it isn't held up by cs_main
+        bool fShouldBan;
+        {
+            CNodeState *pstate = State(pto);
+            LOCK(pstate->cs_misbehavior);
+            fShouldBan = pstate->fShouldBan;
+            pstate->fShouldBan = false;
+        }
+        if (fShouldBan) {
+            if (pto->fWhitelisted)
+                LogPrintf("Warning: not punishing whitelisted peer %s!\n", pto->addr.ToString());
+            else {
+                pto->fDisconnect = true;
+                if (pto->addr.IsLocal())
+                    LogPrintf("Warning: not banning local peer %s!\n", pto->addr.ToString());
+                else
+                {
+                    CNode::Ban(pto->addr);
+                }
+            }
+        }
+
         TRY_LOCK(cs_main, lockMain); // Acquire cs_main for IsInitialBlockDownload() and CNodeState()
         if (!lockMain)
             return true;
@@ -6026,21 +6284,7 @@ bool SendMessages(CNode* pto, bool fSendTrickle)
                 pto->PushMessage("addr", vAddr);
         }
 
-        CNodeState &state = *State(pto->GetId());
-        if (state.fShouldBan) {
-            if (pto->fWhitelisted)
-                LogPrintf("Warning: not punishing whitelisted peer %s!\n", pto->addr.ToString());
-            else {
-                pto->fDisconnect = true;
-                if (pto->addr.IsLocal())
-                    LogPrintf("Warning: not banning local peer %s!\n", pto->addr.ToString());
-                else
-                {
-                    CNode::Ban(pto->addr);
-                }
-            }
-            state.fShouldBan = false;
-        }
+        CNodeState &state = *State(pto);
 
         BOOST_FOREACH(const CBlockReject& reject, state.rejects)
             pto->PushMessage("reject", (string)"block", reject.chRejectCode, reject.strRejectReason, reject.hashBlock);
@@ -6156,10 +6400,10 @@ bool SendMessages(CNode* pto, bool fSendTrickle)
         if (!pto->fDisconnect && !pto->fClient && (fFetch || !IsInitialBlockDownload()) && state.nBlocksInFlight < MAX_BLOCKS_IN_TRANSIT_PER_PEER) {
             vector<CBlockIndex*> vToDownload;
             NodeId staller = -1;
-            FindNextBlocksToDownload(pto->GetId(), MAX_BLOCKS_IN_TRANSIT_PER_PEER - state.nBlocksInFlight, vToDownload, staller);
+            FindNextBlocksToDownload(&state, MAX_BLOCKS_IN_TRANSIT_PER_PEER - state.nBlocksInFlight, vToDownload, staller);
             BOOST_FOREACH(CBlockIndex *pindex, vToDownload) {
                 vGetData.push_back(CInv(MSG_BLOCK, pindex->GetBlockHash()));
-                MarkBlockAsInFlight(pto->GetId(), pindex->GetBlockHash(), consensusParams, pindex);
+                MarkBlockAsInFlight(&state, pindex->GetBlockHash(), consensusParams, pindex);
                 LogPrint("net", "Requesting block %s (%d) peer=%d\n", pindex->GetBlockHash().ToString(),
                     pindex->nHeight, pto->id);
             }
@@ -39,10 +39,12 @@
 #include <boost/unordered_map.hpp>
 
 class CBlockIndex;
+class CBlockFilterDB;
 class CBlockTreeDB;
 class CBloomFilter;
 class CInv;
 class CScriptCheck;
+class CTransactionView;
 class CValidationInterface;
 class CValidationState;
 class PrecomputedTransactionData;
@@ -87,6 +89,10 @@ static const unsigned int BLOCK_STALLING_TIMEOUT = 2;
 /** Number of headers sent in one getheaders result. We rely on the assumption that if a peer sends
  *  less than this number, we reached its tip. Changing this value is a protocol upgrade. */
 static const unsigned int MAX_HEADERS_RESULTS = 160;
+/** Default for -headerscache, the number of serialized headers kept for answering getheaders. */
+static const unsigned int DEFAULT_HEADERS_CACHE_SIZE = 4096;
+/** Default for -blockfilterindex, which keeps a filter of each block's transparent scripts and spends. */
+static const bool DEFAULT_BLOCKFILTERINDEX = false;
 /** Size of the "block download window": how far ahead of our current height do we fetch?
  *  Larger windows tolerate larger download speed differences between peer, but increase the potential
  *  degree of disordering of blocks on disk (which make reindexing and in the future perhaps pruning
@@ -227,7 +233,8 @@ CAmount GetBlockSubsidy(int nHeight, const Consensus::Params& consensusParams);
  * space is allocated in a block or undo file, staying below the target. Changing back to unpruned requires a reindex
  * (which in this case means the blockchain must be re-downloaded.)
  *
- * Pruning functions are called from FlushStateToDisk when the global fCheckForPruning flag has been set.
+ * Pruning functions are called from FlushStateToDisk when the global fCheckForPruning flag has been set,
+ * on the pruning thread once it is running.
  * Block and undo files are deleted in lock-step (when blk00003.dat is deleted, so is rev00003.dat.)
  * Pruning cannot take place until the longest chain is at least a certain length (100000 on mainnet, 1000 on testnet, 10 on regtest).
  * Pruning will never delete a block within a defined distance (currently 288) from the active chain's tip.
@@ -247,12 +254,27 @@ void UnlinkPrunedFiles(std::set<int>& setFilesToPrune);
 CBlockIndex * InsertBlockIndex(uint256 hash);
 /** Get statistics from node state */
 bool GetNodeStateStats(NodeId nodeid, CNodeStateStats &stats);
-/** Increase a node's misbehavior score. */
+/** Increase a node's misbehavior score. Requires cs_main. */
 void Misbehaving(NodeId nodeid, int howmuch);
+/** Increase a node's misbehavior score, without needing cs_main. */
+void Misbehaving(CNode* pnode, int howmuch);
 /** Flush all state, indexes and buffers to disk. */
 void FlushStateToDisk();
 /** Prune block files and flush state to disk. */
 void PruneAndFlush();
+/**
+ * Prune block files and flush state to disk, as the pruning thread does. The
+ * pruned files are not deleted, but returned in setFilesToUnlink for the
+ * caller to pass to UnlinkPrunedFiles once the block index no longer refers
+ * to them.
+ */
+void PruneAndFlush(std::set<int>& setFilesToUnlink);
+/**
+ * Run instance of the pruning thread. Once started, it decides which block
+ * files to prune whenever more space is allocated for blocks, and deletes
+ * them after releasing cs_main.
+ */
+void ThreadPruneBlockFiles();
 
 /** (try to) add transaction to memory pool **/
 bool AcceptToMemoryPool(CTxMemPool& pool, CValidationState &state, const CTransaction &tx, bool fLimitFree,
@@ -351,6 +373,8 @@ void UpdateCoins(const CTransaction& tx, CCoinsViewCache& inputs, int nHeight);
 /** Context-independent validity checks */
 bool CheckTransaction(const CTransaction& tx, CValidationState& state, libzcash::ProofVerifier& verifier);
 bool CheckTransactionWithoutProofVerification(const CTransaction& tx, CValidationState &state);
+/** The same checks on a transaction that has not been copied out of its message */
+bool CheckTransactionWithoutProofVerification(const CTransactionView& tx, CValidationState &state);
 
 /** Check for standard transaction types
  * @return True if all outputs (scriptPubKeys) use only standard transaction forms
@@ -414,6 +438,16 @@ public:
 
     bool operator()();
 
+    /** Runs the script with the signatures that are not cached deferred to
+     *  batch. If the script fails anyway, the signatures it added are removed
+     *  and it is checked exactly instead. */
+    bool operator()(CSignatureBatch& batch);
+
+    /** Whether deferring this check's signatures is likely to pay off: only
+     *  the plain pay-to-pubkey(-hash) scripts are expected to succeed exactly
+     *  when all of their signatures are valid. */
+    bool IsBatchable() const;
+
     void swap(CScriptCheck &check) {
         scriptPubKey.swap(check.scriptPubKey);
         std::swap(ptxTo, check.ptxTo);
@@ -429,6 +463,10 @@ public:
     ScriptError GetScriptError() const { return error; }
 };
 
+/** Runs a batch of script checks for CCheckQueue, verifying the signatures of
+ *  the batchable ones together. */
+bool RunChecks(std::vector<CScriptCheck>& vChecks);
+
 
 /** Functions for disk access for blocks */
 bool WriteBlockToDisk(CBlock& block, CDiskBlockPos& pos, const CMessageHeader::MessageStartChars& messageStart);
@@ -559,6 +597,9 @@ extern CCoinsViewCache *pcoinsTip;
 /** Global variable that points to the active block tree (protected by cs_main) */
 extern CBlockTreeDB *pblocktree;
 
+/** Global variable that points to the block filter index, if -blockfilterindex is set (protected by cs_main) */
+extern CBlockFilterDB *pblockfilterdb;
+
 /**
  * Return the spend height, which is one more than the inputs.GetBestBlock().
  * While checking, GetBestBlock() refers to the parent block. (protected by cs_main)
@@ -314,6 +314,12 @@ void AddressCurrentlyConnected(const CService& addr)
 
 uint64_t CNode::nTotalBytesRecv = 0;
 uint64_t CNode::nTotalBytesSent = 0;
+mapMsgCmdSize CNode::mapTotalBytesRecvPerMsgCmd;
+mapMsgCmdSize CNode::mapTotalBytesSentPerMsgCmd;
+uint64_t CNode::nMaxOutboundTotalBytesSentInCycle = 0;
+uint64_t CNode::nMaxOutboundCycleStartTime = 0;
+uint64_t CNode::nMaxOutboundLimit = 0;
+uint64_t CNode::nMaxOutboundTimeframe = DEFAULT_MAX_UPLOAD_TIMEFRAME * 60 * 60;
 CCriticalSection CNode::cs_totalBytesRecv;
 CCriticalSection CNode::cs_totalBytesSent;
 
@@ -549,8 +555,16 @@ void CNode::copyStats(CNodeStats &stats)
     stats.cleanSubVer = cleanSubVer;
     stats.fInbound = fInbound;
     stats.nStartingHeight = nStartingHeight;
-    stats.nSendBytes = nSendBytes;
-    stats.nRecvBytes = nRecvBytes;
+    {
+        LOCK(cs_vSend);
+        stats.mapSendBytesPerMsgCmd = mapSendBytesPerMsgCmd;
+        stats.nSendBytes = nSendBytes;
+    }
+    {
+        LOCK(cs_vRecvMsg);
+        stats.mapRecvBytesPerMsgCmd = mapRecvBytesPerMsgCmd;
+        stats.nRecvBytes = nRecvBytes;
+    }
     stats.fWhitelisted = fWhitelisted;
 
     // It is common for nodes with good ping times to suddenly become lagged,
@@ -603,6 +617,7 @@ bool CNode::ReceiveMsgBytes(const char *pch, unsigned int nBytes)
         nBytes -= handled;
 
         if (msg.complete()) {
+            RecordMsgBytesRecv(msg.hdr.GetCommand(), msg.hdr.nMessageSize + CMessageHeader::HEADER_SIZE);
             msg.nTime = GetTimeMicros();
             messageHandlerCondition.notify_one();
         }
@@ -1787,7 +1802,7 @@ void StartNode(boost::thread_group& threadGroup, CScheduler& scheduler)
     threadGroup.create_thread(boost::bind(&TraceThread<void (*)()>, "msghand", &ThreadMessageHandler));
 
     // Dump network addresses
-    scheduler.scheduleEvery(&DumpAddresses, DUMP_ADDRESSES_INTERVAL);
+    scheduler.scheduleEvery(&DumpAddresses, DUMP_ADDRESSES_INTERVAL, "dumpaddresses");
 }
 
 bool StopNode()
@@ -1852,7 +1867,7 @@ instance_of_cnetcleanup;
 void RelayTransaction(const CTransaction& tx)
 {
     CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
-    ss.reserve(10000);
+    ss.reserve(tx.GetTotalSize());
     ss << tx;
     RelayTransaction(tx, ss);
 }
@@ -1898,6 +1913,56 @@ void CNode::RecordBytesSent(uint64_t bytes)
 {
     LOCK(cs_totalBytesSent);
     nTotalBytesSent += bytes;
+
+    uint64_t now = GetTime();
+    if (nMaxOutboundCycleStartTime + nMaxOutboundTimeframe < now)
+    {
+        // timeframe expired, reset cycle
+        nMaxOutboundCycleStartTime = now;
+        nMaxOutboundTotalBytesSentInCycle = 0;
+    }
+
+    nMaxOutboundTotalBytesSentInCycle += bytes;
+}
+
+// Unknown commands are accounted together so that peers can't grow the maps.
+static const std::string MSG_CMD_OTHER = "*other*";
+
+static void AccountMsgBytes(mapMsgCmdSize& mapBytes, const std::string& strCommand, uint64_t bytes)
+{
+    mapMsgCmdSize::iterator it = mapBytes.find(strCommand);
+    if (it == mapBytes.end()) {
+        it = mapBytes.find(MSG_CMD_OTHER);
+    }
+    assert(it != mapBytes.end());
+    it->second += bytes;
+}
+
+static void InitMsgBytes(mapMsgCmdSize& mapBytes)
+{
+    BOOST_FOREACH(const std::string& msg, getAllNetMessageTypes())
+        mapBytes[msg] = 0;
+    mapBytes[MSG_CMD_OTHER] = 0;
+}
+
+void CNode::RecordMsgBytesRecv(const std::string& strCommand, uint64_t bytes)
+{
+    AccountMsgBytes(mapRecvBytesPerMsgCmd, strCommand, bytes);
+
+    LOCK(cs_totalBytesRecv);
+    if (mapTotalBytesRecvPerMsgCmd.empty())
+        InitMsgBytes(mapTotalBytesRecvPerMsgCmd);
+    AccountMsgBytes(mapTotalBytesRecvPerMsgCmd, strCommand, bytes);
+}
+
+void CNode::RecordMsgBytesSent(const std::string& strCommand, uint64_t bytes)
+{
+    AccountMsgBytes(mapSendBytesPerMsgCmd, strCommand, bytes);
+
+    LOCK(cs_totalBytesSent);
+    if (mapTotalBytesSentPerMsgCmd.empty())
+        InitMsgBytes(mapTotalBytesSentPerMsgCmd);
+    AccountMsgBytes(mapTotalBytesSentPerMsgCmd, strCommand, bytes);
 }
 
 uint64_t CNode::GetTotalBytesRecv()
@@ -1912,6 +1977,95 @@ uint64_t CNode::GetTotalBytesSent()
     return nTotalBytesSent;
 }
 
+mapMsgCmdSize CNode::GetTotalBytesRecvPerMsgCmd()
+{
+    LOCK(cs_totalBytesRecv);
+    return mapTotalBytesRecvPerMsgCmd;
+}
+
+mapMsgCmdSize CNode::GetTotalBytesSentPerMsgCmd()
+{
+    LOCK(cs_totalBytesSent);
+    return mapTotalBytesSentPerMsgCmd;
+}
+
+void CNode::SetMaxOutboundTarget(uint64_t limit)
+{
+    LOCK(cs_totalBytesSent);
+    uint64_t recommendedMinimum = (nMaxOutboundTimeframe / Params().GetConsensus().nPowTargetSpacing) * MAX_BLOCK_SIZE;
+    nMaxOutboundLimit = limit;
+
+    if (limit > 0 && limit < recommendedMinimum)
+        LogPrintf("Max outbound target is very small (%s bytes) and will be overshot. Recommended minimum is %s bytes.\n", nMaxOutboundLimit, recommendedMinimum);
+}
+
+uint64_t CNode::GetMaxOutboundTarget()
+{
+    LOCK(cs_totalBytesSent);
+    return nMaxOutboundLimit;
+}
+
+uint64_t CNode::GetMaxOutboundTimeframe()
+{
+    LOCK(cs_totalBytesSent);
+    return nMaxOutboundTimeframe;
+}
+
+uint64_t CNode::GetMaxOutboundTimeLeftInCycle()
+{
+    LOCK(cs_totalBytesSent);
+    if (nMaxOutboundLimit == 0)
+        return 0;
+
+    if (nMaxOutboundCycleStartTime == 0)
+        return nMaxOutboundTimeframe;
+
+    uint64_t cycleEndTime = nMaxOutboundCycleStartTime + nMaxOutboundTimeframe;
+    uint64_t now = GetTime();
+    return (cycleEndTime < now) ? 0 : cycleEndTime - now;
+}
+
+void CNode::SetMaxOutboundTimeframe(uint64_t timeframe)
+{
+    LOCK(cs_totalBytesSent);
+    if (nMaxOutboundTimeframe != timeframe)
+    {
+        // reset measure-cycle in case of changing
+        // the timeframe
+        nMaxOutboundCycleStartTime = GetTime();
+    }
+    nMaxOutboundTimeframe = timeframe;
+}
+
+bool CNode::OutboundTargetReached(bool historicalBlockServingLimit)
+{
+    LOCK(cs_totalBytesSent);
+    if (nMaxOutboundLimit == 0)
+        return false;
+
+    if (historicalBlockServingLimit)
+    {
+        // keep a large enough buffer to at least relay each block once
+        uint64_t timeLeftInCycle = GetMaxOutboundTimeLeftInCycle();
+        uint64_t buffer = timeLeftInCycle / Params().GetConsensus().nPowTargetSpacing * MAX_BLOCK_SIZE;
+        if (buffer >= nMaxOutboundLimit || nMaxOutboundTotalBytesSentInCycle >= nMaxOutboundLimit - buffer)
+            return true;
+    }
+    else if (nMaxOutboundTotalBytesSentInCycle >= nMaxOutboundLimit)
+        return true;
+
+    return false;
+}
+
+uint64_t CNode::GetOutboundTargetBytesLeft()
+{
+    LOCK(cs_totalBytesSent);
+    if (nMaxOutboundLimit == 0)
+        return 0;
+
+    return (nMaxOutboundTotalBytesSentInCycle >= nMaxOutboundLimit) ? 0 : nMaxOutboundLimit - nMaxOutboundTotalBytesSentInCycle;
+}
+
 void CNode::Fuzz(int nChance)
 {
     if (!fSuccessfullyConnected) return; // Don't fuzz initial handshake
@@ -2090,6 +2244,9 @@ CNode::CNode(SOCKET hSocketIn, const CAddress& addrIn, const std::string& addrNa
     nPingUsecTime = 0;
     fPingQueued = false;
     nMinPingUsecTime = std::numeric_limits<int64_t>::max();
+    pNodeState = NULL;
+    InitMsgBytes(mapSendBytesPerMsgCmd);
+    InitMsgBytes(mapRecvBytesPerMsgCmd);
 
     {
         LOCK(cs_nLastNodeId);
@@ -2201,6 +2358,9 @@ void CNode::EndMessage() UNLOCK_FUNCTION(cs_vSend)
 
     LogPrint("net", "(%d bytes) peer=%d\n", nSize, id);
 
+    const char* pchCommand = &ssSend[MESSAGE_START_SIZE];
+    RecordMsgBytesSent(std::string(pchCommand, strnlen(pchCommand, CMessageHeader::COMMAND_SIZE)), ssSend.size());
+
     std::deque<CSerializeData>::iterator it = vSendMsg.insert(vSendMsg.end(), CSerializeData());
     ssSend.GetAndClear(*it);
     nSendSize += (*it).size();
@@ -34,6 +34,7 @@ class CAddrMan;
 class CBlockIndex;
 class CScheduler;
 class CNode;
+struct CNodeState;
 
 namespace boost {
     class thread_group;
@@ -59,6 +60,10 @@ static const size_t MAPASKFOR_MAX_SZ = MAX_INV_SZ;
 static const size_t SETASKFOR_MAX_SZ = 2 * MAX_INV_SZ;
 /** The maximum number of peer connections to maintain. */
 static const unsigned int DEFAULT_MAX_PEER_CONNECTIONS = 125;
+/** The default for -maxuploadtarget, in MiB. 0 = Unlimited */
+static const uint64_t DEFAULT_MAX_UPLOAD_TARGET = 0;
+/** The default for -maxuploadtimeframe, in hours. */
+static const uint64_t DEFAULT_MAX_UPLOAD_TIMEFRAME = 24;
 /** The period before a network upgrade activates, where connections to upgrading peers are preferred (in blocks). */
 static const int NETWORK_UPGRADE_PEER_PREFERENCE_BLOCK_PERIOD = 24 * 24 * 3;
 
@@ -102,7 +107,7 @@ struct CNodeSignals
     boost::signals2::signal<int ()> GetHeight;
     boost::signals2::signal<bool (CNode*), CombinerAll> ProcessMessages;
     boost::signals2::signal<bool (CNode*, bool), CombinerAll> SendMessages;
-    boost::signals2::signal<void (NodeId, const CNode*)> InitializeNode;
+    boost::signals2::signal<void (NodeId, CNode*)> InitializeNode;
     boost::signals2::signal<void (NodeId)> FinalizeNode;
 };
 
@@ -168,6 +173,7 @@ struct LocalServiceInfo {
 
 extern CCriticalSection cs_mapLocalHost;
 extern std::map<CNetAddr, LocalServiceInfo> mapLocalHost;
+typedef std::map<std::string, uint64_t> mapMsgCmdSize; //command, total bytes
 
 class CNodeStats
 {
@@ -184,7 +190,9 @@ public:
     bool fInbound;
     int nStartingHeight;
     uint64_t nSendBytes;
+    mapMsgCmdSize mapSendBytesPerMsgCmd;
     uint64_t nRecvBytes;
+    mapMsgCmdSize mapRecvBytesPerMsgCmd;
     bool fWhitelisted;
     double dPingTime;
     double dPingWait;
@@ -256,6 +264,11 @@ public:
     uint64_t nRecvBytes;
     int nRecvVersion;
 
+    // Byte counts per message command, including message headers.
+    // mapSendBytesPerMsgCmd is protected by cs_vSend, mapRecvBytesPerMsgCmd by cs_vRecvMsg.
+    mapMsgCmdSize mapSendBytesPerMsgCmd;
+    mapMsgCmdSize mapRecvBytesPerMsgCmd;
+
     int64_t nLastSend;
     int64_t nLastRecv;
     int64_t nTimeConnected;
@@ -287,6 +300,9 @@ public:
     CBloomFilter* pfilter;
     int nRefCount;
     NodeId id;
+    // Validation state of this peer, kept by main.cpp. It is set up by the
+    // InitializeNode signal and freed by FinalizeNode.
+    CNodeState* pNodeState;
 protected:
 
     // Denial-of-service detection/prevention
@@ -340,6 +356,14 @@ private:
     static CCriticalSection cs_totalBytesSent;
     static uint64_t nTotalBytesRecv;
     static uint64_t nTotalBytesSent;
+    static mapMsgCmdSize mapTotalBytesRecvPerMsgCmd;
+    static mapMsgCmdSize mapTotalBytesSentPerMsgCmd;
+
+    // outbound limit & stats
+    static uint64_t nMaxOutboundTotalBytesSentInCycle;
+    static uint64_t nMaxOutboundCycleStartTime;
+    static uint64_t nMaxOutboundLimit;
+    static uint64_t nMaxOutboundTimeframe;
 
     CNode(const CNode&);
     void operator=(const CNode&);
@@ -632,8 +656,36 @@ public:
     static void RecordBytesRecv(uint64_t bytes);
     static void RecordBytesSent(uint64_t bytes);
 
+    // Account a complete message against this peer's and the global per-command totals.
+    // requires LOCK(cs_vRecvMsg)
+    void RecordMsgBytesRecv(const std::string& strCommand, uint64_t bytes);
+    // requires LOCK(cs_vSend)
+    void RecordMsgBytesSent(const std::string& strCommand, uint64_t bytes);
+
     static uint64_t GetTotalBytesRecv();
     static uint64_t GetTotalBytesSent();
+    static mapMsgCmdSize GetTotalBytesRecvPerMsgCmd();
+    static mapMsgCmdSize GetTotalBytesSentPerMsgCmd();
+
+    // Upload target: the number of bytes we aim to send within each timeframe (0 = unlimited).
+    static void SetMaxOutboundTarget(uint64_t limit);
+    static uint64_t GetMaxOutboundTarget();
+
+    // Length in seconds of the cycle over which the upload target is measured.
+    static void SetMaxOutboundTimeframe(uint64_t timeframe);
+    static uint64_t GetMaxOutboundTimeframe();
+
+    // Whether the upload target has been reached. If historicalBlockServingLimit
+    // is true, returns whether we should stop serving historical blocks, which
+    // happens earlier so that enough of the budget is kept to relay new blocks
+    // and transactions for the rest of the cycle.
+    static bool OutboundTargetReached(bool historicalBlockServingLimit);
+
+    // Bytes left in the current cycle, or 0 if there is no upload target.
+    static uint64_t GetOutboundTargetBytesLeft();
+
+    // Seconds left in the current cycle, or 0 if there is no upload target.
+    static uint64_t GetMaxOutboundTimeLeftInCycle();
 };
 
 
@@ -15,7 +15,7 @@ uint256 CBlockHeader::GetHash() const
     return SerializeHash(*this);
 }
 
-uint256 CBlock::BuildMerkleTree(bool* fMutated) const
+uint256 ComputeMerkleTree(std::vector<uint256>& vMerkleTree, bool* fMutated)
 {
     /* WARNING! If you're reading this because you're learning about crypto
        and/or designing a new system that will use merkle trees, keep in mind
@@ -52,13 +52,11 @@ uint256 CBlock::BuildMerkleTree(bool* fMutated) const
        known ways of changing the transactions without affecting the merkle
        root.
     */
-    vMerkleTree.clear();
-    vMerkleTree.reserve(vtx.size() * 2 + 16); // Safe upper bound for the number of total nodes.
-    for (std::vector<CTransaction>::const_iterator it(vtx.begin()); it != vtx.end(); ++it)
-        vMerkleTree.push_back(it->GetHash());
+    const int nLeaves = vMerkleTree.size();
+    vMerkleTree.reserve(nLeaves * 2 + 16); // Safe upper bound for the number of total nodes.
     int j = 0;
     bool mutated = false;
-    for (int nSize = vtx.size(); nSize > 1; nSize = (nSize + 1) / 2)
+    for (int nSize = nLeaves; nSize > 1; nSize = (nSize + 1) / 2)
     {
         for (int i = 0; i < nSize; i += 2)
         {
@@ -78,6 +76,15 @@ uint256 CBlock::BuildMerkleTree(bool* fMutated) const
     return (vMerkleTree.empty() ? uint256() : vMerkleTree.back());
 }
 
+uint256 CBlock::BuildMerkleTree(bool* fMutated) const
+{
+    vMerkleTree.clear();
+    vMerkleTree.reserve(vtx.size() * 2 + 16);
+    for (std::vector<CTransaction>::const_iterator it(vtx.begin()); it != vtx.end(); ++it)
+        vMerkleTree.push_back(it->GetHash());
+    return ComputeMerkleTree(vMerkleTree, fMutated);
+}
+
 std::vector<uint256> CBlock::GetMerkleBranch(int nIndex) const
 {
     if (vMerkleTree.empty())
@@ -109,6 +116,15 @@ uint256 CBlock::CheckMerkleBranch(uint256 hash, const std::vector<uint256>& vMer
     return hash;
 }
 
+unsigned int CBlock::GetTotalSize() const
+{
+    unsigned int nSize = ::GetSerializeSize(*(const CBlockHeader*)this, SER_NETWORK, PROTOCOL_VERSION);
+    nSize += GetSizeOfCompactSize(vtx.size());
+    for (const CTransaction& tx : vtx)
+        nSize += tx.GetTotalSize();
+    return nSize;
+}
+
 std::string CBlock::ToString() const
 {
     std::stringstream s;
@@ -77,6 +77,10 @@ public:
 };
 
 
+/** Extends vMerkleTree, which holds the transaction hashes of a block, with
+ *  the rest of its merkle tree and returns the root; see CBlock::BuildMerkleTree. */
+uint256 ComputeMerkleTree(std::vector<uint256>& vMerkleTree, bool* mutated = NULL);
+
 class CBlock : public CBlockHeader
 {
 public:
@@ -134,6 +138,11 @@ public:
 
     std::vector<uint256> GetMerkleBranch(int nIndex) const;
     static uint256 CheckMerkleBranch(uint256 hash, const std::vector<uint256>& vMerkleBranch, int nIndex);
+
+    // Returns the serialized size of the block, from the sizes its
+    // transactions cached when they were built or deserialized.
+    unsigned int GetTotalSize() const;
+
     std::string ToString() const;
 };
 
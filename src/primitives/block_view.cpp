@@ -0,0 +1,50 @@
+// Copyright (c) 2018 The Zcash developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "primitives/block_view.h"
+
+#include "hash.h"
+#include "streams.h"
+#include "version.h"
+
+#include <algorithm>
+
+// Smallest serialized size of a transaction, used to bound the memory
+// reserved up front for the transaction count.
+static const size_t MIN_TRANSACTION_SIZE = 4 + 1 + 1 + 4;
+
+CBlockView::CBlockView(const unsigned char* pbegin, const unsigned char* pend)
+{
+    CSpanReader s(SER_NETWORK, PROTOCOL_VERSION, pbegin, pend);
+
+    s >> header;
+    CHash256().Write(pbegin, s.data() - pbegin).Finalize(hash.begin());
+
+    uint64_t n = ReadCompactSize(s);
+    vtx.reserve(std::min<uint64_t>(n, s.size() / MIN_TRANSACTION_SIZE));
+    for (uint64_t i = 0; i < n; i++) {
+        vtx.emplace_back(s);
+    }
+    span = CByteSpan(pbegin, s.data());
+}
+
+uint256 CBlockView::BuildMerkleRoot(bool* mutated) const
+{
+    std::vector<uint256> vMerkleTree;
+    vMerkleTree.reserve(vtx.size() * 2 + 16);
+    for (const CTransactionView& tx : vtx) {
+        vMerkleTree.push_back(tx.GetHash());
+    }
+    return ComputeMerkleTree(vMerkleTree, mutated);
+}
+
+CBlock CBlockView::ToBlock() const
+{
+    CBlock block(header);
+    block.vtx.reserve(vtx.size());
+    for (const CTransactionView& tx : vtx) {
+        block.vtx.push_back(tx.ToTransaction());
+    }
+    return block;
+}
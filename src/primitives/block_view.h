@@ -0,0 +1,45 @@
+// Copyright (c) 2018 The Zcash developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef ZCASH_PRIMITIVES_BLOCK_VIEW_H
+#define ZCASH_PRIMITIVES_BLOCK_VIEW_H
+
+#include "primitives/block.h"
+#include "primitives/transaction_view.h"
+#include "uint256.h"
+
+#include <vector>
+
+/** A read-only view of a serialized block, backed by the buffer it was parsed
+ *  from; see CTransactionView. The buffer must outlive the view.
+ */
+class CBlockView
+{
+private:
+    CByteSpan span;
+    uint256 hash;
+
+public:
+    CBlockHeader header;
+    std::vector<CTransactionView> vtx;
+
+    /** Parses the block at the start of [pbegin, pend). Throws
+     *  std::ios_base::failure if the data is not a well-formed block. */
+    CBlockView(const unsigned char* pbegin, const unsigned char* pend);
+
+    const uint256& GetHash() const { return hash; }
+
+    //! The serialized block
+    const unsigned char* begin() const { return span.begin(); }
+    const unsigned char* end() const { return span.end(); }
+    size_t GetSerializeSize() const { return span.size(); }
+
+    /** Returns the merkle root of vtx; see CBlock::BuildMerkleTree. */
+    uint256 BuildMerkleRoot(bool* mutated = NULL) const;
+
+    /** Builds the full block from the header and transaction views. */
+    CBlock ToBlock() const;
+};
+
+#endif // ZCASH_PRIMITIVES_BLOCK_VIEW_H
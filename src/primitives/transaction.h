@@ -7,6 +7,7 @@
 #define BITCOIN_PRIMITIVES_TRANSACTION_H
 
 #include "amount.h"
+#include "hash.h"
 #include "random.h"
 #include "script/script.h"
 #include "serialize.h"
@@ -503,6 +504,8 @@ class CTransaction
 private:
     /** Memory only. */
     const uint256 hash;
+    /** Memory only. Zero if not yet known. */
+    const unsigned int nTotalSize = 0;
     void UpdateHash() const;
 
 protected:
@@ -511,6 +514,10 @@ protected:
      */
     CTransaction(const CMutableTransaction &tx, bool evilDeveloperFlag);
 
+    /** Used by CTransactionView, which has already hashed the serialized transaction. */
+    CTransaction(CMutableTransaction &&tx, const uint256 &hashIn, unsigned int nTotalSizeIn);
+    friend class CTransactionView;
+
 public:
     typedef std::array<unsigned char, 64> joinsplit_sig_t;
     typedef std::array<unsigned char, 64> binding_sig_t;
@@ -569,7 +576,21 @@ public:
 
     CTransaction& operator=(const CTransaction& tx);
 
-    ADD_SERIALIZE_METHODS;
+    template <typename Stream>
+    void Serialize(Stream& s) const {
+        NCONST_PTR(this)->SerializationOp(s, CSerActionSerialize());
+    }
+
+    template <typename Stream>
+    void Unserialize(Stream& s) {
+        // Hash the bytes as they are read, instead of serializing the
+        // transaction again afterwards. The encoding of every field is
+        // canonical, so the result is the same.
+        CHashVerifier<Stream> hs(&s);
+        SerializationOp(hs, CSerActionUnserialize());
+        *const_cast<unsigned int*>(&nTotalSize) = hs.size();
+        *const_cast<uint256*>(&hash) = hs.GetHash();
+    }
 
     template <typename Stream, typename Operation>
     inline void SerializationOp(Stream& s, Operation ser_action) {
@@ -621,12 +642,12 @@ public:
         if (isSaplingV4 && !(vShieldedSpend.empty() && vShieldedOutput.empty())) {
             READWRITE(*const_cast<binding_sig_t*>(&bindingSig));
         }
-        if (ser_action.ForRead())
-            UpdateHash();
     }
 
     template <typename Stream>
-    CTransaction(deserialize_type, Stream& s) : CTransaction(CMutableTransaction(deserialize, s)) {}
+    CTransaction(deserialize_type, Stream& s) : CTransaction() {
+        Unserialize(s);
+    }
 
     bool IsNull() const {
         return vin.empty() && vout.empty();
@@ -636,6 +657,13 @@ public:
         return hash;
     }
 
+    /**
+     * Returns the serialized size of the transaction in bytes. This is
+     * computed along with the hash, and is the same for every serialization
+     * type and version.
+     */
+    unsigned int GetTotalSize() const;
+
     uint32_t GetHeader() const {
         // When serializing v1 and v2, the 4 byte header is nVersion
         uint32_t header = this->nVersion;
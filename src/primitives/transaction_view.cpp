@@ -0,0 +1,214 @@
+// Copyright (c) 2018 The Zcash developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "primitives/transaction_view.h"
+
+#include "hash.h"
+#include "version.h"
+
+#include <algorithm>
+
+namespace {
+
+// Serialized sizes of the parts of shielded descriptions that are skipped.
+const size_t SPEND_DESCRIPTION_TAIL_SIZE =   // after the nullifier
+    32 +                                     // rk
+    libzcash::GROTH_PROOF_SIZE +             // zkproof
+    sizeof(SpendDescription::spend_auth_sig_t);
+const size_t OUTPUT_DESCRIPTION_SIZE =
+    32 + 32 + 32 +                           // cv, cm, ephemeralKey
+    SAPLING_ENC_CIPHERTEXT_SIZE +
+    SAPLING_OUT_CIPHERTEXT_SIZE +
+    libzcash::GROTH_PROOF_SIZE;
+const size_t JOINSPLIT_COMMITMENTS_SIZE =    // commitments, ephemeralKey, randomSeed, macs
+    32 * ZC_NUM_JS_OUTPUTS + 32 + 32 + 32 * ZC_NUM_JS_INPUTS;
+const size_t JOINSPLIT_CIPHERTEXTS_SIZE =
+    sizeof(ZCNoteEncryption::Ciphertext) * ZC_NUM_JS_OUTPUTS;
+
+// Smallest serialized sizes, used to bound the memory reserved up front for
+// element counts read from untrusted data.
+const size_t MIN_TXIN_SIZE = 32 + 4 + 1 + 4;
+const size_t MIN_TXOUT_SIZE = 8 + 1;
+
+template<typename T>
+void ReserveFor(std::vector<T>& v, uint64_t n, const CSpanReader& s, size_t nMinSize)
+{
+    v.reserve(std::min<uint64_t>(n, s.size() / nMinSize));
+}
+
+CByteSpan ReadScript(CSpanReader& s)
+{
+    uint64_t nSize = ReadCompactSize(s);
+    const unsigned char* p = s.skip(nSize);
+    return CByteSpan(p, p + nSize);
+}
+
+}
+
+CTransactionView::CTransactionView(const unsigned char* pbegin, const unsigned char* pend)
+{
+    CSpanReader s(SER_NETWORK, PROTOCOL_VERSION, pbegin, pend);
+    Parse(s);
+}
+
+CTransactionView::CTransactionView(CSpanReader& s)
+{
+    Parse(s);
+}
+
+void CTransactionView::Parse(CSpanReader& s)
+{
+    // This follows CTransaction::SerializationOp
+    const unsigned char* pbegin = s.data();
+
+    uint32_t header;
+    s >> header;
+    fOverwintered = header >> 31;
+    nVersion = header & 0x7FFFFFFF;
+    nVersionGroupId = 0;
+    if (fOverwintered) {
+        s >> nVersionGroupId;
+    }
+
+    bool isOverwinterV3 =
+        fOverwintered &&
+        nVersionGroupId == OVERWINTER_VERSION_GROUP_ID &&
+        nVersion == OVERWINTER_TX_VERSION;
+    bool isSaplingV4 =
+        fOverwintered &&
+        nVersionGroupId == SAPLING_VERSION_GROUP_ID &&
+        nVersion == SAPLING_TX_VERSION;
+    if (fOverwintered && !(isOverwinterV3 || isSaplingV4)) {
+        throw std::ios_base::failure("Unknown transaction format");
+    }
+
+    uint64_t n = ReadCompactSize(s);
+    ReserveFor(vin, n, s, MIN_TXIN_SIZE);
+    for (uint64_t i = 0; i < n; i++) {
+        CTxInView txin;
+        s >> txin.prevout;
+        txin.scriptSig = ReadScript(s);
+        s >> txin.nSequence;
+        vin.push_back(txin);
+    }
+    n = ReadCompactSize(s);
+    ReserveFor(vout, n, s, MIN_TXOUT_SIZE);
+    for (uint64_t i = 0; i < n; i++) {
+        CTxOutView txout;
+        s >> txout.nValue;
+        txout.scriptPubKey = ReadScript(s);
+        vout.push_back(txout);
+    }
+    s >> nLockTime;
+    nExpiryHeight = 0;
+    if (isOverwinterV3 || isSaplingV4) {
+        s >> nExpiryHeight;
+    }
+    valueBalance = 0;
+    if (isSaplingV4) {
+        s >> valueBalance;
+        n = ReadCompactSize(s);
+        ReserveFor(vShieldedSpend, n, s, 64 + 32 + SPEND_DESCRIPTION_TAIL_SIZE);
+        for (uint64_t i = 0; i < n; i++) {
+            SpendDescriptionView spend;
+            const unsigned char* p = s.skip(64); // cv, anchor
+            s >> spend.nullifier;
+            s.skip(SPEND_DESCRIPTION_TAIL_SIZE);
+            spend.data = CByteSpan(p, s.data());
+            vShieldedSpend.push_back(spend);
+        }
+        n = ReadCompactSize(s);
+        ReserveFor(vShieldedOutput, n, s, OUTPUT_DESCRIPTION_SIZE);
+        for (uint64_t i = 0; i < n; i++) {
+            OutputDescriptionView output;
+            const unsigned char* p = s.skip(OUTPUT_DESCRIPTION_SIZE);
+            output.data = CByteSpan(p, s.data());
+            vShieldedOutput.push_back(output);
+        }
+    }
+    if (nVersion >= 2) {
+        bool useGroth = fOverwintered && nVersion >= SAPLING_TX_VERSION;
+        n = ReadCompactSize(s);
+        ReserveFor(vjoinsplit, n, s, 16 + 32 * (1 + ZC_NUM_JS_INPUTS) + JOINSPLIT_COMMITMENTS_SIZE);
+        for (uint64_t i = 0; i < n; i++) {
+            JSDescriptionView joinsplit;
+            const unsigned char* p = s.data();
+            s >> joinsplit.vpub_old;
+            s >> joinsplit.vpub_new;
+            s.skip(32); // anchor
+            s >> joinsplit.nullifiers;
+            s.skip(JOINSPLIT_COMMITMENTS_SIZE);
+            if (useGroth) {
+                s.skip(libzcash::GROTH_PROOF_SIZE);
+            } else {
+                // Decoded on the stack so that malformed points are rejected
+                // exactly as by deserialization
+                libzcash::PHGRProof proof;
+                s >> proof;
+            }
+            s.skip(JOINSPLIT_CIPHERTEXTS_SIZE);
+            joinsplit.data = CByteSpan(p, s.data());
+            vjoinsplit.push_back(joinsplit);
+        }
+        if (n > 0) {
+            const unsigned char* p = s.skip(32);
+            joinSplitPubKey = CByteSpan(p, s.data());
+            p = s.skip(sizeof(CTransaction::joinsplit_sig_t));
+            joinSplitSig = CByteSpan(p, s.data());
+        }
+    }
+    if (isSaplingV4 && !(vShieldedSpend.empty() && vShieldedOutput.empty())) {
+        const unsigned char* p = s.skip(sizeof(CTransaction::binding_sig_t));
+        bindingSig = CByteSpan(p, s.data());
+    }
+
+    span = CByteSpan(pbegin, s.data());
+    CHash256().Write(span.begin(), span.size()).Finalize(hash.begin());
+}
+
+CTransaction CTransactionView::ToTransaction() const
+{
+    // Build the transaction from the parts found by Parse, which has already
+    // checked the layout and hashed the bytes, rather than deserializing and
+    // hashing it again.
+    CMutableTransaction mtx;
+    mtx.fOverwintered = fOverwintered;
+    mtx.nVersion = nVersion;
+    mtx.nVersionGroupId = nVersionGroupId;
+    mtx.vin.reserve(vin.size());
+    for (const CTxInView& txin : vin) {
+        mtx.vin.emplace_back(txin.prevout, CScript(txin.scriptSig.begin(), txin.scriptSig.end()), txin.nSequence);
+    }
+    mtx.vout.reserve(vout.size());
+    for (const CTxOutView& txout : vout) {
+        mtx.vout.emplace_back(txout.nValue, CScript(txout.scriptPubKey.begin(), txout.scriptPubKey.end()));
+    }
+    mtx.nLockTime = nLockTime;
+    mtx.nExpiryHeight = nExpiryHeight;
+    mtx.valueBalance = valueBalance;
+
+    mtx.vShieldedSpend.resize(vShieldedSpend.size());
+    for (size_t i = 0; i < vShieldedSpend.size(); i++) {
+        CSpanReader s(SER_NETWORK, PROTOCOL_VERSION, vShieldedSpend[i].data.begin(), vShieldedSpend[i].data.end());
+        s >> mtx.vShieldedSpend[i];
+    }
+    mtx.vShieldedOutput.resize(vShieldedOutput.size());
+    for (size_t i = 0; i < vShieldedOutput.size(); i++) {
+        CSpanReader s(SER_NETWORK, PROTOCOL_VERSION, vShieldedOutput[i].data.begin(), vShieldedOutput[i].data.end());
+        s >> mtx.vShieldedOutput[i];
+    }
+    // JSDescription reads the proof format from the stream version, which
+    // CTransaction sets to the transaction header
+    const uint32_t header = (uint32_t)nVersion | ((uint32_t)fOverwintered << 31);
+    mtx.vjoinsplit.resize(vjoinsplit.size());
+    for (size_t i = 0; i < vjoinsplit.size(); i++) {
+        CSpanReader s(SER_NETWORK, static_cast<int>(header), vjoinsplit[i].data.begin(), vjoinsplit[i].data.end());
+        s >> mtx.vjoinsplit[i];
+    }
+    std::copy(joinSplitPubKey.begin(), joinSplitPubKey.end(), mtx.joinSplitPubKey.begin());
+    std::copy(joinSplitSig.begin(), joinSplitSig.end(), mtx.joinSplitSig.begin());
+    std::copy(bindingSig.begin(), bindingSig.end(), mtx.bindingSig.begin());
+
+    return CTransaction(std::move(mtx), hash, span.size());
+}
@@ -0,0 +1,121 @@
+// Copyright (c) 2018 The Zcash developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef ZCASH_PRIMITIVES_TRANSACTION_VIEW_H
+#define ZCASH_PRIMITIVES_TRANSACTION_VIEW_H
+
+#include "primitives/transaction.h"
+#include "streams.h"
+#include "uint256.h"
+
+#include <array>
+#include <vector>
+
+/** A range of bytes inside a serialized transaction. */
+struct CByteSpan
+{
+    const unsigned char* pbegin;
+    const unsigned char* pend;
+
+    CByteSpan() : pbegin(nullptr), pend(nullptr) {}
+    CByteSpan(const unsigned char* pbeginIn, const unsigned char* pendIn) : pbegin(pbeginIn), pend(pendIn) {}
+
+    const unsigned char* begin() const { return pbegin; }
+    const unsigned char* end() const { return pend; }
+    size_t size() const { return pend - pbegin; }
+    bool empty() const { return pbegin == pend; }
+};
+
+struct CTxInView
+{
+    COutPoint prevout;
+    CByteSpan scriptSig;
+    uint32_t nSequence;
+};
+
+struct CTxOutView
+{
+    CAmount nValue;
+    CByteSpan scriptPubKey;
+};
+
+struct JSDescriptionView
+{
+    CAmount vpub_old;
+    CAmount vpub_new;
+    std::array<uint256, ZC_NUM_JS_INPUTS> nullifiers;
+    //! The whole description, including the proof and ciphertexts
+    CByteSpan data;
+};
+
+struct SpendDescriptionView
+{
+    uint256 nullifier;
+    CByteSpan data;
+};
+
+struct OutputDescriptionView
+{
+    CByteSpan data;
+};
+
+/** A read-only view of a serialized transaction, backed by the buffer it was
+ *  parsed from.
+ *
+ * Parsing validates the layout of the transaction the same way deserializing
+ * a CTransaction does, but only decodes the fields that hashing and the
+ * context-free checks look at. Scripts, proofs and ciphertexts stay in the
+ * buffer, so a transaction that turns out to be known or invalid is never
+ * copied. The member names follow CTransaction. The buffer must outlive the
+ * view.
+ */
+class CTransactionView
+{
+private:
+    CByteSpan span;
+    uint256 hash;
+
+    void Parse(CSpanReader& s);
+
+public:
+    bool fOverwintered;
+    int32_t nVersion;
+    uint32_t nVersionGroupId;
+    std::vector<CTxInView> vin;
+    std::vector<CTxOutView> vout;
+    uint32_t nLockTime;
+    uint32_t nExpiryHeight;
+    CAmount valueBalance;
+    std::vector<SpendDescriptionView> vShieldedSpend;
+    std::vector<OutputDescriptionView> vShieldedOutput;
+    std::vector<JSDescriptionView> vjoinsplit;
+    CByteSpan joinSplitPubKey;
+    CByteSpan joinSplitSig;
+    CByteSpan bindingSig;
+
+    /** Parses the transaction at the start of [pbegin, pend). Bytes after the
+     *  end of the transaction are ignored. Throws std::ios_base::failure if the
+     *  data is not a well-formed transaction. */
+    CTransactionView(const unsigned char* pbegin, const unsigned char* pend);
+
+    /** Parses the next transaction in s, advancing past it. */
+    explicit CTransactionView(CSpanReader& s);
+
+    const uint256& GetHash() const { return hash; }
+
+    //! The serialized transaction
+    const unsigned char* begin() const { return span.begin(); }
+    const unsigned char* end() const { return span.end(); }
+    size_t GetSerializeSize() const { return span.size(); }
+
+    bool IsCoinBase() const
+    {
+        return (vin.size() == 1 && vin[0].prevout.IsNull());
+    }
+
+    /** Deserializes the full transaction. */
+    CTransaction ToTransaction() const;
+};
+
+#endif // ZCASH_PRIMITIVES_TRANSACTION_VIEW_H
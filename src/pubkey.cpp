@@ -6,6 +6,7 @@
 #include "pubkey.h"
 
 #include <secp256k1.h>
+#include <secp256k1_batch.h>
 #include <secp256k1_recovery.h>
 
 namespace
@@ -134,6 +135,37 @@ bool CExtPubKey::Derive(CExtPubKey &out, unsigned int nChild) const {
     return (!secp256k1_ecdsa_signature_normalize(secp256k1_context_verify, NULL, &sig));
 }
 
+void CSignatureBatch::Add(const uint256& hash, const std::vector<unsigned char>& vchSig, const CPubKey& pubkey)
+{
+    entries.push_back(Entry());
+    Entry& entry = entries.back();
+    entry.hash = hash;
+    entry.pubkey = pubkey;
+    entry.vchSig = vchSig;
+}
+
+bool CSignatureBatch::Verify() const
+{
+    if (entries.empty())
+        return true;
+    std::vector<secp256k1_ecdsa_signature> sigs(entries.size());
+    std::vector<secp256k1_pubkey> pubkeys(entries.size());
+    std::vector<const unsigned char*> msgs(entries.size());
+    for (size_t i = 0; i < entries.size(); i++) {
+        // Parse exactly as CPubKey::Verify does
+        const Entry& entry = entries[i];
+        if (!entry.pubkey.IsValid() || entry.vchSig.empty())
+            return false;
+        if (!secp256k1_ec_pubkey_parse(secp256k1_context_verify, &pubkeys[i], entry.pubkey.begin(), entry.pubkey.size()))
+            return false;
+        if (!secp256k1_ecdsa_signature_parse_der(secp256k1_context_verify, &sigs[i], &entry.vchSig[0], entry.vchSig.size()))
+            return false;
+        secp256k1_ecdsa_signature_normalize(secp256k1_context_verify, &sigs[i], &sigs[i]);
+        msgs[i] = entry.hash.begin();
+    }
+    return secp256k1_ecdsa_verify_batch(secp256k1_context_verify, &sigs[0], &msgs[0], &pubkeys[0], entries.size());
+}
+
 /* static */ int ECCVerifyHandle::refcount = 0;
 
 ECCVerifyHandle::ECCVerifyHandle()
@@ -240,6 +240,36 @@ struct CExtPubKey {
     }
 };
 
+/**
+ * A set of signatures collected for verification in one go. Verify() gives the
+ * same answer as calling CPubKey::Verify on every entry and and-ing the
+ * results, but shares work between the signatures, so it is cheaper when
+ * most batches are expected to be valid. It does not say which entry failed.
+ */
+class CSignatureBatch
+{
+private:
+    struct Entry {
+        uint256 hash;
+        CPubKey pubkey;
+        std::vector<unsigned char> vchSig;
+    };
+    std::vector<Entry> entries;
+
+public:
+    void Add(const uint256& hash, const std::vector<unsigned char>& vchSig, const CPubKey& pubkey);
+
+    size_t size() const { return entries.size(); }
+
+    //! Drop the entries added after the first n.
+    void resize(size_t n) { entries.resize(n); }
+
+    void clear() { entries.clear(); }
+
+    //! Returns true if every signature in the batch is valid.
+    bool Verify() const;
+};
+
 /** Users of this module must hold an ECCVerifyHandle. The constructor and
  *  destructor of these are not allowed to run in parallel, though. */
 class ECCVerifyHandle
@@ -22,6 +22,8 @@
 using namespace std;
 
 static const size_t MAX_GETUTXOS_OUTPOINTS = 15; //allow a max of 15 outpoints to be queried at once
+//! Work queue for REST requests, so that they are served while RPC calls back up
+static const char* const HTTP_REST_QUEUE = "rest";
 
 enum RetFormat {
     RF_UNDEF,
@@ -603,8 +605,9 @@ static const struct {
 
 bool StartREST()
 {
+    RegisterHTTPWorkQueue(HTTP_REST_QUEUE, 1);
     for (unsigned int i = 0; i < ARRAYLEN(uri_prefixes); i++)
-        RegisterHTTPHandler(uri_prefixes[i].prefix, false, uri_prefixes[i].handler);
+        RegisterHTTPHandler(uri_prefixes[i].prefix, false, uri_prefixes[i].handler, HTTP_REST_QUEUE);
     return true;
 }
 
@@ -0,0 +1,361 @@
+// Copyright (c) 2018 The Zcash developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "rpccbor.h"
+
+#include "crypto/common.h"
+#include "utilstrencodings.h"
+
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+namespace {
+
+enum CBORMajorType {
+    CBOR_UINT = 0,
+    CBOR_NEGINT = 1,
+    CBOR_BYTES = 2,
+    CBOR_TEXT = 3,
+    CBOR_ARRAY = 4,
+    CBOR_MAP = 5,
+    CBOR_TAG = 6,
+    CBOR_SIMPLE = 7,
+};
+
+static const unsigned char CBOR_FALSE = 0xf4;
+static const unsigned char CBOR_TRUE = 0xf5;
+static const unsigned char CBOR_NULL = 0xf6;
+static const unsigned char CBOR_FLOAT64 = 0xfb;
+
+//! Maximum nesting depth accepted when decoding, matching the JSON parser
+static const unsigned int MAX_CBOR_DEPTH = 512;
+
+//! Calls whose (non-verbose) result is serialized data
+static const char* const rawResultMethods[] = {
+    "createrawtransaction",
+    "getblock",
+    "getblockheader",
+    "getrawtransaction",
+    "gettxoutproof",
+};
+
+bool IsRawResultMethod(const std::string& strMethod)
+{
+    for (size_t i = 0; i < ARRAYLEN(rawResultMethods); i++) {
+        if (strMethod == rawResultMethods[i])
+            return true;
+    }
+    return false;
+}
+
+void WriteHead(std::string& out, CBORMajorType type, uint64_t n)
+{
+    unsigned char buf[9];
+    buf[0] = type << 5;
+    size_t len;
+    if (n < 24) {
+        buf[0] |= n;
+        len = 1;
+    } else if (n <= 0xff) {
+        buf[0] |= 24;
+        buf[1] = n;
+        len = 2;
+    } else if (n <= 0xffff) {
+        buf[0] |= 25;
+        buf[1] = n >> 8;
+        buf[2] = n;
+        len = 3;
+    } else if (n <= 0xffffffff) {
+        buf[0] |= 26;
+        WriteBE32(buf + 1, n);
+        len = 5;
+    } else {
+        buf[0] |= 27;
+        WriteBE64(buf + 1, n);
+        len = 9;
+    }
+    out.append((const char*)buf, len);
+}
+
+void WriteString(std::string& out, CBORMajorType type, const std::string& str)
+{
+    WriteHead(out, type, str.size());
+    out.append(str);
+}
+
+void WriteNumber(std::string& out, const UniValue& val)
+{
+    const std::string& str = val.getValStr();
+    if (str.find_first_of(".eE") == std::string::npos) {
+        int64_t n;
+        if (ParseInt64(str, &n)) {
+            if (n >= 0)
+                WriteHead(out, CBOR_UINT, n);
+            else
+                WriteHead(out, CBOR_NEGINT, -1 - n);
+            return;
+        }
+        // Only values above the int64_t range remain, which UniValue
+        // produces from setInt(uint64_t)
+        if (!str.empty() && str[0] != '-' && str.size() <= 20) {
+            uint64_t u = 0;
+            bool fValid = true;
+            for (size_t i = 0; i < str.size() && fValid; i++) {
+                fValid = str[i] >= '0' && str[i] <= '9' && u <= (std::numeric_limits<uint64_t>::max() - (str[i] - '0')) / 10;
+                u = u * 10 + (str[i] - '0');
+            }
+            if (fValid) {
+                WriteHead(out, CBOR_UINT, u);
+                return;
+            }
+        }
+    }
+    double d = val.get_real();
+    uint64_t bits;
+    static_assert(sizeof(d) == sizeof(bits), "double must be 64 bits");
+    std::memcpy(&bits, &d, sizeof(bits));
+    unsigned char buf[9];
+    buf[0] = CBOR_FLOAT64;
+    WriteBE64(buf + 1, bits);
+    out.append((const char*)buf, sizeof(buf));
+}
+
+class CBORReader
+{
+private:
+    const unsigned char* p;
+    const unsigned char* end;
+
+    bool ReadHead(int& type, int& info, uint64_t& n)
+    {
+        if (p == end)
+            return false;
+        type = *p >> 5;
+        info = *p & 0x1f;
+        p++;
+        size_t len;
+        if (info < 24) {
+            n = info;
+            return true;
+        } else if (info == 24) {
+            len = 1;
+        } else if (info == 25) {
+            len = 2;
+        } else if (info == 26) {
+            len = 4;
+        } else if (info == 27) {
+            len = 8;
+        } else {
+            // Indefinite lengths and reserved values
+            return false;
+        }
+        if ((size_t)(end - p) < len)
+            return false;
+        n = 0;
+        for (size_t i = 0; i < len; i++)
+            n = (n << 8) | p[i];
+        p += len;
+        return true;
+    }
+
+    bool ReadString(uint64_t n, std::string& str)
+    {
+        if ((uint64_t)(end - p) < n)
+            return false;
+        str.assign((const char*)p, n);
+        p += n;
+        return true;
+    }
+
+    static double DecodeHalf(uint16_t h)
+    {
+        int exp = (h >> 10) & 0x1f;
+        int mant = h & 0x3ff;
+        double d;
+        if (exp == 0)
+            d = std::ldexp(mant, -24);
+        else if (exp != 31)
+            d = std::ldexp(mant + 1024, exp - 25);
+        else
+            d = mant == 0 ? INFINITY : NAN;
+        return (h & 0x8000) ? -d : d;
+    }
+
+public:
+    CBORReader(const std::string& str) :
+        p((const unsigned char*)str.data()), end(p + str.size()) {}
+
+    bool AtEnd() const { return p == end; }
+
+    //! JSON has no representation for infinities and NaN
+    static bool SetFloat(UniValue& val, double d)
+    {
+        if (!std::isfinite(d))
+            return false;
+        val.setFloat(d);
+        return true;
+    }
+
+    bool Read(UniValue& val, unsigned int nDepth = 0)
+    {
+        if (nDepth > MAX_CBOR_DEPTH)
+            return false;
+        int type, info;
+        uint64_t n;
+        if (!ReadHead(type, info, n))
+            return false;
+
+        switch (type) {
+        case CBOR_UINT:
+            val.setInt(n);
+            return true;
+        case CBOR_NEGINT:
+            if (n > (uint64_t)std::numeric_limits<int64_t>::max())
+                return false;
+            val.setInt(-1 - (int64_t)n);
+            return true;
+        case CBOR_BYTES: {
+            std::string str;
+            if (!ReadString(n, str))
+                return false;
+            val.setStr(HexStr(str.begin(), str.end()));
+            return true;
+        }
+        case CBOR_TEXT: {
+            std::string str;
+            if (!ReadString(n, str))
+                return false;
+            val.setStr(str);
+            return true;
+        }
+        case CBOR_ARRAY:
+            if (n > (uint64_t)(end - p))
+                return false;
+            val.setArray();
+            for (uint64_t i = 0; i < n; i++) {
+                UniValue elem;
+                if (!Read(elem, nDepth + 1))
+                    return false;
+                val.push_back(elem);
+            }
+            return true;
+        case CBOR_MAP:
+            if (n > (uint64_t)(end - p) / 2)
+                return false;
+            val.setObject();
+            for (uint64_t i = 0; i < n; i++) {
+                int keyType, keyInfo;
+                uint64_t nKeySize;
+                std::string key;
+                UniValue elem;
+                if (!ReadHead(keyType, keyInfo, nKeySize) || keyType != CBOR_TEXT ||
+                    !ReadString(nKeySize, key) || !Read(elem, nDepth + 1))
+                    return false;
+                val.pushKV(key, elem);
+            }
+            return true;
+        case CBOR_TAG:
+            // Tags only annotate the item that follows
+            return Read(val, nDepth + 1);
+        case CBOR_SIMPLE:
+            if (info == 20) {
+                val.setBool(false);
+            } else if (info == 21) {
+                val.setBool(true);
+            } else if (info == 22 || info == 23) {
+                val.setNull();
+            } else if (info == 25) {
+                return SetFloat(val, DecodeHalf(n));
+            } else if (info == 26) {
+                uint32_t bits = n;
+                float f;
+                std::memcpy(&f, &bits, sizeof(f));
+                return SetFloat(val, f);
+            } else if (info == 27) {
+                double d;
+                std::memcpy(&d, &n, sizeof(d));
+                return SetFloat(val, d);
+            } else {
+                return false;
+            }
+            return true;
+        }
+        return false;
+    }
+};
+
+}
+
+void EncodeCBOR(std::string& out, const UniValue& val, bool fBytes)
+{
+    switch (val.getType()) {
+    case UniValue::VNULL:
+        out.push_back(CBOR_NULL);
+        break;
+    case UniValue::VBOOL:
+        out.push_back(val.isTrue() ? CBOR_TRUE : CBOR_FALSE);
+        break;
+    case UniValue::VNUM:
+        WriteNumber(out, val);
+        break;
+    case UniValue::VSTR:
+        WriteString(out, fBytes ? CBOR_BYTES : CBOR_TEXT, val.get_str());
+        break;
+    case UniValue::VARR:
+        WriteHead(out, CBOR_ARRAY, val.size());
+        for (size_t i = 0; i < val.size(); i++)
+            EncodeCBOR(out, val[i]);
+        break;
+    case UniValue::VOBJ: {
+        const std::vector<std::string>& keys = val.getKeys();
+        const std::vector<UniValue>& values = val.getValues();
+        WriteHead(out, CBOR_MAP, keys.size());
+        for (size_t i = 0; i < keys.size(); i++) {
+            WriteString(out, CBOR_TEXT, keys[i]);
+            EncodeCBOR(out, values[i], keys[i] == "hex");
+        }
+        break;
+    }
+    }
+}
+
+bool DecodeCBOR(const std::string& str, UniValue& val)
+{
+    CBORReader reader(str);
+    return reader.Read(val) && reader.AtEnd();
+}
+
+static void WriteReply(std::string& out, const std::string& strMethod, const UniValue& result, const UniValue& error, const UniValue& id)
+{
+    WriteHead(out, CBOR_MAP, 3);
+    WriteString(out, CBOR_TEXT, "result");
+    EncodeCBOR(out, result, IsRawResultMethod(strMethod));
+    WriteString(out, CBOR_TEXT, "error");
+    EncodeCBOR(out, error);
+    WriteString(out, CBOR_TEXT, "id");
+    EncodeCBOR(out, id);
+}
+
+std::string CBORRPCReply(const std::string& strMethod, const UniValue& result, const UniValue& error, const UniValue& id)
+{
+    std::string out;
+    WriteReply(out, strMethod, result, error, id);
+    return out;
+}
+
+std::string CBORRPCBatchReply(const UniValue& vReq, const UniValue& vReplies)
+{
+    std::string out;
+    WriteHead(out, CBOR_ARRAY, vReplies.size());
+    for (size_t i = 0; i < vReplies.size(); i++) {
+        const UniValue& method = find_value(vReq[i], "method");
+        WriteReply(out, method.isStr() ? method.get_str() : "",
+                   find_value(vReplies[i], "result"),
+                   find_value(vReplies[i], "error"),
+                   find_value(vReplies[i], "id"));
+    }
+    return out;
+}
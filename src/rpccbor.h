@@ -0,0 +1,43 @@
+// Copyright (c) 2018 The Zcash developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef ZCASH_RPCCBOR_H
+#define ZCASH_RPCCBOR_H
+
+#include <string>
+
+#include <univalue.h>
+
+/**
+ * CBOR (RFC 7049) encoding of RPC requests and replies, used by the HTTP
+ * server instead of JSON when a client sends or accepts "application/cbor".
+ *
+ * Requests and replies have the same shape as their JSON-RPC counterparts.
+ * Binary data travels as CBOR byte strings instead of hex: byte strings in a
+ * request are handed to the RPC handlers as hex strings, and serialized data
+ * in a reply (members named "hex", and the result of calls like
+ * getrawtransaction without verbose output) is sent back as byte strings.
+ * Handlers produce that data as raw bytes when run inside an
+ * RPCRawBytesScope, so the reply must be built from their results that way.
+ */
+
+static const char* const CBOR_CONTENT_TYPE = "application/cbor";
+
+/** Appends the CBOR encoding of val to out. If fBytes is set, a string val
+ *  holds raw bytes and is written as a byte string. */
+void EncodeCBOR(std::string& out, const UniValue& val, bool fBytes = false);
+
+/** Decodes a single CBOR data item spanning all of str. Returns false if str
+ *  is malformed or uses a feature with no JSON equivalent (indefinite-length
+ *  items, non-string map keys). */
+bool DecodeCBOR(const std::string& str, UniValue& val);
+
+/** Builds the CBOR reply to a call of strMethod. */
+std::string CBORRPCReply(const std::string& strMethod, const UniValue& result, const UniValue& error, const UniValue& id);
+
+/** Builds the CBOR reply to a batch of calls, from the reply objects returned
+ *  by JSONRPCExecBatchReplies(). */
+std::string CBORRPCBatchReply(const UniValue& vReq, const UniValue& vReplies);
+
+#endif // ZCASH_RPCCBOR_H
@@ -105,6 +105,7 @@ static const CRPCConvertParam vRPCConvertParams[] =
     { "zcrawjoinsplit", 4 },
     { "zcbenchmark", 1 },
     { "zcbenchmark", 2 },
+    { "zcbenchmark", 3 },
     { "getblocksubsidy", 0},
     { "z_listaddresses", 0},
     { "z_listreceivedbyaddress", 1},
@@ -129,6 +130,8 @@ static const CRPCConvertParam vRPCConvertParams[] =
     { "z_getoperationresult", 0},
     { "z_importkey", 2 },
     { "z_importviewingkey", 2 },
+    { "z_importmulti", 0 },
+    { "z_importmulti", 1 },
     { "z_getpaymentdisclosure", 1},
     { "z_getpaymentdisclosure", 2}
 };
@@ -4,12 +4,14 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "clientversion.h"
+#include "httpserver.h"
 #include "init.h"
 #include "key_io.h"
 #include "main.h"
 #include "net.h"
 #include "netbase.h"
 #include "rpcserver.h"
+#include "scheduler.h"
 #include "timedata.h"
 #include "util.h"
 #ifdef ENABLE_WALLET
@@ -135,7 +137,7 @@ public:
             int nRequired;
             ExtractDestinations(subscript, whichType, addresses, nRequired);
             obj.push_back(Pair("script", GetTxnOutputType(whichType)));
-            obj.push_back(Pair("hex", HexStr(subscript.begin(), subscript.end())));
+            obj.push_back(Pair("hex", RPCBytesStr(subscript.begin(), subscript.end())));
             UniValue a(UniValue::VARR);
             for (const CTxDestination& addr : addresses) {
                 a.push_back(EncodeDestination(addr));
@@ -459,3 +461,103 @@ UniValue setmocktime(const UniValue& params, bool fHelp)
 
     return NullUniValue;
 }
+
+UniValue getrpcqueueinfo(const UniValue& params, bool fHelp)
+{
+    if (fHelp || params.size() != 0)
+        throw runtime_error(
+            "getrpcqueueinfo\n"
+            "\nReturns the state of the work queues that serve HTTP requests.\n"
+            "\nResult:\n"
+            "[\n"
+            "  {\n"
+            "    \"name\": \"xxxx\",          (string) The queue name (rpc, fastrpc, wallet or rest)\n"
+            "    \"threads\": n,            (numeric) The number of worker threads\n"
+            "    \"idle\": n,               (numeric) The number of those threads waiting for work\n"
+            "    \"minthreads\": n,         (numeric) The number of threads that are always kept\n"
+            "    \"maxthreads\": n,         (numeric) The most threads the queue will start\n"
+            "    \"depth\": n,              (numeric) The number of requests waiting\n"
+            "    \"maxdepth\": n,           (numeric) The most requests that may wait before new ones are refused\n"
+            "    \"processed\": n,          (numeric) The number of requests taken off the queue\n"
+            "    \"rejected\": n,           (numeric) The number of requests refused because the queue was full\n"
+            "    \"avgwait\": x.xxx,        (numeric) The average time requests waited in the queue, in milliseconds\n"
+            "    \"maxwait\": x.xxx         (numeric) The longest time a request waited in the queue, in milliseconds\n"
+            "  }\n"
+            "  ,...\n"
+            "]\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getrpcqueueinfo", "")
+            + HelpExampleRpc("getrpcqueueinfo", "")
+        );
+
+    UniValue ret(UniValue::VARR);
+    BOOST_FOREACH(const HTTPWorkQueueStats& stats, GetHTTPWorkQueueStats()) {
+        UniValue obj(UniValue::VOBJ);
+        obj.push_back(Pair("name", stats.name));
+        obj.push_back(Pair("threads", stats.nThreads));
+        obj.push_back(Pair("idle", stats.nIdleThreads));
+        obj.push_back(Pair("minthreads", stats.nMinThreads));
+        obj.push_back(Pair("maxthreads", stats.nMaxThreads));
+        obj.push_back(Pair("depth", (uint64_t)stats.nDepth));
+        obj.push_back(Pair("maxdepth", (uint64_t)stats.nMaxDepth));
+        obj.push_back(Pair("processed", stats.nProcessed));
+        obj.push_back(Pair("rejected", stats.nRejected));
+        obj.push_back(Pair("avgwait", stats.nProcessed ? stats.nTotalWaitMicros * 0.001 / stats.nProcessed : 0.0));
+        obj.push_back(Pair("maxwait", stats.nMaxWaitMicros * 0.001));
+        ret.push_back(obj);
+    }
+    return ret;
+}
+
+UniValue getschedulerinfo(const UniValue& params, bool fHelp)
+{
+    if (fHelp || params.size() != 0)
+        throw runtime_error(
+            "getschedulerinfo\n"
+            "\nReturns how the background tasks have run, by task.\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"pending\": n,             (numeric) The number of tasks waiting to run\n"
+            "  \"tasks\": [\n"
+            "    {\n"
+            "      \"name\": \"xxxx\",        (string) The task name, empty for tasks scheduled without one\n"
+            "      \"runs\": n,             (numeric) The number of times the task ran\n"
+            "      \"overruns\": n,         (numeric) The number of runs that took longer than the task's interval\n"
+            "      \"avglatency\": x.xxx,   (numeric) The average time from when a run was due until it started, in milliseconds\n"
+            "      \"maxlatency\": x.xxx,   (numeric) The longest time a run waited to start, in milliseconds\n"
+            "      \"avgruntime\": x.xxx,   (numeric) The average time a run took, in milliseconds\n"
+            "      \"maxruntime\": x.xxx    (numeric) The longest time a run took, in milliseconds\n"
+            "    }\n"
+            "    ,...\n"
+            "  ]\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getschedulerinfo", "")
+            + HelpExampleRpc("getschedulerinfo", "")
+        );
+
+    if (!pschedulerMain)
+        throw JSONRPCError(RPC_IN_WARMUP, "The scheduler is not running");
+
+    boost::chrono::system_clock::time_point first, last;
+    size_t nPending = pschedulerMain->getQueueInfo(first, last);
+    UniValue tasks(UniValue::VARR);
+    typedef std::map<std::string, CScheduler::TaskStats> StatsMap;
+    BOOST_FOREACH(const StatsMap::value_type& item, pschedulerMain->getTaskStats()) {
+        const CScheduler::TaskStats& stats = item.second;
+        UniValue obj(UniValue::VOBJ);
+        obj.push_back(Pair("name", item.first));
+        obj.push_back(Pair("runs", stats.nRuns));
+        obj.push_back(Pair("overruns", stats.nOverruns));
+        obj.push_back(Pair("avglatency", stats.nRuns ? stats.nTotalLatencyMicros * 0.001 / stats.nRuns : 0.0));
+        obj.push_back(Pair("maxlatency", stats.nMaxLatencyMicros * 0.001));
+        obj.push_back(Pair("avgruntime", stats.nRuns ? stats.nTotalRunMicros * 0.001 / stats.nRuns : 0.0));
+        obj.push_back(Pair("maxruntime", stats.nMaxRunMicros * 0.001));
+        tasks.push_back(obj);
+    }
+
+    UniValue ret(UniValue::VOBJ);
+    ret.push_back(Pair("pending", (uint64_t)nPending));
+    ret.push_back(Pair("tasks", tasks));
+    return ret;
+}
@@ -39,7 +39,7 @@ void ScriptPubKeyToJSON(const CScript& scriptPubKey, UniValue& out, bool fInclud
 
     out.push_back(Pair("asm", ScriptToAsmStr(scriptPubKey)));
     if (fIncludeHex)
-        out.push_back(Pair("hex", HexStr(scriptPubKey.begin(), scriptPubKey.end())));
+        out.push_back(Pair("hex", RPCBytesStr(scriptPubKey.begin(), scriptPubKey.end())));
 
     if (!ExtractDestinations(scriptPubKey, type, addresses, nRequired)) {
         out.push_back(Pair("type", GetTxnOutputType(type)));
@@ -136,7 +136,7 @@ void TxToJSON(const CTransaction& tx, const uint256 hashBlock, UniValue& entry)
             in.push_back(Pair("vout", (int64_t)txin.prevout.n));
             UniValue o(UniValue::VOBJ);
             o.push_back(Pair("asm", ScriptToAsmStr(txin.scriptSig, true)));
-            o.push_back(Pair("hex", HexStr(txin.scriptSig.begin(), txin.scriptSig.end())));
+            o.push_back(Pair("hex", RPCBytesStr(txin.scriptSig.begin(), txin.scriptSig.end())));
             in.push_back(Pair("scriptSig", o));
         }
         in.push_back(Pair("sequence", (int64_t)txin.nSequence));
@@ -283,7 +283,7 @@ UniValue getrawtransaction(const UniValue& params, bool fHelp)
     if (!GetTransaction(hash, tx, hashBlock, true))
         throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available about transaction");
 
-    string strHex = EncodeHexTx(tx);
+    string strHex = RPCEncodeTx(tx);
 
     if (!fVerbose)
         return strHex;
@@ -371,7 +371,7 @@ UniValue gettxoutproof(const UniValue& params, bool fHelp)
     CDataStream ssMB(SER_NETWORK, PROTOCOL_VERSION);
     CMerkleBlock mb(block, setTxids);
     ssMB << mb;
-    std::string strHex = HexStr(ssMB.begin(), ssMB.end());
+    std::string strHex = RPCBytesStr(ssMB.begin(), ssMB.end());
     return strHex;
 }
 
@@ -511,7 +511,7 @@ UniValue createrawtransaction(const UniValue& params, bool fHelp)
         rawTx.vout.push_back(out);
     }
 
-    return EncodeHexTx(rawTx);
+    return RPCEncodeTx(rawTx);
 }
 
 UniValue decoderawtransaction(const UniValue& params, bool fHelp)
@@ -873,9 +873,23 @@ UniValue signrawtransaction(const UniValue& params, bool fHelp)
     UniValue vErrors(UniValue::VARR);
 
     // Use CTransaction for the constant parts of the
-    // transaction to avoid rehashing.
+    // transaction to avoid rehashing. Signature hashes do not cover
+    // scriptSigs, so it serves for every input.
     const CTransaction txConst(mergedTx);
-    // Sign what we can:
+    const PrecomputedTransactionData txdata(txConst);
+
+    // Sign what we can, on all cores:
+    std::vector<SignatureJob> vJobs;
+    for (unsigned int i = 0; i < mergedTx.vin.size(); i++) {
+        const CTxIn& txin = mergedTx.vin[i];
+        const CCoins* coins = view.AccessCoins(txin.prevout.hash);
+        // Only sign SIGHASH_SINGLE if there's a corresponding output:
+        if (coins != NULL && coins->IsAvailable(txin.prevout.n) && (!fHashSingle || (i < mergedTx.vout.size())))
+            vJobs.push_back(SignatureJob(i, coins->vout[txin.prevout.n].scriptPubKey, coins->vout[txin.prevout.n].nValue));
+    }
+    ProduceSignatures(keystore, txConst, vJobs, nHashType, consensusBranchId);
+
+    std::vector<SignatureJob>::const_iterator itJob = vJobs.begin();
     for (unsigned int i = 0; i < mergedTx.vin.size(); i++) {
         CTxIn& txin = mergedTx.vin[i];
         const CCoins* coins = view.AccessCoins(txin.prevout.hash);
@@ -887,26 +901,33 @@ UniValue signrawtransaction(const UniValue& params, bool fHelp)
         const CAmount& amount = coins->vout[txin.prevout.n].nValue;
 
         SignatureData sigdata;
-        // Only sign SIGHASH_SINGLE if there's a corresponding output:
-        if (!fHashSingle || (i < mergedTx.vout.size()))
-            ProduceSignature(MutableTransactionSignatureCreator(&keystore, &mergedTx, i, amount, nHashType), prevPubKey, sigdata, consensusBranchId);
+        bool fVerified = false;
+        if (itJob != vJobs.end() && itJob->nIn == i) {
+            sigdata = itJob->sigdata;
+            fVerified = itJob->fSolved;
+            itJob++;
+        }
+        const CScript scriptSigSigned = sigdata.scriptSig;
 
         // ... and merge in other signatures:
         BOOST_FOREACH(const CMutableTransaction& txv, txVariants) {
-            sigdata = CombineSignatures(prevPubKey, TransactionSignatureChecker(&txConst, i, amount), sigdata, DataFromTransaction(txv, i), consensusBranchId);
+            sigdata = CombineSignatures(prevPubKey, TransactionSignatureChecker(&txConst, i, amount, txdata), sigdata, DataFromTransaction(txv, i), consensusBranchId);
         }
 
         UpdateTransaction(mergedTx, i, sigdata);
 
+        // ProduceSignatures() has already verified the scriptSigs it solved
+        if (fVerified && txin.scriptSig == scriptSigSigned)
+            continue;
         ScriptError serror = SCRIPT_ERR_OK;
-        if (!VerifyScript(txin.scriptSig, prevPubKey, STANDARD_SCRIPT_VERIFY_FLAGS, TransactionSignatureChecker(&txConst, i, amount), consensusBranchId, &serror)) {
+        if (!VerifyScript(txin.scriptSig, prevPubKey, STANDARD_SCRIPT_VERIFY_FLAGS, TransactionSignatureChecker(&txConst, i, amount, txdata), consensusBranchId, &serror)) {
             TxInErrorToJSON(txin, vErrors, ScriptErrorString(serror));
         }
     }
     bool fComplete = vErrors.empty();
 
     UniValue result(UniValue::VOBJ);
-    result.push_back(Pair("hex", EncodeHexTx(mergedTx)));
+    result.push_back(Pair("hex", RPCEncodeTx(mergedTx)));
     result.push_back(Pair("complete", fComplete));
     if (!vErrors.empty()) {
         result.push_back(Pair("errors", vErrors));
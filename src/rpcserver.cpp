@@ -7,11 +7,14 @@
 
 #include "init.h"
 #include "key_io.h"
+#include "primitives/transaction.h"
 #include "random.h"
+#include "streams.h"
 #include "sync.h"
 #include "ui_interface.h"
 #include "util.h"
 #include "utilstrencodings.h"
+#include "version.h"
 #include "asyncrpcqueue.h"
 
 #include <memory>
@@ -151,15 +154,45 @@ vector<unsigned char> ParseHexV(const UniValue& v, string strName)
     string strHex;
     if (v.isStr())
         strHex = v.get_str();
-    if (!IsHex(strHex))
+    vector<unsigned char> vch;
+    if (!TryParseHex(strHex, vch))
         throw JSONRPCError(RPC_INVALID_PARAMETER, strName+" must be hexadecimal string (not '"+strHex+"')");
-    return ParseHex(strHex);
+    return vch;
 }
 vector<unsigned char> ParseHexO(const UniValue& o, string strKey)
 {
     return ParseHexV(find_value(o, strKey), strKey);
 }
 
+// Scopes are only ever stack objects, so the pointer is never deleted
+static void NoDeleteScope(RPCRawBytesScope*) {}
+static boost::thread_specific_ptr<RPCRawBytesScope> ptrRawBytesScope(NoDeleteScope);
+
+RPCRawBytesScope::RPCRawBytesScope(bool fRawBytes) : fActive(fRawBytes), prev(ptrRawBytesScope.get())
+{
+    if (fActive)
+        ptrRawBytesScope.reset(this);
+}
+
+RPCRawBytesScope::~RPCRawBytesScope()
+{
+    if (fActive)
+        ptrRawBytesScope.reset(prev);
+}
+
+bool RPCWantsRawBytes()
+{
+    return ptrRawBytesScope.get() != NULL;
+}
+
+string RPCEncodeTx(const CTransaction& tx)
+{
+    CDataStream ssTx(SER_NETWORK, PROTOCOL_VERSION);
+    ssTx.reserve(tx.GetTotalSize());
+    ssTx << tx;
+    return RPCBytesStr(ssTx.begin(), ssTx.end());
+}
+
 /**
  * Note: This interface may still be subject to change.
  */
@@ -260,6 +293,8 @@ static const CRPCCommand vRPCCommands[] =
   //  --------------------- ------------------------  -----------------------  ----------
     /* Overall control/query calls */
     { "control",            "getinfo",                &getinfo,                true  }, /* uses wallet if enabled */
+    { "control",            "getrpcqueueinfo",        &getrpcqueueinfo,        true  },
+    { "control",            "getschedulerinfo",       &getschedulerinfo,       true  },
     { "control",            "help",                   &help,                   true  },
     { "control",            "stop",                   &stop,                   true  },
 
@@ -400,6 +435,7 @@ static const CRPCCommand vRPCCommands[] =
     { "wallet",             "z_importkey",            &z_importkey,            true  },
     { "wallet",             "z_exportviewingkey",     &z_exportviewingkey,     true  },
     { "wallet",             "z_importviewingkey",     &z_importviewingkey,     true  },
+    { "wallet",             "z_importmulti",          &z_importmulti,          true  },
     { "wallet",             "z_exportwallet",         &z_exportwallet,         true  },
     { "wallet",             "z_importwallet",         &z_importwallet,         true  },
 
@@ -550,13 +586,18 @@ static UniValue JSONRPCExecOne(const UniValue& req)
     return rpc_result;
 }
 
-std::string JSONRPCExecBatch(const UniValue& vReq)
+UniValue JSONRPCExecBatchReplies(const UniValue& vReq)
 {
     UniValue ret(UniValue::VARR);
     for (size_t reqIdx = 0; reqIdx < vReq.size(); reqIdx++)
         ret.push_back(JSONRPCExecOne(vReq[reqIdx]));
 
-    return ret.write() + "\n";
+    return ret;
+}
+
+std::string JSONRPCExecBatch(const UniValue& vReq)
+{
+    return JSONRPCExecBatchReplies(vReq).write() + "\n";
 }
 
 UniValue CRPCTable::execute(const std::string &strMethod, const UniValue &params) const
@@ -9,6 +9,7 @@
 #include "amount.h"
 #include "rpcprotocol.h"
 #include "uint256.h"
+#include "utilstrencodings.h"
 
 #include <list>
 #include <map>
@@ -22,6 +23,7 @@
 
 class AsyncRPCQueue;
 class CRPCCommand;
+class CTransaction;
 
 namespace RPCServer
 {
@@ -161,6 +163,39 @@ extern uint256 ParseHashO(const UniValue& o, std::string strKey);
 extern std::vector<unsigned char> ParseHexV(const UniValue& v, std::string strName);
 extern std::vector<unsigned char> ParseHexO(const UniValue& o, std::string strKey);
 
+/**
+ * While one of these is in scope, RPC handlers on this thread return
+ * serialized data (members named "hex", and the result of calls like
+ * getrawtransaction without verbose output) as raw bytes instead of hex.
+ * Used for replies that are sent as CBOR, which carries bytes natively.
+ */
+class RPCRawBytesScope
+{
+public:
+    /** Does nothing unless fRawBytes is set. */
+    explicit RPCRawBytesScope(bool fRawBytes = true);
+    ~RPCRawBytesScope();
+private:
+    bool fActive;
+    RPCRawBytesScope* prev;
+};
+
+/** True if the reply being built on this thread carries raw bytes. */
+extern bool RPCWantsRawBytes();
+
+/** Serialized data for an RPC reply: raw bytes inside an RPCRawBytesScope,
+ *  hex otherwise. */
+template<typename T>
+std::string RPCBytesStr(const T itbegin, const T itend)
+{
+    if (RPCWantsRawBytes())
+        return std::string(itbegin, itend);
+    return HexStr(itbegin, itend);
+}
+
+/** The serialized transaction, as RPCBytesStr() would return it. */
+extern std::string RPCEncodeTx(const CTransaction& tx);
+
 extern int64_t nWalletUnlockTime;
 extern CAmount AmountFromValue(const UniValue& value);
 extern UniValue ValueFromAmount(const CAmount& amount);
@@ -240,6 +275,8 @@ extern UniValue getblockchaininfo(const UniValue& params, bool fHelp);
 extern UniValue getnetworkinfo(const UniValue& params, bool fHelp);
 extern UniValue getdeprecationinfo(const UniValue& params, bool fHelp);
 extern UniValue setmocktime(const UniValue& params, bool fHelp);
+extern UniValue getrpcqueueinfo(const UniValue& params, bool fHelp);
+extern UniValue getschedulerinfo(const UniValue& params, bool fHelp);
 extern UniValue resendwallettransactions(const UniValue& params, bool fHelp);
 extern UniValue zc_benchmark(const UniValue& params, bool fHelp);
 extern UniValue zc_raw_keygen(const UniValue& params, bool fHelp);
@@ -282,6 +319,7 @@ extern UniValue z_exportkey(const UniValue& params, bool fHelp); // in rpcdump.c
 extern UniValue z_importkey(const UniValue& params, bool fHelp); // in rpcdump.cpp
 extern UniValue z_exportviewingkey(const UniValue& params, bool fHelp); // in rpcdump.cpp
 extern UniValue z_importviewingkey(const UniValue& params, bool fHelp); // in rpcdump.cpp
+extern UniValue z_importmulti(const UniValue& params, bool fHelp); // in rpcdump.cpp
 extern UniValue z_getnewaddress(const UniValue& params, bool fHelp); // in rpcwallet.cpp
 extern UniValue z_listaddresses(const UniValue& params, bool fHelp); // in rpcwallet.cpp
 extern UniValue z_exportwallet(const UniValue& params, bool fHelp); // in rpcdump.cpp
@@ -303,6 +341,7 @@ extern UniValue z_validatepaymentdisclosure(const UniValue &params, bool fHelp);
 bool StartRPC();
 void InterruptRPC();
 void StopRPC();
+UniValue JSONRPCExecBatchReplies(const UniValue& vReq);
 std::string JSONRPCExecBatch(const UniValue& vReq);
 
 #endif // BITCOIN_RPCSERVER_H
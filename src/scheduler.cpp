@@ -5,13 +5,39 @@
 #include "scheduler.h"
 
 #include "reverselock.h"
+#include "util.h"
 
 #include <assert.h>
 #include <boost/bind.hpp>
+#include <limits>
 #include <utility>
 
-CScheduler::CScheduler() : nThreadsServicingQueue(0), stopRequested(false), stopWhenEmpty(false)
+// Returns the first tick at or after t, in milliseconds since the epoch
+static uint64_t TimeToTick(boost::chrono::system_clock::time_point t)
 {
+    int64_t nMicros = boost::chrono::duration_cast<boost::chrono::microseconds>(t.time_since_epoch()).count();
+    if (nMicros <= 0)
+        return 0;
+    return (nMicros + 999) / 1000;
+}
+
+// Returns the last tick that has fully passed
+static uint64_t CurrentTick()
+{
+    int64_t nMicros = boost::chrono::duration_cast<boost::chrono::microseconds>(boost::chrono::system_clock::now().time_since_epoch()).count();
+    return std::max<int64_t>(nMicros, 0) / 1000;
+}
+
+static boost::chrono::system_clock::time_point TickToTime(uint64_t nTick)
+{
+    return boost::chrono::system_clock::time_point(boost::chrono::milliseconds(nTick));
+}
+
+CScheduler::CScheduler() : nTasks(0), nThreadsServicingQueue(0), stopRequested(false), stopWhenEmpty(false)
+{
+    for (int l = 0; l < WHEEL_LEVELS; l++)
+        nLevelTasks[l] = 0;
+    nCurrentTick = CurrentTick();
 }
 
 CScheduler::~CScheduler()
@@ -20,6 +46,84 @@ CScheduler::~CScheduler()
 }
 
 
+void CScheduler::insertTask(TaskList& list, TaskList::iterator it)
+{
+    uint64_t nTick = TimeToTick(it->time);
+    if (nTick <= nCurrentTick) {
+        readyQueue.splice(readyQueue.end(), list, it);
+        return;
+    }
+
+    // Use the lowest level whose turn reaches the task. Within a level, the
+    // slot is picked by the task's own time, so a slot is emptied exactly
+    // when the wheel gets to its block.
+    uint64_t nDelta = nTick - nCurrentTick;
+    int l = 0;
+    while (l < WHEEL_LEVELS - 1 && (nDelta >> (WHEEL_BITS * (l + 1))) != 0)
+        l++;
+    if ((nDelta >> (WHEEL_BITS * (l + 1))) != 0)
+        nTick = nCurrentTick + (uint64_t(1) << (WHEEL_BITS * WHEEL_LEVELS)) - 1;
+    TaskList& slot = wheel[l][(nTick >> (WHEEL_BITS * l)) & (WHEEL_SIZE - 1)];
+    slot.splice(slot.end(), list, it);
+    nLevelTasks[l]++;
+}
+
+uint64_t CScheduler::nextEventTick() const
+{
+    // The next tick at which a level 0 slot comes due, or a slot of a higher
+    // level is spread out over the levels below it
+    uint64_t nNext = std::numeric_limits<uint64_t>::max();
+    for (int l = 0; l < WHEEL_LEVELS; l++) {
+        if (nLevelTasks[l] == 0)
+            continue;
+        int nShift = WHEEL_BITS * l;
+        uint64_t nBlock = nCurrentTick >> nShift;
+        for (uint64_t i = 1; i <= WHEEL_SIZE; i++) {
+            if (!wheel[l][(nBlock + i) & (WHEEL_SIZE - 1)].empty()) {
+                nNext = std::min(nNext, (nBlock + i) << nShift);
+                break;
+            }
+        }
+    }
+    return nNext;
+}
+
+void CScheduler::advance(uint64_t nTick)
+{
+    while (nCurrentTick < nTick) {
+        uint64_t nNext = nextEventTick();
+        if (nNext > nTick) {
+            // Nothing happens in between
+            nCurrentTick = nTick;
+            return;
+        }
+        nCurrentTick = nNext;
+
+        // Spread out the slots whose block starts at this tick, top level
+        // first, then expire the level 0 slot
+        for (int l = WHEEL_LEVELS - 1; l > 0; l--) {
+            int nShift = WHEEL_BITS * l;
+            if ((nCurrentTick & ((uint64_t(1) << nShift) - 1)) != 0)
+                continue;
+            TaskList& slot = wheel[l][(nCurrentTick >> nShift) & (WHEEL_SIZE - 1)];
+            nLevelTasks[l] -= slot.size();
+            while (!slot.empty())
+                insertTask(slot, slot.begin());
+        }
+        TaskList& slot = wheel[0][nCurrentTick & (WHEEL_SIZE - 1)];
+        nLevelTasks[0] -= slot.size();
+        readyQueue.splice(readyQueue.end(), slot);
+    }
+}
+
+CScheduler::TaskList::iterator CScheduler::findRunnableTask()
+{
+    TaskList::iterator it = readyQueue.begin();
+    while (it != readyQueue.end() && !it->strKey.empty() && setRunningKeys.count(it->strKey))
+        ++it;
+    return it;
+}
+
 void CScheduler::serviceQueue()
 {
     boost::unique_lock<boost::mutex> lock(newTaskMutex);
@@ -28,38 +132,75 @@ void CScheduler::serviceQueue()
     // newTaskMutex is locked throughout this loop EXCEPT
     // when the thread is waiting or when the user's function
     // is called.
+    std::string strRunningKey;
     while (!shouldStop()) {
         try {
-            while (!shouldStop() && taskQueue.empty()) {
-                // Wait until there is something to do.
-                newTaskScheduled.wait(lock);
+            advance(CurrentTick());
+            TaskList::iterator it = findRunnableTask();
+            if (it == readyQueue.end()) {
+                // Wait until there is something to do, a key is released, or
+                // the next task comes due.
+                uint64_t nNext = nextEventTick();
+                if (nNext == std::numeric_limits<uint64_t>::max()) {
+                    newTaskScheduled.wait(lock);
+                } else {
+                    // Some boost versions have a conflicting overload of wait_until that returns void.
+                    // Explicitly use a template here to avoid hitting that overload.
+                    newTaskScheduled.wait_until<>(lock, TickToTime(nNext));
+                }
+                continue;
             }
 
-            // Wait until either there is a new task, or until
-            // the time of the first item on the queue:
-
-            // Some boost versions have a conflicting overload of wait_until that returns void.
-            // Explicitly use a template here to avoid hitting that overload.
-            while (!shouldStop() && !taskQueue.empty() &&
-                   newTaskScheduled.wait_until<>(lock, taskQueue.begin()->first) != boost::cv_status::timeout) {
-                // Keep waiting until timeout
+            TaskList running;
+            running.splice(running.end(), readyQueue, it);
+            nTasks--;
+            Task& task = running.front();
+            if (!task.strKey.empty()) {
+                setRunningKeys.insert(task.strKey);
+                strRunningKey = task.strKey;
             }
+            // Let another thread pick up whatever else is due
+            if (findRunnableTask() != readyQueue.end())
+                newTaskScheduled.notify_one();
 
-            // If there are multiple threads, the queue can empty while we're waiting (another
-            // thread may service the task we were waiting on).
-            if (shouldStop() || taskQueue.empty())
-                continue;
-
-            Function f = taskQueue.begin()->second;
-            taskQueue.erase(taskQueue.begin());
-
+            boost::chrono::system_clock::time_point start = boost::chrono::system_clock::now();
+            boost::chrono::steady_clock::time_point startRun = boost::chrono::steady_clock::now();
             {
                 // Unlock before calling f, so it can reschedule itself or another task
                 // without deadlocking:
                 reverse_lock<boost::unique_lock<boost::mutex> > rlock(lock);
-                f();
+                task.f();
+            }
+            int64_t nLatency = std::max<int64_t>(0, boost::chrono::duration_cast<boost::chrono::microseconds>(start - task.time).count());
+            int64_t nRun = boost::chrono::duration_cast<boost::chrono::microseconds>(boost::chrono::steady_clock::now() - startRun).count();
+
+            TaskStats& stats = mapStats[task.strKey];
+            stats.nRuns++;
+            stats.nTotalLatencyMicros += nLatency;
+            stats.nMaxLatencyMicros = std::max(stats.nMaxLatencyMicros, nLatency);
+            stats.nTotalRunMicros += nRun;
+            stats.nMaxRunMicros = std::max(stats.nMaxRunMicros, nRun);
+            if (task.nIntervalSeconds > 0 && nRun > task.nIntervalSeconds * 1000000) {
+                stats.nOverruns++;
+                LogPrint("scheduler", "%s: task %s took %.3fs, longer than its interval of %ds\n",
+                         __func__, task.strKey, nRun * 0.000001, task.nIntervalSeconds);
+            }
+
+            if (!strRunningKey.empty()) {
+                setRunningKeys.erase(strRunningKey);
+                strRunningKey.clear();
+                if (!readyQueue.empty())
+                    newTaskScheduled.notify_all();
+            }
+            if (task.nIntervalSeconds > 0) {
+                task.time = boost::chrono::system_clock::now() + boost::chrono::seconds(task.nIntervalSeconds);
+                insertTask(running, running.begin());
+                nTasks++;
+                newTaskScheduled.notify_one();
             }
         } catch (...) {
+            if (!strRunningKey.empty())
+                setRunningKeys.erase(strRunningKey);
             --nThreadsServicingQueue;
             throw;
         }
@@ -79,39 +220,69 @@ void CScheduler::stop(bool drain)
     newTaskScheduled.notify_all();
 }
 
-void CScheduler::schedule(CScheduler::Function f, boost::chrono::system_clock::time_point t)
+void CScheduler::schedule(CScheduler::Function f, boost::chrono::system_clock::time_point t, const std::string& strKey)
 {
     {
         boost::unique_lock<boost::mutex> lock(newTaskMutex);
-        taskQueue.insert(std::make_pair(t, f));
+        TaskList list(1);
+        Task& task = list.front();
+        task.f = f;
+        task.time = t;
+        task.strKey = strKey;
+        task.nIntervalSeconds = 0;
+        insertTask(list, list.begin());
+        nTasks++;
     }
     newTaskScheduled.notify_one();
 }
 
-void CScheduler::scheduleFromNow(CScheduler::Function f, int64_t deltaSeconds)
+void CScheduler::scheduleFromNow(CScheduler::Function f, int64_t deltaSeconds, const std::string& strKey)
 {
-    schedule(f, boost::chrono::system_clock::now() + boost::chrono::seconds(deltaSeconds));
+    schedule(f, boost::chrono::system_clock::now() + boost::chrono::seconds(deltaSeconds), strKey);
 }
 
-static void Repeat(CScheduler* s, CScheduler::Function f, int64_t deltaSeconds)
+void CScheduler::scheduleEvery(CScheduler::Function f, int64_t deltaSeconds, const std::string& strKey)
 {
-    f();
-    s->scheduleFromNow(boost::bind(&Repeat, s, f, deltaSeconds), deltaSeconds);
-}
-
-void CScheduler::scheduleEvery(CScheduler::Function f, int64_t deltaSeconds)
-{
-    scheduleFromNow(boost::bind(&Repeat, this, f, deltaSeconds), deltaSeconds);
+    {
+        boost::unique_lock<boost::mutex> lock(newTaskMutex);
+        TaskList list(1);
+        Task& task = list.front();
+        task.f = f;
+        task.time = boost::chrono::system_clock::now() + boost::chrono::seconds(deltaSeconds);
+        task.strKey = strKey;
+        task.nIntervalSeconds = deltaSeconds;
+        insertTask(list, list.begin());
+        nTasks++;
+    }
+    newTaskScheduled.notify_one();
 }
 
 size_t CScheduler::getQueueInfo(boost::chrono::system_clock::time_point &first,
                              boost::chrono::system_clock::time_point &last) const
 {
     boost::unique_lock<boost::mutex> lock(newTaskMutex);
-    size_t result = taskQueue.size();
-    if (!taskQueue.empty()) {
-        first = taskQueue.begin()->first;
-        last = taskQueue.rbegin()->first;
+    bool fFound = false;
+    const TaskList* lists[1 + WHEEL_LEVELS * WHEEL_SIZE];
+    size_t nLists = 0;
+    lists[nLists++] = &readyQueue;
+    for (int l = 0; l < WHEEL_LEVELS; l++) {
+        for (uint64_t i = 0; i < WHEEL_SIZE; i++)
+            lists[nLists++] = &wheel[l][i];
     }
-    return result;
+    for (size_t i = 0; i < nLists; i++) {
+        for (const Task& task : *lists[i]) {
+            if (!fFound || task.time < first)
+                first = task.time;
+            if (!fFound || task.time > last)
+                last = task.time;
+            fFound = true;
+        }
+    }
+    return nTasks;
+}
+
+std::map<std::string, CScheduler::TaskStats> CScheduler::getTaskStats() const
+{
+    boost::unique_lock<boost::mutex> lock(newTaskMutex);
+    return mapStats;
 }
@@ -13,7 +13,10 @@
 #include <boost/function.hpp>
 #include <boost/chrono/chrono.hpp>
 #include <boost/thread.hpp>
+#include <list>
 #include <map>
+#include <set>
+#include <string>
 
 //
 // Simple class for background tasks that should be run
@@ -32,6 +35,17 @@
 // delete t;
 // delete s; // Must be done after thread is interrupted/joined.
 //
+// Any number of threads can service the queue, and tasks that are due run
+// on them concurrently. Tasks given the same key never run at the same
+// time, and run in the order they became due.
+//
+// Pending tasks are kept in a hierarchical timer wheel with a resolution of
+// one millisecond, so scheduling a task and starting it cost O(1) no matter
+// how many tasks are waiting.
+//
+
+//! -schedulerthreads default
+static const int DEFAULT_SCHEDULER_THREADS = 2;
 
 class CScheduler
 {
@@ -41,18 +55,38 @@ public:
 
     typedef boost::function<void(void)> Function;
 
-    // Call func at/after time t
-    void schedule(Function f, boost::chrono::system_clock::time_point t);
+    // Timing of the runs of the tasks sharing a key
+    struct TaskStats
+    {
+        uint64_t nRuns;
+        // Runs of a repeating task that took longer than its interval
+        uint64_t nOverruns;
+        // Time from when a run was due until it started
+        int64_t nTotalLatencyMicros;
+        int64_t nMaxLatencyMicros;
+        // Time each run took
+        int64_t nTotalRunMicros;
+        int64_t nMaxRunMicros;
+
+        TaskStats() : nRuns(0), nOverruns(0), nTotalLatencyMicros(0), nMaxLatencyMicros(0),
+                      nTotalRunMicros(0), nMaxRunMicros(0) {}
+    };
+
+    // Call func at/after time t. Tasks with the same non-empty key are run
+    // one at a time, and their statistics are kept under that key. Tasks
+    // without a key may run alongside any other task when more than one
+    // thread services the queue.
+    void schedule(Function f, boost::chrono::system_clock::time_point t, const std::string& strKey = "");
 
     // Convenience method: call f once deltaSeconds from now
-    void scheduleFromNow(Function f, int64_t deltaSeconds);
+    void scheduleFromNow(Function f, int64_t deltaSeconds, const std::string& strKey = "");
 
     // Another convenience method: call f approximately
     // every deltaSeconds forever, starting deltaSeconds from now.
     // To be more precise: every time f is finished, it
     // is rescheduled to run deltaSeconds later. If you
     // need more accurate scheduling, don't use this method.
-    void scheduleEvery(Function f, int64_t deltaSeconds);
+    void scheduleEvery(Function f, int64_t deltaSeconds, const std::string& strKey = "");
 
     // To keep things as simple as possible, there is no unschedule.
 
@@ -70,14 +104,51 @@ public:
     size_t getQueueInfo(boost::chrono::system_clock::time_point &first,
                         boost::chrono::system_clock::time_point &last) const;
 
+    // Returns the statistics of every key that has had a task run. Tasks
+    // without a key are counted together under the empty key.
+    std::map<std::string, TaskStats> getTaskStats() const;
+
 private:
-    std::multimap<boost::chrono::system_clock::time_point, Function> taskQueue;
+    struct Task
+    {
+        Function f;
+        boost::chrono::system_clock::time_point time;
+        std::string strKey;
+        // Zero unless the task repeats
+        int64_t nIntervalSeconds;
+    };
+    typedef std::list<Task> TaskList;
+
+    static const int WHEEL_BITS = 6;
+    static const uint64_t WHEEL_SIZE = 1 << WHEEL_BITS;
+    // Four levels of 64 slots reach about 4.6 hours ahead. Tasks further
+    // out wait in the last slot they can reach and are placed again from
+    // there.
+    static const int WHEEL_LEVELS = 4;
+
+    // wheel[l][i] holds tasks due in the i'th block of 64^l ticks of the
+    // wheel's current turn at level l
+    TaskList wheel[WHEEL_LEVELS][WHEEL_SIZE];
+    size_t nLevelTasks[WHEEL_LEVELS];
+    // Tasks that are due, in the order they became due
+    TaskList readyQueue;
+    // Every task due at or before this tick is in readyQueue
+    uint64_t nCurrentTick;
+    size_t nTasks;
+    std::set<std::string> setRunningKeys;
+    std::map<std::string, TaskStats> mapStats;
+
     boost::condition_variable newTaskScheduled;
     mutable boost::mutex newTaskMutex;
     int nThreadsServicingQueue;
     bool stopRequested;
     bool stopWhenEmpty;
-    bool shouldStop() { return stopRequested || (stopWhenEmpty && taskQueue.empty()); }
+    bool shouldStop() { return stopRequested || (stopWhenEmpty && nTasks == 0); }
+
+    void insertTask(TaskList& list, TaskList::iterator it);
+    uint64_t nextEventTick() const;
+    void advance(uint64_t nTick);
+    TaskList::iterator findRunnableTask();
 };
 
 #endif
@@ -10,7 +10,15 @@
 
 #include <vector>
 
+// DoS prevention: limit cache size to 32MB (over 1000000 entries on 64-bit
+// systems). Due to how we count cache size, actual memory usage is slightly
+// more (~32.25 MB)
+static const unsigned int DEFAULT_MAX_SIG_CACHE_SIZE = 32;
+// Maximum sig cache size allowed
+static const int64_t MAX_MAX_SIG_CACHE_SIZE = 16384;
+
 class CPubKey;
+class CSignatureBatch;
 
 class CachingTransactionSignatureChecker : public TransactionSignatureChecker
 {
@@ -23,4 +31,22 @@ public:
     bool VerifySignature(const std::vector<unsigned char>& vchSig, const CPubKey& vchPubKey, const uint256& sighash) const;
 };
 
+/**
+ * Signature checker for block validation that defers the signatures it does not
+ * find in the cache to a batch, and reports them as valid in the meantime. The
+ * script result is only meaningful once the batch has verified.
+ */
+class BatchingTransactionSignatureChecker : public CachingTransactionSignatureChecker
+{
+private:
+    CSignatureBatch& batch;
+
+public:
+    BatchingTransactionSignatureChecker(const CTransaction* txToIn, unsigned int nInIn, const CAmount& amount, CSignatureBatch& batchIn, PrecomputedTransactionData& txdataIn) : CachingTransactionSignatureChecker(txToIn, nInIn, amount, false, txdataIn), batch(batchIn) {}
+
+    bool VerifySignature(const std::vector<unsigned char>& vchSig, const CPubKey& vchPubKey, const uint256& sighash) const;
+};
+
+void InitSignatureCache();
+
 #endif // BITCOIN_SCRIPT_SIGCACHE_H
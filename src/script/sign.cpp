@@ -10,14 +10,23 @@
 #include "keystore.h"
 #include "script/standard.h"
 #include "uint256.h"
+#include "util.h"
+
+#include <atomic>
 
 #include <boost/foreach.hpp>
+#include <boost/thread.hpp>
 
 using namespace std;
 
 typedef std::vector<unsigned char> valtype;
 
-TransactionSignatureCreator::TransactionSignatureCreator(const CKeyStore* keystoreIn, const CTransaction* txToIn, unsigned int nInIn, const CAmount& amountIn, int nHashTypeIn) : BaseSignatureCreator(keystoreIn), txTo(txToIn), nIn(nInIn), nHashType(nHashTypeIn), amount(amountIn), checker(txTo, nIn, amountIn) {}
+/** Minimum number of inputs worth handing to another signing thread. */
+static const size_t MIN_SIGNATURE_JOBS_PER_THREAD = 8;
+
+TransactionSignatureCreator::TransactionSignatureCreator(const CKeyStore* keystoreIn, const CTransaction* txToIn, unsigned int nInIn, const CAmount& amountIn, int nHashTypeIn) : BaseSignatureCreator(keystoreIn), txTo(txToIn), nIn(nInIn), nHashType(nHashTypeIn), amount(amountIn), txdata(NULL), checker(txTo, nIn, amountIn) {}
+
+TransactionSignatureCreator::TransactionSignatureCreator(const CKeyStore* keystoreIn, const CTransaction* txToIn, unsigned int nInIn, const CAmount& amountIn, int nHashTypeIn, const PrecomputedTransactionData& txdataIn) : BaseSignatureCreator(keystoreIn), txTo(txToIn), nIn(nInIn), nHashType(nHashTypeIn), amount(amountIn), txdata(&txdataIn), checker(txTo, nIn, amountIn, txdataIn) {}
 
 bool TransactionSignatureCreator::CreateSig(std::vector<unsigned char>& vchSig, const CKeyID& address, const CScript& scriptCode, uint32_t consensusBranchId) const
 {
@@ -27,7 +36,7 @@ bool TransactionSignatureCreator::CreateSig(std::vector<unsigned char>& vchSig,
 
     uint256 hash;
     try {
-        hash = SignatureHash(scriptCode, *txTo, nIn, nHashType, amount, consensusBranchId);
+        hash = SignatureHash(scriptCode, *txTo, nIn, nHashType, amount, consensusBranchId, txdata);
     } catch (logic_error ex) {
         return false;
     }
@@ -154,6 +163,38 @@ bool ProduceSignature(const BaseSignatureCreator& creator, const CScript& fromPu
     return solved && VerifyScript(sigdata.scriptSig, fromPubKey, STANDARD_SCRIPT_VERIFY_FLAGS, creator.Checker(), consensusBranchId);
 }
 
+static void SignJobs(const CKeyStore* keystore, const CTransaction* txTo, const PrecomputedTransactionData* txdata, std::vector<SignatureJob>* vJobs, std::atomic<size_t>* nNext, int nHashType, uint32_t consensusBranchId)
+{
+    size_t i;
+    while ((i = (*nNext)++) < vJobs->size()) {
+        SignatureJob& job = (*vJobs)[i];
+        job.fSolved = ProduceSignature(TransactionSignatureCreator(keystore, txTo, job.nIn, job.amount, nHashType, *txdata), job.scriptPubKey, job.sigdata, consensusBranchId);
+    }
+}
+
+bool ProduceSignatures(const CKeyStore& keystore, const CTransaction& txTo, std::vector<SignatureJob>& vJobs, int nHashType, uint32_t consensusBranchId, int nThreads)
+{
+    const PrecomputedTransactionData txdata(txTo);
+    std::atomic<size_t> nNext(0);
+
+    if (nThreads <= 0)
+        nThreads = GetNumCores();
+    nThreads = std::min<size_t>(nThreads, (vJobs.size() + MIN_SIGNATURE_JOBS_PER_THREAD - 1) / MIN_SIGNATURE_JOBS_PER_THREAD);
+
+    // The calling thread signs too
+    boost::thread_group threads;
+    for (int i = 1; i < nThreads; i++)
+        threads.create_thread(boost::bind(&SignJobs, &keystore, &txTo, &txdata, &vJobs, &nNext, nHashType, consensusBranchId));
+    SignJobs(&keystore, &txTo, &txdata, &vJobs, &nNext, nHashType, consensusBranchId);
+    threads.join_all();
+
+    BOOST_FOREACH(const SignatureJob& job, vJobs) {
+        if (!job.fSolved)
+            return false;
+    }
+    return true;
+}
+
 SignatureData DataFromTransaction(const CMutableTransaction& tx, unsigned int nIn)
 {
     SignatureData data;
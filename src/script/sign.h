@@ -36,10 +36,12 @@ class TransactionSignatureCreator : public BaseSignatureCreator {
     unsigned int nIn;
     int nHashType;
     CAmount amount;
+    const PrecomputedTransactionData* txdata;
     const TransactionSignatureChecker checker;
 
 public:
     TransactionSignatureCreator(const CKeyStore* keystoreIn, const CTransaction* txToIn, unsigned int nInIn, const CAmount& amountIn, int nHashTypeIn=SIGHASH_ALL);
+    TransactionSignatureCreator(const CKeyStore* keystoreIn, const CTransaction* txToIn, unsigned int nInIn, const CAmount& amountIn, int nHashTypeIn, const PrecomputedTransactionData& txdataIn);
     const BaseSignatureChecker& Checker() const { return checker; }
     bool CreateSig(std::vector<unsigned char>& vchSig, const CKeyID& keyid, const CScript& scriptCode, uint32_t consensusBranchId) const;
 };
@@ -69,6 +71,27 @@ struct SignatureData {
 /** Produce a script signature using a generic signature creator. */
 bool ProduceSignature(const BaseSignatureCreator& creator, const CScript& scriptPubKey, SignatureData& sigdata, uint32_t consensusBranchId);
 
+/** One input to sign with ProduceSignatures(). */
+struct SignatureJob {
+    unsigned int nIn;
+    CScript scriptPubKey;
+    CAmount amount;
+    SignatureData sigdata;
+    //! Set if sigdata is a complete, verified script signature
+    bool fSolved;
+
+    SignatureJob(unsigned int nInIn, const CScript& scriptPubKeyIn, const CAmount& amountIn) : nIn(nInIn), scriptPubKey(scriptPubKeyIn), amount(amountIn), fSolved(false) {}
+};
+
+/**
+ * Produce script signatures for many inputs of one transaction. The parts of
+ * the signature hash shared by all inputs are computed once, and the inputs
+ * are signed on up to nThreads threads (0 = one per core). The results are the
+ * same as calling ProduceSignature() on each input in turn. Returns true if
+ * every job was solved.
+ */
+bool ProduceSignatures(const CKeyStore& keystore, const CTransaction& txTo, std::vector<SignatureJob>& vJobs, int nHashType, uint32_t consensusBranchId, int nThreads = 0);
+
 /** Produce a script signature for a transaction. */
 bool SignSignature(
     const CKeyStore &keystore,
@@ -0,0 +1,38 @@
+#ifndef SECP256K1_BATCH_H
+#define SECP256K1_BATCH_H
+
+#include "secp256k1.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Verify a batch of ECDSA signatures.
+ *
+ *  Returns: 1: every signature is correct for its message and public key
+ *           0: at least one signature is incorrect or unparseable; verify
+ *              them individually to find out which
+ *  Args:    ctx:     a secp256k1 context object, initialized for verification.
+ *  In:      sigs:    an array of n signatures to verify (cannot be NULL
+ *                    unless n is 0)
+ *           msgs32:  an array of n pointers to 32-byte message hashes
+ *           pubkeys: an array of n public keys
+ *           n:       the number of signatures
+ *
+ *  The result is the same as calling secp256k1_ecdsa_verify on each
+ *  signature, so only lower-S signatures are accepted. The batch is faster
+ *  because the modular inversions of the signatures' s values are shared.
+ */
+SECP256K1_API SECP256K1_WARN_UNUSED_RESULT int secp256k1_ecdsa_verify_batch(
+    const secp256k1_context* ctx,
+    const secp256k1_ecdsa_signature *sigs,
+    const unsigned char * const *msgs32,
+    const secp256k1_pubkey *pubkeys,
+    size_t n
+) SECP256K1_ARG_NONNULL(1);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SECP256K1_BATCH_H */
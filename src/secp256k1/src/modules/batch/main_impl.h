@@ -0,0 +1,63 @@
+/**********************************************************************
+ * Copyright (c) 2018 The Zcash developers                             *
+ * Distributed under the MIT software license, see the accompanying   *
+ * file COPYING or http://www.opensource.org/licenses/mit-license.php.*
+ **********************************************************************/
+
+#ifndef SECP256K1_MODULE_BATCH_MAIN_H
+#define SECP256K1_MODULE_BATCH_MAIN_H
+
+#include "include/secp256k1_batch.h"
+
+/** Number of signatures whose s values are inverted together. */
+#define SECP256K1_BATCH_INVERSIONS 64
+
+int secp256k1_ecdsa_verify_batch(const secp256k1_context* ctx, const secp256k1_ecdsa_signature *sigs, const unsigned char * const *msgs32, const secp256k1_pubkey *pubkeys, size_t n) {
+    secp256k1_scalar r[SECP256K1_BATCH_INVERSIONS], s[SECP256K1_BATCH_INVERSIONS];
+    secp256k1_scalar prod[SECP256K1_BATCH_INVERSIONS];
+    secp256k1_scalar inv, sn, m;
+    secp256k1_ge q;
+    size_t i, j, len;
+    VERIFY_CHECK(ctx != NULL);
+    ARG_CHECK(secp256k1_ecmult_context_is_built(&ctx->ecmult_ctx));
+    ARG_CHECK(n == 0 || sigs != NULL);
+    ARG_CHECK(n == 0 || msgs32 != NULL);
+    ARG_CHECK(n == 0 || pubkeys != NULL);
+
+    for (i = 0; i < n; i += len) {
+        len = n - i < SECP256K1_BATCH_INVERSIONS ? n - i : SECP256K1_BATCH_INVERSIONS;
+
+        /* prod[j] = s[0] * ... * s[j] */
+        for (j = 0; j < len; j++) {
+            secp256k1_ecdsa_signature_load(ctx, &r[j], &s[j], &sigs[i + j]);
+            if (secp256k1_scalar_is_zero(&r[j]) || secp256k1_scalar_is_zero(&s[j]) || secp256k1_scalar_is_high(&s[j])) {
+                return 0;
+            }
+            if (j == 0) {
+                prod[0] = s[0];
+            } else {
+                secp256k1_scalar_mul(&prod[j], &prod[j - 1], &s[j]);
+            }
+        }
+
+        /* Montgomery's trick: one inversion yields all the 1/s[j]. */
+        secp256k1_scalar_inverse_var(&inv, &prod[len - 1]);
+        for (j = len; j-- > 0;) {
+            if (j == 0) {
+                sn = inv;
+            } else {
+                secp256k1_scalar_mul(&sn, &inv, &prod[j - 1]);
+                secp256k1_scalar_mul(&inv, &inv, &s[j]);
+            }
+            ARG_CHECK(msgs32[i + j] != NULL);
+            secp256k1_scalar_set_b32(&m, msgs32[i + j], NULL);
+            if (!secp256k1_pubkey_load(ctx, &q, &pubkeys[i + j]) ||
+                !secp256k1_ecdsa_sig_verify_inverse(&ctx->ecmult_ctx, &r[j], &sn, &q, &m)) {
+                return 0;
+            }
+        }
+    }
+    return 1;
+}
+
+#endif /* SECP256K1_MODULE_BATCH_MAIN_H */
@@ -0,0 +1,77 @@
+/**********************************************************************
+ * Copyright (c) 2018 The Zcash developers                             *
+ * Distributed under the MIT software license, see the accompanying   *
+ * file COPYING or http://www.opensource.org/licenses/mit-license.php.*
+ **********************************************************************/
+
+#ifndef SECP256K1_MODULE_BATCH_TESTS_H
+#define SECP256K1_MODULE_BATCH_TESTS_H
+
+#define BATCH_TEST_SIZE (2 * SECP256K1_BATCH_INVERSIONS + 3)
+
+void test_ecdsa_verify_batch(void) {
+    secp256k1_ecdsa_signature sigs[BATCH_TEST_SIZE];
+    secp256k1_pubkey pubkeys[BATCH_TEST_SIZE];
+    unsigned char msgs[BATCH_TEST_SIZE][32];
+    const unsigned char *msgptrs[BATCH_TEST_SIZE];
+    secp256k1_ecdsa_signature saved;
+    secp256k1_scalar r, s;
+    unsigned char key[32];
+    size_t n, i, bad;
+    unsigned char flip;
+
+    for (i = 0; i < BATCH_TEST_SIZE; i++) {
+        secp256k1_scalar k;
+        random_scalar_order_test(&k);
+        secp256k1_scalar_get_b32(key, &k);
+        secp256k1_rand256_test(msgs[i]);
+        msgptrs[i] = msgs[i];
+        CHECK(secp256k1_ec_pubkey_create(ctx, &pubkeys[i], key) == 1);
+        CHECK(secp256k1_ecdsa_sign(ctx, &sigs[i], msgs[i], key, NULL, NULL) == 1);
+    }
+
+    /* Every prefix of the batch is valid, including the empty one. */
+    CHECK(secp256k1_ecdsa_verify_batch(ctx, NULL, NULL, NULL, 0) == 1);
+    for (n = 1; n <= BATCH_TEST_SIZE; n += 1 + secp256k1_rand_int(17)) {
+        CHECK(secp256k1_ecdsa_verify_batch(ctx, sigs, msgptrs, pubkeys, n) == 1);
+    }
+    CHECK(secp256k1_ecdsa_verify_batch(ctx, sigs, msgptrs, pubkeys, BATCH_TEST_SIZE) == 1);
+
+    /* A single bad signature anywhere fails the batch. */
+    bad = secp256k1_rand_int(BATCH_TEST_SIZE);
+    flip = 1 << secp256k1_rand_int(8);
+    msgs[bad][0] ^= flip;
+    CHECK(secp256k1_ecdsa_verify(ctx, &sigs[bad], msgs[bad], &pubkeys[bad]) == 0);
+    CHECK(secp256k1_ecdsa_verify_batch(ctx, sigs, msgptrs, pubkeys, BATCH_TEST_SIZE) == 0);
+    CHECK(secp256k1_ecdsa_verify_batch(ctx, sigs, msgptrs, pubkeys, bad) == 1);
+    msgptrs[bad] = msgs[(bad + 1) % BATCH_TEST_SIZE];
+    CHECK(secp256k1_ecdsa_verify_batch(ctx, sigs, msgptrs, pubkeys, BATCH_TEST_SIZE) == 0);
+    CHECK(secp256k1_ecdsa_verify_batch(ctx, sigs + bad, msgptrs + bad, pubkeys + bad, 1) == 0);
+    msgs[bad][0] ^= flip;
+    msgptrs[bad] = msgs[bad];
+
+    /* High-S signatures are rejected, as by secp256k1_ecdsa_verify. */
+    bad = secp256k1_rand_int(BATCH_TEST_SIZE);
+    saved = sigs[bad];
+    secp256k1_ecdsa_signature_load(ctx, &r, &s, &sigs[bad]);
+    secp256k1_scalar_negate(&s, &s);
+    secp256k1_ecdsa_signature_save(&sigs[bad], &r, &s);
+    CHECK(secp256k1_ecdsa_verify(ctx, &sigs[bad], msgs[bad], &pubkeys[bad]) == 0);
+    CHECK(secp256k1_ecdsa_verify_batch(ctx, sigs, msgptrs, pubkeys, BATCH_TEST_SIZE) == 0);
+    sigs[bad] = saved;
+    CHECK(secp256k1_ecdsa_verify_batch(ctx, sigs, msgptrs, pubkeys, BATCH_TEST_SIZE) == 1);
+
+    /* So are signatures with a zero component. */
+    secp256k1_scalar_clear(&s);
+    secp256k1_ecdsa_signature_save(&sigs[0], &r, &s);
+    CHECK(secp256k1_ecdsa_verify_batch(ctx, sigs, msgptrs, pubkeys, 1) == 0);
+}
+
+void run_batch_tests(void) {
+    int i;
+    for (i = 0; i < count / 8 + 1; i++) {
+        test_ecdsa_verify_batch();
+    }
+}
+
+#endif /* SECP256K1_MODULE_BATCH_TESTS_H */
@@ -105,6 +105,47 @@ std::istream& operator>>(std::istream& in, alt_bn128_ate_G2_precomp &prec_Q)
     return in;
 }
 
+bool alt_bn128_ate_G2_precomp_table::operator==(const alt_bn128_ate_G2_precomp_table &other) const
+{
+    return (this->num_points == other.num_points &&
+            this->coeffs == other.coeffs);
+}
+
+std::ostream& operator<<(std::ostream& out, const alt_bn128_ate_G2_precomp_table &table)
+{
+    out << table.num_points << "\n";
+    out << table.coeffs.size() << "\n";
+    for (const alt_bn128_ate_ell_coeffs &c : table.coeffs)
+    {
+        out << c << OUTPUT_NEWLINE;
+    }
+    return out;
+}
+
+std::istream& operator>>(std::istream& in, alt_bn128_ate_G2_precomp_table &table)
+{
+    in >> table.num_points;
+    consume_newline(in);
+
+    table.coeffs.clear();
+    size_t s;
+    in >> s;
+
+    consume_newline(in);
+
+    table.coeffs.reserve(s);
+
+    for (size_t i = 0; i < s; ++i)
+    {
+        alt_bn128_ate_ell_coeffs c;
+        in >> c;
+        consume_OUTPUT_NEWLINE(in);
+        table.coeffs.emplace_back(c);
+    }
+
+    return in;
+}
+
 /* final exponentiations */
 
 alt_bn128_Fq12 alt_bn128_final_exponentiation_first_chunk(const alt_bn128_Fq12 &elt)
@@ -488,6 +529,144 @@ alt_bn128_Fq12 alt_bn128_ate_double_miller_loop(const alt_bn128_ate_G1_precomp &
     return f;
 }
 
+alt_bn128_ate_G2_precomp_table alt_bn128_ate_precompute_G2_table(const std::vector<alt_bn128_G2> &Qs)
+{
+    enter_block("Call to alt_bn128_ate_precompute_G2_table");
+
+    alt_bn128_ate_G2_precomp_table result;
+    result.num_points = Qs.size();
+
+    std::vector<alt_bn128_ate_G2_precomp> prec_Qs;
+    prec_Qs.reserve(Qs.size());
+    for (const alt_bn128_G2 &Q : Qs)
+    {
+        prec_Qs.emplace_back(alt_bn128_ate_precompute_G2(Q));
+    }
+
+    if (!prec_Qs.empty())
+    {
+        const size_t num_coeffs = prec_Qs[0].coeffs.size();
+        result.coeffs.reserve(num_coeffs * Qs.size());
+        for (size_t idx = 0; idx < num_coeffs; ++idx)
+        {
+            for (const alt_bn128_ate_G2_precomp &prec_Q : prec_Qs)
+            {
+                result.coeffs.emplace_back(prec_Q.coeffs[idx]);
+            }
+        }
+    }
+
+    leave_block("Call to alt_bn128_ate_precompute_G2_table");
+    return result;
+}
+
+alt_bn128_Fq12 alt_bn128_ate_multi_miller_loop(const std::vector<alt_bn128_ate_G1_precomp> &prec_Ps,
+                                               const alt_bn128_ate_G2_precomp_table &table,
+                                               const std::vector<alt_bn128_ate_G1_precomp> &prec_Ps_online,
+                                               const std::vector<alt_bn128_G2> &Qs_online)
+{
+    enter_block("Call to alt_bn128_ate_multi_miller_loop");
+
+    assert(prec_Ps.size() == table.num_points);
+    assert(prec_Ps_online.size() == Qs_online.size());
+
+    const size_t n = table.num_points;
+    const size_t m = Qs_online.size();
+    const alt_bn128_Fq two_inv = (alt_bn128_Fq("2").inverse());
+
+    /* the online points take the same steps as alt_bn128_ate_precompute_G2 */
+    std::vector<alt_bn128_G2> Qs(Qs_online), Rs(m);
+    for (size_t j = 0; j < m; ++j)
+    {
+        Qs[j].to_affine_coordinates();
+        Rs[j].X = Qs[j].X;
+        Rs[j].Y = Qs[j].Y;
+        Rs[j].Z = alt_bn128_Fq2::one();
+    }
+
+    alt_bn128_Fq12 f = alt_bn128_Fq12::one();
+
+    bool found_one = false;
+    const alt_bn128_ate_ell_coeffs *c = table.coeffs.data();
+    alt_bn128_ate_ell_coeffs c_online;
+
+    const bigint<alt_bn128_Fr::num_limbs> &loop_count = alt_bn128_ate_loop_count;
+    for (long i = loop_count.max_bits(); i >= 0; --i)
+    {
+        const bool bit = loop_count.test_bit(i);
+        if (!found_one)
+        {
+            /* this skips the MSB itself */
+            found_one |= bit;
+            continue;
+        }
+
+        /* code below gets executed for all bits (EXCEPT the MSB itself) of
+           alt_bn128_param_p (skipping leading zeros) in MSB to LSB
+           order */
+
+        f = f.squared();
+
+        for (size_t k = 0; k < n; ++k, ++c)
+        {
+            f = f.mul_by_024(c->ell_0, prec_Ps[k].PY * c->ell_VW, prec_Ps[k].PX * c->ell_VV);
+        }
+        for (size_t j = 0; j < m; ++j)
+        {
+            doubling_step_for_flipped_miller_loop(two_inv, Rs[j], c_online);
+            f = f.mul_by_024(c_online.ell_0, prec_Ps_online[j].PY * c_online.ell_VW, prec_Ps_online[j].PX * c_online.ell_VV);
+        }
+
+        if (bit)
+        {
+            for (size_t k = 0; k < n; ++k, ++c)
+            {
+                f = f.mul_by_024(c->ell_0, prec_Ps[k].PY * c->ell_VW, prec_Ps[k].PX * c->ell_VV);
+            }
+            for (size_t j = 0; j < m; ++j)
+            {
+                mixed_addition_step_for_flipped_miller_loop(Qs[j], Rs[j], c_online);
+                f = f.mul_by_024(c_online.ell_0, prec_Ps_online[j].PY * c_online.ell_VW, prec_Ps_online[j].PX * c_online.ell_VV);
+            }
+        }
+    }
+
+    if (alt_bn128_ate_is_loop_count_neg)
+    {
+        f = f.inverse();
+    }
+
+    for (size_t k = 0; k < 2 * n; ++k, ++c)
+    {
+        f = f.mul_by_024(c->ell_0, prec_Ps[k % n].PY * c->ell_VW, prec_Ps[k % n].PX * c->ell_VV);
+    }
+    for (size_t j = 0; j < m; ++j)
+    {
+        alt_bn128_G2 Q1 = Qs[j].mul_by_q();
+        assert_except(Q1.Z == alt_bn128_Fq2::one());
+        alt_bn128_G2 Q2 = Q1.mul_by_q();
+        assert_except(Q2.Z == alt_bn128_Fq2::one());
+
+        if (alt_bn128_ate_is_loop_count_neg)
+        {
+            Rs[j].Y = - Rs[j].Y;
+        }
+        Q2.Y = - Q2.Y;
+
+        mixed_addition_step_for_flipped_miller_loop(Q1, Rs[j], c_online);
+        f = f.mul_by_024(c_online.ell_0, prec_Ps_online[j].PY * c_online.ell_VW, prec_Ps_online[j].PX * c_online.ell_VV);
+
+        mixed_addition_step_for_flipped_miller_loop(Q2, Rs[j], c_online);
+        f = f.mul_by_024(c_online.ell_0, prec_Ps_online[j].PY * c_online.ell_VW, prec_Ps_online[j].PX * c_online.ell_VV);
+    }
+
+    assert(c == table.coeffs.data() + table.coeffs.size());
+
+    leave_block("Call to alt_bn128_ate_multi_miller_loop");
+
+    return f;
+}
+
 alt_bn128_Fq12 alt_bn128_ate_pairing(const alt_bn128_G1& P, const alt_bn128_G2 &Q)
 {
     enter_block("Call to alt_bn128_ate_pairing");
@@ -533,6 +712,19 @@ alt_bn128_Fq12 alt_bn128_double_miller_loop(const alt_bn128_G1_precomp &prec_P1,
     return alt_bn128_ate_double_miller_loop(prec_P1, prec_Q1, prec_P2, prec_Q2);
 }
 
+alt_bn128_G2_precomp_table alt_bn128_precompute_G2_table(const std::vector<alt_bn128_G2> &Qs)
+{
+    return alt_bn128_ate_precompute_G2_table(Qs);
+}
+
+alt_bn128_Fq12 alt_bn128_multi_miller_loop(const std::vector<alt_bn128_G1_precomp> &prec_Ps,
+                                           const alt_bn128_G2_precomp_table &table,
+                                           const std::vector<alt_bn128_G1_precomp> &prec_Ps_online,
+                                           const std::vector<alt_bn128_G2> &Qs_online)
+{
+    return alt_bn128_ate_multi_miller_loop(prec_Ps, table, prec_Ps_online, Qs_online);
+}
+
 alt_bn128_Fq12 alt_bn128_pairing(const alt_bn128_G1& P,
                       const alt_bn128_G2 &Q)
 {
@@ -57,6 +57,35 @@ alt_bn128_Fq12 alt_bn128_ate_double_miller_loop(const alt_bn128_ate_G1_precomp &
                                      const alt_bn128_ate_G1_precomp &prec_P2,
                                      const alt_bn128_ate_G2_precomp &prec_Q2);
 
+/**
+ * Line coefficients of several fixed G2 points, interleaved so that entry
+ * idx * num_points + i is the idx-th line of the i-th point. A Miller loop
+ * over all the points then reads the table front to back.
+ */
+struct alt_bn128_ate_G2_precomp_table {
+    size_t num_points;
+    std::vector<alt_bn128_ate_ell_coeffs> coeffs;
+
+    alt_bn128_ate_G2_precomp_table() : num_points(0) {}
+
+    bool operator==(const alt_bn128_ate_G2_precomp_table &other) const;
+    friend std::ostream& operator<<(std::ostream &out, const alt_bn128_ate_G2_precomp_table &table);
+    friend std::istream& operator>>(std::istream &in, alt_bn128_ate_G2_precomp_table &table);
+};
+
+alt_bn128_ate_G2_precomp_table alt_bn128_ate_precompute_G2_table(const std::vector<alt_bn128_G2> &Qs);
+
+/**
+ * Computes the product of the Miller loops of prec_Ps[i] with the i-th point
+ * of table, and of prec_Ps_online[j] with Qs_online[j], sharing a single
+ * accumulator. The lines of Qs_online are computed as the loop goes instead
+ * of being precomputed.
+ */
+alt_bn128_Fq12 alt_bn128_ate_multi_miller_loop(const std::vector<alt_bn128_ate_G1_precomp> &prec_Ps,
+                                               const alt_bn128_ate_G2_precomp_table &table,
+                                               const std::vector<alt_bn128_ate_G1_precomp> &prec_Ps_online,
+                                               const std::vector<alt_bn128_G2> &Qs_online);
+
 alt_bn128_Fq12 alt_bn128_ate_pairing(const alt_bn128_G1& P,
                           const alt_bn128_G2 &Q);
 alt_bn128_GT alt_bn128_ate_reduced_pairing(const alt_bn128_G1 &P,
@@ -66,6 +95,7 @@ alt_bn128_GT alt_bn128_ate_reduced_pairing(const alt_bn128_G1 &P,
 
 typedef alt_bn128_ate_G1_precomp alt_bn128_G1_precomp;
 typedef alt_bn128_ate_G2_precomp alt_bn128_G2_precomp;
+typedef alt_bn128_ate_G2_precomp_table alt_bn128_G2_precomp_table;
 
 alt_bn128_G1_precomp alt_bn128_precompute_G1(const alt_bn128_G1& P);
 
@@ -79,6 +109,13 @@ alt_bn128_Fq12 alt_bn128_double_miller_loop(const alt_bn128_G1_precomp &prec_P1,
                                  const alt_bn128_G1_precomp &prec_P2,
                                  const alt_bn128_G2_precomp &prec_Q2);
 
+alt_bn128_G2_precomp_table alt_bn128_precompute_G2_table(const std::vector<alt_bn128_G2> &Qs);
+
+alt_bn128_Fq12 alt_bn128_multi_miller_loop(const std::vector<alt_bn128_G1_precomp> &prec_Ps,
+                                           const alt_bn128_G2_precomp_table &table,
+                                           const std::vector<alt_bn128_G1_precomp> &prec_Ps_online,
+                                           const std::vector<alt_bn128_G2> &Qs_online);
+
 alt_bn128_Fq12 alt_bn128_pairing(const alt_bn128_G1& P,
                       const alt_bn128_G2 &Q);
 
@@ -43,6 +43,19 @@ alt_bn128_Fq12 alt_bn128_pp::double_miller_loop(const alt_bn128_G1_precomp &prec
     return alt_bn128_double_miller_loop(prec_P1, prec_Q1, prec_P2, prec_Q2);
 }
 
+alt_bn128_G2_precomp_table alt_bn128_pp::precompute_G2_table(const std::vector<alt_bn128_G2> &Qs)
+{
+    return alt_bn128_precompute_G2_table(Qs);
+}
+
+alt_bn128_Fq12 alt_bn128_pp::multi_miller_loop(const std::vector<alt_bn128_G1_precomp> &prec_Ps,
+                                               const alt_bn128_G2_precomp_table &table,
+                                               const std::vector<alt_bn128_G1_precomp> &prec_Ps_online,
+                                               const std::vector<alt_bn128_G2> &Qs_online)
+{
+    return alt_bn128_multi_miller_loop(prec_Ps, table, prec_Ps_online, Qs_online);
+}
+
 alt_bn128_Fq12 alt_bn128_pp::pairing(const alt_bn128_G1 &P,
                                      const alt_bn128_G2 &Q)
 {
@@ -20,6 +20,7 @@ namespace libsnark {
   G2_type
   G1_precomp_type
   G2_precomp_type
+  G2_precomp_table_type
   affine_ate_G1_precomp_type
   affine_ate_G2_precomp_type
   Fq_type
@@ -60,6 +61,12 @@ namespace libsnark {
                                  const G1_precomp<EC_ppT> &prec_P2,
                                  const G2_precomp<EC_ppT> &prec_Q2);
 
+  G2_precomp_table<EC_ppT> precompute_G2_table(const std::vector<G2<EC_ppT> > &Qs);
+  Fqk<EC_ppT> multi_miller_loop(const std::vector<G1_precomp<EC_ppT> > &prec_Ps,
+                                const G2_precomp_table<EC_ppT> &table,
+                                const std::vector<G1_precomp<EC_ppT> > &prec_Ps_online,
+                                const std::vector<G2<EC_ppT> > &Qs_online);
+
   Fqk<EC_ppT> pairing(const G1<EC_ppT> &P,
                       const G2<EC_ppT> &Q);
   GT<EC_ppT> reduced_pairing(const G1<EC_ppT> &P,
@@ -79,6 +86,8 @@ using G1_precomp = typename EC_ppT::G1_precomp_type;
 template<typename EC_ppT>
 using G2_precomp = typename EC_ppT::G2_precomp_type;
 template<typename EC_ppT>
+using G2_precomp_table = typename EC_ppT::G2_precomp_table_type;
+template<typename EC_ppT>
 using affine_ate_G1_precomp = typename EC_ppT::affine_ate_G1_precomp_type;
 template<typename EC_ppT>
 using affine_ate_G2_precomp = typename EC_ppT::affine_ate_G2_precomp_type;
@@ -72,6 +72,37 @@ void double_miller_loop_test()
     EXPECT_EQ(ans_1 * ans_2, ans_12);
 }
 
+template<typename ppT>
+void multi_miller_loop_test()
+{
+    std::vector<G1<ppT> > Ps;
+    std::vector<G2<ppT> > Qs;
+    std::vector<G1_precomp<ppT> > prec_Ps;
+    for (size_t i = 0; i < 3; ++i)
+    {
+        Ps.emplace_back((Fr<ppT>::random_element()) * G1<ppT>::one());
+        Qs.emplace_back((Fr<ppT>::random_element()) * G2<ppT>::one());
+        prec_Ps.emplace_back(ppT::precompute_G1(Ps.back()));
+    }
+    const G2_precomp_table<ppT> table = ppT::precompute_G2_table(Qs);
+
+    const G1<ppT> P_online = (Fr<ppT>::random_element()) * G1<ppT>::one();
+    const G2<ppT> Q_online = (Fr<ppT>::random_element()) * G2<ppT>::one();
+    const G1_precomp<ppT> prec_P_online = ppT::precompute_G1(P_online);
+
+    Fqk<ppT> expected = ppT::miller_loop(prec_P_online, ppT::precompute_G2(Q_online));
+    for (size_t i = 0; i < Ps.size(); ++i)
+    {
+        expected = expected * ppT::miller_loop(prec_Ps[i], ppT::precompute_G2(Qs[i]));
+    }
+
+    EXPECT_EQ(ppT::multi_miller_loop(prec_Ps, table, { prec_P_online }, { Q_online }), expected);
+    EXPECT_EQ(ppT::multi_miller_loop(prec_Ps, table, {}, {}),
+              expected * ppT::miller_loop(prec_P_online, ppT::precompute_G2(Q_online)).inverse());
+    EXPECT_EQ(ppT::multi_miller_loop({}, ppT::precompute_G2_table({}), { prec_P_online }, { Q_online }),
+              ppT::miller_loop(prec_P_online, ppT::precompute_G2(Q_online)));
+}
+
 template<typename ppT>
 void affine_pairing_test()
 {
@@ -112,6 +143,7 @@ TEST(algebra, bilinearity)
     alt_bn128_pp::init_public_params();
     pairing_test<alt_bn128_pp>();
     double_miller_loop_test<alt_bn128_pp>();
+    multi_miller_loop_test<alt_bn128_pp>();
 
 #ifdef CURVE_BN128       // BN128 has fancy dependencies so it may be disabled
     bn128_pp::init_public_params();
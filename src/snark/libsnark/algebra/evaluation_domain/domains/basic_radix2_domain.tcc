@@ -45,10 +45,13 @@ void basic_radix2_domain<FieldT>::iFFT(std::vector<FieldT> &a)
     _basic_radix2_FFT(a, omega.inverse());
 
     const FieldT sconst = FieldT(a.size()).inverse();
-    for (size_t i = 0; i < a.size(); ++i)
-    {
-        a[i] *= sconst;
-    }
+    const size_t num_threads = (a.size() >= FFT_MIN_PARALLEL_SIZE ? get_num_threads() : 1);
+    parallel_for(a.size(), num_threads, [&a, &sconst](const size_t begin, const size_t end) {
+        for (size_t i = begin; i < end; ++i)
+        {
+            a[i] *= sconst;
+        }
+    });
     leave_block("Execute inverse FFT");
 }
 
@@ -3,7 +3,7 @@
 
  Declaration of interfaces for auxiliary functions for the "basic radix-2" evaluation domain.
 
- These functions compute the radix-2 FFT (in single- or multi-thread mode) and,
+ These functions compute the radix-2 FFT (in single- or multi-thread mode) and
  also compute Lagrange coefficients.
 
  *****************************************************************************
@@ -15,19 +15,42 @@
 #ifndef BASIC_RADIX2_DOMAIN_AUX_HPP_
 #define BASIC_RADIX2_DOMAIN_AUX_HPP_
 
+#include <memory>
+#include <vector>
+
 namespace libsnark {
 
+/* The first stages of _basic_radix2_FFT are done separately on blocks of this
+   many elements, so that each block stays in cache across those stages. */
+const size_t FFT_BLOCK_SIZE = 1ul << 12;
+
+/* Vectors shorter than this are transformed on a single thread. */
+const size_t FFT_MIN_PARALLEL_SIZE = 1ul << 14;
+
 /**
  * Compute the radix-2 FFT of the vector a over the set S={omega^{0},...,omega^{m-1}}.
+ *
+ * The transform is done in place, cache-blocked and split over num_threads threads
+ * (get_num_threads() if 0), using the twiddle factors returned by _basic_radix2_twiddles.
+ */
+template<typename FieldT>
+void _basic_radix2_FFT(std::vector<FieldT> &a, const FieldT &omega, const size_t num_threads = 0);
+
+/**
+ * A single-thread version of _basic_radix2_FFT that computes its twiddle factors on the fly.
  */
 template<typename FieldT>
-void _basic_radix2_FFT(std::vector<FieldT> &a, const FieldT &omega);
+void _basic_serial_radix2_FFT(std::vector<FieldT> &a, const FieldT &omega);
 
 /**
- * A multi-thread version of _basic_radix2_FFT.
+ * Return the twiddle factors omega^{0},...,omega^{n/2-1} for an FFT of size n.
+ *
+ * Tables are computed once per (n, omega) and kept until a transform of another
+ * size is done, so repeated transforms over the same domain (e.g. one per proof)
+ * share them while the cache stays bounded by the domain size.
  */
 template<typename FieldT>
-void _parallel_basic_radix2_FFT(std::vector<FieldT> &a, const FieldT &omega);
+std::shared_ptr<const std::vector<FieldT> > _basic_radix2_twiddles(const size_t n, const FieldT &omega);
 
 /**
  * Translate the vector a to a coset defined by g.
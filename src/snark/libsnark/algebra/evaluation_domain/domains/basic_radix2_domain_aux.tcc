@@ -14,22 +14,15 @@
 #ifndef BASIC_RADIX2_DOMAIN_AUX_TCC_
 #define BASIC_RADIX2_DOMAIN_AUX_TCC_
 
+#include <algorithm>
 #include <cassert>
-#ifdef MULTICORE
-#include <omp.h>
-#endif
+#include <mutex>
 #include "algebra/fields/field_utils.hpp"
 #include "common/profiling.hpp"
 #include "common/utils.hpp"
 
 namespace libsnark {
 
-#ifdef MULTICORE
-#define _basic_radix2_FFT _basic_parallel_radix2_FFT
-#else
-#define _basic_radix2_FFT _basic_serial_radix2_FFT
-#endif
-
 /*
  Below we make use of pseudocode from [CLRS 2n Ed, pp. 864].
  Also, note that it's the caller's responsibility to multiply by 1/N.
@@ -72,99 +65,117 @@ void _basic_serial_radix2_FFT(std::vector<FieldT> &a, const FieldT &omega)
 }
 
 template<typename FieldT>
-void _basic_parallel_radix2_FFT_inner(std::vector<FieldT> &a, const FieldT &omega, const size_t log_cpus)
+std::shared_ptr<const std::vector<FieldT> > _basic_radix2_twiddles(const size_t n, const FieldT &omega)
 {
-    const size_t num_cpus = 1ul<<log_cpus;
+    struct twiddle_table {
+        size_t n;
+        FieldT omega;
+        std::shared_ptr<const std::vector<FieldT> > twiddles;
+    };
+    static std::mutex tables_lock;
+    static std::vector<twiddle_table> tables;
+
+    std::lock_guard<std::mutex> lock(tables_lock);
+    for (const twiddle_table &t : tables)
+    {
+        if (t.n == n && t.omega == omega)
+        {
+            return t.twiddles;
+        }
+    }
 
-    const size_t m = a.size();
-    const size_t log_m = log2(m);
-    assert(m == 1ul<<log_m);
+    /* only keep the tables for one domain size, i.e. those for its forward
+       and inverse transforms, so the cache never holds more than n elements */
+    tables.erase(std::remove_if(tables.begin(), tables.end(),
+                                [n](const twiddle_table &t) { return t.n != n; }),
+                 tables.end());
+
+    std::shared_ptr<std::vector<FieldT> > twiddles = std::make_shared<std::vector<FieldT> >(n/2);
+    std::vector<FieldT> &w = *twiddles;
+    parallel_for(n/2, n >= FFT_MIN_PARALLEL_SIZE ? get_num_threads() : 1, [&w, &omega](const size_t begin, const size_t end) {
+        FieldT w_i = omega^begin;
+        for (size_t i = begin; i < end; ++i)
+        {
+            w[i] = w_i;
+            w_i *= omega;
+        }
+    });
+
+    tables.push_back(twiddle_table{n, omega, twiddles});
+    return twiddles;
+}
+
+/*
+ The same butterflies as _basic_serial_radix2_FFT, in the same order within each
+ stage. Stages with half-size m < FFT_BLOCK_SIZE only combine elements within a
+ block of FFT_BLOCK_SIZE elements, so they are run block by block; the remaining
+ stages are split into contiguous ranges of butterflies. Both are spread over
+ the available threads. Twiddle factors come from the shared table, so each
+ butterfly needs a single multiplication.
+ */
+template<typename FieldT>
+void _basic_radix2_FFT(std::vector<FieldT> &a, const FieldT &omega, size_t num_threads)
+{
+    const size_t n = a.size(), logn = log2(n);
+    assert(n == (1u << logn));
 
-    if (log_m < log_cpus)
+    if (n == 1)
     {
-        _basic_serial_radix2_FFT(a, omega);
         return;
     }
 
-    enter_block("Shuffle inputs");
-    std::vector<std::vector<FieldT> > tmp(num_cpus);
-    for (size_t j = 0; j < num_cpus; ++j)
+    if (num_threads == 0)
     {
-        tmp[j].resize(1ul<<(log_m-log_cpus), FieldT::zero());
+        num_threads = (n >= FFT_MIN_PARALLEL_SIZE ? get_num_threads() : 1);
     }
+    const std::shared_ptr<const std::vector<FieldT> > twiddles = _basic_radix2_twiddles(n, omega);
+    const std::vector<FieldT> &w = *twiddles;
 
-#ifdef MULTICORE
-    #pragma omp parallel for
-#endif
-    for (size_t j = 0; j < num_cpus; ++j)
-    {
-        const FieldT omega_j = omega^j;
-        const FieldT omega_step = omega^(j<<(log_m - log_cpus));
-
-        FieldT elt = FieldT::one();
-        for (size_t i = 0; i < 1ul<<(log_m - log_cpus); ++i)
+    /* swapping in place; each pair is swapped by its smaller index */
+    parallel_for(n, num_threads, [&a, logn](const size_t begin, const size_t end) {
+        for (size_t k = begin; k < end; ++k)
         {
-            for (size_t s = 0; s < num_cpus; ++s)
-            {
-                // invariant: elt is omega^(j*idx)
-                const size_t idx = (i + (s<<(log_m - log_cpus))) % (1u << log_m);
-                tmp[j][i] += a[idx] * elt;
-                elt *= omega_step;
-            }
-            elt *= omega_j;
+            const size_t rk = bitreverse(k, logn);
+            if (k < rk)
+                std::swap(a[k], a[rk]);
         }
-    }
-    leave_block("Shuffle inputs");
-
-    enter_block("Execute sub-FFTs");
-    const FieldT omega_num_cpus = omega^num_cpus;
+    });
 
-#ifdef MULTICORE
-    #pragma omp parallel for
-#endif
-    for (size_t j = 0; j < num_cpus; ++j)
-    {
-        _basic_serial_radix2_FFT(tmp[j], omega_num_cpus);
-    }
-    leave_block("Execute sub-FFTs");
-
-    enter_block("Re-shuffle outputs");
-
-#ifdef MULTICORE
-    #pragma omp parallel for
-#endif
-    for (size_t i = 0; i < num_cpus; ++i)
-    {
-        for (size_t j = 0; j < 1ul<<(log_m - log_cpus); ++j)
+    const size_t block_size = std::min(n, FFT_BLOCK_SIZE);
+    parallel_for(n / block_size, num_threads, [&a, &w, n, block_size](const size_t begin, const size_t end) {
+        for (size_t b = begin; b < end; ++b)
         {
-            // now: i = idx >> (log_m - log_cpus) and j = idx % (1u << (log_m - log_cpus)), for idx = ((i<<(log_m-log_cpus))+j) % (1u << log_m)
-            a[(j<<log_cpus) + i] = tmp[i][j];
+            FieldT *block = &a[b * block_size];
+            for (size_t m = 1; m < block_size; m *= 2)
+            {
+                const size_t stride = n/(2*m);
+                for (size_t k = 0; k < block_size; k += 2*m)
+                {
+                    for (size_t j = 0; j < m; ++j)
+                    {
+                        const FieldT t = w[j*stride] * block[k+j+m];
+                        block[k+j+m] = block[k+j] - t;
+                        block[k+j] += t;
+                    }
+                }
+            }
         }
-    }
-    leave_block("Re-shuffle outputs");
-}
+    });
 
-template<typename FieldT>
-void _basic_parallel_radix2_FFT(std::vector<FieldT> &a, const FieldT &omega)
-{
-#ifdef MULTICORE
-    const size_t num_cpus = omp_get_max_threads();
-#else
-    const size_t num_cpus = 1;
-#endif
-    const size_t log_cpus = ((num_cpus & (num_cpus - 1)) == 0 ? log2(num_cpus) : log2(num_cpus) - 1);
-
-#ifdef DEBUG
-    print_indent(); printf("* Invoking parallel FFT on 2^%zu CPUs (omp_get_max_threads = %zu)\n", log_cpus, num_cpus);
-#endif
-
-    if (log_cpus == 0)
+    for (size_t m = block_size; m < n; m *= 2)
     {
-        _basic_serial_radix2_FFT(a, omega);
-    }
-    else
-    {
-        _basic_parallel_radix2_FFT_inner(a, omega, log_cpus);
+        const size_t stride = n/(2*m);
+        parallel_for(n/2, num_threads, [&a, &w, m, stride](const size_t begin, const size_t end) {
+            for (size_t i = begin; i < end; ++i)
+            {
+                /* butterfly i is the j-th one of the group starting at k */
+                const size_t j = i & (m-1);
+                const size_t k = 2*(i-j);
+                const FieldT t = w[j*stride] * a[k+j+m];
+                a[k+j+m] = a[k+j] - t;
+                a[k+j] += t;
+            }
+        });
     }
 }
 
@@ -172,12 +183,15 @@ template<typename FieldT>
 void _multiply_by_coset(std::vector<FieldT> &a, const FieldT &g)
 {
     //enter_block("Multiply by coset");
-    FieldT u = g;
-    for (size_t i = 1; i < a.size(); ++i)
-    {
-        a[i] *= u;
-        u *= g;
-    }
+    const size_t num_threads = (a.size() >= FFT_MIN_PARALLEL_SIZE ? get_num_threads() : 1);
+    parallel_for(a.size(), num_threads, [&a, &g](const size_t begin, const size_t end) {
+        FieldT u = g^begin;
+        for (size_t i = begin; i < end; ++i)
+        {
+            a[i] *= u;
+            u *= g;
+        }
+    });
     //leave_block("Multiply by coset");
 }
 
@@ -0,0 +1,135 @@
+/**
+ *****************************************************************************
+ * @author     This file is part of libsnark, developed by SCIPR Lab
+ *             and contributors (see AUTHORS).
+ * @copyright  MIT license (see LICENSE file)
+ *****************************************************************************/
+#include "common/profiling.hpp"
+#include "algebra/curves/alt_bn128/alt_bn128_pp.hpp"
+#include "algebra/evaluation_domain/evaluation_domain.hpp"
+
+#include <gtest/gtest.h>
+
+using namespace libsnark;
+
+typedef Fr<alt_bn128_pp> FieldT;
+
+std::vector<FieldT> random_vector(const size_t n)
+{
+    std::vector<FieldT> a;
+    for (size_t i = 0; i < n; ++i)
+    {
+        a.emplace_back(FieldT::random_element());
+    }
+    return a;
+}
+
+void test_fft(const size_t n, const size_t num_threads)
+{
+    const FieldT omega = get_root_of_unity<FieldT>(n);
+    const std::vector<FieldT> a = random_vector(n);
+
+    std::vector<FieldT> expected = a;
+    _basic_serial_radix2_FFT(expected, omega);
+
+    std::vector<FieldT> b = a;
+    _basic_radix2_FFT(b, omega, num_threads);
+    EXPECT_EQ(expected, b);
+
+    // Transforming back with the inverse root gives n times the input
+    _basic_radix2_FFT(b, omega.inverse(), num_threads);
+    const FieldT n_inverse = FieldT(n).inverse();
+    for (size_t i = 0; i < n; ++i)
+    {
+        EXPECT_EQ(a[i], b[i] * n_inverse);
+    }
+}
+
+TEST(evaluation_domain, radix2_fft)
+{
+    alt_bn128_pp::init_public_params();
+    inhibit_profiling_info = true;
+
+    for (size_t logn = 1; logn <= 15; ++logn)
+    {
+        test_fft(1ul << logn, 1);
+    }
+    // Sizes around the block size, split over different numbers of threads
+    for (size_t num_threads : {2, 3, 4, 7})
+    {
+        test_fft(FFT_BLOCK_SIZE / 2, num_threads);
+        test_fft(FFT_BLOCK_SIZE, num_threads);
+        test_fft(FFT_BLOCK_SIZE * 8, num_threads);
+    }
+}
+
+TEST(evaluation_domain, radix2_twiddles_are_shared)
+{
+    alt_bn128_pp::init_public_params();
+
+    const size_t n = 1ul << 10;
+    const FieldT omega = get_root_of_unity<FieldT>(n);
+    const auto twiddles = _basic_radix2_twiddles(n, omega);
+    EXPECT_EQ(twiddles, _basic_radix2_twiddles(n, omega));
+    EXPECT_NE(twiddles, _basic_radix2_twiddles(n, omega.inverse()));
+    EXPECT_NE(twiddles, _basic_radix2_twiddles(n / 2, omega * omega));
+
+    ASSERT_EQ(n / 2, twiddles->size());
+    FieldT w = FieldT::one();
+    for (size_t i = 0; i < n / 2; ++i)
+    {
+        EXPECT_EQ(w, (*twiddles)[i]);
+        w *= omega;
+    }
+}
+
+TEST(evaluation_domain, radix2_twiddles_are_bounded)
+{
+    alt_bn128_pp::init_public_params();
+
+    const size_t n = 1ul << 10;
+    const FieldT omega = get_root_of_unity<FieldT>(n);
+    std::weak_ptr<const std::vector<FieldT> > forward = _basic_radix2_twiddles(n, omega);
+    std::weak_ptr<const std::vector<FieldT> > inverse = _basic_radix2_twiddles(n, omega.inverse());
+    EXPECT_FALSE(forward.expired());
+    EXPECT_FALSE(inverse.expired());
+
+    // A transform of another size drops both tables for the old one
+    const auto other = _basic_radix2_twiddles(n / 2, omega * omega);
+    EXPECT_TRUE(forward.expired());
+    EXPECT_TRUE(inverse.expired());
+    EXPECT_EQ(other, _basic_radix2_twiddles(n / 2, omega * omega));
+}
+
+TEST(evaluation_domain, radix2_domain)
+{
+    alt_bn128_pp::init_public_params();
+    inhibit_profiling_info = true;
+
+    const size_t n = FFT_MIN_PARALLEL_SIZE;
+    std::shared_ptr<evaluation_domain<FieldT> > domain = get_evaluation_domain<FieldT>(n);
+    const std::vector<FieldT> a = random_vector(n);
+    const FieldT g = FieldT::multiplicative_generator;
+
+    std::vector<FieldT> b = a;
+    domain->iFFT(b);
+    domain->FFT(b);
+    EXPECT_EQ(a, b);
+
+    // The coset FFT evaluates the polynomial at g * omega^i
+    domain->iFFT(b);
+    const std::vector<FieldT> coefficients = b;
+    domain->cosetFFT(b, g);
+    for (size_t i : {0ul, 1ul, n / 2 + 5, n - 1})
+    {
+        const FieldT x = g * domain->get_element(i);
+        FieldT value = FieldT::zero();
+        for (size_t j = n; j-- > 0; )
+        {
+            value = value * x + coefficients[j];
+        }
+        EXPECT_EQ(value, b[i]);
+    }
+    domain->icosetFFT(b, g);
+    EXPECT_EQ(coefficients, b);
+}
@@ -73,6 +73,15 @@ public:
 
     void mul_reduce(const bigint<n> &other);
 
+    /* For lazy reduction in extension fields: the full 2n-limb product of two
+       (not necessarily reduced) Montgomery representations, and the Montgomery
+       reduction of such a product, which requires T < modulus * R. */
+    static void mul_unreduced(bigint<2*n> &res, const bigint<n> &a, const bigint<n> &b);
+    void reduce(const bigint<2*n> &T);
+
+    /* Whether 2*modulus < R, so that the sum of two elements fits in n limbs */
+    static bool has_spare_bit() { return (modulus.data[n-1] >> (GMP_NUMB_BITS - 1)) == 0; }
+
     void clear();
 
     /* Return the standard (not Montgomery) representation of the
@@ -52,6 +52,10 @@ void Fp_model<n,modulus>::mul_reduce(const bigint<n> &other)
              : "cc", "memory", "%rax");
         mpn_copyi(this->mont_repr.data, res+n, n);
     }
+    else if (n == 4 && mulx_adx_enabled())
+    { // use the "CIOS method" with MULX/ADCX/ADOX
+        MULX_MONT_MUL_4(this->mont_repr.data, this->mont_repr.data, other.data, modulus.data, inv);
+    }
     else if (n == 4)
     { // use asm-optimized "CIOS method"
 
@@ -159,31 +163,59 @@ void Fp_model<n,modulus>::mul_reduce(const bigint<n> &other)
     else
 #endif
     {
-        mp_limb_t res[2*n];
-        mpn_mul_n(res, this->mont_repr.data, other.data, n);
-
-        /*
-          The Montgomery reduction here is based on Algorithm 14.32 in
-          Handbook of Applied Cryptography
-          <http://cacr.uwaterloo.ca/hac/about/chap14.pdf>.
-         */
-        for (size_t i = 0; i < n; ++i)
-        {
-            mp_limb_t k = inv * res[i];
-            /* calculate res = res + k * mod * b^i */
-            mp_limb_t carryout = mpn_addmul_1(res+i, modulus.data, n, k);
-            carryout = mpn_add_1(res+n+i, res+n+i, n-i, carryout);
-            assert(carryout == 0);
-        }
+        bigint<2*n> res;
+        mpn_mul_n(res.data, this->mont_repr.data, other.data, n);
+        reduce(res);
+    }
+}
 
-        if (mpn_cmp(res+n, modulus.data, n) >= 0)
-        {
-            const mp_limb_t borrow = mpn_sub(res+n, res+n, n, modulus.data, n);
-            assert(borrow == 0);
-        }
+template<mp_size_t n, const bigint<n>& modulus>
+void Fp_model<n,modulus>::mul_unreduced(bigint<2*n> &res, const bigint<n> &a, const bigint<n> &b)
+{
+#if defined(__x86_64__) && defined(USE_ASM)
+    if (n == 4 && mulx_adx_enabled())
+    {
+        MULX_MUL_4_BY_4(res.data, a.data, b.data);
+        return;
+    }
+#endif
+    mpn_mul_n(res.data, a.data, b.data, n);
+}
 
-        mpn_copyi(this->mont_repr.data, res+n, n);
+template<mp_size_t n, const bigint<n>& modulus>
+void Fp_model<n,modulus>::reduce(const bigint<2*n> &T)
+{
+#if defined(__x86_64__) && defined(USE_ASM)
+    if (n == 4 && mulx_adx_enabled())
+    {
+        MULX_MONT_REDUCE_8(this->mont_repr.data, T.data, modulus.data, inv);
+        return;
     }
+#endif
+    mp_limb_t res[2*n];
+    mpn_copyi(res, T.data, 2*n);
+
+    /*
+      The Montgomery reduction here is based on Algorithm 14.32 in
+      Handbook of Applied Cryptography
+      <http://cacr.uwaterloo.ca/hac/about/chap14.pdf>.
+     */
+    for (size_t i = 0; i < n; ++i)
+    {
+        mp_limb_t k = inv * res[i];
+        /* calculate res = res + k * mod * b^i */
+        mp_limb_t carryout = mpn_addmul_1(res+i, modulus.data, n, k);
+        carryout = mpn_add_1(res+n+i, res+n+i, n-i, carryout);
+        assert(carryout == 0);
+    }
+
+    if (mpn_cmp(res+n, modulus.data, n) >= 0)
+    {
+        const mp_limb_t borrow = mpn_sub(res+n, res+n, n, modulus.data, n);
+        assert(borrow == 0);
+    }
+
+    mpn_copyi(this->mont_repr.data, res+n, n);
 }
 
 template<mp_size_t n, const bigint<n>& modulus>
@@ -611,6 +643,15 @@ Fp_model<n,modulus> Fp_model<n,modulus>::squared() const
         mpn_copyi(r.mont_repr.data, res+n, n);
         return r;
     }
+    else if (n == 4 && mulx_adx_enabled())
+    { // use MULX squaring, which needs 10 multiplications instead of 16, and reduce separately
+        mp_limb_t res[2*n];
+        MULX_SQR_4(res, this->mont_repr.data);
+
+        Fp_model<n, modulus> r;
+        MULX_MONT_REDUCE_8(r.mont_repr.data, res, modulus.data, inv);
+        return r;
+    }
     else
 #endif
     {
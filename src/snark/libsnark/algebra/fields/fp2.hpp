@@ -62,7 +62,7 @@ public:
 
     Fp2_model operator+(const Fp2_model &other) const;
     Fp2_model operator-(const Fp2_model &other) const;
-    Fp2_model operator*(const Fp2_model &other) const;
+    Fp2_model operator*(const Fp2_model &other) const; // mul_lazy if non_residue = -1 and Fp has a spare bit, else mul_karatsuba
     Fp2_model operator-() const;
     Fp2_model squared() const; // default is squared_complex
     Fp2_model inverse() const;
@@ -70,6 +70,10 @@ public:
     Fp2_model sqrt() const; // HAS TO BE A SQUARE (else does not terminate)
     Fp2_model squared_karatsuba() const;
     Fp2_model squared_complex() const;
+    Fp2_model mul_karatsuba(const Fp2_model &other) const;
+    Fp2_model mul_lazy(const Fp2_model &other) const; // requires non_residue = -1 and Fp_model::has_spare_bit()
+
+    static bool non_residue_is_minus_one();
 
     template<mp_size_t m>
     Fp2_model operator^(const bigint<m> &other) const;
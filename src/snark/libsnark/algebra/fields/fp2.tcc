@@ -69,8 +69,25 @@ Fp2_model<n, modulus> operator*(const Fp_model<n, modulus> &lhs, const Fp2_model
                                 lhs*rhs.c1);
 }
 
+template<mp_size_t n, const bigint<n>& modulus>
+bool Fp2_model<n,modulus>::non_residue_is_minus_one()
+{
+    static const my_Fp minus_one = -my_Fp::one();
+    return non_residue == minus_one;
+}
+
 template<mp_size_t n, const bigint<n>& modulus>
 Fp2_model<n,modulus> Fp2_model<n,modulus>::operator*(const Fp2_model<n,modulus> &other) const
+{
+    if (my_Fp::has_spare_bit() && non_residue_is_minus_one())
+    {
+        return mul_lazy(other);
+    }
+    return mul_karatsuba(other);
+}
+
+template<mp_size_t n, const bigint<n>& modulus>
+Fp2_model<n,modulus> Fp2_model<n,modulus>::mul_karatsuba(const Fp2_model<n,modulus> &other) const
 {
     /* Devegili OhEig Scott Dahab --- Multiplication and Squaring on Pairing-Friendly Fields.pdf; Section 3 (Karatsuba) */
     const my_Fp
@@ -83,6 +100,41 @@ Fp2_model<n,modulus> Fp2_model<n,modulus>::operator*(const Fp2_model<n,modulus>
                                 (a + b)*(A+B) - aA - bB);
 }
 
+template<mp_size_t n, const bigint<n>& modulus>
+Fp2_model<n,modulus> Fp2_model<n,modulus>::mul_lazy(const Fp2_model<n,modulus> &other) const
+{
+    /* Karatsuba as above, but with the products kept at double width and
+       only reduced once per coefficient ("lazy reduction", see Aranha et al.,
+       Faster Explicit Formulas for Computing Pairings over Ordinary Curves).
+       With non_residue = -1, both double-width results are below modulus * R:
+       c0 = aA - bB is shifted up by modulus * R if negative, and
+       c1 = (a + b)*(A + B) - aA - bB = aB + bA < 2*modulus^2. */
+    const my_Fp
+        &A = other.c0, &B = other.c1,
+        &a = this->c0, &b = this->c1;
+
+    bigint<2*n> aA, bB, c0, c1;
+    my_Fp::mul_unreduced(aA, a.mont_repr, A.mont_repr);
+    my_Fp::mul_unreduced(bB, b.mont_repr, B.mont_repr);
+
+    bigint<n> a_plus_b, A_plus_B;
+    mpn_add_n(a_plus_b.data, a.mont_repr.data, b.mont_repr.data, n);
+    mpn_add_n(A_plus_B.data, A.mont_repr.data, B.mont_repr.data, n);
+    my_Fp::mul_unreduced(c1, a_plus_b, A_plus_B);
+    mpn_sub_n(c1.data, c1.data, aA.data, 2*n);
+    mpn_sub_n(c1.data, c1.data, bB.data, 2*n);
+
+    if (mpn_sub_n(c0.data, aA.data, bB.data, 2*n))
+    {
+        mpn_add_n(c0.data + n, c0.data + n, modulus.data, n);
+    }
+
+    Fp2_model<n,modulus> r;
+    r.c0.reduce(c0);
+    r.c1.reduce(c1);
+    return r;
+}
+
 template<mp_size_t n, const bigint<n>& modulus>
 Fp2_model<n,modulus> Fp2_model<n,modulus>::operator-() const
 {
@@ -115,6 +167,12 @@ Fp2_model<n,modulus> Fp2_model<n,modulus>::squared_complex() const
     const my_Fp &a = this->c0, &b = this->c1;
     const my_Fp ab = a * b;
 
+    if (non_residue_is_minus_one())
+    {
+        return Fp2_model<n,modulus>((a + b) * (a - b),
+                                    ab + ab);
+    }
+
     return Fp2_model<n,modulus>((a + b) * (a + non_residue * b) - ab - non_residue * ab,
                                 ab + ab);
 }
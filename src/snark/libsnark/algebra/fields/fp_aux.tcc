@@ -13,6 +13,10 @@
 #ifndef FP_AUX_TCC_
 #define FP_AUX_TCC_
 
+#if defined(__x86_64__) && defined(USE_ASM)
+#include <cpuid.h>
+#endif
+
 namespace libsnark {
 
 #define STR_HELPER(x) #x
@@ -385,5 +389,245 @@ namespace libsnark {
          : [modprime] "r" (inv_), [res] "r" (res_), [mod] "r" (mod_) \
          : "%rax", "%rdx", "cc", "memory")
 
+/*
+  Kernels for n == 4 using the MULX (BMI2), ADCX and ADOX (ADX) instructions.
+  MULX leaves the flags alone, so the low and high halves of a row of partial
+  products are accumulated on two independent carry chains (CF and OF).
+
+  They are only used when the CPU reports both extensions, which is checked
+  once at runtime (see mulx_adx_enabled); fp.tcc falls back to the kernels
+  above otherwise.
+
+  The accumulator t = t0..t5 lives in %r8..%r13; %rax, %rdx, %r14 and %r15
+  are scratch.
+*/
+
+#define MULX_ZERO_ACC                   \
+    "xorl    %%r8d, %%r8d     \n\t"     \
+    "xorl    %%r9d, %%r9d     \n\t"     \
+    "xorl    %%r10d, %%r10d   \n\t"     \
+    "xorl    %%r11d, %%r11d   \n\t"     \
+    "xorl    %%r12d, %%r12d   \n\t"     \
+    "xorl    %%r13d, %%r13d   \n\t"
+
+/* t <- t + A * B[i] */
+#define MULX_MUL_STEP(i)                                \
+    "movq    " STR((i*8)) "(%[B]), %%rdx    \n\t"       \
+    "xorl    %%eax, %%eax                   \n\t"       \
+    "mulxq   0(%[A]), %%rax, %%r14          \n\t"       \
+    "adcxq   %%rax, %%r8                    \n\t"       \
+    "adoxq   %%r14, %%r9                    \n\t"       \
+    "mulxq   8(%[A]), %%rax, %%r14          \n\t"       \
+    "adcxq   %%rax, %%r9                    \n\t"       \
+    "adoxq   %%r14, %%r10                   \n\t"       \
+    "mulxq   16(%[A]), %%rax, %%r14         \n\t"       \
+    "adcxq   %%rax, %%r10                   \n\t"       \
+    "adoxq   %%r14, %%r11                   \n\t"       \
+    "mulxq   24(%[A]), %%rax, %%r14         \n\t"       \
+    "adcxq   %%rax, %%r11                   \n\t"       \
+    "adoxq   %%r14, %%r12                   \n\t"       \
+    "movl    $0, %%eax                      \n\t"       \
+    "adcxq   %%rax, %%r12                   \n\t"       \
+    "adoxq   %%rax, %%r13                   \n\t"       \
+    "adcxq   %%rax, %%r13                   \n\t"
+
+/* t <- t / b, where b = 2^64 and t0 = 0 */
+#define MULX_SHIFT_ACC                  \
+    "movq    %%r9, %%r8       \n\t"     \
+    "movq    %%r10, %%r9      \n\t"     \
+    "movq    %%r11, %%r10     \n\t"     \
+    "movq    %%r12, %%r11     \n\t"     \
+    "movq    %%r13, %%r12     \n\t"     \
+    "xorl    %%r13d, %%r13d   \n\t"
+
+/* t <- (t + M * u) / b, where u = t0 * inv makes the sum divisible by b */
+#define MULX_REDUCE_STEP                                \
+    "movq    %%r8, %%rdx                    \n\t"       \
+    "imulq   %[inv], %%rdx                  \n\t"       \
+    "xorl    %%eax, %%eax                   \n\t"       \
+    "mulxq   0(%[M]), %%rax, %%r14          \n\t"       \
+    "adcxq   %%rax, %%r8                    \n\t"       \
+    "adoxq   %%r14, %%r9                    \n\t"       \
+    "mulxq   8(%[M]), %%rax, %%r14          \n\t"       \
+    "adcxq   %%rax, %%r9                    \n\t"       \
+    "adoxq   %%r14, %%r10                   \n\t"       \
+    "mulxq   16(%[M]), %%rax, %%r14         \n\t"       \
+    "adcxq   %%rax, %%r10                   \n\t"       \
+    "adoxq   %%r14, %%r11                   \n\t"       \
+    "mulxq   24(%[M]), %%rax, %%r14         \n\t"       \
+    "adcxq   %%rax, %%r11                   \n\t"       \
+    "adoxq   %%r14, %%r12                   \n\t"       \
+    "movl    $0, %%eax                      \n\t"       \
+    "adcxq   %%rax, %%r12                   \n\t"       \
+    "adoxq   %%rax, %%r13                   \n\t"       \
+    "adcxq   %%rax, %%r13                   \n\t"       \
+    MULX_SHIFT_ACC
+
+/* res <- t mod M, for t < 2*M; branch-free */
+#define MULX_FINAL_SUB                                  \
+    "movq    %%r8, %%rax                    \n\t"       \
+    "subq    0(%[M]), %%rax                 \n\t"       \
+    "movq    %%r9, %%r14                    \n\t"       \
+    "sbbq    8(%[M]), %%r14                 \n\t"       \
+    "movq    %%r10, %%r15                   \n\t"       \
+    "sbbq    16(%[M]), %%r15                \n\t"       \
+    "movq    %%r11, %%rdx                   \n\t"       \
+    "sbbq    24(%[M]), %%rdx                \n\t"       \
+    "sbbq    $0, %%r12                      \n\t"       \
+    "cmovcq  %%r8, %%rax                    \n\t"       \
+    "cmovcq  %%r9, %%r14                    \n\t"       \
+    "cmovcq  %%r10, %%r15                   \n\t"       \
+    "cmovcq  %%r11, %%rdx                   \n\t"       \
+    "movq    %%rax, 0(%[res])               \n\t"       \
+    "movq    %%r14, 8(%[res])               \n\t"       \
+    "movq    %%r15, 16(%[res])              \n\t"       \
+    "movq    %%rdx, 24(%[res])              \n\t"
+
+#define MULX_CLOBBERS "cc", "memory", "%rax", "%rdx", "%r8", "%r9", "%r10", "%r11", "%r12", "%r13", "%r14", "%r15"
+
+/* res <- A * B / R mod M (CIOS method, as MONT_* above) */
+#define MULX_MONT_MUL_4(res_, A_, B_, M_, inv_)                 \
+    __asm__ volatile (MULX_ZERO_ACC                             \
+                      MULX_MUL_STEP(0)                          \
+                      MULX_REDUCE_STEP                          \
+                      MULX_MUL_STEP(1)                          \
+                      MULX_REDUCE_STEP                          \
+                      MULX_MUL_STEP(2)                          \
+                      MULX_REDUCE_STEP                          \
+                      MULX_MUL_STEP(3)                          \
+                      MULX_REDUCE_STEP                          \
+                      MULX_FINAL_SUB                            \
+                      :                                         \
+                      : [res] "r" (res_), [A] "r" (A_), [B] "r" (B_), [M] "r" (M_), [inv] "m" (inv_) \
+                      : MULX_CLOBBERS)
+
+/* res[0..7] <- A * B */
+#define MULX_MUL_4_BY_4(res_, A_, B_)                           \
+    __asm__ volatile (MULX_ZERO_ACC                             \
+                      MULX_MUL_STEP(0)                          \
+                      "movq    %%r8, 0(%[res])       \n\t"      \
+                      MULX_SHIFT_ACC                            \
+                      MULX_MUL_STEP(1)                          \
+                      "movq    %%r8, 8(%[res])       \n\t"      \
+                      MULX_SHIFT_ACC                            \
+                      MULX_MUL_STEP(2)                          \
+                      "movq    %%r8, 16(%[res])      \n\t"      \
+                      MULX_SHIFT_ACC                            \
+                      MULX_MUL_STEP(3)                          \
+                      "movq    %%r8, 24(%[res])      \n\t"      \
+                      "movq    %%r9, 32(%[res])      \n\t"      \
+                      "movq    %%r10, 40(%[res])     \n\t"      \
+                      "movq    %%r11, 48(%[res])     \n\t"      \
+                      "movq    %%r12, 56(%[res])     \n\t"      \
+                      :                                         \
+                      : [res] "r" (res_), [A] "r" (A_), [B] "r" (B_) \
+                      : MULX_CLOBBERS)
+
+/*
+  res[0..7] <- A^2: the off-diagonal products A[i]*A[j] (i < j) are summed into
+  words 1..6 (%r8..%r13), doubled into words 1..7 (%r8..%r14), and the squares
+  A[i]^2 are added on top.
+*/
+#define MULX_SQR_4(res_, A_)                                    \
+    __asm__ volatile ("movq    0(%[A]), %%rdx        \n\t"      \
+                      "mulxq   8(%[A]), %%r8, %%r9   \n\t"      \
+                      "mulxq   16(%[A]), %%rax, %%r10 \n\t"     \
+                      "addq    %%rax, %%r9           \n\t"      \
+                      "mulxq   24(%[A]), %%rax, %%r11 \n\t"     \
+                      "adcq    %%rax, %%r10          \n\t"      \
+                      "adcq    $0, %%r11             \n\t"      \
+                      "movq    8(%[A]), %%rdx        \n\t"      \
+                      "xorl    %%eax, %%eax          \n\t"      \
+                      "mulxq   16(%[A]), %%rax, %%r15 \n\t"     \
+                      "adcxq   %%rax, %%r10          \n\t"      \
+                      "adoxq   %%r15, %%r11          \n\t"      \
+                      "mulxq   24(%[A]), %%rax, %%r12 \n\t"     \
+                      "adcxq   %%rax, %%r11          \n\t"      \
+                      "movl    $0, %%eax             \n\t"      \
+                      "adoxq   %%rax, %%r12          \n\t"      \
+                      "adcxq   %%rax, %%r12          \n\t"      \
+                      "movq    16(%[A]), %%rdx       \n\t"      \
+                      "mulxq   24(%[A]), %%rax, %%r13 \n\t"     \
+                      "addq    %%rax, %%r12          \n\t"      \
+                      "adcq    $0, %%r13             \n\t"      \
+                      "xorl    %%r14d, %%r14d        \n\t"      \
+                      "addq    %%r8, %%r8            \n\t"      \
+                      "adcq    %%r9, %%r9            \n\t"      \
+                      "adcq    %%r10, %%r10          \n\t"      \
+                      "adcq    %%r11, %%r11          \n\t"      \
+                      "adcq    %%r12, %%r12          \n\t"      \
+                      "adcq    %%r13, %%r13          \n\t"      \
+                      "adcq    $0, %%r14             \n\t"      \
+                      "movq    0(%[A]), %%rdx        \n\t"      \
+                      "mulxq   %%rdx, %%rax, %%r15   \n\t"      \
+                      "movq    %%rax, 0(%[res])      \n\t"      \
+                      "addq    %%r15, %%r8           \n\t"      \
+                      "movq    8(%[A]), %%rdx        \n\t"      \
+                      "mulxq   %%rdx, %%rax, %%r15   \n\t"      \
+                      "adcq    %%rax, %%r9           \n\t"      \
+                      "adcq    %%r15, %%r10          \n\t"      \
+                      "movq    16(%[A]), %%rdx       \n\t"      \
+                      "mulxq   %%rdx, %%rax, %%r15   \n\t"      \
+                      "adcq    %%rax, %%r11          \n\t"      \
+                      "adcq    %%r15, %%r12          \n\t"      \
+                      "movq    24(%[A]), %%rdx       \n\t"      \
+                      "mulxq   %%rdx, %%rax, %%r15   \n\t"      \
+                      "adcq    %%rax, %%r13          \n\t"      \
+                      "adcq    %%r15, %%r14          \n\t"      \
+                      "movq    %%r8, 8(%[res])       \n\t"      \
+                      "movq    %%r9, 16(%[res])      \n\t"      \
+                      "movq    %%r10, 24(%[res])     \n\t"      \
+                      "movq    %%r11, 32(%[res])     \n\t"      \
+                      "movq    %%r12, 40(%[res])     \n\t"      \
+                      "movq    %%r13, 48(%[res])     \n\t"      \
+                      "movq    %%r14, 56(%[res])     \n\t"      \
+                      :                                         \
+                      : [res] "r" (res_), [A] "r" (A_)          \
+                      : MULX_CLOBBERS)
+
+/* res <- T / R mod M, for the 8-limb T < M * R */
+#define MULX_MONT_REDUCE_8(res_, T_, M_, inv_)                  \
+    __asm__ volatile ("movq    0(%[T]), %%r8         \n\t"      \
+                      "movq    8(%[T]), %%r9         \n\t"      \
+                      "movq    16(%[T]), %%r10       \n\t"      \
+                      "movq    24(%[T]), %%r11       \n\t"      \
+                      "xorl    %%r12d, %%r12d        \n\t"      \
+                      "xorl    %%r13d, %%r13d        \n\t"      \
+                      MULX_REDUCE_STEP                          \
+                      MULX_REDUCE_STEP                          \
+                      MULX_REDUCE_STEP                          \
+                      MULX_REDUCE_STEP                          \
+                      "addq    32(%[T]), %%r8        \n\t"      \
+                      "adcq    40(%[T]), %%r9        \n\t"      \
+                      "adcq    48(%[T]), %%r10       \n\t"      \
+                      "adcq    56(%[T]), %%r11       \n\t"      \
+                      "adcq    $0, %%r12             \n\t"      \
+                      MULX_FINAL_SUB                            \
+                      :                                         \
+                      : [res] "r" (res_), [T] "r" (T_), [M] "r" (M_), [inv] "m" (inv_) \
+                      : MULX_CLOBBERS)
+
+#if defined(__x86_64__) && defined(USE_ASM)
+/* Whether the CPU supports BMI2 and ADX (CPUID leaf 7, EBX bits 8 and 19). */
+inline bool cpu_supports_mulx_adx()
+{
+    unsigned int eax, ebx, ecx, edx;
+    if (__get_cpuid_max(0, nullptr) < 7)
+    {
+        return false;
+    }
+    __cpuid_count(7, 0, eax, ebx, ecx, edx);
+    return (ebx & (1u << 8)) && (ebx & (1u << 19));
+}
+
+/* Whether fp.tcc uses the MULX/ADX kernels; initially set from CPU detection.
+   Tests clear it to compare against the other code paths. */
+inline bool& mulx_adx_enabled()
+{
+    static bool enabled = cpu_supports_mulx_adx();
+    return enabled;
+}
+#endif
+
 } // libsnark
 #endif // FP_AUX_TCC_
@@ -94,6 +94,35 @@ void test_unitary_inverse()
     EXPECT_EQ(aqcubed_minus1.inverse(), aqcubed_minus1.unitary_inverse());
 }
 
+template<typename FieldT>
+void test_unreduced_mul()
+{
+    FieldT a = FieldT::random_element();
+    FieldT b = FieldT::random_element();
+    bigint<2*FieldT::num_limbs> ab;
+    FieldT::mul_unreduced(ab, a.mont_repr, b.mont_repr);
+    FieldT c;
+    c.reduce(ab);
+    EXPECT_EQ(a * b, c);
+}
+
+template<typename Fp2T>
+void test_Fp2_mul()
+{
+    Fp2T a = Fp2T::random_element();
+    Fp2T b = Fp2T::random_element();
+    EXPECT_EQ(a * b, a.mul_karatsuba(b));
+    if (Fp2T::my_Fp::has_spare_bit() && Fp2T::non_residue_is_minus_one())
+    {
+        EXPECT_EQ(a.mul_lazy(b), a.mul_karatsuba(b));
+        // aA - bB is as negative as it gets
+        a.c0 = Fp2T::my_Fp::zero();
+        b.c1 = -Fp2T::my_Fp::one();
+        EXPECT_EQ(a.mul_lazy(-a), a.mul_karatsuba(-a));
+        EXPECT_EQ(b.mul_lazy(b), b.mul_karatsuba(b));
+    }
+}
+
 template<typename ppT>
 void test_all_fields()
 {
@@ -110,6 +139,12 @@ void test_all_fields()
     test_Frobenius<Fqk<ppT> >();
 
     test_unitary_inverse<Fqk<ppT> >();
+
+    test_unreduced_mul<Fr<ppT> >();
+    test_unreduced_mul<Fq<ppT> >();
+
+    test_two_squarings<Fqe<ppT> >();
+    test_Fp2_mul<Fqe<ppT> >();
 }
 
 template<typename Fp4T>
@@ -189,3 +224,78 @@ TEST(algebra, fields)
     test_field<Fq<bn128_pp> >();
 #endif
 }
+
+#if defined(__x86_64__) && defined(USE_ASM)
+/* Compares the MULX/ADX kernels with the other code paths, on random elements
+   and on the extremes of the Montgomery representation. */
+template<typename FieldT>
+void test_mulx_adx()
+{
+    std::vector<FieldT> elements;
+    elements.emplace_back(FieldT::zero());
+    elements.emplace_back(FieldT::one());
+    elements.emplace_back(-FieldT::one());
+    FieldT e;
+    e.mont_repr.clear();
+    e.mont_repr.data[0] = 1;
+    elements.emplace_back(e);
+    mpn_sub_1(e.mont_repr.data, FieldT::mod.data, FieldT::num_limbs, 1);
+    elements.emplace_back(e);
+    mpn_sub_1(e.mont_repr.data, FieldT::mod.data, FieldT::num_limbs, 2);
+    elements.emplace_back(e);
+    for (size_t i = 0; i < 100; ++i)
+    {
+        elements.emplace_back(FieldT::random_element());
+    }
+
+    for (const FieldT &a : elements)
+    {
+        for (const FieldT &b : elements)
+        {
+            bigint<2*FieldT::num_limbs> ab_mulx, ab;
+
+            mulx_adx_enabled() = true;
+            const FieldT c_mulx = a * b;
+            FieldT::mul_unreduced(ab_mulx, a.mont_repr, b.mont_repr);
+            FieldT d_mulx;
+            d_mulx.reduce(ab_mulx);
+
+            mulx_adx_enabled() = false;
+            const FieldT c = a * b;
+            FieldT::mul_unreduced(ab, a.mont_repr, b.mont_repr);
+            FieldT d;
+            d.reduce(ab);
+
+            EXPECT_EQ(c, c_mulx);
+            EXPECT_EQ(ab, ab_mulx);
+            EXPECT_EQ(d, d_mulx);
+            EXPECT_EQ(c, d);
+        }
+
+        mulx_adx_enabled() = true;
+        const FieldT sq_mulx = a.squared();
+        mulx_adx_enabled() = false;
+        EXPECT_EQ(a.squared(), sq_mulx);
+        EXPECT_EQ(a * a, sq_mulx);
+    }
+}
+
+TEST(algebra, fields_mulx_adx)
+{
+    alt_bn128_pp::init_public_params();
+    if (!cpu_supports_mulx_adx())
+    {
+        return;
+    }
+
+    const bool enabled = mulx_adx_enabled();
+    test_mulx_adx<alt_bn128_Fq>();
+    test_mulx_adx<alt_bn128_Fr>();
+
+    // The tower fields should agree with the kernels disabled too
+    mulx_adx_enabled() = false;
+    test_field<alt_bn128_Fq6>();
+    test_all_fields<alt_bn128_pp>();
+    mulx_adx_enabled() = enabled;
+}
+#endif
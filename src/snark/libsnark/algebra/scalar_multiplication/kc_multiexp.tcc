@@ -86,6 +86,12 @@ knowledge_commitment<T1, T2> kc_multi_exp_with_mixed_addition(const knowledge_co
     //print_indent(); printf("* Elements of w remaining: %zu (%0.2f%%)\n", num_other, 100.*num_other/(num_skip+num_add+num_other));
     leave_block("Process scalar vector");
 
+    if (use_multiexp && g.size() >= PIPPENGER_MIN_TERMS)
+    {
+        return acc + multi_exp_pippenger<knowledge_commitment<T1, T2>, FieldT, true>(g.begin(), g.end(), p.begin(), p.end(),
+                                                                                     get_multi_exp_threads(chunks));
+    }
+
     return acc + multi_exp<knowledge_commitment<T1, T2>, FieldT>(g.begin(), g.end(), p.begin(), p.end(), chunks, use_multiexp);
 }
 
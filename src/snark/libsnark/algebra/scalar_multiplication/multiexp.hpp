@@ -14,6 +14,11 @@
 
 namespace libsnark {
 
+/**
+ * Below this many terms, the heap-based algorithm beats the bucket method.
+ */
+const size_t PIPPENGER_MIN_TERMS = 64;
+
 /**
  * Naive multi-exponentiation individually multiplies each base by the
  * corresponding scalar and adds up the results.
@@ -32,7 +37,8 @@ T naive_plain_exp(typename std::vector<T>::const_iterator vec_start,
 
 /**
  * Naive multi-exponentiation uses a variant of the Bos-Coster algorithm [1],
- * and implementation suggestions from [2].
+ * and implementation suggestions from [2]. If use_multiexp is set, instances
+ * of at least PIPPENGER_MIN_TERMS terms use multi_exp_pippenger instead.
  *
  * [1] = Bos and Coster, "Addition chain heuristics", CRYPTO '89
  * [2] = Bernstein, Duif, Lange, Schwabe, and Yang, "High-speed high-security signatures", CHES '11
@@ -46,6 +52,30 @@ T multi_exp(typename std::vector<T>::const_iterator vec_start,
             const bool use_multiexp=false);
 
 
+/**
+ * Multi-exponentiation using Pippenger's bucket method [1]. Scalars are split
+ * into c-bit windows, with c chosen from the number of terms. For each window,
+ * every base is added into the bucket selected by its window digit, and the
+ * buckets are then combined with a running sum. Windows are processed in
+ * parallel on up to num_threads threads (0 = one per hardware thread).
+ *
+ * If mixed_addition is set, every base must be in special form and bucket
+ * additions use mixed_add (when built with USE_MIXED_ADDITION).
+ *
+ * [1] = Bernstein, Doumen, Lange, and Oosterwijk, "Faster batch forgery identification", INDOCRYPT '12
+ */
+template<typename T, typename FieldT, bool mixed_addition>
+T multi_exp_pippenger(typename std::vector<T>::const_iterator vec_start,
+                      typename std::vector<T>::const_iterator vec_end,
+                      typename std::vector<FieldT>::const_iterator scalar_start,
+                      typename std::vector<FieldT>::const_iterator scalar_end,
+                      const size_t num_threads);
+
+/**
+ * Compute the Pippenger window size for the given number of terms.
+ */
+inline size_t get_pippenger_window_size(const size_t num_terms);
+
 /**
  * A variant of multi_exp that takes advantage of the method mixed_add (instead of the operator '+').
  */
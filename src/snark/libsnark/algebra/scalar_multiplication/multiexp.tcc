@@ -17,7 +17,9 @@
 #include "algebra/fields/fp_aux.tcc"
 
 #include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <thread>
 #include <type_traits>
 
 #include "common/profiling.hpp"
@@ -266,6 +268,151 @@ T multi_exp_inner(typename std::vector<T>::const_iterator vec_start,
     return opt_result;
 }
 
+inline size_t get_pippenger_window_size(const size_t num_terms)
+{
+    if (num_terms < 32)
+    {
+        return 3;
+    }
+
+    // ~ln(num_terms) + 2, which roughly balances the cost of adding the terms
+    // into buckets against the cost of summing up 2^c buckets per window
+    return log2(num_terms) * 69 / 100 + 2;
+}
+
+/* Returns the c-bit window of r starting at bit offset. */
+template<mp_size_t n>
+size_t get_pippenger_digit(const bigint<n> &r, const size_t offset, const size_t c)
+{
+    const size_t limb = offset / GMP_NUMB_BITS;
+    const size_t shift = offset % GMP_NUMB_BITS;
+    if (limb >= n)
+    {
+        return 0;
+    }
+
+    mp_limb_t bits = r.data[limb] >> shift;
+    if (shift + c > GMP_NUMB_BITS && limb + 1 < n)
+    {
+        bits |= r.data[limb + 1] << (GMP_NUMB_BITS - shift);
+    }
+    return bits & ((1ul << c) - 1);
+}
+
+template<typename T, typename FieldT, bool mixed_addition>
+T multi_exp_pippenger_window(typename std::vector<T>::const_iterator vec_start,
+                             const std::vector<bigint<FieldT::num_limbs> > &exponents,
+                             const size_t offset,
+                             const size_t c)
+{
+    std::vector<T> buckets((1ul << c) - 1, T::zero());
+
+    for (size_t i = 0; i < exponents.size(); ++i)
+    {
+        const size_t digit = get_pippenger_digit(exponents[i], offset, c);
+        if (digit == 0)
+        {
+            continue;
+        }
+
+        T &bucket = buckets[digit - 1];
+#ifdef USE_MIXED_ADDITION
+        if (mixed_addition)
+        {
+            bucket = bucket.mixed_add(*(vec_start + i));
+            continue;
+        }
+#endif
+        bucket = bucket + *(vec_start + i);
+    }
+
+    // sum_j j * bucket[j], computed as the sum of the running suffix sums
+    T running_sum = T::zero();
+    T window_sum = T::zero();
+    for (size_t j = buckets.size(); j-- > 0; )
+    {
+        running_sum = running_sum + buckets[j];
+        window_sum = window_sum + running_sum;
+    }
+
+    return window_sum;
+}
+
+template<typename T, typename FieldT, bool mixed_addition>
+T multi_exp_pippenger(typename std::vector<T>::const_iterator vec_start,
+                      typename std::vector<T>::const_iterator vec_end,
+                      typename std::vector<FieldT>::const_iterator scalar_start,
+                      typename std::vector<FieldT>::const_iterator scalar_end,
+                      const size_t num_threads)
+{
+    const size_t num_terms = vec_end - vec_start;
+    assert(num_terms == (size_t)(scalar_end - scalar_start));
+
+    if (num_terms == 0)
+    {
+        return T::zero();
+    }
+
+    std::vector<bigint<FieldT::num_limbs> > exponents;
+    exponents.reserve(num_terms);
+    for (auto scalar_it = scalar_start; scalar_it != scalar_end; ++scalar_it)
+    {
+        exponents.emplace_back(scalar_it->as_bigint());
+    }
+
+    const size_t c = get_pippenger_window_size(num_terms);
+    const size_t num_bits = FieldT::size_in_bits();
+    const size_t num_windows = (num_bits + c - 1) / c;
+
+    std::vector<T> window_sums(num_windows, T::zero());
+    std::atomic<size_t> next_window(0);
+    auto worker = [&]() {
+        for (size_t w = next_window++; w < num_windows; w = next_window++)
+        {
+            window_sums[w] = multi_exp_pippenger_window<T, FieldT, mixed_addition>(vec_start, exponents, w * c, c);
+        }
+    };
+
+    size_t threads = (num_threads != 0 ? num_threads : std::thread::hardware_concurrency());
+    threads = std::max<size_t>(1, std::min(threads, num_windows));
+
+    std::vector<std::thread> pool;
+    for (size_t i = 1; i < threads; ++i)
+    {
+        pool.emplace_back(worker);
+    }
+    worker();
+    for (auto &t : pool)
+    {
+        t.join();
+    }
+
+    T result = window_sums[num_windows - 1];
+    for (size_t w = num_windows - 1; w-- > 0; )
+    {
+        for (size_t i = 0; i < c; ++i)
+        {
+            result = result.dbl();
+        }
+        result = result + window_sums[w];
+    }
+
+    return result;
+}
+
+/* The number of threads to give multi_exp_pippenger for a multi_exp call
+   with the given number of chunks. */
+inline size_t get_multi_exp_threads(const size_t chunks)
+{
+#ifdef MULTICORE
+    return chunks;
+#else
+    // Without OpenMP, callers always pass a single chunk; use all cores.
+    UNUSED(chunks);
+    return 0;
+#endif
+}
+
 template<typename T, typename FieldT>
 T multi_exp(typename std::vector<T>::const_iterator vec_start,
             typename std::vector<T>::const_iterator vec_end,
@@ -275,6 +422,12 @@ T multi_exp(typename std::vector<T>::const_iterator vec_start,
             const bool use_multiexp)
 {
     const size_t total = vec_end - vec_start;
+    if (use_multiexp && total >= PIPPENGER_MIN_TERMS)
+    {
+        return multi_exp_pippenger<T, FieldT, false>(vec_start, vec_end, scalar_start, scalar_end,
+                                                     get_multi_exp_threads(chunks));
+    }
+
     if (total < chunks)
     {
         return naive_exp<T, FieldT>(vec_start, vec_end, scalar_start, scalar_end);
@@ -374,6 +527,12 @@ T multi_exp_with_mixed_addition(typename std::vector<T>::const_iterator vec_star
 
     leave_block("Process scalar vector");
 
+    if (use_multiexp && g.size() >= PIPPENGER_MIN_TERMS)
+    {
+        return acc + multi_exp_pippenger<T, FieldT, true>(g.begin(), g.end(), p.begin(), p.end(),
+                                                          get_multi_exp_threads(chunks));
+    }
+
     return acc + multi_exp<T, FieldT>(g.begin(), g.end(), p.begin(), p.end(), chunks, use_multiexp);
 }
 
@@ -0,0 +1,82 @@
+/**
+ *****************************************************************************
+ * @author     This file is part of libsnark, developed by SCIPR Lab
+ *             and contributors (see AUTHORS).
+ * @copyright  MIT license (see LICENSE file)
+ *****************************************************************************/
+#include "common/profiling.hpp"
+#include "algebra/curves/alt_bn128/alt_bn128_pp.hpp"
+#include "algebra/knowledge_commitment/knowledge_commitment.hpp"
+#include "algebra/scalar_multiplication/kc_multiexp.hpp"
+#include "algebra/scalar_multiplication/multiexp.hpp"
+
+#include <gtest/gtest.h>
+
+using namespace libsnark;
+
+template<typename GroupT, typename FieldT>
+void test_multi_exp_pippenger(const size_t num_terms, const size_t num_threads)
+{
+    std::vector<GroupT> bases;
+    std::vector<FieldT> scalars;
+    for (size_t i = 0; i < num_terms; ++i)
+    {
+        bases.emplace_back(GroupT::random_element());
+        scalars.emplace_back(FieldT::random_element());
+    }
+    // Digits of zero and of the largest scalar exercise the edge buckets
+    if (num_terms > 2)
+    {
+        scalars[0] = FieldT::zero();
+        scalars[1] = -FieldT::one();
+    }
+
+    GroupT expected = naive_plain_exp<GroupT, FieldT>(bases.begin(), bases.end(), scalars.begin(), scalars.end());
+
+    EXPECT_EQ(expected, (multi_exp_pippenger<GroupT, FieldT, false>(bases.begin(), bases.end(), scalars.begin(), scalars.end(), num_threads)));
+    EXPECT_EQ(expected, (multi_exp<GroupT, FieldT>(bases.begin(), bases.end(), scalars.begin(), scalars.end(), 1, true)));
+
+    batch_to_special<GroupT>(bases);
+    EXPECT_EQ(expected, (multi_exp_pippenger<GroupT, FieldT, true>(bases.begin(), bases.end(), scalars.begin(), scalars.end(), num_threads)));
+    EXPECT_EQ(expected, (multi_exp_with_mixed_addition<GroupT, FieldT>(bases.begin(), bases.end(), scalars.begin(), scalars.end(), 1, true)));
+}
+
+TEST(multiexp, pippenger)
+{
+    alt_bn128_pp::init_public_params();
+
+    for (size_t num_terms : {0, 1, 2, 31, 32, 64, 200, 1000})
+    {
+        test_multi_exp_pippenger<G1<alt_bn128_pp>, Fr<alt_bn128_pp> >(num_terms, 1);
+        test_multi_exp_pippenger<G1<alt_bn128_pp>, Fr<alt_bn128_pp> >(num_terms, 4);
+    }
+    test_multi_exp_pippenger<G2<alt_bn128_pp>, Fr<alt_bn128_pp> >(100, 0);
+}
+
+TEST(multiexp, kc_pippenger)
+{
+    alt_bn128_pp::init_public_params();
+
+    typedef knowledge_commitment<G2<alt_bn128_pp>, G1<alt_bn128_pp> > kc_t;
+    typedef Fr<alt_bn128_pp> FieldT;
+
+    const size_t num_terms = 300;
+    knowledge_commitment_vector<G2<alt_bn128_pp>, G1<alt_bn128_pp> > vec;
+    std::vector<FieldT> scalars;
+    kc_t expected = kc_t::zero();
+    for (size_t i = 0; i < num_terms; ++i)
+    {
+        kc_t value(G2<alt_bn128_pp>::random_element(), G1<alt_bn128_pp>::random_element());
+        // Scalars of zero and one are handled before the multi-exponentiation
+        FieldT scalar = (i % 10 == 0 ? FieldT::zero() : (i % 10 == 1 ? FieldT::one() : FieldT::random_element()));
+        vec.indices.emplace_back(i);
+        vec.values.emplace_back(value);
+        scalars.emplace_back(scalar);
+        expected = expected + scalar * value;
+    }
+    vec.domain_size_ = num_terms;
+    kc_batch_to_special(vec.values);
+
+    EXPECT_EQ(expected, (kc_multi_exp_with_mixed_addition<G2<alt_bn128_pp>, G1<alt_bn128_pp>, FieldT>(
+        vec, 0, num_terms, scalars.begin(), scalars.end(), 1, true)));
+}
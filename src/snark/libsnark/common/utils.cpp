@@ -11,6 +11,10 @@
 #include <cassert>
 #include <cstdint>
 #include <cstdarg>
+#include <thread>
+#ifdef MULTICORE
+#include <omp.h>
+#endif
 #include "common/utils.hpp"
 
 namespace libsnark {
@@ -99,4 +103,13 @@ void deserialize_bit_vector(std::istream &in, bit_vector &v)
         v[i] = b;
     }
 }
+
+size_t get_num_threads()
+{
+#ifdef MULTICORE
+    return omp_get_max_threads();
+#else
+    return std::max<size_t>(1, std::thread::hardware_concurrency());
+#endif
+}
 } // libsnark
@@ -49,6 +49,13 @@ void deserialize_bit_vector(std::istream &in, bit_vector &v);
 template<typename T>
 size_t size_in_bits(const std::vector<T> &v);
 
+/// returns the number of threads to use for parallel loops: omp_get_max_threads() if compiled with MULTICORE, and the number of hardware threads otherwise
+size_t get_num_threads();
+
+/// calls f(begin, end) on at most num_threads consecutive ranges that cover [0, n), each on its own thread, and returns once all calls are done
+template<typename Func>
+void parallel_for(const size_t n, const size_t num_threads, Func f);
+
 #define ARRAY_SIZE(arr) (sizeof(arr)/sizeof(arr[0]))
 
 } // libsnark
@@ -10,6 +10,9 @@
 #ifndef UTILS_TCC_
 #define UTILS_TCC_
 
+#include <algorithm>
+#include <thread>
+
 namespace libsnark {
 
 template<typename T>
@@ -18,6 +21,24 @@ size_t size_in_bits(const std::vector<T> &v)
     return v.size() * T::size_in_bits();
 }
 
+template<typename Func>
+void parallel_for(const size_t n, const size_t num_threads, Func f)
+{
+    const size_t threads = std::max<size_t>(1, std::min(num_threads, n));
+    const size_t chunk = (n + threads - 1) / threads;
+
+    std::vector<std::thread> pool;
+    for (size_t begin = chunk; begin < n; begin += chunk)
+    {
+        pool.emplace_back(f, begin, std::min(begin + chunk, n));
+    }
+    f(0, std::min(chunk, n));
+    for (auto &t : pool)
+    {
+        t.join();
+    }
+}
+
 } // libsnark
 
 #endif // UTILS_TCC_
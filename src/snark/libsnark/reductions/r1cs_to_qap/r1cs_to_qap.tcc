@@ -300,6 +300,7 @@ qap_witness<FieldT> r1cs_to_qap_witness_map(const r1cs_constraint_system<FieldT>
     {
         H_tmp[i] = (H_tmp[i]-aC[i]);
     }
+    std::vector<FieldT>().swap(aC); // destroy aC
 
     enter_block("Divide by Z on set T");
     domain->divide_by_Z_on_coset(H_tmp);
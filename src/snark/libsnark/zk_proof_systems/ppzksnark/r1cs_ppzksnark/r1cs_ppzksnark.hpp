@@ -241,6 +241,12 @@ public:
     G1_precomp<ppT> vk_gamma_beta_g1_precomp;
     G2_precomp<ppT> vk_gamma_beta_g2_precomp;
 
+    /* for the batched pairing check */
+    G1<ppT> vk_alphaB_g1;
+    G1<ppT> vk_gamma_beta_g1;
+    /* lines of G2::one(), alphaA_g2, alphaC_g2, rC_Z_g2, gamma_g2 and gamma_beta_g2, in that order */
+    G2_precomp_table<ppT> vk_G2_precomp_table;
+
     accumulation_vector<G1<ppT> > encoded_IC_query;
 
     bool operator==(const r1cs_ppzksnark_processed_verification_key &other) const;
@@ -453,6 +459,16 @@ bool r1cs_ppzksnark_online_verifier_weak_IC(const r1cs_ppzksnark_processed_verif
                                             const r1cs_ppzksnark_primary_input<ppT> &input,
                                             const r1cs_ppzksnark_proof<ppT> &proof);
 
+/**
+ * Same as r1cs_ppzksnark_online_verifier_weak_IC, but checks each of the
+ * proof's pairing equations on its own instead of batching them into a
+ * single multi-Miller loop.
+ */
+template<typename ppT>
+bool r1cs_ppzksnark_online_verifier_weak_IC_unbatched(const r1cs_ppzksnark_processed_verification_key<ppT> &pvk,
+                                                      const r1cs_ppzksnark_primary_input<ppT> &input,
+                                                      const r1cs_ppzksnark_proof<ppT> &proof);
+
 /**
  * A verifier algorithm for the R1CS ppzkSNARK that:
  * (1) accepts a processed verification key, and
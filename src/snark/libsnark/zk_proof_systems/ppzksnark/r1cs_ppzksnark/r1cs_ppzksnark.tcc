@@ -124,6 +124,9 @@ bool r1cs_ppzksnark_processed_verification_key<ppT>::operator==(const r1cs_ppzks
             this->vk_gamma_g2_precomp == other.vk_gamma_g2_precomp &&
             this->vk_gamma_beta_g1_precomp == other.vk_gamma_beta_g1_precomp &&
             this->vk_gamma_beta_g2_precomp == other.vk_gamma_beta_g2_precomp &&
+            this->vk_alphaB_g1 == other.vk_alphaB_g1 &&
+            this->vk_gamma_beta_g1 == other.vk_gamma_beta_g1 &&
+            this->vk_G2_precomp_table == other.vk_G2_precomp_table &&
             this->encoded_IC_query == other.encoded_IC_query);
 }
 
@@ -138,6 +141,9 @@ std::ostream& operator<<(std::ostream &out, const r1cs_ppzksnark_processed_verif
     out << pvk.vk_gamma_g2_precomp << OUTPUT_NEWLINE;
     out << pvk.vk_gamma_beta_g1_precomp << OUTPUT_NEWLINE;
     out << pvk.vk_gamma_beta_g2_precomp << OUTPUT_NEWLINE;
+    out << pvk.vk_alphaB_g1 << OUTPUT_NEWLINE;
+    out << pvk.vk_gamma_beta_g1 << OUTPUT_NEWLINE;
+    out << pvk.vk_G2_precomp_table << OUTPUT_NEWLINE;
     out << pvk.encoded_IC_query << OUTPUT_NEWLINE;
 
     return out;
@@ -162,6 +168,12 @@ std::istream& operator>>(std::istream &in, r1cs_ppzksnark_processed_verification
     consume_OUTPUT_NEWLINE(in);
     in >> pvk.vk_gamma_beta_g2_precomp;
     consume_OUTPUT_NEWLINE(in);
+    in >> pvk.vk_alphaB_g1;
+    consume_OUTPUT_NEWLINE(in);
+    in >> pvk.vk_gamma_beta_g1;
+    consume_OUTPUT_NEWLINE(in);
+    in >> pvk.vk_G2_precomp_table;
+    consume_OUTPUT_NEWLINE(in);
     in >> pvk.encoded_IC_query;
     consume_OUTPUT_NEWLINE(in);
 
@@ -668,6 +680,10 @@ r1cs_ppzksnark_processed_verification_key<ppT> r1cs_ppzksnark_verifier_process_v
     pvk.vk_gamma_g2_precomp      = ppT::precompute_G2(vk.gamma_g2);
     pvk.vk_gamma_beta_g1_precomp = ppT::precompute_G1(vk.gamma_beta_g1);
     pvk.vk_gamma_beta_g2_precomp = ppT::precompute_G2(vk.gamma_beta_g2);
+    pvk.vk_alphaB_g1             = vk.alphaB_g1;
+    pvk.vk_gamma_beta_g1         = vk.gamma_beta_g1;
+    pvk.vk_G2_precomp_table      = ppT::precompute_G2_table({ G2<ppT>::one(), vk.alphaA_g2, vk.alphaC_g2,
+                                                              vk.rC_Z_g2, vk.gamma_g2, vk.gamma_beta_g2 });
 
     pvk.encoded_IC_query = vk.encoded_IC_query;
 
@@ -677,20 +693,10 @@ r1cs_ppzksnark_processed_verification_key<ppT> r1cs_ppzksnark_verifier_process_v
 }
 
 template <typename ppT>
-bool r1cs_ppzksnark_online_verifier_weak_IC(const r1cs_ppzksnark_processed_verification_key<ppT> &pvk,
-                                            const r1cs_ppzksnark_primary_input<ppT> &primary_input,
-                                            const r1cs_ppzksnark_proof<ppT> &proof)
+bool r1cs_ppzksnark_check_pairings_unbatched(const r1cs_ppzksnark_processed_verification_key<ppT> &pvk,
+                                             const G1<ppT> &acc,
+                                             const r1cs_ppzksnark_proof<ppT> &proof)
 {
-    assert(pvk.encoded_IC_query.domain_size() >= primary_input.size());
-
-    const accumulation_vector<G1<ppT> > accumulated_IC = pvk.encoded_IC_query.template accumulate_chunk<Fr<ppT> >(primary_input.begin(), primary_input.end(), 0);
-    const G1<ppT> &acc = accumulated_IC.first;
-
-    if (!proof.is_well_formed())
-    {
-        return false;
-    }
-
     G1_precomp<ppT> proof_g_A_g_precomp      = ppT::precompute_G1(proof.g_A.g);
     G1_precomp<ppT> proof_g_A_h_precomp = ppT::precompute_G1(proof.g_A.h);
     Fqk<ppT> kc_A_1 = ppT::miller_loop(proof_g_A_g_precomp,      pvk.vk_alphaA_g2_precomp);
@@ -746,6 +752,119 @@ bool r1cs_ppzksnark_online_verifier_weak_IC(const r1cs_ppzksnark_processed_verif
     return true;
 }
 
+template <typename ppT>
+bool r1cs_ppzksnark_check_pairings_batched(const r1cs_ppzksnark_processed_verification_key<ppT> &pvk,
+                                           const G1<ppT> &acc,
+                                           const r1cs_ppzksnark_proof<ppT> &proof)
+{
+    /*
+      Each of the five checks is of the form \Prod_i e(P_i, Q_i) = 1. Raising
+      all but the first to independent random 128-bit powers and multiplying
+      them together gives a single check that fails with probability 2^-128
+      if any of the original ones does. Since e(r*P, Q) = e(P, Q)^r, the
+      powers go on the G1 points, and the terms that share a G2 point merge:
+
+        e(r1*A_g, alphaA) * e(r3*C_g, alphaC) * e(-r4*H, rC_Z) * e(r5*K, gamma)
+        * e(-r5*(A_g+acc+C_g), gamma_beta_g2)
+        * e(-(A_h + r2*B_h + r3*C_h + r4*C_g), one)
+        * e(r2*alphaB_g1 + r4*(A_g+acc) - r5*gamma_beta_g1, B_g) = 1
+
+      with r1 = 1. The six fixed G2 points come from pvk.vk_G2_precomp_table.
+    */
+    const mp_size_t r_limbs = (128 + GMP_NUMB_BITS - 1) / GMP_NUMB_BITS;
+    bigint<r_limbs> r2, r3, r4, r5;
+    r2.randomize();
+    r3.randomize();
+    r4.randomize();
+    r5.randomize();
+
+    const G1<ppT> A_g_acc = proof.g_A.g + acc;
+
+    std::vector<G1<ppT> > Ps = {
+        -(proof.g_A.h + r2 * proof.g_B.h + r3 * proof.g_C.h + r4 * proof.g_C.g),
+        proof.g_A.g,
+        r3 * proof.g_C.g,
+        -(r4 * proof.g_H),
+        r5 * proof.g_K,
+        -(r5 * (A_g_acc + proof.g_C.g)),
+        r2 * pvk.vk_alphaB_g1 + r4 * A_g_acc - r5 * pvk.vk_gamma_beta_g1
+    };
+
+    for (const G1<ppT> &P : Ps)
+    {
+        if (P.is_zero())
+        {
+            /* a zero point has no affine form to evaluate the lines at */
+            return r1cs_ppzksnark_check_pairings_unbatched<ppT>(pvk, acc, proof);
+        }
+    }
+
+    std::vector<G1_precomp<ppT> > prec_Ps;
+    prec_Ps.reserve(Ps.size() - 1);
+    for (size_t i = 0; i + 1 < Ps.size(); ++i)
+    {
+        prec_Ps.emplace_back(ppT::precompute_G1(Ps[i]));
+    }
+    const Fqk<ppT> f = ppT::multi_miller_loop(prec_Ps, pvk.vk_G2_precomp_table,
+                                              { ppT::precompute_G1(Ps.back()) }, { proof.g_B.g });
+
+    return ppT::final_exponentiation(f) == GT<ppT>::one();
+}
+
+template <typename ppT>
+bool r1cs_ppzksnark_online_verifier_weak_IC(const r1cs_ppzksnark_processed_verification_key<ppT> &pvk,
+                                            const r1cs_ppzksnark_primary_input<ppT> &primary_input,
+                                            const r1cs_ppzksnark_proof<ppT> &proof)
+{
+    assert(pvk.encoded_IC_query.domain_size() >= primary_input.size());
+
+    const accumulation_vector<G1<ppT> > accumulated_IC = pvk.encoded_IC_query.template accumulate_chunk<Fr<ppT> >(primary_input.begin(), primary_input.end(), 0);
+    const G1<ppT> &acc = accumulated_IC.first;
+
+    if (!proof.is_well_formed())
+    {
+        return false;
+    }
+
+    /*
+      Batching relies on bilinearity, which only holds for points in the
+      prime-order subgroups, and the Miller loop has no affine form for the
+      zero point to evaluate. Proofs outside of that take the separate checks,
+      so that every proof gets the same answer either way.
+    */
+    const bool can_batch = (!proof.g_A.g.is_zero() && !proof.g_A.h.is_zero() &&
+                            !proof.g_B.g.is_zero() && !proof.g_B.h.is_zero() &&
+                            !proof.g_C.g.is_zero() && !proof.g_C.h.is_zero() &&
+                            !proof.g_H.is_zero() && !proof.g_K.is_zero() &&
+                            !(proof.g_A.g + acc).is_zero() &&
+                            !(proof.g_A.g + acc + proof.g_C.g).is_zero() &&
+                            (G2<ppT>::order() * proof.g_B.g).is_zero());
+    if (!can_batch)
+    {
+        return r1cs_ppzksnark_check_pairings_unbatched<ppT>(pvk, acc, proof);
+    }
+
+    return r1cs_ppzksnark_check_pairings_batched<ppT>(pvk, acc, proof);
+}
+
+template <typename ppT>
+bool r1cs_ppzksnark_online_verifier_weak_IC_unbatched(const r1cs_ppzksnark_processed_verification_key<ppT> &pvk,
+                                                      const r1cs_ppzksnark_primary_input<ppT> &primary_input,
+                                                      const r1cs_ppzksnark_proof<ppT> &proof)
+{
+    assert(pvk.encoded_IC_query.domain_size() >= primary_input.size());
+
+    const accumulation_vector<G1<ppT> > accumulated_IC = pvk.encoded_IC_query.template accumulate_chunk<Fr<ppT> >(primary_input.begin(), primary_input.end(), 0);
+    const G1<ppT> &acc = accumulated_IC.first;
+
+    if (!proof.is_well_formed())
+    {
+        return false;
+    }
+
+    return r1cs_ppzksnark_check_pairings_unbatched<ppT>(pvk, acc, proof);
+}
+
 template<typename ppT>
 bool r1cs_ppzksnark_verifier_weak_IC(const r1cs_ppzksnark_verification_key<ppT> &vk,
                                      const r1cs_ppzksnark_primary_input<ppT> &primary_input,
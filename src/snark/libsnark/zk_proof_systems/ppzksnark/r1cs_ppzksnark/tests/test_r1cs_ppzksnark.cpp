@@ -36,9 +36,51 @@ void test_r1cs_ppzksnark(size_t num_constraints,
     print_header("(leave) Test R1CS ppzkSNARK");
 }
 
+template<typename ppT>
+void test_r1cs_ppzksnark_batched_verifier(size_t num_constraints,
+                                          size_t input_size)
+{
+    r1cs_example<Fr<ppT> > example = generate_r1cs_example_with_binary_input<Fr<ppT> >(num_constraints, input_size);
+    r1cs_ppzksnark_keypair<ppT> keypair = r1cs_ppzksnark_generator<ppT>(example.constraint_system);
+    r1cs_ppzksnark_processed_verification_key<ppT> pvk = r1cs_ppzksnark_verifier_process_vk<ppT>(keypair.vk);
+    r1cs_ppzksnark_proof<ppT> proof = r1cs_ppzksnark_prover<ppT>(keypair.pk, example.primary_input, example.auxiliary_input, example.constraint_system);
+
+    EXPECT_TRUE(r1cs_ppzksnark_online_verifier_weak_IC<ppT>(pvk, example.primary_input, proof));
+    EXPECT_TRUE(r1cs_ppzksnark_online_verifier_weak_IC_unbatched<ppT>(pvk, example.primary_input, proof));
+
+    /* each of these breaks a different pairing check */
+    std::vector<r1cs_ppzksnark_proof<ppT> > bad_proofs(9, proof);
+    bad_proofs[0].g_A.g = bad_proofs[0].g_A.g + G1<ppT>::one();
+    bad_proofs[1].g_A.h = bad_proofs[1].g_A.h + G1<ppT>::one();
+    bad_proofs[2].g_B.g = bad_proofs[2].g_B.g + G2<ppT>::one();
+    bad_proofs[3].g_B.h = bad_proofs[3].g_B.h + G1<ppT>::one();
+    bad_proofs[4].g_C.g = bad_proofs[4].g_C.g + G1<ppT>::one();
+    bad_proofs[5].g_C.h = bad_proofs[5].g_C.h + G1<ppT>::one();
+    bad_proofs[6].g_H = bad_proofs[6].g_H + G1<ppT>::one();
+    bad_proofs[7].g_K = bad_proofs[7].g_K + G1<ppT>::one();
+    bad_proofs[8].g_H = G1<ppT>::zero();
+
+    for (const r1cs_ppzksnark_proof<ppT> &bad_proof : bad_proofs)
+    {
+        EXPECT_FALSE(r1cs_ppzksnark_online_verifier_weak_IC<ppT>(pvk, example.primary_input, bad_proof));
+        EXPECT_FALSE(r1cs_ppzksnark_online_verifier_weak_IC_unbatched<ppT>(pvk, example.primary_input, bad_proof));
+    }
+
+    r1cs_ppzksnark_primary_input<ppT> bad_input = example.primary_input;
+    bad_input[0] = bad_input[0] + Fr<ppT>::one();
+    EXPECT_FALSE(r1cs_ppzksnark_online_verifier_weak_IC<ppT>(pvk, bad_input, proof));
+    EXPECT_FALSE(r1cs_ppzksnark_online_verifier_weak_IC_unbatched<ppT>(pvk, bad_input, proof));
+}
+
 TEST(zk_proof_systems, r1cs_ppzksnark)
 {
     start_profiling();
 
     test_r1cs_ppzksnark<alt_bn128_pp>(1000, 20);
 }
+
+TEST(zk_proof_systems, r1cs_ppzksnark_batched_verifier)
+{
+    alt_bn128_pp::init_public_params();
+    test_r1cs_ppzksnark_batched_verifier<alt_bn128_pp>(100, 10);
+}
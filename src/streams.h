@@ -170,6 +170,7 @@ public:
     iterator end()                                   { return vch.end(); }
     size_type size() const                           { return vch.size() - nReadPos; }
     bool empty() const                               { return vch.size() == nReadPos; }
+    const value_type* data() const                   { return vch.data() + nReadPos; }
     void resize(size_type n, value_type c=0)         { vch.resize(n + nReadPos, c); }
     void reserve(size_type n)                        { vch.reserve(n + nReadPos); }
     const_reference operator[](size_type pos) const  { return vch[pos + nReadPos]; }
@@ -380,6 +381,55 @@ public:
 
 };
 
+/** Read-only stream over a byte range it does not own.
+ *
+ * Unlike CDataStream nothing is copied on construction, and skip() gives
+ * access to serialized data in place. The range must outlive the reader.
+ */
+class CSpanReader
+{
+private:
+    const int nType;
+    const int nVersion;
+    const unsigned char* pos;
+    const unsigned char* const pend;
+
+public:
+    CSpanReader(int nTypeIn, int nVersionIn, const unsigned char* pbegin, const unsigned char* pendIn) :
+        nType(nTypeIn), nVersion(nVersionIn), pos(pbegin), pend(pendIn) { }
+
+    template<typename T>
+    CSpanReader& operator>>(T& obj)
+    {
+        // Unserialize from this stream
+        ::Unserialize(*this, obj);
+        return (*this);
+    }
+
+    int GetType() const { return nType; }
+    int GetVersion() const { return nVersion; }
+
+    size_t size() const { return pend - pos; }
+    bool empty() const { return pos == pend; }
+    const unsigned char* data() const { return pos; }
+
+    void read(char* pch, size_t nSize)
+    {
+        memcpy(pch, skip(nSize), nSize);
+    }
+
+    /** Advance past nSize bytes and return where they start. */
+    const unsigned char* skip(size_t nSize)
+    {
+        if (nSize > size()) {
+            throw std::ios_base::failure("CSpanReader::read(): end of data");
+        }
+        const unsigned char* ret = pos;
+        pos += nSize;
+        return ret;
+    }
+};
+
 
 
 
@@ -110,6 +110,29 @@ BOOST_AUTO_TEST_CASE(DoS_bantime)
     BOOST_CHECK(!CNode::IsBanned(addr));
 }
 
+BOOST_AUTO_TEST_CASE(DoS_misbehaving_node)
+{
+    CNode::ClearBanned();
+    CAddress addr1(ip(0xa0b0c001));
+    CNode dummyNode1(INVALID_SOCKET, addr1, "", true);
+    dummyNode1.nVersion = 1;
+    BOOST_CHECK(dummyNode1.pNodeState != NULL);
+
+    // The score kept with the node is the one looked up by id
+    Misbehaving(&dummyNode1, 60);
+    Misbehaving(dummyNode1.GetId(), 30);
+    CNodeStateStats stats;
+    BOOST_CHECK(GetNodeStateStats(dummyNode1.GetId(), stats));
+    BOOST_CHECK_EQUAL(stats.nMisbehavior, 90);
+    SendMessages(&dummyNode1, false);
+    BOOST_CHECK(!CNode::IsBanned(addr1));
+
+    Misbehaving(&dummyNode1, 10);
+    SendMessages(&dummyNode1, false);
+    BOOST_CHECK(CNode::IsBanned(addr1));
+    BOOST_CHECK(dummyNode1.fDisconnect);
+}
+
 CTransaction RandomOrphan()
 {
     std::map<uint256, COrphanTx>::iterator it;
@@ -10,6 +10,7 @@
 
 #include "key.h"
 #include "key_io.h"
+#include "random.h"
 #include "script/script.h"
 #include "test/test_bitcoin.h"
 #include "uint256.h"
@@ -75,6 +76,53 @@ BOOST_AUTO_TEST_CASE(base58_DecodeBase58)
     BOOST_CHECK_EQUAL_COLLECTIONS(result.begin(), result.end(), expected.begin(), expected.end());
 }
 
+// Round trip payloads of every length the limb arithmetic distinguishes,
+// with and without leading zero bytes
+BOOST_AUTO_TEST_CASE(base58_roundtrip)
+{
+    seed_insecure_rand(true);
+    for (size_t len = 0; len < 200; len++) {
+        for (size_t nZeros = 0; nZeros <= std::min<size_t>(len, 3); nZeros++) {
+            std::vector<unsigned char> data(len);
+            for (size_t i = nZeros; i < len; i++) {
+                data[i] = insecure_rand();
+            }
+            std::string str = EncodeBase58(data);
+            // Each leading zero byte becomes a leading '1'
+            size_t nLeading = std::find_if(data.begin(), data.end(), [](unsigned char c) { return c != 0; }) - data.begin();
+            BOOST_CHECK_EQUAL(std::min(str.find_first_not_of('1'), str.size()), nLeading);
+            std::vector<unsigned char> result;
+            BOOST_CHECK(DecodeBase58(str, result));
+            BOOST_CHECK(result == data);
+
+            std::string strCheck = EncodeBase58Check(data);
+            BOOST_CHECK_EQUAL(strCheck, EncodeBase58Check(data.data(), data.data() + data.size()));
+            BOOST_CHECK(DecodeBase58Check(strCheck, result));
+            BOOST_CHECK(result == data);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(base58_EncodeDestinations)
+{
+    std::vector<CTxDestination> dests;
+    for (int i = 0; i < 10; i++) {
+        uint160 hash;
+        GetRandBytes(hash.begin(), hash.size());
+        dests.push_back(CKeyID(hash));
+        dests.push_back(CScriptID(hash));
+        dests.push_back(CNoDestination());
+    }
+    // Repeated destinations share one encoding but still get an entry each
+    dests.push_back(dests[0]);
+
+    std::vector<std::string> encoded = EncodeDestinations(dests);
+    BOOST_CHECK_EQUAL(encoded.size(), dests.size());
+    for (size_t i = 0; i < dests.size(); i++) {
+        BOOST_CHECK_EQUAL(encoded[i], EncodeDestination(dests[i]));
+    }
+}
+
 // Goal: check that parsed keys match test payload
 BOOST_AUTO_TEST_CASE(base58_keys_valid_parse)
 {
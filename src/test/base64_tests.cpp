@@ -2,6 +2,7 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include "random.h"
 #include "utilstrencodings.h"
 #include "test/test_bitcoin.h"
 
@@ -22,4 +23,53 @@ BOOST_AUTO_TEST_CASE(base64_testvectors)
     }
 }
 
+BOOST_AUTO_TEST_CASE(base64_invalid)
+{
+    static const char* vstrValid[] = {"", "Zg==", "Zm8=", "Zm9v", "Zm9vYg=="};
+    static const char* vstrInvalid[] = {"Z", "Zm9vYg", "Zh==", "Zm9=", "Z===", "Zm9v=", "Zm9vY", "Zm 9v", "Zg==Zg=="};
+    bool fInvalid;
+    for (unsigned int i=0; i<sizeof(vstrValid)/sizeof(vstrValid[0]); i++)
+    {
+        DecodeBase64(vstrValid[i], &fInvalid);
+        BOOST_CHECK_MESSAGE(!fInvalid, vstrValid[i]);
+    }
+    for (unsigned int i=0; i<sizeof(vstrInvalid)/sizeof(vstrInvalid[0]); i++)
+    {
+        DecodeBase64(vstrInvalid[i], &fInvalid);
+        BOOST_CHECK_MESSAGE(fInvalid, vstrInvalid[i]);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(base64_kernels)
+{
+    // Each set of kernels the CPU supports gives the same results as the
+    // scalar code, for every length and wherever a bad character is
+    EncodingISA isaDetected = EncodingISALevel();
+    std::vector<unsigned char> data(200);
+    for (size_t i = 0; i < data.size(); i++)
+        data[i] = insecure_rand();
+
+    for (int isa = ENCODING_ISA_SCALAR; isa <= isaDetected; isa++) {
+        for (size_t n = 0; n <= data.size(); n++) {
+            EncodingISALevel() = ENCODING_ISA_SCALAR;
+            std::string strExpected = EncodeBase64(data.data(), n);
+            std::string strBad = strExpected;
+            if (n > 0)
+                strBad[insecure_rand() % strBad.size()] = (insecure_rand() % 2) ? '-' : '\xb0';
+            bool fExpectedInvalid;
+            std::vector<unsigned char> expected = DecodeBase64(strBad.c_str(), &fExpectedInvalid);
+
+            EncodingISALevel() = (EncodingISA)isa;
+            std::string str = EncodeBase64(data.data(), n);
+            BOOST_CHECK_EQUAL(str, strExpected);
+            bool fInvalid;
+            BOOST_CHECK(DecodeBase64(str.c_str(), &fInvalid) == std::vector<unsigned char>(data.begin(), data.begin() + n));
+            BOOST_CHECK(!fInvalid);
+            BOOST_CHECK(DecodeBase64(strBad.c_str(), &fInvalid) == expected);
+            BOOST_CHECK_EQUAL(fInvalid, fExpectedInvalid);
+        }
+    }
+    EncodingISALevel() = isaDetected;
+}
+
 BOOST_AUTO_TEST_SUITE_END()
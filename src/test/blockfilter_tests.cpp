@@ -0,0 +1,113 @@
+// Copyright (c) 2018 The Zcash developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "blockfilter.h"
+
+#include "primitives/block.h"
+#include "script/script.h"
+#include "test/test_bitcoin.h"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(blockfilter_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(gcsfilter_test)
+{
+    GCSFilter::ElementSet included_elements, excluded_elements;
+    for (int i = 0; i < 100; ++i) {
+        GCSFilter::Element element1(32);
+        element1[0] = i;
+        included_elements.insert(std::move(element1));
+
+        GCSFilter::Element element2(32);
+        element2[1] = i;
+        excluded_elements.insert(std::move(element2));
+    }
+
+    GCSFilter filter(0, 0, included_elements);
+    BOOST_CHECK_EQUAL(filter.GetN(), 100);
+    for (const GCSFilter::Element& element : included_elements) {
+        BOOST_CHECK(filter.Match(element));
+
+        GCSFilter::ElementSet query = excluded_elements;
+        query.insert(element);
+        BOOST_CHECK(filter.MatchAny(query));
+    }
+
+    // Decoding the filter gives back the same set
+    GCSFilter decoded(0, 0, filter.GetEncoded());
+    BOOST_CHECK_EQUAL(decoded.GetN(), 100);
+    for (const GCSFilter::Element& element : included_elements)
+        BOOST_CHECK(decoded.Match(element));
+
+    GCSFilter empty;
+    BOOST_CHECK_EQUAL(empty.GetN(), 0);
+    BOOST_CHECK(!empty.Match(*included_elements.begin()));
+    BOOST_CHECK(!empty.MatchAny(included_elements));
+}
+
+BOOST_AUTO_TEST_CASE(gcsfilter_truncated)
+{
+    GCSFilter::ElementSet elements;
+    for (int i = 0; i < 10; ++i)
+        elements.insert(GCSFilter::Element(1, i));
+    std::vector<unsigned char> vchEncoded = GCSFilter(0, 0, elements).GetEncoded();
+    vchEncoded.resize(2);
+
+    GCSFilter filter(0, 0, vchEncoded);
+    GCSFilter::ElementSet query;
+    query.insert(GCSFilter::Element(1, 100));
+    BOOST_CHECK_THROW(filter.MatchAny(query), std::ios_base::failure);
+
+    BOOST_CHECK_THROW(GCSFilter(0, 0, std::vector<unsigned char>()), std::ios_base::failure);
+}
+
+BOOST_AUTO_TEST_CASE(blockfilter_basic_test)
+{
+    CScript included_scripts[3], excluded_scripts[2];
+    included_scripts[0] << std::vector<unsigned char>(33, 1) << OP_CHECKSIG;
+    included_scripts[1] << OP_DUP << OP_HASH160 << std::vector<unsigned char>(20, 2) << OP_EQUALVERIFY << OP_CHECKSIG;
+    included_scripts[2] << OP_HASH160 << std::vector<unsigned char>(20, 3) << OP_EQUAL;
+    excluded_scripts[0] << OP_RETURN << std::vector<unsigned char>(4, 4);
+    excluded_scripts[1] << OP_DUP << OP_HASH160 << std::vector<unsigned char>(20, 5) << OP_EQUALVERIFY << OP_CHECKSIG;
+
+    CMutableTransaction coinbase;
+    coinbase.vin.resize(1);
+    coinbase.vin[0].prevout.SetNull();
+    coinbase.vout.resize(1);
+    coinbase.vout[0].nValue = 100;
+    coinbase.vout[0].scriptPubKey = included_scripts[0];
+
+    CMutableTransaction tx;
+    tx.vin.resize(1);
+    tx.vin[0].prevout = COutPoint(uint256S("0x01"), 1);
+    tx.vout.resize(4);
+    tx.vout[0].scriptPubKey = included_scripts[1];
+    tx.vout[1].scriptPubKey = included_scripts[2];
+    tx.vout[2].scriptPubKey = excluded_scripts[0];
+
+    CBlock block;
+    block.vtx.push_back(coinbase);
+    block.vtx.push_back(tx);
+
+    BlockFilter block_filter(block);
+    BOOST_CHECK(block_filter.GetBlockHash() == block.GetHash());
+    const GCSFilter& filter = block_filter.GetFilter();
+
+    for (const CScript& script : included_scripts)
+        BOOST_CHECK(filter.Match(BlockFilter::ScriptElement(script)));
+    BOOST_CHECK(filter.Match(BlockFilter::OutPointElement(tx.vin[0].prevout)));
+    // The coinbase input, the OP_RETURN and the empty output are left out
+    BOOST_CHECK_EQUAL(filter.GetN(), 4);
+    BOOST_CHECK(!filter.Match(BlockFilter::ScriptElement(excluded_scripts[1])));
+    BOOST_CHECK(!filter.Match(BlockFilter::OutPointElement(COutPoint(tx.GetHash(), 0))));
+
+    // Reconstructing the filter from its encoding
+    BlockFilter block_filter2(block_filter.GetBlockHash(), block_filter.GetEncoded());
+    BOOST_CHECK(block_filter2.GetEncoded() == block_filter.GetEncoded());
+    for (const CScript& script : included_scripts)
+        BOOST_CHECK(block_filter2.GetFilter().Match(BlockFilter::ScriptElement(script)));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,102 @@
+// Copyright (c) 2018 The Zcash developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "checkqueue.h"
+
+#include "test/test_bitcoin.h"
+
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(checkqueue_tests, BasicTestingSetup)
+
+/** Counts how often it is run, and fails if it was built as a failing check. */
+struct CountingCheck {
+    std::atomic<unsigned int>* pnRun;
+    bool fOk;
+
+    CountingCheck() : pnRun(NULL), fOk(true) {}
+    CountingCheck(std::atomic<unsigned int>* pnRunIn, bool fOkIn) : pnRun(pnRunIn), fOk(fOkIn) {}
+
+    bool operator()()
+    {
+        (*pnRun)++;
+        return fOk;
+    }
+
+    void swap(CountingCheck& check)
+    {
+        std::swap(pnRun, check.pnRun);
+        std::swap(fOk, check.fOk);
+    }
+};
+
+static void RunQueue(int nThreads, const std::vector<size_t>& vBatches, size_t nFailAt, unsigned int nBatchSize)
+{
+    CCheckQueue<CountingCheck> queue(nBatchSize);
+    boost::thread_group threadGroup;
+    for (int i = 0; i < nThreads - 1; i++)
+        threadGroup.create_thread(boost::bind(&CCheckQueue<CountingCheck>::Thread, boost::ref(queue)));
+
+    // Run several rounds on the same queue to check that the state is reset in between.
+    for (int nRound = 0; nRound < 3; nRound++) {
+        std::atomic<unsigned int> nRun(0);
+        size_t nTotal = 0;
+        {
+            CCheckQueueControl<CountingCheck> control(&queue);
+            BOOST_FOREACH(size_t nBatch, vBatches) {
+                std::vector<CountingCheck> vChecks;
+                for (size_t i = 0; i < nBatch; i++, nTotal++)
+                    vChecks.push_back(CountingCheck(&nRun, nTotal != nFailAt));
+                control.Add(vChecks);
+            }
+            bool fOk = control.Wait();
+            BOOST_CHECK_EQUAL(fOk, nFailAt >= nTotal);
+        }
+        if (nFailAt >= nTotal) {
+            // Every check must have run exactly once.
+            BOOST_CHECK_EQUAL(nRun.load(), nTotal);
+        } else {
+            BOOST_CHECK(nRun.load() <= nTotal);
+        }
+        BOOST_CHECK(queue.IsIdle());
+    }
+
+    threadGroup.interrupt_all();
+    threadGroup.join_all();
+}
+
+BOOST_AUTO_TEST_CASE(checkqueue_all_ok)
+{
+    std::vector<size_t> vBatches;
+    for (size_t i = 0; i < 200; i++)
+        vBatches.push_back(i % 7);
+    for (int nThreads = 1; nThreads <= 16; nThreads *= 2) {
+        RunQueue(nThreads, vBatches, std::numeric_limits<size_t>::max(), 1);
+        RunQueue(nThreads, vBatches, std::numeric_limits<size_t>::max(), 128);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(checkqueue_failure)
+{
+    std::vector<size_t> vBatches(1, 1000);
+    vBatches.push_back(1);
+    vBatches.push_back(500);
+    for (int nThreads = 1; nThreads <= 16; nThreads *= 2) {
+        RunQueue(nThreads, vBatches, 0, 16);
+        RunQueue(nThreads, vBatches, 1000, 16);
+        RunQueue(nThreads, vBatches, 1500, 16);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(checkqueue_empty)
+{
+    std::vector<size_t> vBatches;
+    RunQueue(4, vBatches, std::numeric_limits<size_t>::max(), 128);
+    vBatches.push_back(0);
+    RunQueue(4, vBatches, std::numeric_limits<size_t>::max(), 128);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,180 @@
+// Copyright (c) 2012-2016 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "cuckoocache.h"
+#include "random.h"
+#include "test/test_bitcoin.h"
+#include "uint256.h"
+
+#include <boost/test/unit_test.hpp>
+
+#include <cstring>
+#include <vector>
+
+/** Test Suite for CuckooCache
+ *
+ *  1) All tests should have a deterministic result (using insecure rand
+ *  with deterministic seeds)
+ *  2) Some test methods are templated to allow for easier testing
+ *  against new versions / comparing
+ *  3) Results should be treated as a regression test, i.e., did the behavior
+ *  change significantly from what was expected. This can be OK, depending on
+ *  the nature of the change, but requires updating the tests to reflect the new
+ *  expected behavior. For example improving the hit rate may cause some tests
+ *  using BOOST_CHECK_CLOSE to fail.
+ *
+ */
+
+namespace {
+
+/** uint256Hasher uses successive 4-byte slices of the key as its hashes, in
+ * the same way as the signature cache, whose keys are already salted hashes.
+ */
+class uint256Hasher
+{
+public:
+    template <uint8_t hash_select>
+    uint32_t operator()(const uint256& key) const
+    {
+        static_assert(hash_select < 8, "uint256Hasher only has 8 hashes available.");
+        uint32_t u;
+        std::memcpy(&u, key.begin() + 4 * hash_select, 4);
+        return u;
+    }
+};
+
+typedef CuckooCache::cache<uint256, uint256Hasher> cache_type;
+
+uint256 InsecureRand256()
+{
+    uint256 r;
+    for (unsigned int i = 0; i < 8; i++) {
+        uint32_t u = insecure_rand();
+        std::memcpy(r.begin() + 4 * i, &u, 4);
+    }
+    return r;
+}
+
+std::vector<uint256> GenerateHashes(size_t n)
+{
+    std::vector<uint256> hashes;
+    hashes.reserve(n);
+    for (size_t i = 0; i < n; i++)
+        hashes.push_back(InsecureRand256());
+    return hashes;
+}
+
+/** Inserts hashes equal to load times the size of a cache of megabytes MiB
+ * and returns the fraction of them still found afterwards.
+ */
+double HitRate(double load, size_t megabytes)
+{
+    cache_type set;
+    size_t bytes = megabytes * (1 << 20);
+    uint32_t n = set.setup_bytes(bytes);
+    std::vector<uint256> hashes = GenerateHashes(load * n);
+    for (size_t i = 0; i < hashes.size(); i++)
+        set.insert(hashes[i]);
+    size_t count = 0;
+    for (size_t i = 0; i < hashes.size(); i++)
+        count += set.contains(hashes[i], false);
+    return double(count) / double(hashes.size());
+}
+
+}
+
+BOOST_FIXTURE_TEST_SUITE(cuckoocache_tests, BasicTestingSetup)
+
+/* Test that no values not inserted into the cache are read out of it.
+ *
+ * There are no repeats in the first 200000 insecure_rand calls
+ */
+BOOST_AUTO_TEST_CASE(test_cuckoocache_no_fakes)
+{
+    seed_insecure_rand(true);
+    cache_type cc;
+    size_t megabytes = 4;
+    cc.setup_bytes(megabytes << 20);
+    for (int x = 0; x < 100000; ++x)
+        cc.insert(InsecureRand256());
+    for (int x = 0; x < 100000; ++x)
+        BOOST_CHECK(!cc.contains(InsecureRand256(), false));
+}
+
+/* Below the epoch size nothing is evicted, and the cache stays almost full
+ * when loaded past its capacity.
+ */
+BOOST_AUTO_TEST_CASE(cuckoocache_hit_rate_ok)
+{
+    seed_insecure_rand(true);
+    BOOST_CHECK(HitRate(0.40, 4) > 0.99);
+    BOOST_CHECK(HitRate(0.90, 4) > 0.90);
+    BOOST_CHECK(HitRate(2.00, 4) > 0.40);
+}
+
+/* Entries looked up with erase set are the first to be replaced, so the
+ * entries that were not erased survive a refill of the cache.
+ */
+BOOST_AUTO_TEST_CASE(cuckoocache_erase_ok)
+{
+    seed_insecure_rand(true);
+    cache_type set;
+    uint32_t n = set.setup_bytes(1 << 20);
+    std::vector<uint256> hashes = GenerateHashes(n);
+    std::vector<uint256> hashes_insert_copy = hashes;
+    size_t half = n / 2;
+
+    // Fill the first half and erase all of it
+    for (size_t i = 0; i < half; i++)
+        set.insert(hashes_insert_copy[i]);
+    for (size_t i = 0; i < half; i++)
+        BOOST_CHECK(set.contains(hashes[i], true));
+    // Erased entries are still found until they are overwritten
+    for (size_t i = 0; i < half; i++)
+        BOOST_CHECK(set.contains(hashes[i], false));
+
+    // Fill the second half; nothing from it should be lost
+    for (size_t i = half; i < hashes.size(); i++)
+        set.insert(hashes_insert_copy[i]);
+
+    size_t count_erased_but_contained = 0;
+    size_t count_stale = 0;
+    for (size_t i = 0; i < half; i++)
+        count_erased_but_contained += set.contains(hashes[i], false);
+    for (size_t i = half; i < hashes.size(); i++)
+        count_stale += set.contains(hashes[i], false);
+
+    BOOST_CHECK(double(count_stale) / double(hashes.size() - half) > 0.99);
+    BOOST_CHECK(count_erased_but_contained < half);
+}
+
+/* Re-inserting an entry that is already present keeps it from being evicted
+ * when the cache ages out older generations.
+ */
+BOOST_AUTO_TEST_CASE(cuckoocache_generations)
+{
+    seed_insecure_rand(true);
+    cache_type set;
+    uint32_t n = set.setup_bytes(1 << 20);
+    std::vector<uint256> hashes = GenerateHashes(n / 8);
+    for (size_t i = 0; i < hashes.size(); i++)
+        set.insert(hashes[i]);
+
+    // Push several epochs worth of new entries through the cache, refreshing
+    // the original entries as we go.
+    for (int round = 0; round < 8; round++) {
+        std::vector<uint256> fresh = GenerateHashes(n / 2);
+        for (size_t i = 0; i < fresh.size(); i++)
+            set.insert(fresh[i]);
+        for (size_t i = 0; i < hashes.size(); i++)
+            set.insert(hashes[i]);
+    }
+
+    size_t count = 0;
+    for (size_t i = 0; i < hashes.size(); i++)
+        count += set.contains(hashes[i], false);
+    BOOST_CHECK(double(count) / double(hashes.size()) > 0.99);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -186,6 +186,53 @@ BOOST_AUTO_TEST_CASE(key_test1)
     BOOST_CHECK(detsigc == ParseHex("2052d8a32079c11e79db95af63bb9600c5b04f21a9ca33dc129c2bfa8ac9dc1cd561d8ae5e0f6c1a16bde3719c64c2fd70e404b6428ab9a69566962e8771b5944d"));
 }
 
+BOOST_AUTO_TEST_CASE(signature_batch)
+{
+    std::vector<CKey> keys(20);
+    std::vector<uint256> hashes;
+    std::vector<std::vector<unsigned char> > sigs(keys.size());
+    for (size_t i = 0; i < keys.size(); i++) {
+        keys[i].MakeNewKey(i % 2 == 0);
+        hashes.push_back(Hash(&i, &i + 1));
+        BOOST_CHECK(keys[i].Sign(hashes[i], sigs[i]));
+    }
+
+    CSignatureBatch batch;
+    BOOST_CHECK(batch.Verify());
+    for (size_t i = 0; i < keys.size(); i++)
+        batch.Add(hashes[i], sigs[i], keys[i].GetPubKey());
+    BOOST_CHECK_EQUAL(batch.size(), keys.size());
+    BOOST_CHECK(batch.Verify());
+
+    // Each kind of failure that CPubKey::Verify reports fails the batch
+    batch.Add(hashes[1], sigs[0], keys[0].GetPubKey());
+    BOOST_CHECK(!keys[0].GetPubKey().Verify(hashes[1], sigs[0]));
+    BOOST_CHECK(!batch.Verify());
+    batch.resize(keys.size());
+    BOOST_CHECK(batch.Verify());
+
+    batch.Add(hashes[0], sigs[0], keys[1].GetPubKey());
+    BOOST_CHECK(!batch.Verify());
+    batch.resize(keys.size());
+
+    std::vector<unsigned char> badSig = sigs[0];
+    badSig[0] ^= 1;
+    BOOST_CHECK(!keys[0].GetPubKey().Verify(hashes[0], badSig));
+    batch.Add(hashes[0], badSig, keys[0].GetPubKey());
+    BOOST_CHECK(!batch.Verify());
+    batch.resize(keys.size());
+
+    batch.Add(hashes[0], std::vector<unsigned char>(), keys[0].GetPubKey());
+    BOOST_CHECK(!batch.Verify());
+    batch.resize(keys.size());
+
+    batch.Add(hashes[0], sigs[0], CPubKey());
+    BOOST_CHECK(!batch.Verify());
+
+    batch.clear();
+    BOOST_CHECK(batch.Verify());
+}
+
 BOOST_AUTO_TEST_CASE(zc_address_test)
 {
     for (size_t i = 0; i < 1000; i++) {
@@ -324,5 +324,67 @@ BOOST_DATA_TEST_CASE(multisig_Sign, boost::unit_test::data::xrange(static_cast<i
     }
 }
 
+// Parameterized testing over consensus branch ids
+BOOST_DATA_TEST_CASE(multisig_SignParallel, boost::unit_test::data::xrange(static_cast<int>(Consensus::MAX_NETWORK_UPGRADES)))
+{
+    uint32_t consensusBranchId = NetworkUpgradeInfo[sample].nBranchId;
+
+    // ProduceSignatures() must give the same scriptSigs as signing one input at a time
+    CBasicKeyStore keystore;
+    CKey key[3];
+    for (int i = 0; i < 3; i++)
+    {
+        key[i].MakeNewKey(i != 2);
+        keystore.AddKey(key[i]);
+    }
+
+    CScript escrow;
+    escrow << OP_2 << ToByteVector(key[0].GetPubKey()) << ToByteVector(key[1].GetPubKey()) << ToByteVector(key[2].GetPubKey()) << OP_3 << OP_CHECKMULTISIG;
+    keystore.AddCScript(escrow);
+
+    CMutableTransaction txFrom;  // Funding transaction
+    txFrom.vout.resize(4);
+    txFrom.vout[0].scriptPubKey = GetScriptForDestination(key[0].GetPubKey().GetID());
+    txFrom.vout[1].scriptPubKey = CScript() << ToByteVector(key[2].GetPubKey()) << OP_CHECKSIG;
+    txFrom.vout[2].scriptPubKey = escrow;
+    txFrom.vout[3].scriptPubKey = GetScriptForDestination(CScriptID(escrow));
+
+    CMutableTransaction txTo;    // Spending transaction with many inputs
+    if (sample >= Consensus::UPGRADE_OVERWINTER) {
+        txTo.fOverwintered = true;
+        txTo.nVersionGroupId = OVERWINTER_VERSION_GROUP_ID;
+        txTo.nVersion = OVERWINTER_TX_VERSION;
+    }
+    txTo.vin.resize(50);
+    txTo.vout.resize(1);
+    txTo.vout[0].nValue = 1;
+    std::vector<SignatureJob> vJobs;
+    for (unsigned int i = 0; i < txTo.vin.size(); i++)
+    {
+        txTo.vin[i].prevout.n = i % txFrom.vout.size();
+        txTo.vin[i].prevout.hash = txFrom.GetHash();
+        txFrom.vout[i % txFrom.vout.size()].nValue = i;
+        vJobs.push_back(SignatureJob(i, txFrom.vout[i % txFrom.vout.size()].scriptPubKey, i));
+    }
+
+    BOOST_CHECK(ProduceSignatures(keystore, txTo, vJobs, SIGHASH_ALL, consensusBranchId, 4));
+
+    CMutableTransaction txSerial = txTo;
+    for (unsigned int i = 0; i < txTo.vin.size(); i++)
+    {
+        BOOST_CHECK(SignSignature(keystore, vJobs[i].scriptPubKey, txSerial, i, vJobs[i].amount, SIGHASH_ALL, consensusBranchId));
+        BOOST_CHECK(vJobs[i].fSolved);
+        BOOST_CHECK(vJobs[i].sigdata.scriptSig == txSerial.vin[i].scriptSig);
+    }
+
+    // An input whose key is missing is reported without affecting the others
+    CBasicKeyStore partial;
+    partial.AddKey(key[2]);
+    BOOST_CHECK(!ProduceSignatures(partial, txTo, vJobs, SIGHASH_ALL, consensusBranchId, 4));
+    BOOST_CHECK(!vJobs[0].fSolved);
+    BOOST_CHECK(vJobs[1].fSolved);
+    BOOST_CHECK(vJobs[1].sigdata.scriptSig == txSerial.vin[1].scriptSig);
+}
+
 
 BOOST_AUTO_TEST_SUITE_END()
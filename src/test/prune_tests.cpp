@@ -0,0 +1,153 @@
+// Copyright (c) 2018 The Zcash developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "chainparams.h"
+#include "consensus/validation.h"
+#include "main.h"
+#include "random.h"
+#include "txdb.h"
+
+#include "test/test_bitcoin.h"
+
+#include <map>
+#include <set>
+
+#include <boost/filesystem.hpp>
+#include <boost/test/unit_test.hpp>
+
+extern bool ReceivedBlockTransactions(const CBlock &block, CValidationState& state, CBlockIndex *pindexNew, const CDiskBlockPos& pos);
+extern bool FindBlockPos(CValidationState &state, CDiskBlockPos &pos, unsigned int nAddSize, unsigned int nHeight, uint64_t nTime, bool fKnown);
+extern uint64_t CalculateCurrentUsage();
+
+static const int BLOCKS_PER_FILE = 100;
+static const unsigned int BLOCK_SIZE = 1024 * 1024;
+static const int NUM_BLOCKS = 1300;
+static const int NUM_FILES = NUM_BLOCKS / BLOCKS_PER_FILE;
+
+// Adds a block index entry on top of pprev for a block stored at pos, the
+// way AcceptBlock does, without writing the block.
+static CBlockIndex* AddBlock(CBlockIndex* pprev, const CDiskBlockPos& pos)
+{
+    CBlockIndex* pindex = new CBlockIndex();
+    pindex->pprev = pprev;
+    pindex->nHeight = pprev ? pprev->nHeight + 1 : 0;
+    pindex->nChainWork = pindex->nHeight + 1;
+    pindex->RaiseValidity(BLOCK_VALID_TREE);
+    pindex->phashBlock = &mapBlockIndex.insert(std::make_pair(GetRandHash(), pindex)).first->first;
+
+    CValidationState state;
+    CDiskBlockPos posBlock = pos;
+    BOOST_REQUIRE(FindBlockPos(state, posBlock, BLOCK_SIZE, pindex->nHeight, 0, true));
+    CBlock block;
+    block.vtx.push_back(CMutableTransaction());
+    BOOST_REQUIRE(ReceivedBlockTransactions(block, state, pindex, posBlock));
+    return pindex;
+}
+
+// Replaces the block index with an active chain of NUM_BLOCKS blocks,
+// BLOCKS_PER_FILE to a file, and returns a fork block stored in file 2.
+static CBlockIndex* BuildChain()
+{
+    UnloadBlockIndex();
+    LOCK(cs_main);
+    CBlockIndex* pindex = NULL;
+    CBlockIndex* pfork = NULL;
+    for (int i = 0; i < NUM_BLOCKS; i++) {
+        pindex = AddBlock(pindex, CDiskBlockPos(i / BLOCKS_PER_FILE, (i % BLOCKS_PER_FILE) * BLOCK_SIZE));
+        if (i == 2 * BLOCKS_PER_FILE + 50)
+            pfork = AddBlock(pindex->pprev, CDiskBlockPos(2, BLOCKS_PER_FILE * BLOCK_SIZE));
+    }
+    chainActive.SetTip(pindex);
+    return pfork;
+}
+
+BOOST_FIXTURE_TEST_SUITE(prune_tests, TestingSetup)
+
+// The files hold 1301 MiB. Files 0 to 9 only hold blocks deeper than
+// MIN_BLOCKS_TO_KEEP, and pruning stops once usage plus one chunk of each
+// file type fits under the target, i.e. after the first four files.
+static const uint64_t PRUNE_TARGET = 1000 * 1024 * 1024;
+static const std::set<int> setExpectedPrune = {0, 1, 2, 3};
+
+BOOST_AUTO_TEST_CASE(find_files_to_prune)
+{
+    SelectParams(CBaseChainParams::REGTEST);
+    CBlockIndex* pfork = BuildChain();
+
+    // Where each block was stored before pruning
+    std::map<CBlockIndex*, int> mapFile;
+    for (const auto& entry : mapBlockIndex)
+        mapFile[entry.second] = entry.second->nFile;
+
+    fPruneMode = true;
+    nPruneTarget = PRUNE_TARGET;
+    std::set<int> setFilesToPrune;
+    FindFilesToPrune(setFilesToPrune);
+    BOOST_CHECK(setFilesToPrune == setExpectedPrune);
+    BOOST_CHECK_EQUAL(CalculateCurrentUsage(), (uint64_t)(NUM_BLOCKS - 4 * BLOCKS_PER_FILE) * BLOCK_SIZE);
+
+    // Exactly the blocks a scan of mapBlockIndex finds in the pruned files,
+    // including ones off the active chain, lost their data
+    for (const auto& entry : mapFile) {
+        bool fPruned = setFilesToPrune.count(entry.second);
+        BOOST_CHECK_EQUAL(!(entry.first->nStatus & BLOCK_HAVE_DATA), fPruned);
+        BOOST_CHECK_EQUAL(entry.first->nFile, fPruned ? 0 : entry.second);
+    }
+    BOOST_CHECK(!(pfork->nStatus & BLOCK_HAVE_DATA));
+
+    // Nothing else is pruned while usage stays under the target
+    setFilesToPrune.clear();
+    FindFilesToPrune(setFilesToPrune);
+    BOOST_CHECK(setFilesToPrune.empty());
+
+    fPruneMode = false;
+    nPruneTarget = 0;
+    SelectParams(CBaseChainParams::MAIN);
+}
+
+BOOST_AUTO_TEST_CASE(prune_files_unlinked_after_flush)
+{
+    SelectParams(CBaseChainParams::REGTEST);
+    BuildChain();
+    for (int nFile = 0; nFile < NUM_FILES; nFile++) {
+        FILE* file = OpenBlockFile(CDiskBlockPos(nFile, 0));
+        BOOST_REQUIRE(file);
+        fclose(file);
+        file = OpenUndoFile(CDiskBlockPos(nFile, 0));
+        BOOST_REQUIRE(file);
+        fclose(file);
+    }
+
+    // This is what the pruning thread does before it unlinks the files
+    fPruneMode = true;
+    nPruneTarget = PRUNE_TARGET;
+    std::set<int> setFilesToUnlink;
+    PruneAndFlush(setFilesToUnlink);
+    BOOST_CHECK(setFilesToUnlink == setExpectedPrune);
+
+    // The block index on disk no longer refers to the pruned files, but they
+    // are still there
+    bool fPrunedFlag = false;
+    BOOST_CHECK(pblocktree->ReadFlag("prunedblockfiles", fPrunedFlag) && fPrunedFlag);
+    for (int nFile = 0; nFile < NUM_FILES; nFile++) {
+        CBlockFileInfo info;
+        BOOST_CHECK(pblocktree->ReadBlockFileInfo(nFile, info));
+        BOOST_CHECK_EQUAL(info.nSize == 0, setFilesToUnlink.count(nFile) != 0);
+        BOOST_CHECK(boost::filesystem::exists(GetBlockPosFilename(CDiskBlockPos(nFile, 0), "blk")));
+        BOOST_CHECK(boost::filesystem::exists(GetBlockPosFilename(CDiskBlockPos(nFile, 0), "rev")));
+    }
+
+    UnlinkPrunedFiles(setFilesToUnlink);
+    for (int nFile = 0; nFile < NUM_FILES; nFile++) {
+        bool fPruned = setFilesToUnlink.count(nFile);
+        BOOST_CHECK_EQUAL(boost::filesystem::exists(GetBlockPosFilename(CDiskBlockPos(nFile, 0), "blk")), !fPruned);
+        BOOST_CHECK_EQUAL(boost::filesystem::exists(GetBlockPosFilename(CDiskBlockPos(nFile, 0), "rev")), !fPruned);
+    }
+
+    fPruneMode = false;
+    nPruneTarget = 0;
+    SelectParams(CBaseChainParams::MAIN);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
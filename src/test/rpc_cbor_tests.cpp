@@ -0,0 +1,163 @@
+// Copyright (c) 2018 The Zcash developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "rpccbor.h"
+#include "rpcprotocol.h"
+#include "rpcserver.h"
+#include "utilstrencodings.h"
+
+#include "test/test_bitcoin.h"
+
+#include <boost/test/unit_test.hpp>
+
+#include <univalue.h>
+
+static std::string EncodeHex(const UniValue& val)
+{
+    std::string out;
+    EncodeCBOR(out, val);
+    return HexStr(out.begin(), out.end());
+}
+
+static UniValue DecodeHex(const std::string& hex)
+{
+    std::vector<unsigned char> vch = ParseHex(hex);
+    UniValue val;
+    BOOST_CHECK(DecodeCBOR(std::string(vch.begin(), vch.end()), val));
+    return val;
+}
+
+static bool DecodeFails(const std::string& hex)
+{
+    std::vector<unsigned char> vch = ParseHex(hex);
+    UniValue val;
+    return !DecodeCBOR(std::string(vch.begin(), vch.end()), val);
+}
+
+BOOST_FIXTURE_TEST_SUITE(rpc_cbor_tests, BasicTestingSetup)
+
+// Examples from RFC 7049 appendix A
+BOOST_AUTO_TEST_CASE(cbor_encode)
+{
+    BOOST_CHECK_EQUAL(EncodeHex(UniValue((int64_t)0)), "00");
+    BOOST_CHECK_EQUAL(EncodeHex(UniValue((int64_t)23)), "17");
+    BOOST_CHECK_EQUAL(EncodeHex(UniValue((int64_t)24)), "1818");
+    BOOST_CHECK_EQUAL(EncodeHex(UniValue((int64_t)1000)), "1903e8");
+    BOOST_CHECK_EQUAL(EncodeHex(UniValue((int64_t)1000000)), "1a000f4240");
+    BOOST_CHECK_EQUAL(EncodeHex(UniValue((int64_t)1000000000000)), "1b000000e8d4a51000");
+    BOOST_CHECK_EQUAL(EncodeHex(UniValue((uint64_t)18446744073709551615ULL)), "1bffffffffffffffff");
+    BOOST_CHECK_EQUAL(EncodeHex(UniValue((int64_t)-1)), "20");
+    BOOST_CHECK_EQUAL(EncodeHex(UniValue((int64_t)-1000)), "3903e7");
+    BOOST_CHECK_EQUAL(EncodeHex(UniValue(1.1)), "fb3ff199999999999a");
+    BOOST_CHECK_EQUAL(EncodeHex(UniValue(false)), "f4");
+    BOOST_CHECK_EQUAL(EncodeHex(UniValue(true)), "f5");
+    BOOST_CHECK_EQUAL(EncodeHex(NullUniValue), "f6");
+    BOOST_CHECK_EQUAL(EncodeHex(UniValue("IETF")), "6449455446");
+
+    UniValue arr(UniValue::VARR);
+    arr.push_back(1);
+    arr.push_back(2);
+    arr.push_back(3);
+    BOOST_CHECK_EQUAL(EncodeHex(arr), "83010203");
+
+    UniValue obj(UniValue::VOBJ);
+    obj.push_back(Pair("a", 1));
+    obj.push_back(Pair("b", arr));
+    BOOST_CHECK_EQUAL(EncodeHex(obj), "a2616101616283010203");
+
+    // Members named "hex" carry serialized data and become byte strings,
+    // whatever their contents
+    UniValue tx(UniValue::VOBJ);
+    tx.push_back(Pair("hex", std::string("\x01\x02\x03\x04")));
+    tx.push_back(Pair("txid", "01020304"));
+    BOOST_CHECK_EQUAL(EncodeHex(tx), "a26368657844010203046474786964683031303230333034");
+
+    UniValue script(UniValue::VOBJ);
+    script.push_back(Pair("hex", ""));
+    BOOST_CHECK_EQUAL(EncodeHex(script), "a163686578" "40");
+    UniValue odd(UniValue::VOBJ);
+    odd.push_back(Pair("hex", "abc"));
+    BOOST_CHECK_EQUAL(EncodeHex(odd), "a163686578" "43616263");
+}
+
+BOOST_AUTO_TEST_CASE(cbor_decode)
+{
+    BOOST_CHECK_EQUAL(DecodeHex("00").get_int64(), 0);
+    BOOST_CHECK_EQUAL(DecodeHex("1a000f4240").get_int64(), 1000000);
+    BOOST_CHECK_EQUAL(DecodeHex("1bffffffffffffffff").getValStr(), "18446744073709551615");
+    BOOST_CHECK_EQUAL(DecodeHex("3903e7").get_int64(), -1000);
+    BOOST_CHECK_EQUAL(DecodeHex("3b7fffffffffffffff").get_int64(), std::numeric_limits<int64_t>::min());
+    BOOST_CHECK_EQUAL(DecodeHex("f93e00").get_real(), 1.5);
+    BOOST_CHECK_EQUAL(DecodeHex("fa47c35000").get_real(), 100000.0);
+    BOOST_CHECK_EQUAL(DecodeHex("fb3ff199999999999a").get_real(), 1.1);
+    BOOST_CHECK(DecodeHex("f4").isFalse());
+    BOOST_CHECK(DecodeHex("f5").isTrue());
+    BOOST_CHECK(DecodeHex("f6").isNull());
+    BOOST_CHECK(DecodeHex("f7").isNull());
+    BOOST_CHECK_EQUAL(DecodeHex("6449455446").get_str(), "IETF");
+    // Byte strings are handed to RPC handlers as hex
+    BOOST_CHECK_EQUAL(DecodeHex("4401020304").get_str(), "01020304");
+    // Tags are ignored
+    BOOST_CHECK_EQUAL(DecodeHex("c11a514b67b0").get_int64(), 1363896240);
+
+    UniValue obj = DecodeHex("a26161016162820203");
+    BOOST_CHECK_EQUAL(find_value(obj, "a").get_int(), 1);
+    BOOST_CHECK_EQUAL(find_value(obj, "b")[1].get_int(), 3);
+
+    // Truncated items, trailing data, and features without a JSON equivalent
+    BOOST_CHECK(DecodeFails(""));
+    BOOST_CHECK(DecodeFails("19e8"));
+    BOOST_CHECK(DecodeFails("6449455"));
+    BOOST_CHECK(DecodeFails("8301020300"));
+    BOOST_CHECK(DecodeFails("830102"));
+    BOOST_CHECK(DecodeFails("9f0102ff"));
+    BOOST_CHECK(DecodeFails("a10102"));
+    BOOST_CHECK(DecodeFails("3bffffffffffffffff"));
+    BOOST_CHECK(DecodeFails("f97c00"));
+    BOOST_CHECK(DecodeFails("9b7fffffffffffffff"));
+    std::string deep(600, '\x81');
+    UniValue val;
+    BOOST_CHECK(!DecodeCBOR(deep + std::string(1, '\x00'), val));
+}
+
+BOOST_AUTO_TEST_CASE(cbor_reply)
+{
+    std::string reply = CBORRPCReply("getrawtransaction", UniValue(std::string("\x01\x02")), NullUniValue, UniValue((int64_t)1));
+    BOOST_CHECK_EQUAL(HexStr(reply.begin(), reply.end()), "a366726573756c74420102656572726f72f662696401");
+
+    reply = CBORRPCReply("getbestblockhash", UniValue("0102"), NullUniValue, UniValue((int64_t)1));
+    UniValue val;
+    BOOST_CHECK(DecodeCBOR(reply, val));
+    BOOST_CHECK_EQUAL(find_value(val, "result").get_str(), "0102");
+    BOOST_CHECK(find_value(val, "error").isNull());
+    BOOST_CHECK_EQUAL(find_value(val, "id").get_int(), 1);
+
+    reply = CBORRPCReply("", NullUniValue, JSONRPCError(RPC_METHOD_NOT_FOUND, "Method not found"), NullUniValue);
+    BOOST_CHECK(DecodeCBOR(reply, val));
+    BOOST_CHECK_EQUAL(find_value(find_value(val, "error"), "code").get_int(), RPC_METHOD_NOT_FOUND);
+}
+
+BOOST_AUTO_TEST_CASE(cbor_raw_bytes_scope)
+{
+    const unsigned char data[] = {0x00, 0xab};
+    BOOST_CHECK(!RPCWantsRawBytes());
+    BOOST_CHECK_EQUAL(RPCBytesStr(data, data + 2), "00ab");
+    {
+        RPCRawBytesScope scope;
+        BOOST_CHECK(RPCWantsRawBytes());
+        BOOST_CHECK_EQUAL(RPCBytesStr(data, data + 2), std::string("\x00\xab", 2));
+        {
+            RPCRawBytesScope inactive(false);
+            BOOST_CHECK(RPCWantsRawBytes());
+        }
+        BOOST_CHECK(RPCWantsRawBytes());
+    }
+    BOOST_CHECK(!RPCWantsRawBytes());
+    {
+        RPCRawBytesScope inactive(false);
+        BOOST_CHECK(!RPCWantsRawBytes());
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -5,8 +5,10 @@
 #include "rpcserver.h"
 #include "rpcclient.h"
 
+#include "init.h"
 #include "key_io.h"
 #include "netbase.h"
+#include "scheduler.h"
 #include "utilstrencodings.h"
 
 #include "test/test_bitcoin.h"
@@ -342,4 +344,31 @@ BOOST_AUTO_TEST_CASE(rpc_getnetworksolps)
     BOOST_CHECK_NO_THROW(CallRPC("getnetworksolps 120 -1"));
 }
 
+static void NoOp() {}
+
+BOOST_AUTO_TEST_CASE(rpc_getschedulerinfo)
+{
+    BOOST_CHECK_THROW(CallRPC("getschedulerinfo"), runtime_error);
+
+    CScheduler scheduler;
+    scheduler.scheduleFromNow(&NoOp, 0, "noop");
+    scheduler.scheduleFromNow(&NoOp, 0);
+    boost::thread thread(boost::bind(&CScheduler::serviceQueue, &scheduler));
+    scheduler.stop(true);
+    thread.join();
+    scheduler.scheduleFromNow(&NoOp, 3600, "noop");
+
+    pschedulerMain = &scheduler;
+    UniValue r;
+    BOOST_CHECK_NO_THROW(r = CallRPC("getschedulerinfo"));
+    pschedulerMain = NULL;
+    BOOST_CHECK_EQUAL(find_value(r.get_obj(), "pending").get_int(), 1);
+    UniValue tasks = find_value(r.get_obj(), "tasks").get_array();
+    BOOST_REQUIRE_EQUAL(tasks.size(), 2);
+    BOOST_CHECK_EQUAL(find_value(tasks[0].get_obj(), "name").get_str(), "");
+    BOOST_CHECK_EQUAL(find_value(tasks[1].get_obj(), "name").get_str(), "noop");
+    BOOST_CHECK_EQUAL(find_value(tasks[1].get_obj(), "runs").get_int(), 1);
+    BOOST_CHECK_EQUAL(find_value(tasks[1].get_obj(), "overruns").get_int(), 0);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
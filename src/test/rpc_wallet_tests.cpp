@@ -5,6 +5,7 @@
 #include "rpcserver.h"
 #include "rpcclient.h"
 
+#include "consensus/validation.h"
 #include "key_io.h"
 #include "main.h"
 #include "wallet/wallet.h"
@@ -43,6 +44,8 @@ extern UniValue createArgs(int nRequired, const char* address1 = NULL, const cha
 extern UniValue CallRPC(string args);
 
 extern CWallet* pwalletMain;
+extern bool ReceivedBlockTransactions(const CBlock &block, CValidationState& state, CBlockIndex *pindexNew, const CDiskBlockPos& pos);
+extern bool FindBlockPos(CValidationState &state, CDiskBlockPos &pos, unsigned int nAddSize, unsigned int nHeight, uint64_t nTime, bool fKnown);
 
 bool find_error(const UniValue& objError, const std::string& expected) {
     return find_value(objError, "message").get_str().find(expected) != string::npos;
@@ -446,6 +449,59 @@ BOOST_AUTO_TEST_CASE(rpc_wallet_z_exportwallet)
 }
 
 
+/*
+ * dumpwallet formats keys on several threads; check that each key is written
+ * once, in order of birth time
+ */
+BOOST_AUTO_TEST_CASE(rpc_wallet_dumpwallet_order)
+{
+    LOCK2(cs_main, pwalletMain->cs_wallet);
+
+    // enough keys to be formatted in several chunks
+    for (int i = 0; i < 2500; i++)
+        pwalletMain->GenerateNewKey();
+    std::set<CKeyID> setKeys;
+    pwalletMain->GetKeys(setKeys);
+    std::set<std::string> setAddrs;
+    BOOST_FOREACH(const CKeyID& keyid, setKeys)
+        setAddrs.insert(EncodeDestination(keyid));
+
+    boost::filesystem::path tmppath = boost::filesystem::temp_directory_path();
+    boost::filesystem::path tmpfilename = boost::filesystem::unique_path("%%%%%%%%");
+    boost::filesystem::path exportfilepath = tmppath / tmpfilename;
+    mapArgs["-exportdir"] = tmppath.native();
+
+    BOOST_CHECK_NO_THROW(CallRPC(string("dumpwallet ") + tmpfilename.string()));
+
+    ifstream file;
+    file.open(exportfilepath.string().c_str(), std::ios::in);
+    BOOST_CHECK(file.is_open());
+    std::string strLastTime;
+    size_t nLines = 0;
+    bool fEnd = false;
+    while (file.good()) {
+        std::string line;
+        std::getline(file, line);
+        if (line == "# End of dump")
+            fEnd = true;
+        if (line.empty() || line[0] == '#')
+            continue;
+        std::vector<std::string> vstr;
+        boost::split(vstr, line, boost::is_any_of(" "));
+        BOOST_REQUIRE(vstr.size() >= 2);
+        BOOST_CHECK(vstr[1] >= strLastTime);
+        strLastTime = vstr[1];
+        size_t pos = line.find("# addr=");
+        BOOST_REQUIRE(pos != std::string::npos);
+        BOOST_CHECK(setAddrs.erase(line.substr(pos + 7)) == 1);
+        nLines++;
+    }
+    BOOST_CHECK(fEnd);
+    BOOST_CHECK_EQUAL(nLines, setKeys.size());
+    BOOST_CHECK(setAddrs.empty());
+}
+
+
 /*
  * This test covers RPC command z_importwallet
  */
@@ -607,6 +663,133 @@ BOOST_AUTO_TEST_CASE(rpc_wallet_z_importexport)
     BOOST_CHECK_THROW(CallRPC("z_getnewaddress toomanyargs"), runtime_error);
 }
 
+/*
+ * This test covers RPC command z_importmulti
+ */
+BOOST_AUTO_TEST_CASE(rpc_wallet_z_importmulti)
+{
+    LOCK2(cs_main, pwalletMain->cs_wallet);
+    UniValue retValue;
+
+    // error if no args or too many args
+    BOOST_CHECK_THROW(CallRPC("z_importmulti"), runtime_error);
+    BOOST_CHECK_THROW(CallRPC("z_importmulti [] true toomany"), runtime_error);
+
+    CKey key;
+    key.MakeNewKey(true);
+    std::string strKey = EncodeSecret(key);
+    std::string strKeyAddr = EncodeDestination(key.GetPubKey().GetID());
+    CKey watchKey;
+    watchKey.MakeNewKey(true);
+    std::string strWatchAddr = EncodeDestination(watchKey.GetPubKey().GetID());
+    auto sk = libzcash::SproutSpendingKey::random();
+    std::string strZKey = EncodeSpendingKey(sk);
+    auto vk = libzcash::SproutSpendingKey::random().viewing_key();
+    std::string strVKey = EncodeViewingKey(vk);
+
+    // error if invalid requests
+    BOOST_CHECK_THROW(CallRPC("z_importmulti [{}]"), runtime_error);
+    BOOST_CHECK_THROW(CallRPC("z_importmulti [{\"key\":\"" + strKey + "\",\"address\":\"" + strWatchAddr + "\"}]"), runtime_error);
+    BOOST_CHECK_THROW(CallRPC("z_importmulti [{\"key\":\"notakey\"}]"), runtime_error);
+    BOOST_CHECK_THROW(CallRPC("z_importmulti [{\"address\":\"notanaddress\"}]"), runtime_error);
+    BOOST_CHECK_THROW(CallRPC("z_importmulti [{\"key\":\"" + strKey + "\",\"birthday\":-1}]"), runtime_error);
+    BOOST_CHECK_THROW(CallRPC("z_importmulti [{\"key\":\"" + strKey + "\",\"birthday\":2147483647}]"), runtime_error);
+    // A bad request anywhere in the batch leaves the wallet unchanged
+    BOOST_CHECK_THROW(CallRPC("z_importmulti [{\"key\":\"" + strKey + "\"},{\"key\":\"notakey\"}]"), runtime_error);
+    BOOST_CHECK(!pwalletMain->HaveKey(key.GetPubKey().GetID()));
+
+    std::string strImports = "[{\"key\":\"" + strKey + "\",\"label\":\"imported\"},"
+                             "{\"address\":\"" + strWatchAddr + "\"},"
+                             "{\"key\":\"" + strZKey + "\",\"birthday\":0},"
+                             "{\"key\":\"" + strVKey + "\"},"
+                             "{\"key\":\"" + strKey + "\"}]";
+    BOOST_CHECK_NO_THROW(retValue = CallRPC("z_importmulti " + strImports));
+    UniValue arr = retValue.get_array();
+    BOOST_REQUIRE_EQUAL(arr.size(), 5);
+    BOOST_CHECK_EQUAL(find_value(arr[0], "address").get_str(), strKeyAddr);
+    BOOST_CHECK_EQUAL(find_value(arr[1], "address").get_str(), strWatchAddr);
+    BOOST_CHECK_EQUAL(find_value(arr[2], "address").get_str(), EncodePaymentAddress(sk.address()));
+    BOOST_CHECK_EQUAL(find_value(arr[3], "address").get_str(), EncodePaymentAddress(vk.address()));
+    for (size_t i = 0; i < 4; i++) {
+        BOOST_CHECK(find_value(arr[i], "imported").get_bool());
+    }
+    // Repeats within the batch are imported once
+    BOOST_CHECK(!find_value(arr[4], "imported").get_bool());
+
+    BOOST_CHECK(pwalletMain->HaveKey(key.GetPubKey().GetID()));
+    BOOST_CHECK(pwalletMain->HaveWatchOnly(GetScriptForDestination(watchKey.GetPubKey().GetID())));
+    BOOST_CHECK(pwalletMain->HaveSpendingKey(sk.address()));
+    BOOST_CHECK(pwalletMain->HaveViewingKey(vk.address()));
+    BOOST_CHECK_EQUAL(pwalletMain->mapAddressBook[key.GetPubKey().GetID()].name, "imported");
+
+    // Importing again, without a rescan, adds nothing
+    BOOST_CHECK_NO_THROW(retValue = CallRPC("z_importmulti " + strImports + " false"));
+    arr = retValue.get_array();
+    for (size_t i = 0; i < arr.size(); i++) {
+        BOOST_CHECK(!find_value(arr[i], "imported").get_bool());
+    }
+}
+
+// Writes a block paying to script on top of the active chain, and makes it
+// the tip, so that rescans can read it back.
+static CTransaction AddBlockPayingTo(const CScript& script)
+{
+    CMutableTransaction mtx;
+    mtx.vin.resize(1);
+    mtx.vin[0].prevout = COutPoint(GetRandHash(), 0);
+    mtx.vout.push_back(CTxOut(COIN, script));
+
+    CBlockIndex* pprev = chainActive.Tip();
+    CBlock block;
+    block.hashPrevBlock = pprev->GetBlockHash();
+    block.nTime = pprev->nTime + 1;
+    block.vtx.push_back(mtx);
+    block.hashMerkleRoot = block.BuildMerkleTree();
+
+    CBlockIndex* pindex = new CBlockIndex(block);
+    pindex->pprev = pprev;
+    pindex->nHeight = pprev->nHeight + 1;
+    pindex->nChainWork = pprev->nChainWork + 1;
+    pindex->hashSproutAnchor = pprev->hashSproutAnchor;
+    pindex->phashBlock = &mapBlockIndex.insert(std::make_pair(block.GetHash(), pindex)).first->first;
+
+    CValidationState state;
+    CDiskBlockPos pos;
+    unsigned int nBlockSize = ::GetSerializeSize(block, SER_DISK, CLIENT_VERSION);
+    BOOST_REQUIRE(FindBlockPos(state, pos, nBlockSize + 8, pindex->nHeight, block.GetBlockTime(), false));
+    BOOST_REQUIRE(WriteBlockToDisk(block, pos, Params().MessageStart()));
+    BOOST_REQUIRE(ReceivedBlockTransactions(block, state, pindex, pos));
+    chainActive.SetTip(pindex);
+    return block.vtx[0];
+}
+
+/*
+ * A key is only matched against blocks from its birthday on, even when
+ * another import in the batch starts the rescan earlier
+ */
+BOOST_AUTO_TEST_CASE(rpc_wallet_z_importmulti_birthday)
+{
+    LOCK2(cs_main, pwalletMain->cs_wallet);
+    UniValue retValue;
+
+    CKey key;
+    key.MakeNewKey(true);
+    CKey earlyKey;
+    earlyKey.MakeNewKey(true);
+    CScript script = GetScriptForDestination(key.GetPubKey().GetID());
+    CTransaction txBefore = AddBlockPayingTo(script);
+    CTransaction txAt = AddBlockPayingTo(script);
+    CTransaction txAfter = AddBlockPayingTo(script);
+    BOOST_REQUIRE_EQUAL(chainActive.Height(), 3);
+
+    BOOST_CHECK_NO_THROW(retValue = CallRPC("z_importmulti [{\"key\":\"" + EncodeSecret(earlyKey) + "\"},"
+                                            "{\"key\":\"" + EncodeSecret(key) + "\",\"birthday\":2}]"));
+    BOOST_CHECK(pwalletMain->HaveKey(key.GetPubKey().GetID()));
+    BOOST_CHECK_EQUAL(pwalletMain->mapWallet.count(txBefore.GetHash()), 0);
+    BOOST_CHECK_EQUAL(pwalletMain->mapWallet.count(txAt.GetHash()), 1);
+    BOOST_CHECK_EQUAL(pwalletMain->mapWallet.count(txAfter.GetHash()), 1);
+}
+
 
 
 /**
@@ -109,4 +109,96 @@ BOOST_AUTO_TEST_CASE(manythreads)
     BOOST_CHECK_EQUAL(counterSum, 200);
 }
 
+static void timedTask(boost::mutex& mutex, int& nEarly, int& nRun, boost::chrono::system_clock::time_point t)
+{
+    bool fEarly = boost::chrono::system_clock::now() < t;
+    boost::unique_lock<boost::mutex> lock(mutex);
+    if (fEarly)
+        nEarly++;
+    nRun++;
+}
+
+BOOST_AUTO_TEST_CASE(timing)
+{
+    // Tasks up to half a second out, so that both the lowest level of the
+    // timer wheel and the one above it are used. None may run early.
+    CScheduler timedTasks;
+    boost::mutex mutex;
+    int nEarly = 0, nRun = 0;
+    boost::random::mt19937 rng(insecure_rand());
+    boost::random::uniform_int_distribution<> randomMsec(-10, 500);
+
+    boost::chrono::system_clock::time_point now = boost::chrono::system_clock::now();
+    for (int i = 0; i < 200; i++) {
+        boost::chrono::system_clock::time_point t = now + boost::chrono::microseconds(randomMsec(rng) * 1000 + randomMsec(rng));
+        timedTasks.schedule(boost::bind(&timedTask, boost::ref(mutex), boost::ref(nEarly), boost::ref(nRun), t), t);
+    }
+    boost::chrono::system_clock::time_point first, last;
+    BOOST_CHECK_EQUAL(timedTasks.getQueueInfo(first, last), 200);
+
+    boost::thread_group threads;
+    for (int i = 0; i < 3; i++)
+        threads.create_thread(boost::bind(&CScheduler::serviceQueue, &timedTasks));
+    timedTasks.stop(true);
+    threads.join_all();
+
+    BOOST_CHECK_EQUAL(nRun, 200);
+    BOOST_CHECK_EQUAL(nEarly, 0);
+    BOOST_CHECK(boost::chrono::system_clock::now() >= last);
+    BOOST_CHECK_EQUAL(timedTasks.getQueueInfo(first, last), 0);
+}
+
+static void keyedTask(boost::mutex& mutex, int& nRunning, int& nMaxRunning, std::vector<int>& vOrder, int n)
+{
+    {
+        boost::unique_lock<boost::mutex> lock(mutex);
+        nMaxRunning = std::max(nMaxRunning, ++nRunning);
+        vOrder.push_back(n);
+    }
+    MicroSleep(100);
+    boost::unique_lock<boost::mutex> lock(mutex);
+    nRunning--;
+}
+
+BOOST_AUTO_TEST_CASE(serialization_keys)
+{
+    // Tasks sharing a key run one at a time and in order, even with plenty
+    // of threads, while tasks under other keys run alongside them.
+    CScheduler keyedTasks;
+    boost::mutex mutex;
+    int nRunning[2] = { 0, 0 };
+    int nMaxRunning[2] = { 0, 0 };
+    std::vector<int> vOrder[2];
+
+    boost::chrono::system_clock::time_point now = boost::chrono::system_clock::now();
+    for (int i = 0; i < 50; i++) {
+        for (int k = 0; k < 2; k++) {
+            keyedTasks.schedule(boost::bind(&keyedTask, boost::ref(mutex), boost::ref(nRunning[k]), boost::ref(nMaxRunning[k]), boost::ref(vOrder[k]), i),
+                                now + boost::chrono::microseconds(i * 10), k == 0 ? "a" : "b");
+        }
+    }
+
+    boost::thread_group threads;
+    for (int i = 0; i < 8; i++)
+        threads.create_thread(boost::bind(&CScheduler::serviceQueue, &keyedTasks));
+    keyedTasks.stop(true);
+    threads.join_all();
+
+    for (int k = 0; k < 2; k++) {
+        BOOST_CHECK_EQUAL(nMaxRunning[k], 1);
+        BOOST_CHECK_EQUAL(vOrder[k].size(), 50);
+        for (size_t i = 0; i < vOrder[k].size(); i++)
+            BOOST_CHECK_EQUAL(vOrder[k][i], (int)i);
+    }
+
+    std::map<std::string, CScheduler::TaskStats> stats = keyedTasks.getTaskStats();
+    BOOST_CHECK_EQUAL(stats.size(), 2);
+    BOOST_CHECK_EQUAL(stats["a"].nRuns, 50);
+    BOOST_CHECK_EQUAL(stats["b"].nRuns, 50);
+    BOOST_CHECK_EQUAL(stats["a"].nOverruns, 0);
+    BOOST_CHECK(stats["a"].nTotalRunMicros >= 50 * 100);
+    BOOST_CHECK(stats["a"].nMaxRunMicros >= 100);
+    BOOST_CHECK(stats["a"].nMaxLatencyMicros <= stats["a"].nTotalLatencyMicros);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
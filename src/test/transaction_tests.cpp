@@ -18,7 +18,9 @@
 #include "script/script.h"
 #include "script/script_error.h"
 #include "script/sign.h"
+#include "primitives/block_view.h"
 #include "primitives/transaction.h"
+#include "primitives/transaction_view.h"
 
 #include "sodium.h"
 
@@ -745,6 +747,201 @@ BOOST_AUTO_TEST_CASE(test_big_overwinter_transaction) {
     threadGroup.join_all();
 }
 
+// Checks that a view of the serialization of tx agrees with tx
+static void CheckTransactionViewOf(const CTransaction& tx, const std::string& strTest)
+{
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << tx;
+    std::vector<unsigned char> data(ss.begin(), ss.end());
+    // Trailing data is not part of the transaction
+    data.push_back(0xff);
+
+    CTransactionView view(data.data(), data.data() + data.size());
+    BOOST_CHECK_MESSAGE(view.GetHash() == tx.GetHash(), strTest);
+    BOOST_CHECK_EQUAL(view.GetSerializeSize(), ss.size());
+
+    // The copy is built from the parts of the view and takes its hash, so
+    // check that it serializes back to the same bytes
+    const CTransaction txCopy = view.ToTransaction();
+    BOOST_CHECK(txCopy == tx);
+    BOOST_CHECK_EQUAL(txCopy.GetTotalSize(), ss.size());
+    CDataStream ssCopy(SER_NETWORK, PROTOCOL_VERSION);
+    ssCopy << txCopy;
+    BOOST_CHECK_MESSAGE(ssCopy.str() == ss.str(), strTest);
+
+    BOOST_CHECK_EQUAL(view.fOverwintered, tx.fOverwintered);
+    BOOST_CHECK_EQUAL(view.nVersion, tx.nVersion);
+    BOOST_CHECK_EQUAL(view.nLockTime, tx.nLockTime);
+    BOOST_CHECK_EQUAL(view.valueBalance, tx.valueBalance);
+    BOOST_REQUIRE_EQUAL(view.vin.size(), tx.vin.size());
+    for (size_t i = 0; i < tx.vin.size(); i++) {
+        BOOST_CHECK(view.vin[i].prevout == tx.vin[i].prevout);
+        BOOST_CHECK(CScript(view.vin[i].scriptSig.begin(), view.vin[i].scriptSig.end()) == tx.vin[i].scriptSig);
+        BOOST_CHECK_EQUAL(view.vin[i].nSequence, tx.vin[i].nSequence);
+    }
+    BOOST_REQUIRE_EQUAL(view.vout.size(), tx.vout.size());
+    for (size_t i = 0; i < tx.vout.size(); i++) {
+        BOOST_CHECK_EQUAL(view.vout[i].nValue, tx.vout[i].nValue);
+        BOOST_CHECK(CScript(view.vout[i].scriptPubKey.begin(), view.vout[i].scriptPubKey.end()) == tx.vout[i].scriptPubKey);
+    }
+    BOOST_REQUIRE_EQUAL(view.vjoinsplit.size(), tx.vjoinsplit.size());
+    for (size_t i = 0; i < tx.vjoinsplit.size(); i++) {
+        BOOST_CHECK_EQUAL(view.vjoinsplit[i].vpub_old, tx.vjoinsplit[i].vpub_old);
+        BOOST_CHECK_EQUAL(view.vjoinsplit[i].vpub_new, tx.vjoinsplit[i].vpub_new);
+        BOOST_CHECK(view.vjoinsplit[i].nullifiers == tx.vjoinsplit[i].nullifiers);
+    }
+    BOOST_REQUIRE_EQUAL(view.vShieldedSpend.size(), tx.vShieldedSpend.size());
+    for (size_t i = 0; i < tx.vShieldedSpend.size(); i++) {
+        BOOST_CHECK(view.vShieldedSpend[i].nullifier == tx.vShieldedSpend[i].nullifier);
+    }
+    BOOST_CHECK_EQUAL(view.vShieldedOutput.size(), tx.vShieldedOutput.size());
+
+    CValidationState state, stateView;
+    BOOST_CHECK_EQUAL(CheckTransactionWithoutProofVerification(tx, state),
+                      CheckTransactionWithoutProofVerification(view, stateView));
+    BOOST_CHECK_EQUAL(state.GetRejectReason(), stateView.GetRejectReason());
+
+    // Any truncation is rejected, as it is by deserialization
+    for (size_t n = 0; n < ss.size(); n++) {
+        BOOST_CHECK_THROW(CTransactionView(data.data(), data.data() + n), std::ios_base::failure);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(transaction_view)
+{
+    const unsigned char* const vectors[] = {json_tests::tx_valid, json_tests::tx_invalid};
+    const size_t sizes[] = {sizeof(json_tests::tx_valid), sizeof(json_tests::tx_invalid)};
+    for (size_t n = 0; n < 2; n++) {
+        UniValue tests = read_json(std::string(vectors[n], vectors[n] + sizes[n]));
+        for (size_t idx = 0; idx < tests.size(); idx++) {
+            UniValue test = tests[idx];
+            if (!test[0].isArray())
+                continue;
+            CDataStream stream(ParseHex(test[1].get_str()), SER_NETWORK, PROTOCOL_VERSION);
+            CTransaction tx;
+            stream >> tx;
+            CheckTransactionViewOf(tx, test.write());
+        }
+    }
+
+    // Sprout joinsplits with PHGR proofs
+    CMutableTransaction mtx;
+    mtx.nVersion = 2;
+    mtx.vin.resize(1);
+    mtx.vin[0].prevout = COutPoint(GetRandHash(), 0);
+    mtx.vin[0].scriptSig = CScript() << OP_1 << OP_2;
+    mtx.vout.resize(2);
+    mtx.vout[0].nValue = 1000;
+    mtx.vout[1].nValue = -1;
+    mtx.vjoinsplit.resize(2);
+    mtx.vjoinsplit[0].vpub_old = 5;
+    mtx.vjoinsplit[0].nullifiers = {GetRandHash(), GetRandHash()};
+    mtx.vjoinsplit[1].vpub_new = 7;
+    mtx.vjoinsplit[1].nullifiers = {GetRandHash(), mtx.vjoinsplit[0].nullifiers[1]};
+    mtx.joinSplitPubKey = GetRandHash();
+    CheckTransactionViewOf(mtx, "sprout");
+
+    // Sapling, with Groth joinsplit proofs
+    mtx.fOverwintered = true;
+    mtx.nVersion = SAPLING_TX_VERSION;
+    mtx.nVersionGroupId = SAPLING_VERSION_GROUP_ID;
+    mtx.nExpiryHeight = 10;
+    mtx.valueBalance = -3;
+    mtx.vout[1].nValue = 1;
+    mtx.vjoinsplit[1].nullifiers[1] = GetRandHash();
+    for (auto& joinsplit : mtx.vjoinsplit) {
+        joinsplit.proof = libzcash::GrothProof();
+    }
+    mtx.vShieldedSpend.resize(2);
+    mtx.vShieldedSpend[0].nullifier = GetRandHash();
+    mtx.vShieldedSpend[1].nullifier = GetRandHash();
+    mtx.vShieldedOutput.resize(3);
+    GetRandBytes(mtx.joinSplitSig.data(), mtx.joinSplitSig.size());
+    GetRandBytes(mtx.bindingSig.data(), mtx.bindingSig.size());
+    CheckTransactionViewOf(mtx, "sapling");
+
+    // Coinbase, Overwinter
+    CMutableTransaction coinbase;
+    coinbase.fOverwintered = true;
+    coinbase.nVersion = OVERWINTER_TX_VERSION;
+    coinbase.nVersionGroupId = OVERWINTER_VERSION_GROUP_ID;
+    coinbase.vin.resize(1);
+    coinbase.vin[0].scriptSig = CScript() << OP_1;
+    coinbase.vout.resize(1);
+    coinbase.vout[0].nValue = 1;
+    CheckTransactionViewOf(coinbase, "coinbase");
+
+    // Blocks
+    CBlock block;
+    block.nVersion = 4;
+    block.nSolution.assign(1344, 0x5a);
+    block.vtx.push_back(coinbase);
+    block.vtx.push_back(mtx);
+    mtx.nLockTime = 1;
+    block.vtx.push_back(mtx);
+    block.hashMerkleRoot = block.BuildMerkleTree();
+    CDataStream ssBlock(SER_NETWORK, PROTOCOL_VERSION);
+    ssBlock << block;
+    const unsigned char* pblock = (const unsigned char*)ssBlock.data();
+
+    CBlockView blockView(pblock, pblock + ssBlock.size());
+    BOOST_CHECK(blockView.GetHash() == block.GetHash());
+    BOOST_CHECK_EQUAL(blockView.GetSerializeSize(), ssBlock.size());
+    bool mutated = true;
+    BOOST_CHECK(blockView.BuildMerkleRoot(&mutated) == block.hashMerkleRoot);
+    BOOST_CHECK(!mutated);
+    CDataStream ssCopy(SER_NETWORK, PROTOCOL_VERSION);
+    ssCopy << blockView.ToBlock();
+    BOOST_CHECK(ssCopy.str() == ssBlock.str());
+
+    // Repeating the last transaction keeps the header and merkle root, but is
+    // detected as a mutation
+    block.vtx.push_back(block.vtx.back());
+    BOOST_CHECK(block.BuildMerkleTree() == block.hashMerkleRoot);
+    ssBlock.clear();
+    ssBlock << block;
+    pblock = (const unsigned char*)ssBlock.data();
+    CBlockView mutatedView(pblock, pblock + ssBlock.size());
+    BOOST_CHECK(mutatedView.GetHash() == blockView.GetHash());
+    BOOST_CHECK(mutatedView.BuildMerkleRoot(&mutated) == block.hashMerkleRoot);
+    BOOST_CHECK(mutated);
+}
+
+BOOST_AUTO_TEST_CASE(transaction_cached_size)
+{
+    CBlock block;
+    UniValue tests = read_json(std::string(json_tests::tx_valid, json_tests::tx_valid + sizeof(json_tests::tx_valid)));
+    for (size_t idx = 0; idx < tests.size(); idx++) {
+        UniValue test = tests[idx];
+        if (!test[0].isArray())
+            continue;
+        std::string strTest = test.write();
+        std::vector<unsigned char> data = ParseHex(test[1].get_str());
+
+        // Deserializing hashes the bytes as they are read
+        CDataStream stream(data, SER_NETWORK, PROTOCOL_VERSION);
+        CTransaction tx;
+        stream >> tx;
+        BOOST_CHECK_EQUAL(tx.GetTotalSize(), data.size());
+        BOOST_CHECK_MESSAGE(tx.GetHash() == CMutableTransaction(tx).GetHash(), strTest);
+
+        CDataStream stream2(data, SER_NETWORK, PROTOCOL_VERSION);
+        CTransaction tx2(deserialize, stream2);
+        BOOST_CHECK(tx2.GetHash() == tx.GetHash());
+        BOOST_CHECK_EQUAL(tx2.GetTotalSize(), data.size());
+
+        // Conversion and assignment
+        CTransaction tx3;
+        tx3 = CTransaction(CMutableTransaction(tx));
+        BOOST_CHECK(tx3.GetHash() == tx.GetHash());
+        BOOST_CHECK_EQUAL(tx3.GetTotalSize(), data.size());
+
+        block.vtx.push_back(tx);
+    }
+    BOOST_CHECK_EQUAL(CTransaction().GetTotalSize(), ::GetSerializeSize(CTransaction(), SER_NETWORK, PROTOCOL_VERSION));
+    BOOST_CHECK_EQUAL(block.GetTotalSize(), ::GetSerializeSize(block, SER_NETWORK, PROTOCOL_VERSION));
+}
+
 BOOST_AUTO_TEST_CASE(test_IsStandard)
 {
     LOCK(cs_main);
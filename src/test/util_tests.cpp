@@ -65,6 +65,24 @@ BOOST_AUTO_TEST_CASE(util_ParseHex)
     BOOST_CHECK(result.size() == 2 && result[0] == 0x12 && result[1] == 0x34);
 }
 
+BOOST_AUTO_TEST_CASE(util_TryParseHex)
+{
+    std::vector<unsigned char> result;
+    std::vector<unsigned char> expected(ParseHex_expected, ParseHex_expected + sizeof(ParseHex_expected));
+    BOOST_CHECK(TryParseHex("04678afdb0fe5548271967f1a67130b7105cd6a828e03909a67962e0ea1f61deb649f6bc3f4cef38c4f35504e51ec112de5c384df7ba0b8d578a4c702b6bf11d5f", result));
+    BOOST_CHECK_EQUAL_COLLECTIONS(result.begin(), result.end(), expected.begin(), expected.end());
+
+    BOOST_CHECK(TryParseHex("00FfaB", result));
+    BOOST_CHECK(result.size() == 3 && result[0] == 0x00 && result[1] == 0xff && result[2] == 0xab);
+
+    // Only what IsHex accepts is decoded
+    BOOST_CHECK(!TryParseHex("", result));
+    BOOST_CHECK(!TryParseHex("123", result));
+    BOOST_CHECK(!TryParseHex("12 34", result));
+    BOOST_CHECK(!TryParseHex("12g4", result));
+    BOOST_CHECK(!TryParseHex(std::string("12\0\x34", 4), result));
+}
+
 BOOST_AUTO_TEST_CASE(util_HexStr)
 {
     BOOST_CHECK_EQUAL(
@@ -86,6 +104,44 @@ BOOST_AUTO_TEST_CASE(util_HexStr)
         "04 67 8a fd b0");
 }
 
+BOOST_AUTO_TEST_CASE(util_hex_kernels)
+{
+    // Each set of kernels the CPU supports gives the same results as the
+    // scalar code, for every length and wherever a bad character is
+    EncodingISA isaDetected = EncodingISALevel();
+    std::vector<unsigned char> data(200);
+    for (size_t i = 0; i < data.size(); i++)
+        data[i] = insecure_rand();
+    std::string strHex = HexStr(data.begin(), data.end());
+    std::string strMixed = strHex;
+    for (size_t i = 0; i < strMixed.size(); i += 3)
+        strMixed[i] = toupper(strMixed[i]);
+
+    for (int isa = ENCODING_ISA_SCALAR; isa <= isaDetected; isa++) {
+        EncodingISALevel() = (EncodingISA)isa;
+        for (size_t n = 0; n <= data.size(); n++) {
+            std::string str = HexStr(data.begin(), data.begin() + n);
+            BOOST_CHECK_EQUAL(str, strHex.substr(0, 2 * n));
+            std::vector<unsigned char> result;
+            BOOST_CHECK_EQUAL(TryParseHex(strMixed.substr(0, 2 * n), result), n > 0);
+            BOOST_CHECK(ParseHex(strMixed.substr(0, 2 * n)) == result);
+            BOOST_CHECK(result == std::vector<unsigned char>(data.begin(), data.begin() + n));
+
+            // Decoding stops at the bad character
+            if (n == 0)
+                continue;
+            str = strMixed.substr(0, 2 * n);
+            str[insecure_rand() % str.size()] = (insecure_rand() % 2) ? 'g' : '\xb0';
+            BOOST_CHECK(!TryParseHex(str, result));
+            EncodingISALevel() = ENCODING_ISA_SCALAR;
+            std::vector<unsigned char> expected = ParseHex(str);
+            EncodingISALevel() = (EncodingISA)isa;
+            BOOST_CHECK(ParseHex(str) == expected);
+        }
+    }
+    EncodingISALevel() = isaDetected;
+}
+
 
 BOOST_AUTO_TEST_CASE(util_DateTimeStrFormat)
 {
@@ -5,6 +5,7 @@
 
 #include "txdb.h"
 
+#include "blockfilter.h"
 #include "chainparams.h"
 #include "hash.h"
 #include "main.h"
@@ -35,6 +36,8 @@ static const char DB_FLAG = 'F';
 static const char DB_REINDEX_FLAG = 'R';
 static const char DB_LAST_BLOCK = 'l';
 
+static const char DB_BLOCK_FILTER = 'g';
+
 
 CCoinsViewDB::CCoinsViewDB(std::string dbName, size_t nCacheSize, bool fMemory, bool fWipe) : db(GetDataDir() / dbName, nCacheSize, fMemory, fWipe) {
 }
@@ -357,3 +360,22 @@ bool CBlockTreeDB::LoadBlockIndexGuts()
 
     return true;
 }
+
+CBlockFilterDB::CBlockFilterDB(size_t nCacheSize, bool fMemory, bool fWipe) : CDBWrapper(GetDataDir() / "blocks" / "filter", nCacheSize, fMemory, fWipe) {
+}
+
+bool CBlockFilterDB::WriteFilter(const BlockFilter& filter) {
+    return Write(make_pair(DB_BLOCK_FILTER, filter.GetBlockHash()), filter.GetEncoded());
+}
+
+bool CBlockFilterDB::ReadFilter(const uint256& hashBlock, BlockFilter& filter) const {
+    std::vector<unsigned char> vchEncoded;
+    if (!Read(make_pair(DB_BLOCK_FILTER, hashBlock), vchEncoded))
+        return false;
+    try {
+        filter = BlockFilter(hashBlock, vchEncoded);
+    } catch (const std::exception& e) {
+        return error("%s: invalid filter for block %s: %s", __func__, hashBlock.ToString(), e.what());
+    }
+    return true;
+}
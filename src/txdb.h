@@ -14,6 +14,7 @@
 #include <utility>
 #include <vector>
 
+class BlockFilter;
 class CBlockFileInfo;
 class CBlockIndex;
 struct CDiskTxPos;
@@ -75,4 +76,17 @@ public:
     bool LoadBlockIndexGuts();
 };
 
+/** Access to the block filter database (blocks/filter/) */
+class CBlockFilterDB : public CDBWrapper
+{
+public:
+    CBlockFilterDB(size_t nCacheSize, bool fMemory = false, bool fWipe = false);
+private:
+    CBlockFilterDB(const CBlockFilterDB&);
+    void operator=(const CBlockFilterDB&);
+public:
+    bool WriteFilter(const BlockFilter& filter);
+    bool ReadFilter(const uint256& hashBlock, BlockFilter& filter) const;
+};
+
 #endif // BITCOIN_TXDB_H
@@ -13,6 +13,12 @@
 #include <iomanip>
 #include <limits>
 
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <cpuid.h>
+#include <immintrin.h>
+#define ENABLE_ENCODING_SIMD
+#endif
+
 using namespace std;
 
 static const string CHARS_ALPHA_NUM = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789";
@@ -87,6 +93,305 @@ signed char HexDigit(char c)
     return p_util_hexdigit[(unsigned char)c];
 }
 
+static EncodingISA DetectEncodingISA()
+{
+#ifdef ENABLE_ENCODING_SIMD
+    // SSSE3 is CPUID leaf 1, ECX bit 9
+    unsigned int eax, ebx, ecx, edx;
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx) || !(ecx & (1u << 9)))
+        return ENCODING_ISA_SCALAR;
+    // AVX2 is leaf 7, EBX bit 5, and also needs the OS to save the YMM
+    // registers: OSXSAVE and AVX (ECX bits 27 and 28), and XCR0 bits 1 and 2
+    if ((ecx & (1u << 27)) && (ecx & (1u << 28)) && __get_cpuid_max(0, NULL) >= 7) {
+        unsigned int xcr0, xcr0_hi;
+        __asm__("xgetbv" : "=a"(xcr0), "=d"(xcr0_hi) : "c"(0));
+        __cpuid_count(7, 0, eax, ebx, ecx, edx);
+        if ((xcr0 & 6) == 6 && (ebx & (1u << 5)))
+            return ENCODING_ISA_AVX2;
+    }
+    return ENCODING_ISA_SSSE3;
+#else
+    return ENCODING_ISA_SCALAR;
+#endif
+}
+
+EncodingISA& EncodingISALevel()
+{
+    static EncodingISA level = DetectEncodingISA();
+    return level;
+}
+
+#ifdef ENABLE_ENCODING_SIMD
+// Each kernel handles whole blocks from the start of its input and returns
+// how much it consumed; the callers finish the rest with the scalar code.
+
+__attribute__((target("ssse3")))
+static size_t WriteHexSSSE3(const unsigned char* pch, size_t len, char* psz)
+{
+    const __m128i digits = _mm_setr_epi8('0', '1', '2', '3', '4', '5', '6', '7',
+                                         '8', '9', 'a', 'b', 'c', 'd', 'e', 'f');
+    const __m128i mask = _mm_set1_epi8(0x0f);
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(pch + i));
+        __m128i hi = _mm_shuffle_epi8(digits, _mm_and_si128(_mm_srli_epi16(v, 4), mask));
+        __m128i lo = _mm_shuffle_epi8(digits, _mm_and_si128(v, mask));
+        _mm_storeu_si128((__m128i*)(psz + 2 * i), _mm_unpacklo_epi8(hi, lo));
+        _mm_storeu_si128((__m128i*)(psz + 2 * i + 16), _mm_unpackhi_epi8(hi, lo));
+    }
+    return i;
+}
+
+__attribute__((target("avx2")))
+static size_t WriteHexAVX2(const unsigned char* pch, size_t len, char* psz)
+{
+    const __m256i digits = _mm256_setr_epi8('0', '1', '2', '3', '4', '5', '6', '7',
+                                            '8', '9', 'a', 'b', 'c', 'd', 'e', 'f',
+                                            '0', '1', '2', '3', '4', '5', '6', '7',
+                                            '8', '9', 'a', 'b', 'c', 'd', 'e', 'f');
+    const __m256i mask = _mm256_set1_epi8(0x0f);
+    size_t i = 0;
+    for (; i + 32 <= len; i += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(pch + i));
+        __m256i hi = _mm256_shuffle_epi8(digits, _mm256_and_si256(_mm256_srli_epi16(v, 4), mask));
+        __m256i lo = _mm256_shuffle_epi8(digits, _mm256_and_si256(v, mask));
+        // Unpacking works within each 128-bit lane, so these hold the
+        // digits of bytes 0-7 and 16-23, and of bytes 8-15 and 24-31
+        __m256i a = _mm256_unpacklo_epi8(hi, lo);
+        __m256i b = _mm256_unpackhi_epi8(hi, lo);
+        _mm256_storeu_si256((__m256i*)(psz + 2 * i), _mm256_permute2x128_si256(a, b, 0x20));
+        _mm256_storeu_si256((__m256i*)(psz + 2 * i + 32), _mm256_permute2x128_si256(a, b, 0x31));
+    }
+    return i;
+}
+
+/** Sets v to the values of the 16 hex digits in c, unless c holds anything else. */
+__attribute__((target("ssse3")))
+static inline bool HexDigitsSSSE3(__m128i c, __m128i& v)
+{
+    // Setting bit 5 lowers the case of letters, and leaves digits as they are.
+    // Signed comparisons also rule out characters from 0x80 on.
+    __m128i l = _mm_or_si128(c, _mm_set1_epi8(0x20));
+    __m128i digit = _mm_and_si128(_mm_cmpgt_epi8(c, _mm_set1_epi8('0' - 1)), _mm_cmpgt_epi8(_mm_set1_epi8('9' + 1), c));
+    __m128i alpha = _mm_and_si128(_mm_cmpgt_epi8(l, _mm_set1_epi8('a' - 1)), _mm_cmpgt_epi8(_mm_set1_epi8('f' + 1), l));
+    if (_mm_movemask_epi8(_mm_or_si128(digit, alpha)) != 0xffff)
+        return false;
+    __m128i offset = _mm_or_si128(_mm_and_si128(digit, _mm_set1_epi8('0')), _mm_andnot_si128(digit, _mm_set1_epi8('a' - 10)));
+    v = _mm_sub_epi8(l, offset);
+    return true;
+}
+
+__attribute__((target("ssse3")))
+static size_t ParseHexSSSE3(const unsigned char* psz, size_t nLen, unsigned char* pch)
+{
+    // Each pair of digits makes a byte, the first one being the high nibble
+    const __m128i weights = _mm_set1_epi16(0x0110);
+    size_t n = 0;
+    for (; 2 * n + 32 <= nLen; n += 16) {
+        __m128i a, b;
+        if (!HexDigitsSSSE3(_mm_loadu_si128((const __m128i*)(psz + 2 * n)), a) ||
+            !HexDigitsSSSE3(_mm_loadu_si128((const __m128i*)(psz + 2 * n + 16)), b))
+            break;
+        _mm_storeu_si128((__m128i*)(pch + n), _mm_packus_epi16(_mm_maddubs_epi16(a, weights), _mm_maddubs_epi16(b, weights)));
+    }
+    return n;
+}
+
+__attribute__((target("avx2")))
+static inline bool HexDigitsAVX2(__m256i c, __m256i& v)
+{
+    __m256i l = _mm256_or_si256(c, _mm256_set1_epi8(0x20));
+    __m256i digit = _mm256_and_si256(_mm256_cmpgt_epi8(c, _mm256_set1_epi8('0' - 1)), _mm256_cmpgt_epi8(_mm256_set1_epi8('9' + 1), c));
+    __m256i alpha = _mm256_and_si256(_mm256_cmpgt_epi8(l, _mm256_set1_epi8('a' - 1)), _mm256_cmpgt_epi8(_mm256_set1_epi8('f' + 1), l));
+    if (_mm256_movemask_epi8(_mm256_or_si256(digit, alpha)) != -1)
+        return false;
+    __m256i offset = _mm256_or_si256(_mm256_and_si256(digit, _mm256_set1_epi8('0')), _mm256_andnot_si256(digit, _mm256_set1_epi8('a' - 10)));
+    v = _mm256_sub_epi8(l, offset);
+    return true;
+}
+
+__attribute__((target("avx2")))
+static size_t ParseHexAVX2(const unsigned char* psz, size_t nLen, unsigned char* pch)
+{
+    const __m256i weights = _mm256_set1_epi16(0x0110);
+    size_t n = 0;
+    for (; 2 * n + 64 <= nLen; n += 32) {
+        __m256i a, b;
+        if (!HexDigitsAVX2(_mm256_loadu_si256((const __m256i*)(psz + 2 * n)), a) ||
+            !HexDigitsAVX2(_mm256_loadu_si256((const __m256i*)(psz + 2 * n + 32)), b))
+            break;
+        // Packing works within each 128-bit lane; put the quarters back in order
+        __m256i packed = _mm256_packus_epi16(_mm256_maddubs_epi16(a, weights), _mm256_maddubs_epi16(b, weights));
+        _mm256_storeu_si256((__m256i*)(pch + n), _mm256_permute4x64_epi64(packed, 0xd8));
+    }
+    return n;
+}
+
+// Base64 kernels after Wojciech Mula's SIMD base64 encoding and decoding
+
+__attribute__((target("ssse3")))
+static size_t EncodeBase64SSSE3(const unsigned char* pch, size_t len, char* psz)
+{
+    // Offsets from the values in each range to their characters, indexed
+    // by 0 for A-Z, 13 for a-z, and 1 to 12 for the values from 52 on
+    const __m128i offsets = _mm_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                                          '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62,
+                                          '/' - 63, 'A', 0, 0);
+    size_t i = 0;
+    // Twelve bytes make sixteen characters, but sixteen are read
+    for (; i + 16 <= len; i += 12) {
+        __m128i in = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(pch + i)),
+                                      _mm_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1));
+        // Move each 6-bit value of a group of three bytes into its own byte
+        __m128i t0 = _mm_mulhi_epu16(_mm_and_si128(in, _mm_set1_epi32(0x0fc0fc00)), _mm_set1_epi32(0x04000040));
+        __m128i t1 = _mm_mullo_epi16(_mm_and_si128(in, _mm_set1_epi32(0x003f03f0)), _mm_set1_epi32(0x01000010));
+        __m128i v = _mm_or_si128(t0, t1);
+        __m128i range = _mm_subs_epu8(v, _mm_set1_epi8(51));
+        range = _mm_or_si128(range, _mm_and_si128(_mm_cmpgt_epi8(_mm_set1_epi8(26), v), _mm_set1_epi8(13)));
+        _mm_storeu_si128((__m128i*)(psz + i / 3 * 4), _mm_add_epi8(v, _mm_shuffle_epi8(offsets, range)));
+    }
+    return i;
+}
+
+__attribute__((target("avx2")))
+static size_t EncodeBase64AVX2(const unsigned char* pch, size_t len, char* psz)
+{
+    const __m256i offsets = _mm256_broadcastsi128_si256(
+        _mm_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                      '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62,
+                      '/' - 63, 'A', 0, 0));
+    const __m256i shuffle = _mm256_broadcastsi128_si256(
+        _mm_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1));
+    size_t i = 0;
+    // Each lane encodes twelve bytes, as the SSSE3 kernel does
+    for (; i + 28 <= len; i += 24) {
+        __m256i in = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i*)(pch + i))),
+                                             _mm_loadu_si128((const __m128i*)(pch + i + 12)), 1);
+        in = _mm256_shuffle_epi8(in, shuffle);
+        __m256i t0 = _mm256_mulhi_epu16(_mm256_and_si256(in, _mm256_set1_epi32(0x0fc0fc00)), _mm256_set1_epi32(0x04000040));
+        __m256i t1 = _mm256_mullo_epi16(_mm256_and_si256(in, _mm256_set1_epi32(0x003f03f0)), _mm256_set1_epi32(0x01000010));
+        __m256i v = _mm256_or_si256(t0, t1);
+        __m256i range = _mm256_subs_epu8(v, _mm256_set1_epi8(51));
+        range = _mm256_or_si256(range, _mm256_and_si256(_mm256_cmpgt_epi8(_mm256_set1_epi8(26), v), _mm256_set1_epi8(13)));
+        _mm256_storeu_si256((__m256i*)(psz + i / 3 * 4), _mm256_add_epi8(v, _mm256_shuffle_epi8(offsets, range)));
+    }
+    return i;
+}
+
+/** Sets v to the values of the 16 base64 characters in c, unless c holds anything else. */
+__attribute__((target("ssse3")))
+static inline bool Base64ValuesSSSE3(__m128i c, __m128i& v)
+{
+    __m128i upper = _mm_and_si128(_mm_cmpgt_epi8(c, _mm_set1_epi8('A' - 1)), _mm_cmpgt_epi8(_mm_set1_epi8('Z' + 1), c));
+    __m128i lower = _mm_and_si128(_mm_cmpgt_epi8(c, _mm_set1_epi8('a' - 1)), _mm_cmpgt_epi8(_mm_set1_epi8('z' + 1), c));
+    __m128i digit = _mm_and_si128(_mm_cmpgt_epi8(c, _mm_set1_epi8('0' - 1)), _mm_cmpgt_epi8(_mm_set1_epi8('9' + 1), c));
+    __m128i plus = _mm_cmpeq_epi8(c, _mm_set1_epi8('+'));
+    __m128i slash = _mm_cmpeq_epi8(c, _mm_set1_epi8('/'));
+    if (_mm_movemask_epi8(_mm_or_si128(_mm_or_si128(upper, lower), _mm_or_si128(_mm_or_si128(digit, plus), slash))) != 0xffff)
+        return false;
+    __m128i offset = _mm_or_si128(_mm_or_si128(_mm_and_si128(upper, _mm_set1_epi8(-'A')), _mm_and_si128(lower, _mm_set1_epi8(26 - 'a'))),
+                                  _mm_or_si128(_mm_and_si128(digit, _mm_set1_epi8(52 - '0')),
+                                               _mm_or_si128(_mm_and_si128(plus, _mm_set1_epi8(62 - '+')), _mm_and_si128(slash, _mm_set1_epi8(63 - '/')))));
+    v = _mm_add_epi8(c, offset);
+    return true;
+}
+
+__attribute__((target("ssse3")))
+static size_t DecodeBase64SSSE3(const unsigned char* psz, size_t nLen, unsigned char* pch)
+{
+    // Byte order of the three bytes each group of four values makes
+    const __m128i order = _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+    size_t i = 0;
+    for (; i + 16 <= nLen; i += 16) {
+        __m128i v;
+        if (!Base64ValuesSSSE3(_mm_loadu_si128((const __m128i*)(psz + i)), v))
+            break;
+        // Merge the values in pairs into 12 bits, then into 24
+        v = _mm_madd_epi16(_mm_maddubs_epi16(v, _mm_set1_epi32(0x01400140)), _mm_set1_epi32(0x00011000));
+        v = _mm_shuffle_epi8(v, order);
+        unsigned char* out = pch + i / 4 * 3;
+        _mm_storel_epi64((__m128i*)out, v);
+        uint32_t nLast = _mm_cvtsi128_si32(_mm_srli_si128(v, 8));
+        memcpy(out + 8, &nLast, 4);
+    }
+    return i;
+}
+
+__attribute__((target("avx2")))
+static inline bool Base64ValuesAVX2(__m256i c, __m256i& v)
+{
+    __m256i upper = _mm256_and_si256(_mm256_cmpgt_epi8(c, _mm256_set1_epi8('A' - 1)), _mm256_cmpgt_epi8(_mm256_set1_epi8('Z' + 1), c));
+    __m256i lower = _mm256_and_si256(_mm256_cmpgt_epi8(c, _mm256_set1_epi8('a' - 1)), _mm256_cmpgt_epi8(_mm256_set1_epi8('z' + 1), c));
+    __m256i digit = _mm256_and_si256(_mm256_cmpgt_epi8(c, _mm256_set1_epi8('0' - 1)), _mm256_cmpgt_epi8(_mm256_set1_epi8('9' + 1), c));
+    __m256i plus = _mm256_cmpeq_epi8(c, _mm256_set1_epi8('+'));
+    __m256i slash = _mm256_cmpeq_epi8(c, _mm256_set1_epi8('/'));
+    if (_mm256_movemask_epi8(_mm256_or_si256(_mm256_or_si256(upper, lower), _mm256_or_si256(_mm256_or_si256(digit, plus), slash))) != -1)
+        return false;
+    __m256i offset = _mm256_or_si256(_mm256_or_si256(_mm256_and_si256(upper, _mm256_set1_epi8(-'A')), _mm256_and_si256(lower, _mm256_set1_epi8(26 - 'a'))),
+                                     _mm256_or_si256(_mm256_and_si256(digit, _mm256_set1_epi8(52 - '0')),
+                                                     _mm256_or_si256(_mm256_and_si256(plus, _mm256_set1_epi8(62 - '+')), _mm256_and_si256(slash, _mm256_set1_epi8(63 - '/')))));
+    v = _mm256_add_epi8(c, offset);
+    return true;
+}
+
+__attribute__((target("avx2")))
+static size_t DecodeBase64AVX2(const unsigned char* psz, size_t nLen, unsigned char* pch)
+{
+    const __m256i order = _mm256_broadcastsi128_si256(
+        _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+    // Moves the twelve bytes of the second lane up against those of the first
+    const __m256i gather = _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 3, 7);
+    size_t i = 0;
+    for (; i + 32 <= nLen; i += 32) {
+        __m256i v;
+        if (!Base64ValuesAVX2(_mm256_loadu_si256((const __m256i*)(psz + i)), v))
+            break;
+        v = _mm256_madd_epi16(_mm256_maddubs_epi16(v, _mm256_set1_epi32(0x01400140)), _mm256_set1_epi32(0x00011000));
+        v = _mm256_permutevar8x32_epi32(_mm256_shuffle_epi8(v, order), gather);
+        unsigned char* out = pch + i / 4 * 3;
+        _mm_storeu_si128((__m128i*)out, _mm256_castsi256_si128(v));
+        _mm_storel_epi64((__m128i*)(out + 16), _mm256_extracti128_si256(v, 1));
+    }
+    return i;
+}
+#endif // ENABLE_ENCODING_SIMD
+
+void WriteHex(const unsigned char* pch, size_t len, char* psz)
+{
+    static const char hexmap[16] = { '0', '1', '2', '3', '4', '5', '6', '7',
+                                     '8', '9', 'a', 'b', 'c', 'd', 'e', 'f' };
+    size_t i = 0;
+#ifdef ENABLE_ENCODING_SIMD
+    EncodingISA isa = EncodingISALevel();
+    if (isa >= ENCODING_ISA_AVX2)
+        i = WriteHexAVX2(pch, len, psz);
+    if (isa >= ENCODING_ISA_SSSE3)
+        i += WriteHexSSSE3(pch + i, len - i, psz + 2 * i);
+#endif
+    for (; i < len; i++) {
+        psz[2 * i] = hexmap[pch[i] >> 4];
+        psz[2 * i + 1] = hexmap[pch[i] & 15];
+    }
+}
+
+/**
+ * Decodes whole blocks of hex digits from the start of the nLen characters
+ * at psz, up to the first block that holds anything else, and returns the
+ * number of bytes written to pch.
+ */
+static size_t ParseHexBlocks(const unsigned char* psz, size_t nLen, unsigned char* pch)
+{
+    size_t n = 0;
+#ifdef ENABLE_ENCODING_SIMD
+    EncodingISA isa = EncodingISALevel();
+    if (isa >= ENCODING_ISA_AVX2)
+        n = ParseHexAVX2(psz, nLen, pch);
+    if (isa >= ENCODING_ISA_SSSE3)
+        n += ParseHexSSSE3(psz + 2 * n, nLen - 2 * n, pch + n);
+#endif
+    return n;
+}
+
 bool IsHex(const string& str)
 {
     for(std::string::const_iterator it(str.begin()); it != str.end(); ++it)
@@ -97,40 +402,95 @@ bool IsHex(const string& str)
     return (str.size() > 0) && (str.size()%2 == 0);
 }
 
-vector<unsigned char> ParseHex(const char* psz)
+/**
+ * Decodes the hex dump in the nLen characters at psz, which must be followed
+ * by a NUL. The result is written into a vector sized for the whole input,
+ * which is then cut down to what was decoded.
+ */
+static vector<unsigned char> ParseHex(const char* psz, size_t nLen)
 {
-    // convert hex dump to vector
-    vector<unsigned char> vch;
+    vector<unsigned char> vch(nLen / 2);
+    size_t n = ParseHexBlocks((const unsigned char*)psz, nLen, vch.data());
+    psz += 2 * n;
     while (true)
     {
-        while (isspace(*psz))
+        signed char c = HexDigit(*psz);
+        if (c == (signed char)-1) {
+            // Whitespace is allowed between bytes
+            if (!isspace((unsigned char)*psz))
+                break;
             psz++;
-        signed char c = HexDigit(*psz++);
-        if (c == (signed char)-1)
-            break;
-        unsigned char n = (c << 4);
-        c = HexDigit(*psz++);
-        if (c == (signed char)-1)
+            continue;
+        }
+        signed char c2 = HexDigit(psz[1]);
+        if (c2 == (signed char)-1)
             break;
-        n |= c;
-        vch.push_back(n);
+        vch[n++] = (c << 4) | c2;
+        psz += 2;
     }
+    vch.resize(n);
     return vch;
 }
 
+vector<unsigned char> ParseHex(const char* psz)
+{
+    return ParseHex(psz, strlen(psz));
+}
+
 vector<unsigned char> ParseHex(const string& str)
 {
-    return ParseHex(str.c_str());
+    return ParseHex(str.c_str(), str.size());
+}
+
+bool TryParseHex(const string& str, vector<unsigned char>& vch)
+{
+    if (str.empty() || str.size() % 2 != 0)
+        return false;
+    vch.resize(str.size() / 2);
+    size_t n = ParseHexBlocks((const unsigned char*)str.data(), str.size(), vch.data());
+    const unsigned char* p = (const unsigned char*)str.data() + 2 * n;
+    for (size_t i = n; i < vch.size(); i++, p += 2) {
+        signed char c = p_util_hexdigit[p[0]];
+        signed char c2 = p_util_hexdigit[p[1]];
+        if ((c | c2) < 0)
+            return false;
+        vch[i] = (c << 4) | c2;
+    }
+    return true;
 }
 
 string EncodeBase64(const unsigned char* pch, size_t len)
 {
     static const char *pbase64 = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
 
-    std::string str;
-    str.reserve(((len + 2) / 3) * 4);
-    ConvertBits<8, 6, true>([&](int v) { str += pbase64[v]; }, pch, pch + len);
-    while (str.size() % 4) str += '=';
+    // Encode three bytes into four characters at a time, into a string of
+    // the final size that is already padded
+    std::string str(((len + 2) / 3) * 4, '=');
+    size_t i = 0;
+#ifdef ENABLE_ENCODING_SIMD
+    EncodingISA isa = EncodingISALevel();
+    if (isa >= ENCODING_ISA_AVX2)
+        i = EncodeBase64AVX2(pch, len, &str[0]);
+    if (isa >= ENCODING_ISA_SSSE3)
+        i += EncodeBase64SSSE3(pch + i, len - i, &str[i / 3 * 4]);
+#endif
+    size_t j = i / 3 * 4;
+    for (; i + 3 <= len; i += 3, j += 4) {
+        uint32_t v = (pch[i] << 16) | (pch[i + 1] << 8) | pch[i + 2];
+        str[j] = pbase64[v >> 18];
+        str[j + 1] = pbase64[(v >> 12) & 63];
+        str[j + 2] = pbase64[(v >> 6) & 63];
+        str[j + 3] = pbase64[v & 63];
+    }
+    if (i < len) {
+        uint32_t v = pch[i] << 16;
+        if (i + 1 < len)
+            v |= pch[i + 1] << 8;
+        str[j] = pbase64[v >> 18];
+        str[j + 1] = pbase64[(v >> 12) & 63];
+        if (i + 1 < len)
+            str[j + 2] = pbase64[(v >> 6) & 63];
+    }
     return str;
 }
 
@@ -158,19 +518,52 @@ vector<unsigned char> DecodeBase64(const char* p, bool* pfInvalid)
         -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1
     };
 
+    // The kernels decode whole blocks from the start of the string, up to the
+    // first block holding anything but base64 characters, into a buffer large
+    // enough for all of it
     const char* e = p;
-    std::vector<uint8_t> val;
-    val.reserve(strlen(p));
-    while (*p != 0) {
-        int x = decode64_table[(unsigned char)*p];
-        if (x == -1) break;
-        val.push_back(x);
+    size_t nLen = strlen(p);
+    std::vector<unsigned char> ret((nLen / 4) * 3 + 2);
+    size_t nBlockChars = 0;
+#ifdef ENABLE_ENCODING_SIMD
+    EncodingISA isa = EncodingISALevel();
+    if (isa >= ENCODING_ISA_AVX2)
+        nBlockChars = DecodeBase64AVX2((const unsigned char*)e, nLen, ret.data());
+    if (isa >= ENCODING_ISA_SSSE3)
+        nBlockChars += DecodeBase64SSSE3((const unsigned char*)e + nBlockChars, nLen - nBlockChars, ret.data() + nBlockChars / 4 * 3);
+#endif
+
+    // Find the rest of the run of base64 characters; NUL isn't one of them
+    p += nBlockChars;
+    while (decode64_table[(unsigned char)*p] != -1)
         ++p;
+    size_t nChars = p - e;
+    size_t nRemainder = nChars % 4;
+
+    // Decode four characters into three bytes at a time. The one or two
+    // bytes of a partial group must not leave any bits over, and a single
+    // character doesn't make a byte.
+    ret.resize((nChars / 4) * 3 + (nRemainder > 1 ? nRemainder - 1 : 0));
+    const unsigned char* q4 = (const unsigned char*)e + nBlockChars;
+    size_t j = nBlockChars / 4 * 3;
+    for (size_t i = nBlockChars / 4; i < nChars / 4; i++, q4 += 4, j += 3) {
+        uint32_t v = (decode64_table[q4[0]] << 18) | (decode64_table[q4[1]] << 12) |
+                     (decode64_table[q4[2]] << 6) | decode64_table[q4[3]];
+        ret[j] = v >> 16;
+        ret[j + 1] = (v >> 8) & 255;
+        ret[j + 2] = v & 255;
+    }
+    bool valid = nRemainder != 1;
+    if (nRemainder == 2) {
+        uint32_t v = (decode64_table[q4[0]] << 6) | decode64_table[q4[1]];
+        ret[j] = v >> 4;
+        valid = (v & 15) == 0;
+    } else if (nRemainder == 3) {
+        uint32_t v = (decode64_table[q4[0]] << 12) | (decode64_table[q4[1]] << 6) | decode64_table[q4[2]];
+        ret[j] = v >> 10;
+        ret[j + 1] = (v >> 2) & 255;
+        valid = (v & 3) == 0;
     }
-
-    std::vector<unsigned char> ret;
-    ret.reserve((val.size() * 3) / 4);
-    bool valid = ConvertBits<6, 8, false>([&](unsigned char c) { ret.push_back(c); }, val.begin(), val.end());
 
     const char* q = p;
     while (valid && *p != 0) {
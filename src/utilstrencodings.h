@@ -44,6 +44,12 @@ std::vector<unsigned char> ParseHex(const char* psz);
 std::vector<unsigned char> ParseHex(const std::string& str);
 signed char HexDigit(char c);
 bool IsHex(const std::string& str);
+/**
+ * Decode a string of hex digits in one pass. Unlike ParseHex, whitespace is
+ * not skipped.
+ * @returns true if IsHex(str) holds, in which case vch holds the decoded bytes
+ */
+bool TryParseHex(const std::string& str, std::vector<unsigned char>& vch);
 std::vector<unsigned char> DecodeBase64(const char* p, bool* pfInvalid = NULL);
 std::string DecodeBase64(const std::string& str);
 std::string EncodeBase64(const unsigned char* pch, size_t len);
@@ -80,20 +86,53 @@ bool ParseInt64(const std::string& str, int64_t *out);
  */
 bool ParseDouble(const std::string& str, double *out);
 
+/**
+ * Instruction set extensions the hex and base64 codecs use. The level is
+ * set from CPU detection the first time it is read; tests lower it to check
+ * the kernels against each other.
+ */
+enum EncodingISA {
+    ENCODING_ISA_SCALAR,
+    ENCODING_ISA_SSSE3,
+    ENCODING_ISA_AVX2,
+};
+EncodingISA& EncodingISALevel();
+
+/** Writes the 2 * len hex digits of the bytes at pch to psz. */
+void WriteHex(const unsigned char* pch, size_t len, char* psz);
+
 template<typename T>
 std::string HexStr(const T itbegin, const T itend, bool fSpaces=false)
 {
-    std::string rv;
     static const char hexmap[16] = { '0', '1', '2', '3', '4', '5', '6', '7',
                                      '8', '9', 'a', 'b', 'c', 'd', 'e', 'f' };
-    rv.reserve((itend-itbegin)*3);
-    for(T it = itbegin; it < itend; ++it)
+    if (!(itbegin < itend))
+        return std::string();
+
+    if (!fSpaces) {
+        // Bytes are gathered into a buffer, whatever the iterator type, so
+        // that WriteHex can convert them a block at a time
+        std::string rv((itend - itbegin) * 2, ' ');
+        unsigned char buf[256];
+        size_t i = 0;
+        for (T it = itbegin; it < itend; ) {
+            size_t n = 0;
+            for (; n < sizeof(buf) && it < itend; ++it)
+                buf[n++] = (unsigned char)(*it);
+            WriteHex(buf, n, &rv[i]);
+            i += 2 * n;
+        }
+        return rv;
+    }
+
+    // Fill in a string of the final size, rather than append a character at a time
+    std::string rv((itend - itbegin) * 3 - 1, ' ');
+    size_t i = 0;
+    for(T it = itbegin; it < itend; ++it, i += 3)
     {
         unsigned char val = (unsigned char)(*it);
-        if(fSpaces && it != itbegin)
-            rv.push_back(' ');
-        rv.push_back(hexmap[val>>4]);
-        rv.push_back(hexmap[val&15]);
+        rv[i] = hexmap[val>>4];
+        rv[i + 1] = hexmap[val&15];
     }
 
     return rv;
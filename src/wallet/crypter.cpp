@@ -251,6 +251,19 @@ bool CCryptoKeyStore::AddKeyPubKey(const CKey& key, const CPubKey &pubkey)
 }
 
 
+bool CCryptoKeyStore::EncryptKey(const CKey& key, const CPubKey& pubkey, std::vector<unsigned char>& vchCryptedSecret) const
+{
+    CKeyingMaterial vMasterKeyCopy;
+    {
+        LOCK(cs_KeyStore);
+        if (!IsCrypted() || IsLocked())
+            return false;
+        vMasterKeyCopy = vMasterKey;
+    }
+    CKeyingMaterial vchSecret(key.begin(), key.end());
+    return EncryptSecret(vMasterKeyCopy, vchSecret, pubkey.GetHash(), vchCryptedSecret);
+}
+
 bool CCryptoKeyStore::AddCryptedKey(const CPubKey &vchPubKey, const std::vector<unsigned char> &vchCryptedSecret)
 {
     {
@@ -265,20 +278,24 @@ bool CCryptoKeyStore::AddCryptedKey(const CPubKey &vchPubKey, const std::vector<
 
 bool CCryptoKeyStore::GetKey(const CKeyID &address, CKey& keyOut) const
 {
+    CKeyingMaterial vMasterKeyCopy;
+    CPubKey vchPubKey;
+    std::vector<unsigned char> vchCryptedSecret;
     {
         LOCK(cs_KeyStore);
         if (!IsCrypted())
             return CBasicKeyStore::GetKey(address, keyOut);
 
         CryptedKeyMap::const_iterator mi = mapCryptedKeys.find(address);
-        if (mi != mapCryptedKeys.end())
-        {
-            const CPubKey &vchPubKey = (*mi).second.first;
-            const std::vector<unsigned char> &vchCryptedSecret = (*mi).second.second;
-            return DecryptKey(vMasterKey, vchCryptedSecret, vchPubKey, keyOut);
-        }
+        if (mi == mapCryptedKeys.end())
+            return false;
+        vMasterKeyCopy = vMasterKey;
+        vchPubKey = (*mi).second.first;
+        vchCryptedSecret = (*mi).second.second;
     }
-    return false;
+    // Decrypt (and check the key against its public key) without holding
+    // the lock, so that threads signing in parallel do not wait on each other
+    return DecryptKey(vMasterKeyCopy, vchCryptedSecret, vchPubKey, keyOut);
 }
 
 bool CCryptoKeyStore::GetPubKey(const CKeyID &address, CPubKey& vchPubKeyOut) const
@@ -147,6 +147,10 @@ protected:
 
     bool Unlock(const CKeyingMaterial& vMasterKeyIn);
 
+    //! Encrypts the secret of a key for AddCryptedKey. Like GetKey, this
+    //! encrypts outside cs_KeyStore, so it can run on many threads at once.
+    bool EncryptKey(const CKey& key, const CPubKey& pubkey, std::vector<unsigned char>& vchCryptedSecret) const;
+
 public:
     CCryptoKeyStore() : fUseCrypto(false), fDecryptionThoroughlyChecked(false)
     {
@@ -3,6 +3,7 @@
 #include <sodium.h>
 
 #include "base58.h"
+#include "blockfilter.h"
 #include "chainparams.h"
 #include "main.h"
 #include "primitives/block.h"
@@ -409,6 +410,52 @@ TEST(wallet_tests, FindMyNotesInEncryptedWallet) {
     EXPECT_EQ(nd, noteMap[jsoutpt]);
 }
 
+TEST(wallet_tests, BlockFilterQueryNeedsTransparentWallet) {
+    ECC_Start();
+
+    TestWallet wallet;
+    uint256 r {GetRandHash()};
+    CKeyingMaterial vMasterKey (r.begin(), r.end());
+    GCSFilter::ElementSet query;
+
+    CKey key;
+    key.MakeNewKey(true);
+    wallet.AddKeyPubKey(key, key.GetPubKey());
+    {
+        LOCK(wallet.cs_wallet);
+        EXPECT_TRUE(wallet.GetBlockFilterQuery(query));
+    }
+    EXPECT_EQ(1, query.count(BlockFilter::ScriptElement(GetScriptForDestination(key.GetPubKey().GetID()))));
+
+    // An encrypted wallet doesn't list its viewing keys as payment addresses
+    auto vk = libzcash::SproutSpendingKey::random().viewing_key();
+    wallet.AddViewingKey(vk);
+    ASSERT_TRUE(wallet.EncryptKeys(vMasterKey));
+    {
+        LOCK(wallet.cs_wallet);
+        EXPECT_FALSE(wallet.GetBlockFilterQuery(query));
+    }
+    wallet.RemoveViewingKey(vk);
+    {
+        LOCK(wallet.cs_wallet);
+        EXPECT_TRUE(wallet.GetBlockFilterQuery(query));
+    }
+
+    // Notes the wallet still holds have to be found by scanning
+    auto sk = libzcash::SproutSpendingKey::random();
+    auto wtx = GetValidReceive(sk, 10, true);
+    mapNoteData_t noteData;
+    noteData[JSOutPoint {wtx.GetHash(), 0, 1}] = CNoteData {sk.address()};
+    wtx.SetNoteData(noteData);
+    wallet.AddToWallet(wtx, true, NULL);
+    {
+        LOCK(wallet.cs_wallet);
+        EXPECT_FALSE(wallet.GetBlockFilterQuery(query));
+    }
+
+    ECC_Stop();
+}
+
 TEST(wallet_tests, get_conflicted_notes) {
     CWallet wallet;
 
@@ -1079,3 +1126,59 @@ TEST(wallet_tests, NoteLocking) {
     EXPECT_FALSE(wallet.IsLockedNote(jsoutpt));
     EXPECT_FALSE(wallet.IsLockedNote(jsoutpt2));
 }
+
+TEST(wallet_tests, KeyPoolBatches) {
+    ECC_Start();
+
+    SelectParams(CBaseChainParams::TESTNET);
+
+    bool fFirstRun;
+    CWallet wallet("wallet-keypool.dat");
+    ASSERT_EQ(DB_LOAD_OK, wallet.LoadWallet(fFirstRun));
+
+    // Fill the pool with more keys than fit in one batch
+    {
+        LOCK(wallet.cs_wallet);
+        ASSERT_TRUE(wallet.TopUpKeyPool(KEYPOOL_BATCH_SIZE + 10));
+    }
+    EXPECT_EQ(KEYPOOL_BATCH_SIZE + 11, wallet.GetKeyPoolSize());
+
+    // The keys and the pool were written to the database
+    CWallet wallet2("wallet-keypool.dat");
+    ASSERT_EQ(DB_LOAD_OK, wallet2.LoadWallet(fFirstRun));
+    EXPECT_EQ(KEYPOOL_BATCH_SIZE + 11, wallet2.GetKeyPoolSize());
+    {
+        LOCK(wallet2.cs_wallet);
+        int64_t nIndex;
+        CKeyPool keypool;
+        wallet2.ReserveKeyFromKeyPool(nIndex, keypool);
+        ASSERT_EQ(1, nIndex);
+        EXPECT_TRUE(wallet2.HaveKey(keypool.vchPubKey.GetID()));
+        wallet2.ReturnKey(nIndex);
+    }
+
+    // Encrypting the wallet replaces the pool with encrypted keys
+    SecureString strWalletPass;
+    strWalletPass.reserve(100);
+    strWalletPass = "hello";
+    ASSERT_TRUE(wallet.EncryptWallet(strWalletPass));
+    EXPECT_EQ(DEFAULT_KEYPOOL_SIZE, wallet.GetKeyPoolSize());
+
+    CWallet wallet3("wallet-keypool.dat");
+    ASSERT_EQ(DB_LOAD_OK, wallet3.LoadWallet(fFirstRun));
+    EXPECT_EQ(DEFAULT_KEYPOOL_SIZE, wallet3.GetKeyPoolSize());
+    ASSERT_TRUE(wallet3.Unlock(strWalletPass));
+    {
+        LOCK(wallet3.cs_wallet);
+        int64_t nIndex;
+        CKeyPool keypool;
+        wallet3.ReserveKeyFromKeyPool(nIndex, keypool);
+        ASSERT_NE(-1, nIndex);
+        CKey key;
+        ASSERT_TRUE(wallet3.GetKey(keypool.vchPubKey.GetID(), key));
+        EXPECT_EQ(keypool.vchPubKey, key.GetPubKey());
+        wallet3.ReturnKey(nIndex);
+    }
+
+    ECC_Stop();
+}
@@ -8,6 +8,7 @@
 #include "main.h"
 #include "script/script.h"
 #include "script/standard.h"
+#include "support/cleanse.h"
 #include "sync.h"
 #include "util.h"
 #include "utiltime.h"
@@ -17,7 +18,10 @@
 #include <stdint.h>
 
 #include <boost/algorithm/string.hpp>
+#include <boost/assign/list_of.hpp>
+#include <boost/bind.hpp>
 #include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/thread.hpp>
 
 #include <univalue.h>
 
@@ -460,86 +464,196 @@ UniValue dumpwallet(const UniValue& params, bool fHelp)
 	return dumpwallet_impl(params, fHelp, false);
 }
 
-UniValue dumpwallet_impl(const UniValue& params, bool fHelp, bool fDumpZKeys)
+//! Number of keys in a wallet dump that are formatted together
+static const size_t DUMP_CHUNK_SIZE = 1000;
+
+/** A transparent key copied out of the wallet by dumpwallet */
+struct CDumpKey
 {
-    LOCK2(cs_main, pwalletMain->cs_wallet);
+    CKey key;
+    CKeyID keyid;
+    int64_t nTime;
+    //! label=<label>, reserve=1 or change=1
+    std::string strKind;
+};
+
+/** A Sprout spending key copied out of the wallet by z_exportwallet */
+struct CDumpZKey
+{
+    libzcash::SproutSpendingKey key;
+    libzcash::SproutPaymentAddress addr;
+    int64_t nTime;
+};
 
-    EnsureWalletIsUnlocked();
+static std::string FormatDumpLine(const CDumpKey& entry)
+{
+    return strprintf("%s %s %s # addr=%s\n", EncodeSecret(entry.key), EncodeDumpTime(entry.nTime), entry.strKind, EncodeDestination(entry.keyid));
+}
 
-    boost::filesystem::path exportdir;
-    try {
-        exportdir = GetExportDir();
-    } catch (const std::runtime_error& e) {
-        throw JSONRPCError(RPC_INTERNAL_ERROR, e.what());
-    }
-    if (exportdir.empty()) {
-        throw JSONRPCError(RPC_WALLET_ERROR, "Cannot export wallet until the zcashd -exportdir option has been set");
-    }
-    std::string unclean = params[0].get_str();
-    std::string clean = SanitizeFilename(unclean);
-    if (clean.compare(unclean) != 0) {
-        throw JSONRPCError(RPC_WALLET_ERROR, strprintf("Filename is invalid as only alphanumeric characters are allowed.  Try '%s' instead.", clean));
-    }
-    boost::filesystem::path exportfilepath = exportdir / clean;
+static std::string FormatDumpLine(const CDumpZKey& entry)
+{
+    return strprintf("%s %s # zaddr=%s\n", EncodeSpendingKey(entry.key), EncodeDumpTime(entry.nTime), EncodePaymentAddress(entry.addr));
+}
 
-    if (boost::filesystem::exists(exportfilepath)) {
-        throw JSONRPCError(RPC_INVALID_PARAMETER, "Cannot overwrite existing file " + exportfilepath.string());
+/**
+ * Formats the entries on a pool of threads, DUMP_CHUNK_SIZE at a time, and
+ * writes each chunk to the file as soon as it and the ones before it are done.
+ */
+template <typename Entry>
+static void WriteDumpEntries(std::ofstream& file, const std::vector<Entry>& vEntries)
+{
+    size_t nChunks = (vEntries.size() + DUMP_CHUNK_SIZE - 1) / DUMP_CHUNK_SIZE;
+    if (nChunks == 0)
+        return;
+
+    std::vector<std::string> vChunks(nChunks);
+    std::vector<bool> vDone(nChunks, false);
+    size_t nNextChunk = 0;
+    boost::mutex cs;
+    boost::condition_variable cond;
+
+    auto worker = [&]() {
+        while (true) {
+            size_t nChunk;
+            {
+                boost::unique_lock<boost::mutex> lock(cs);
+                if (nNextChunk == nChunks)
+                    return;
+                nChunk = nNextChunk++;
+            }
+            std::string str;
+            size_t nEnd = std::min(vEntries.size(), (nChunk + 1) * DUMP_CHUNK_SIZE);
+            for (size_t i = nChunk * DUMP_CHUNK_SIZE; i < nEnd; i++)
+                str += FormatDumpLine(vEntries[i]);
+            {
+                boost::unique_lock<boost::mutex> lock(cs);
+                vChunks[nChunk].swap(str);
+                vDone[nChunk] = true;
+            }
+            cond.notify_all();
+        }
+    };
+
+    boost::thread_group threads;
+    int nThreads = std::max(1, (int)std::min<size_t>(GetNumCores(), nChunks));
+    for (int i = 0; i < nThreads; i++)
+        threads.create_thread(worker);
+
+    for (size_t nChunk = 0; nChunk < nChunks; nChunk++) {
+        std::string str;
+        {
+            boost::unique_lock<boost::mutex> lock(cs);
+            while (!vDone[nChunk])
+                cond.wait(lock);
+            vChunks[nChunk].swap(str);
+        }
+        file << str;
+        memory_cleanse(&str[0], str.size());
     }
+    threads.join_all();
+}
 
+UniValue dumpwallet_impl(const UniValue& params, bool fHelp, bool fDumpZKeys)
+{
     ofstream file;
-    file.open(exportfilepath.string().c_str());
-    if (!file.is_open())
-        throw JSONRPCError(RPC_INVALID_PARAMETER, "Cannot open wallet dump file");
+    std::string strHeader;
+    std::vector<CDumpKey> vKeys;
+    std::vector<CDumpZKey> vZKeys;
+    boost::filesystem::path exportfilepath;
 
-    std::map<CKeyID, int64_t> mapKeyBirth;
-    std::set<CKeyID> setKeyPool;
-    pwalletMain->GetKeyBirthTimes(mapKeyBirth);
-    pwalletMain->GetAllReserveKeys(setKeyPool);
+    // Copy the keys out of the wallet, and encode and write them once the
+    // locks are released
+    {
+        LOCK2(cs_main, pwalletMain->cs_wallet);
 
-    // sort time/key pairs
-    std::vector<std::pair<int64_t, CKeyID> > vKeyBirth;
-    for (std::map<CKeyID, int64_t>::const_iterator it = mapKeyBirth.begin(); it != mapKeyBirth.end(); it++) {
-        vKeyBirth.push_back(std::make_pair(it->second, it->first));
-    }
-    mapKeyBirth.clear();
-    std::sort(vKeyBirth.begin(), vKeyBirth.end());
+        EnsureWalletIsUnlocked();
 
-    // produce output
-    file << strprintf("# Wallet dump created by Zcash %s (%s)\n", CLIENT_BUILD, CLIENT_DATE);
-    file << strprintf("# * Created on %s\n", EncodeDumpTime(GetTime()));
-    file << strprintf("# * Best block at time of backup was %i (%s),\n", chainActive.Height(), chainActive.Tip()->GetBlockHash().ToString());
-    file << strprintf("#   mined on %s\n", EncodeDumpTime(chainActive.Tip()->GetBlockTime()));
-    file << "\n";
-    for (std::vector<std::pair<int64_t, CKeyID> >::const_iterator it = vKeyBirth.begin(); it != vKeyBirth.end(); it++) {
-        const CKeyID &keyid = it->second;
-        std::string strTime = EncodeDumpTime(it->first);
-        std::string strAddr = EncodeDestination(keyid);
-        CKey key;
-        if (pwalletMain->GetKey(keyid, key)) {
-            if (pwalletMain->mapAddressBook.count(keyid)) {
-                file << strprintf("%s %s label=%s # addr=%s\n", EncodeSecret(key), strTime, EncodeDumpString(pwalletMain->mapAddressBook[keyid].name), strAddr);
-            } else if (setKeyPool.count(keyid)) {
-                file << strprintf("%s %s reserve=1 # addr=%s\n", EncodeSecret(key), strTime, strAddr);
+        boost::filesystem::path exportdir;
+        try {
+            exportdir = GetExportDir();
+        } catch (const std::runtime_error& e) {
+            throw JSONRPCError(RPC_INTERNAL_ERROR, e.what());
+        }
+        if (exportdir.empty()) {
+            throw JSONRPCError(RPC_WALLET_ERROR, "Cannot export wallet until the zcashd -exportdir option has been set");
+        }
+        std::string unclean = params[0].get_str();
+        std::string clean = SanitizeFilename(unclean);
+        if (clean.compare(unclean) != 0) {
+            throw JSONRPCError(RPC_WALLET_ERROR, strprintf("Filename is invalid as only alphanumeric characters are allowed.  Try '%s' instead.", clean));
+        }
+        exportfilepath = exportdir / clean;
+
+        if (boost::filesystem::exists(exportfilepath)) {
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Cannot overwrite existing file " + exportfilepath.string());
+        }
+
+        file.open(exportfilepath.string().c_str());
+        if (!file.is_open())
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Cannot open wallet dump file");
+
+        std::map<CKeyID, int64_t> mapKeyBirth;
+        std::set<CKeyID> setKeyPool;
+        pwalletMain->GetKeyBirthTimes(mapKeyBirth);
+        pwalletMain->GetAllReserveKeys(setKeyPool);
+
+        // sort time/key pairs
+        std::vector<std::pair<int64_t, CKeyID> > vKeyBirth;
+        for (std::map<CKeyID, int64_t>::const_iterator it = mapKeyBirth.begin(); it != mapKeyBirth.end(); it++) {
+            vKeyBirth.push_back(std::make_pair(it->second, it->first));
+        }
+        mapKeyBirth.clear();
+        std::sort(vKeyBirth.begin(), vKeyBirth.end());
+
+        strHeader += strprintf("# Wallet dump created by Zcash %s (%s)\n", CLIENT_BUILD, CLIENT_DATE);
+        strHeader += strprintf("# * Created on %s\n", EncodeDumpTime(GetTime()));
+        strHeader += strprintf("# * Best block at time of backup was %i (%s),\n", chainActive.Height(), chainActive.Tip()->GetBlockHash().ToString());
+        strHeader += strprintf("#   mined on %s\n", EncodeDumpTime(chainActive.Tip()->GetBlockTime()));
+        strHeader += "\n";
+
+        vKeys.reserve(vKeyBirth.size());
+        for (std::vector<std::pair<int64_t, CKeyID> >::const_iterator it = vKeyBirth.begin(); it != vKeyBirth.end(); it++) {
+            CDumpKey entry;
+            entry.keyid = it->second;
+            entry.nTime = it->first;
+            if (!pwalletMain->GetKey(entry.keyid, entry.key))
+                continue;
+            std::map<CTxDestination, CAddressBookData>::const_iterator mi = pwalletMain->mapAddressBook.find(entry.keyid);
+            if (mi != pwalletMain->mapAddressBook.end()) {
+                entry.strKind = "label=" + EncodeDumpString(mi->second.name);
+            } else if (setKeyPool.count(entry.keyid)) {
+                entry.strKind = "reserve=1";
             } else {
-                file << strprintf("%s %s change=1 # addr=%s\n", EncodeSecret(key), strTime, strAddr);
+                entry.strKind = "change=1";
+            }
+            vKeys.push_back(entry);
+        }
+
+        if (fDumpZKeys) {
+            std::set<libzcash::SproutPaymentAddress> addresses;
+            pwalletMain->GetPaymentAddresses(addresses);
+            vZKeys.reserve(addresses.size());
+            for (auto addr : addresses ) {
+                CDumpZKey entry;
+                entry.addr = addr;
+                if (pwalletMain->GetSpendingKey(addr, entry.key)) {
+                    entry.nTime = pwalletMain->mapZKeyMetadata[addr].nCreateTime;
+                    vZKeys.push_back(entry);
+                }
             }
         }
     }
+
+    // produce output
+    file << strHeader;
+    WriteDumpEntries(file, vKeys);
     file << "\n";
 
     if (fDumpZKeys) {
-        std::set<libzcash::SproutPaymentAddress> addresses;
-        pwalletMain->GetPaymentAddresses(addresses);
         file << "\n";
         file << "# Zkeys\n";
         file << "\n";
-        for (auto addr : addresses ) {
-            libzcash::SproutSpendingKey key;
-            if (pwalletMain->GetSpendingKey(addr, key)) {
-                std::string strTime = EncodeDumpTime(pwalletMain->mapZKeyMetadata[addr].nCreateTime);
-                file << strprintf("%s %s # zaddr=%s\n", EncodeSpendingKey(key), strTime, EncodePaymentAddress(addr));
-            }
-        }
+        WriteDumpEntries(file, vZKeys);
         file << "\n";
     }
 
@@ -745,6 +859,194 @@ UniValue z_importviewingkey(const UniValue& params, bool fHelp)
     return NullUniValue;
 }
 
+static void ImportKeyToWallet(const CKey& key, int64_t nCreateTime)
+{
+    CPubKey pubkey = key.GetPubKey();
+    pwalletMain->mapKeyMetadata[pubkey.GetID()].nCreateTime = nCreateTime;
+    if (!pwalletMain->AddKeyPubKey(key, pubkey))
+        throw JSONRPCError(RPC_WALLET_ERROR, "Error adding key to wallet");
+}
+
+static void ImportScriptToWallet(const CScript& script)
+{
+    if (!pwalletMain->AddWatchOnly(script))
+        throw JSONRPCError(RPC_WALLET_ERROR, "Error adding address to wallet");
+}
+
+static void ImportZKeyToWallet(const libzcash::SproutSpendingKey& key, int64_t nCreateTime)
+{
+    pwalletMain->mapZKeyMetadata[key.address()].nCreateTime = nCreateTime;
+    if (!pwalletMain->AddZKey(key))
+        throw JSONRPCError(RPC_WALLET_ERROR, "Error adding spending key to wallet");
+}
+
+static void ImportViewingKeyToWallet(const libzcash::SproutViewingKey& vkey)
+{
+    if (!pwalletMain->AddViewingKey(vkey))
+        throw JSONRPCError(RPC_WALLET_ERROR, "Error adding viewing key to wallet");
+}
+
+UniValue z_importmulti(const UniValue& params, bool fHelp)
+{
+    if (!EnsureWalletIsAvailable(fHelp))
+        return NullUniValue;
+
+    if (fHelp || params.size() < 1 || params.size() > 2)
+        throw runtime_error(
+            "z_importmulti [{\"key\":\"key\",\"birthday\":n},...] ( rescan )\n"
+            "\nAdds many keys and addresses to your wallet, followed by a single rescan.\n"
+            "The rescan starts at the lowest birthday, and each key is only checked against\n"
+            "blocks from its own birthday on.\n"
+            "\nArguments:\n"
+            "1. \"imports\"            (array, required) The keys and addresses to import\n"
+            "    [\n"
+            "      {\n"
+            "        \"key\":\"key\",       (string) A private key (see dumpprivkey), zkey (see z_exportkey) or viewing key (see z_exportviewingkey)\n"
+            "        \"address\":\"addr\",  (string) Or an address or script (in hex) to watch, as with importaddress\n"
+            "        \"label\":\"label\",   (string, optional) Label for a transparent key or address, if it should change\n"
+            "        \"birthday\":n       (numeric, optional, default=0) Height of the first block that can involve the key\n"
+            "      }, ...\n"
+            "    ]\n"
+            "2. rescan               (boolean, optional, default=true) Rescan the wallet for transactions\n"
+            "\nResult:\n"
+            "[\n"
+            "  {\n"
+            "    \"address\": \"addr\",    (string) The address of the key, or the watched address or script\n"
+            "    \"imported\": true|false (boolean) Whether it was added; false if the wallet already had it\n"
+            "  }, ...\n"
+            "]\n"
+            "\nNote: This call can take minutes to complete if rescan is true.\n"
+            "\nExamples:\n"
+            + HelpExampleCli("z_importmulti", "'[{\"key\":\"mykey\",\"birthday\":250000},{\"key\":\"myzkey\"}]'") +
+            "\nImport without rescan\n"
+            + HelpExampleCli("z_importmulti", "'[{\"address\":\"myaddress\",\"label\":\"testing\"}]' false") +
+            "\nAs a JSON-RPC call\n"
+            + HelpExampleRpc("z_importmulti", "[{\"key\":\"mykey\",\"birthday\":250000}], true")
+        );
+
+    LOCK2(cs_main, pwalletMain->cs_wallet);
+
+    UniValue imports = params[0].get_array();
+
+    // Whether to perform rescan after import
+    bool fRescan = true;
+    if (params.size() > 1)
+        fRescan = params[1].get_bool();
+
+    // Validate everything before changing the wallet, and queue the keys
+    // that are new by birthday
+    std::multimap<int, boost::function<void()> > mapImports;
+    std::vector<std::pair<CTxDestination, std::string> > vLabels;
+    std::set<std::string> setImported;
+    bool fHavePrivateKeys = false;
+    UniValue results(UniValue::VARR);
+    for (size_t i = 0; i < imports.size(); i++) {
+        const UniValue& request = imports[i].get_obj();
+        RPCTypeCheckObj(request, boost::assign::map_list_of("key", UniValue::VSTR)("address", UniValue::VSTR)("label", UniValue::VSTR)("birthday", UniValue::VNUM), true);
+        const UniValue& key = find_value(request, "key");
+        const UniValue& address = find_value(request, "address");
+        if (key.isNull() == address.isNull())
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Each import needs exactly one of key or address");
+        const UniValue& label = find_value(request, "label");
+
+        const UniValue& birthday = find_value(request, "birthday");
+        int nBirthday = birthday.isNull() ? 0 : birthday.get_int();
+        if (nBirthday < 0 || nBirthday > chainActive.Height())
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Block height out of range");
+        // Keys carry their birthday as a creation time, like generated keys
+        int64_t nCreateTime = nBirthday > 0 ? chainActive[nBirthday]->GetBlockTime() : 1;
+
+        std::string strAddress;
+        bool fNew;
+        boost::function<void()> import;
+        CTxDestination labelDest = CNoDestination();
+        if (!address.isNull()) {
+            CScript script;
+            CTxDestination dest = DecodeDestination(address.get_str());
+            if (IsValidDestination(dest)) {
+                script = GetScriptForDestination(dest);
+            } else if (IsHex(address.get_str())) {
+                std::vector<unsigned char> data(ParseHex(address.get_str()));
+                script = CScript(data.begin(), data.end());
+            } else {
+                throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid Zcash address or script");
+            }
+            if (::IsMine(*pwalletMain, script) == ISMINE_SPENDABLE)
+                throw JSONRPCError(RPC_WALLET_ERROR, "The wallet already contains the private key for this address or script");
+            labelDest = dest;
+            strAddress = address.get_str();
+            fNew = !pwalletMain->HaveWatchOnly(script);
+            import = boost::bind(&ImportScriptToWallet, script);
+        } else if (DecodeSecret(key.get_str()).IsValid()) {
+            CKey secret = DecodeSecret(key.get_str());
+            CKeyID keyID = secret.GetPubKey().GetID();
+            labelDest = keyID;
+            strAddress = EncodeDestination(keyID);
+            fNew = !pwalletMain->HaveKey(keyID);
+            import = boost::bind(&ImportKeyToWallet, secret, nCreateTime);
+            fHavePrivateKeys = true;
+        } else if (IsValidSpendingKey(DecodeSpendingKey(key.get_str()))) {
+            auto spendingkey = DecodeSpendingKey(key.get_str());
+            // TODO: Add Sapling support. For now, ensure we can freely convert.
+            assert(boost::get<libzcash::SproutSpendingKey>(&spendingkey) != nullptr);
+            auto zkey = boost::get<libzcash::SproutSpendingKey>(spendingkey);
+            strAddress = EncodePaymentAddress(zkey.address());
+            fNew = !pwalletMain->HaveSpendingKey(zkey.address());
+            import = boost::bind(&ImportZKeyToWallet, zkey, nCreateTime);
+            fHavePrivateKeys = true;
+        } else if (IsValidViewingKey(DecodeViewingKey(key.get_str()))) {
+            auto viewingkey = DecodeViewingKey(key.get_str());
+            // TODO: Add Sapling support. For now, ensure we can freely convert.
+            assert(boost::get<libzcash::SproutViewingKey>(&viewingkey) != nullptr);
+            auto vkey = boost::get<libzcash::SproutViewingKey>(viewingkey);
+            if (pwalletMain->HaveSpendingKey(vkey.address()))
+                throw JSONRPCError(RPC_WALLET_ERROR, "The wallet already contains the private key for this viewing key");
+            strAddress = EncodePaymentAddress(vkey.address());
+            fNew = !pwalletMain->HaveViewingKey(vkey.address());
+            import = boost::bind(&ImportViewingKeyToWallet, vkey);
+        } else {
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid key encoding");
+        }
+
+        // Repeats within the batch are only imported, and labelled, once
+        if (!setImported.insert(key.isNull() ? address.get_str() : key.get_str()).second)
+            fNew = false;
+        else if (!label.isNull() && IsValidDestination(labelDest))
+            vLabels.push_back(std::make_pair(labelDest, label.get_str()));
+        if (fNew)
+            mapImports.insert(std::make_pair(nBirthday, import));
+
+        UniValue result(UniValue::VOBJ);
+        result.push_back(Pair("address", strAddress));
+        result.push_back(Pair("imported", fNew));
+        results.push_back(result);
+    }
+
+    if (fHavePrivateKeys)
+        EnsureWalletIsUnlocked();
+
+    for (size_t i = 0; i < vLabels.size(); i++)
+        pwalletMain->SetAddressBook(vLabels[i].first, vLabels[i].second, "receive");
+
+    if (mapImports.empty())
+        return results;
+
+    pwalletMain->MarkDirty();
+    // Later rescans must not skip blocks that can involve the new keys
+    int64_t nTimeStart = mapImports.begin()->first > 0 ? chainActive[mapImports.begin()->first]->GetBlockTime() : 1;
+    if (pwalletMain->nTimeFirstKey > nTimeStart)
+        pwalletMain->nTimeFirstKey = nTimeStart;
+    if (fRescan) {
+        pwalletMain->ScanForWalletTransactions(chainActive[mapImports.begin()->first], true, &mapImports);
+        pwalletMain->ReacceptWalletTransactions();
+    } else {
+        for (std::multimap<int, boost::function<void()> >::iterator it = mapImports.begin(); it != mapImports.end(); ++it)
+            it->second();
+    }
+
+    return results;
+}
+
 UniValue z_exportkey(const UniValue& params, bool fHelp)
 {
     if (!EnsureWalletIsAvailable(fHelp))
@@ -4,6 +4,7 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "amount.h"
+#include "checkqueue.h"
 #include "consensus/upgrades.h"
 #include "core_io.h"
 #include "init.h"
@@ -135,9 +136,6 @@ UniValue getnewaddress(const UniValue& params, bool fHelp)
     if (params.size() > 0)
         strAccount = AccountFromValue(params[0]);
 
-    if (!pwalletMain->IsLocked())
-        pwalletMain->TopUpKeyPool();
-
     // Generate a new key that is added to wallet
     CPubKey newKey;
     if (!pwalletMain->GetKeyFromPool(newKey))
@@ -238,9 +236,6 @@ UniValue getrawchangeaddress(const UniValue& params, bool fHelp)
 
     LOCK2(cs_main, pwalletMain->cs_wallet);
 
-    if (!pwalletMain->IsLocked())
-        pwalletMain->TopUpKeyPool();
-
     CReserveKey reservekey(pwalletMain);
     CPubKey vchPubKey;
     if (!reservekey.GetReservedKey(vchPubKey))
@@ -1349,7 +1344,7 @@ void ListTransactions(const CWalletTx& wtx, const string& strAccount, int nMinDe
             entry.push_back(Pair("fee", ValueFromAmount(-nFee)));
             if (fLong)
                 WalletTxToJSON(wtx, entry);
-            entry.push_back(Pair("size", static_cast<uint64_t>(GetSerializeSize(static_cast<CTransaction>(wtx), SER_NETWORK, PROTOCOL_VERSION))));
+            entry.push_back(Pair("size", static_cast<uint64_t>(wtx.GetTotalSize())));
             ret.push_back(entry);
         }
     }
@@ -1386,7 +1381,7 @@ void ListTransactions(const CWalletTx& wtx, const string& strAccount, int nMinDe
                 entry.push_back(Pair("vout", r.vout));
                 if (fLong)
                     WalletTxToJSON(wtx, entry);
-                entry.push_back(Pair("size", static_cast<uint64_t>(GetSerializeSize(static_cast<CTransaction>(wtx), SER_NETWORK, PROTOCOL_VERSION))));
+                entry.push_back(Pair("size", static_cast<uint64_t>(wtx.GetTotalSize())));
                 ret.push_back(entry);
             }
         }
@@ -1785,7 +1780,7 @@ UniValue gettransaction(const UniValue& params, bool fHelp)
     ListTransactions(wtx, "*", 0, false, details, filter);
     entry.push_back(Pair("details", details));
 
-    string strHex = EncodeHexTx(static_cast<CTransaction>(wtx));
+    string strHex = RPCEncodeTx(static_cast<CTransaction>(wtx));
     entry.push_back(Pair("hex", strHex));
 
     return entry;
@@ -2395,24 +2390,37 @@ UniValue listunspent(const UniValue& params, bool fHelp)
     assert(pwalletMain != NULL);
     LOCK2(cs_main, pwalletMain->cs_wallet);
     pwalletMain->AvailableCoins(vecOutputs, false, NULL, true);
+
+    // Select the outputs first so their addresses can be encoded in one go
+    vector<const COutput*> vSelected;
+    vector<CTxDestination> vAddresses;
     BOOST_FOREACH(const COutput& out, vecOutputs) {
         if (out.nDepth < nMinDepth || out.nDepth > nMaxDepth)
             continue;
 
         CTxDestination address;
-        const CScript& scriptPubKey = out.tx->vout[out.i].scriptPubKey;
-        bool fValidAddress = ExtractDestination(scriptPubKey, address);
+        bool fValidAddress = ExtractDestination(out.tx->vout[out.i].scriptPubKey, address);
 
         if (destinations.size() && (!fValidAddress || !destinations.count(address)))
             continue;
 
+        vSelected.push_back(&out);
+        vAddresses.push_back(fValidAddress ? address : CTxDestination(CNoDestination()));
+    }
+    vector<std::string> vEncoded = EncodeDestinations(vAddresses);
+
+    for (size_t n = 0; n < vSelected.size(); n++) {
+        const COutput& out = *vSelected[n];
+        const CTxDestination& address = vAddresses[n];
+        const CScript& scriptPubKey = out.tx->vout[out.i].scriptPubKey;
+
         UniValue entry(UniValue::VOBJ);
         entry.push_back(Pair("txid", out.tx->GetHash().GetHex()));
         entry.push_back(Pair("vout", out.i));
         entry.push_back(Pair("generated", out.tx->IsCoinBase()));
 
-        if (fValidAddress) {
-            entry.push_back(Pair("address", EncodeDestination(address)));
+        if (IsValidDestination(address)) {
+            entry.push_back(Pair("address", vEncoded[n]));
 
             if (pwalletMain->mapAddressBook.count(address))
                 entry.push_back(Pair("account", pwalletMain->mapAddressBook[address].name));
@@ -2553,14 +2561,21 @@ UniValue z_listunspent(const UniValue& params, bool fHelp)
     if (zaddrs.size() > 0) {
         std::vector<CUnspentSproutNotePlaintextEntry> entries;
         pwalletMain->GetUnspentFilteredNotes(entries, zaddrs, nMinDepth, nMaxDepth, !fIncludeWatchonly);
-        for (CUnspentSproutNotePlaintextEntry & entry : entries) {
+        std::vector<libzcash::PaymentAddress> vAddresses;
+        vAddresses.reserve(entries.size());
+        for (const CUnspentSproutNotePlaintextEntry& entry : entries) {
+            vAddresses.push_back(entry.address);
+        }
+        std::vector<std::string> vEncoded = EncodePaymentAddresses(vAddresses);
+        for (size_t n = 0; n < entries.size(); n++) {
+            const CUnspentSproutNotePlaintextEntry& entry = entries[n];
             UniValue obj(UniValue::VOBJ);
             obj.push_back(Pair("txid",entry.jsop.hash.ToString()));
             obj.push_back(Pair("jsindex", (int)entry.jsop.js ));
             obj.push_back(Pair("jsoutindex", (int)entry.jsop.n));
             obj.push_back(Pair("confirmations", entry.nHeight));
             obj.push_back(Pair("spendable", pwalletMain->HaveSpendingKey(boost::get<libzcash::SproutPaymentAddress>(entry.address))));
-            obj.push_back(Pair("address", EncodePaymentAddress(entry.address)));
+            obj.push_back(Pair("address", vEncoded[n]));
             obj.push_back(Pair("amount", ValueFromAmount(CAmount(entry.plaintext.value()))));
             std::string data(entry.plaintext.memo().begin(), entry.plaintext.memo().end());
             obj.push_back(Pair("memo", HexStr(data)));
@@ -2619,7 +2634,7 @@ UniValue fundrawtransaction(const UniValue& params, bool fHelp)
         throw JSONRPCError(RPC_INTERNAL_ERROR, strFailReason);
 
     UniValue result(UniValue::VOBJ);
-    result.push_back(Pair("hex", EncodeHexTx(tx)));
+    result.push_back(Pair("hex", RPCEncodeTx(tx)));
     result.push_back(Pair("changepos", nChangePos));
     result.push_back(Pair("fee", ValueFromAmount(nFee)));
 
@@ -2758,6 +2773,33 @@ UniValue zc_benchmark(const UniValue& params, bool fHelp)
             sample_times.push_back(benchmark_loadwallet());
         } else if (benchmarktype == "listunspent") {
             sample_times.push_back(benchmark_listunspent());
+        } else if (benchmarktype == "checkqueue") {
+            // Number of threads (including the calling thread) and number of checks
+            int nThreads = 1;
+            int nChecks = 100000;
+            if (params.size() >= 3) {
+                nThreads = params[2].get_int();
+            }
+            if (params.size() >= 4) {
+                nChecks = params[3].get_int();
+            }
+            if (nThreads < 1 || nThreads > MAX_CHECKQUEUE_PARTICIPANTS) {
+                throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid number of threads");
+            }
+            if (nChecks < 0) {
+                throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid number of checks");
+            }
+            sample_times.push_back(benchmark_checkqueue(nThreads, nChecks));
+        } else if (benchmarktype == "addressencoding") {
+            // Number of addresses of each type to encode and decode
+            int nAddrs = 1000;
+            if (params.size() >= 3) {
+                nAddrs = params[2].get_int();
+            }
+            if (nAddrs < 0) {
+                throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid number of addresses");
+            }
+            sample_times.push_back(benchmark_address_encoding(nAddrs));
         } else {
             throw JSONRPCError(RPC_TYPE_ERROR, "Invalid benchmarktype");
         }
@@ -3149,11 +3191,15 @@ UniValue z_listaddresses(const UniValue& params, bool fHelp)
     // TODO: Add Sapling support
     std::set<libzcash::SproutPaymentAddress> addresses;
     pwalletMain->GetPaymentAddresses(addresses);
+    std::vector<libzcash::PaymentAddress> vAddresses;
     for (auto addr : addresses ) {
         if (fIncludeWatchonly || pwalletMain->HaveSpendingKey(addr)) {
-            ret.push_back(EncodePaymentAddress(addr));
+            vAddresses.push_back(addr);
         }
     }
+    for (const std::string& encoded : EncodePaymentAddresses(vAddresses)) {
+        ret.push_back(encoded);
+    }
     return ret;
 }
 
@@ -3447,6 +3493,31 @@ UniValue z_getoperationstatus(const UniValue& params, bool fHelp)
    return z_getoperationstatus_IMPL(params, false);
 }
 
+// Operations build their results on worker threads, so a signed transaction
+// in a result is always hex. Replies that carry raw bytes get it decoded.
+static UniValue OperationStatusForReply(const UniValue& status)
+{
+    const UniValue& result = find_value(status, "result");
+    if (!RPCWantsRawBytes() || !find_value(result, "hex").isStr())
+        return status;
+
+    UniValue newResult(UniValue::VOBJ);
+    for (size_t i = 0; i < result.size(); i++) {
+        if (result.getKeys()[i] == "hex") {
+            std::vector<unsigned char> vch = ParseHex(result[i].get_str());
+            newResult.push_back(Pair("hex", std::string(vch.begin(), vch.end())));
+        } else {
+            newResult.push_back(Pair(result.getKeys()[i], result[i]));
+        }
+    }
+    UniValue ret(UniValue::VOBJ);
+    for (size_t i = 0; i < status.size(); i++) {
+        const std::string& key = status.getKeys()[i];
+        ret.push_back(Pair(key, key == "result" ? newResult : status[i]));
+    }
+    return ret;
+}
+
 UniValue z_getoperationstatus_IMPL(const UniValue& params, bool fRemoveFinishedOperations=false)
 {
     LOCK2(cs_main, pwalletMain->cs_wallet);
@@ -3475,7 +3546,7 @@ UniValue z_getoperationstatus_IMPL(const UniValue& params, bool fRemoveFinishedO
             // throw JSONRPCError(RPC_INVALID_PARAMETER, "No operation exists for that id.");
         }
 
-        UniValue obj = operation->getStatus();
+        UniValue obj = OperationStatusForReply(operation->getStatus());
         std::string s = obj["status"].get_str();
         if (fRemoveFinishedOperations) {
             // Caller is only interested in retrieving finished results
@@ -3678,7 +3749,7 @@ UniValue z_sendmany(const UniValue& params, bool fHelp)
         mtx.vjoinsplit.push_back(jsdesc);
     }
     CTransaction tx(mtx);
-    txsize += GetSerializeSize(tx, SER_NETWORK, tx.nVersion);
+    txsize += tx.GetTotalSize();
     if (fromTaddr) {
         txsize += CTXIN_SPEND_DUST_SIZE;
         txsize += CTXOUT_REGULAR_SIZE;      // There will probably be taddr change
@@ -14,9 +14,11 @@
 #include "key_io.h"
 #include "main.h"
 #include "net.h"
+#include "scheduler.h"
 #include "script/script.h"
 #include "script/sign.h"
 #include "timedata.h"
+#include "txdb.h"
 #include "utilmoneystr.h"
 #include "zcash/Note.hpp"
 #include "crypter.h"
@@ -1132,6 +1134,9 @@ bool CWallet::AddToWallet(const CWalletTx& wtxIn, bool fFromLoadWallet, CWalletD
             }
         }
 
+        if (fInsertedNew || fUpdated)
+            UpdateKeyFirstBlocks(wtx);
+
         //// debug print
         LogPrintf("AddToWallet %s  %s%s\n", wtxIn.GetHash().ToString(), (fInsertedNew ? "new" : ""), (fUpdated ? "update" : ""));
 
@@ -1779,12 +1784,58 @@ void CWallet::WitnessNoteCommitment(std::vector<uint256> commitments,
     }
 }
 
+bool CWallet::GetBlockFilterQuery(GCSFilter::ElementSet& query) const
+{
+    AssertLockHeld(cs_wallet);
+    query.clear();
+
+    // An encrypted wallet only lists its spending keys here, so the viewing
+    // keys, and notes left from removed keys, are checked as well
+    std::set<libzcash::SproutPaymentAddress> setAddresses;
+    GetPaymentAddresses(setAddresses);
+    if (!setAddresses.empty())
+        return false;
+    {
+        LOCK(cs_KeyStore);
+        if (!mapViewingKeys.empty())
+            return false;
+    }
+    for (const std::pair<const uint256, CWalletTx>& item : mapWallet) {
+        if (!item.second.mapNoteData.empty())
+            return false;
+    }
+
+    std::set<CKeyID> setKeys;
+    GetKeys(setKeys);
+    for (const CKeyID& keyid : setKeys) {
+        query.insert(BlockFilter::ScriptElement(GetScriptForDestination(keyid)));
+        CPubKey pubkey;
+        if (GetPubKey(keyid, pubkey))
+            query.insert(BlockFilter::ScriptElement(CScript() << ToByteVector(pubkey) << OP_CHECKSIG));
+    }
+    {
+        LOCK(cs_KeyStore);
+        for (const ScriptMap::value_type& item : mapScripts)
+            query.insert(BlockFilter::ScriptElement(GetScriptForDestination(item.first)));
+        for (const CScript& script : setWatchOnly)
+            query.insert(BlockFilter::ScriptElement(script));
+    }
+    for (const std::pair<const uint256, CWalletTx>& item : mapWallet) {
+        for (unsigned int i = 0; i < item.second.vout.size(); i++) {
+            if (IsMine(item.second.vout[i]) != ISMINE_NO)
+                query.insert(BlockFilter::OutPointElement(COutPoint(item.first, i)));
+        }
+    }
+    return true;
+}
+
 /**
  * Scan the block chain (starting in pindexStart) for transactions
  * from or to us. If fUpdate is true, found transactions that already
  * exist in the wallet will be updated.
  */
-int CWallet::ScanForWalletTransactions(CBlockIndex* pindexStart, bool fUpdate)
+int CWallet::ScanForWalletTransactions(CBlockIndex* pindexStart, bool fUpdate,
+                                       const std::multimap<int, boost::function<void()> >* pmapImports)
 {
     int ret = 0;
     int64_t nNow = GetTime();
@@ -1802,17 +1853,50 @@ int CWallet::ScanForWalletTransactions(CBlockIndex* pindexStart, bool fUpdate)
         ShowProgress(_("Rescanning..."), 0); // show rescan progress in GUI as dialog or on splashscreen, if -rescan on startup
         double dProgressStart = Checkpoints::GuessVerificationProgress(chainParams.Checkpoints(), pindex, false);
         double dProgressTip = Checkpoints::GuessVerificationProgress(chainParams.Checkpoints(), chainActive.Tip(), false);
+        std::multimap<int, boost::function<void()> >::const_iterator itImport;
+        if (pmapImports)
+            itImport = pmapImports->begin();
+        GCSFilter::ElementSet filterQuery;
+        bool fUseFilters = pblockfilterdb && GetBlockFilterQuery(filterQuery);
         while (pindex)
         {
             if (pindex->nHeight % 100 == 0 && dProgressTip - dProgressStart > 0.0)
                 ShowProgress(_("Rescanning..."), std::max(1, std::min(99, (int)((Checkpoints::GuessVerificationProgress(chainParams.Checkpoints(), pindex, false) - dProgressStart) / (dProgressTip - dProgressStart) * 100))));
 
+            bool fImported = false;
+            while (pmapImports && itImport != pmapImports->end() && itImport->first <= pindex->nHeight) {
+                itImport->second();
+                ++itImport;
+                fImported = true;
+            }
+            if (fImported && pblockfilterdb)
+                fUseFilters = GetBlockFilterQuery(filterQuery);
+
+            // A block that doesn't match the filter has nothing for us. With
+            // only transparent keys there are no note witnesses to update
+            // either, beyond counting the block.
+            BlockFilter filter;
+            if (fUseFilters && pblockfilterdb->ReadFilter(pindex->GetBlockHash(), filter) &&
+                !filter.GetFilter().MatchAny(filterQuery)) {
+                if (nWitnessCacheSize < WITNESS_CACHE_SIZE)
+                    nWitnessCacheSize += 1;
+                pindex = chainActive.Next(pindex);
+                continue;
+            }
+
             CBlock block;
             ReadBlockFromDisk(block, pindex);
             BOOST_FOREACH(CTransaction& tx, block.vtx)
             {
-                if (AddToWalletIfInvolvingMe(tx, &block, fUpdate))
+                if (AddToWalletIfInvolvingMe(tx, &block, fUpdate)) {
                     ret++;
+                    if (fUseFilters) {
+                        for (unsigned int i = 0; i < tx.vout.size(); i++) {
+                            if (IsMine(tx.vout[i]) != ISMINE_NO)
+                                filterQuery.insert(BlockFilter::OutPointElement(COutPoint(tx.GetHash(), i)));
+                        }
+                    }
+                }
             }
 
             ZCIncrementalMerkleTree tree;
@@ -1828,6 +1912,11 @@ int CWallet::ScanForWalletTransactions(CBlockIndex* pindexStart, bool fUpdate)
                 LogPrintf("Still rescanning. At block %d. Progress=%f\n", pindex->nHeight, Checkpoints::GuessVerificationProgress(chainParams.Checkpoints(), pindex));
             }
         }
+        // Imports with birthdays past the tip still have to be added
+        while (pmapImports && itImport != pmapImports->end()) {
+            itImport->second();
+            ++itImport;
+        }
         ShowProgress(_("Rescanning..."), 100); // hide progress dialog in GUI
     }
     return ret;
@@ -2796,25 +2885,29 @@ bool CWallet::CreateTransaction(const vector<CRecipient>& vecSend, CWalletTx& wt
                 // Sign
                 int nIn = 0;
                 CTransaction txNewConst(txNew);
+                std::vector<SignatureJob> vJobs;
                 BOOST_FOREACH(const PAIRTYPE(const CWalletTx*,unsigned int)& coin, setCoins)
                 {
-                    bool signSuccess;
                     const CScript& scriptPubKey = coin.first->vout[coin.second].scriptPubKey;
-                    SignatureData sigdata;
-                    if (sign)
-                        signSuccess = ProduceSignature(TransactionSignatureCreator(this, &txNewConst, nIn, coin.first->vout[coin.second].nValue, SIGHASH_ALL), scriptPubKey, sigdata, consensusBranchId);
-                    else
-                        signSuccess = ProduceSignature(DummySignatureCreator(this), scriptPubKey, sigdata, consensusBranchId);
+                    vJobs.push_back(SignatureJob(nIn, scriptPubKey, coin.first->vout[coin.second].nValue));
+                    if (!sign) {
+                        SignatureJob& job = vJobs.back();
+                        job.fSolved = ProduceSignature(DummySignatureCreator(this), scriptPubKey, job.sigdata, consensusBranchId);
+                    }
+                    nIn++;
+                }
+                if (sign)
+                    ProduceSignatures(*this, txNewConst, vJobs, SIGHASH_ALL, consensusBranchId);
 
-                    if (!signSuccess)
+                BOOST_FOREACH(const SignatureJob& job, vJobs)
+                {
+                    if (!job.fSolved)
                     {
                         strFailReason = _("Signing transaction failed");
                         return false;
                     } else {
-                        UpdateTransaction(txNew, nIn, sigdata);
+                        UpdateTransaction(txNew, job.nIn, job.sigdata);
                     }
-
-                    nIn++;
                 }
 
                 unsigned int nBytes = ::GetSerializeSize(txNew, SER_NETWORK, PROTOCOL_VERSION);
@@ -3060,6 +3153,119 @@ bool CWallet::SetDefaultKey(const CPubKey &vchPubKey)
     return true;
 }
 
+//! Fewest keys worth handing to a thread of their own when generating keys
+static const size_t KEYPOOL_MIN_KEYS_PER_THREAD = 100;
+
+static unsigned int GetKeyPoolTargetSize()
+{
+    return max(GetArg("-keypool", DEFAULT_KEYPOOL_SIZE), (int64_t)0);
+}
+
+bool CWallet::GenerateKeyPoolBatch(size_t nCount, bool fCompressed, bool fCrypted, std::vector<CNewPoolKey>& vKeys)
+{
+    vKeys.assign(nCount, CNewPoolKey());
+    std::atomic<bool> fOk(true);
+    auto generate = [&](size_t nBegin, size_t nEnd) {
+        for (size_t i = nBegin; i < nEnd; i++) {
+            CNewPoolKey& entry = vKeys[i];
+            entry.key.MakeNewKey(fCompressed);
+            entry.pubkey = entry.key.GetPubKey();
+            assert(entry.key.VerifyPubKey(entry.pubkey));
+            if (!fCrypted)
+                entry.privkey = entry.key.GetPrivKey();
+            else if (!EncryptKey(entry.key, entry.pubkey, entry.vchCryptedSecret))
+                fOk = false;
+        }
+    };
+
+    // The last slice is done on this thread. The workers hold references to
+    // this frame, so an interrupt must not unwind it before they are joined.
+    boost::this_thread::disable_interruption di;
+    size_t nThreads = std::max<size_t>(1, std::min<size_t>(GetNumCores(), nCount / KEYPOOL_MIN_KEYS_PER_THREAD));
+    boost::thread_group threads;
+    size_t nBegin = 0;
+    for (size_t i = 0; i + 1 < nThreads; i++) {
+        size_t nEnd = nCount * (i + 1) / nThreads;
+        threads.create_thread([&generate, nBegin, nEnd]() { generate(nBegin, nEnd); });
+        nBegin = nEnd;
+    }
+    generate(nBegin, nCount);
+    threads.join_all();
+    return fOk;
+}
+
+bool CWallet::AddKeyPoolBatch(const std::vector<CNewPoolKey>& vKeys, bool fCrypted)
+{
+    AssertLockHeld(cs_wallet); // mapKeyMetadata, setKeyPool
+    if (vKeys.empty())
+        return true;
+    if (fCrypted != IsCrypted())
+        return false;
+
+    // Compressed public keys were introduced in version 0.6.0
+    if (vKeys[0].pubkey.IsCompressed())
+        SetMinVersion(FEATURE_COMPRPUBKEY);
+
+    CKeyMetadata meta(GetTime());
+    int64_t nFirst = 1;
+    if (!setKeyPool.empty())
+        nFirst = *(--setKeyPool.end()) + 1;
+
+    CWalletDB walletdb(strWalletFile);
+    if (!walletdb.TxnBegin())
+        return false;
+    for (size_t i = 0; i < vKeys.size(); i++) {
+        const CNewPoolKey& entry = vKeys[i];
+        bool fWritten = true;
+        if (fFileBacked) {
+            if (fCrypted)
+                fWritten = walletdb.WriteCryptedKey(entry.pubkey, entry.vchCryptedSecret, meta);
+            else
+                fWritten = walletdb.WriteKey(entry.pubkey, entry.privkey, meta);
+        }
+        if (!fWritten || !walletdb.WritePool(nFirst + i, CKeyPool(entry.pubkey))) {
+            walletdb.TxnAbort();
+            return false;
+        }
+    }
+    if (!walletdb.TxnCommit())
+        return false;
+
+    // The keys are on disk; now add them in memory, skipping the overrides
+    // that would write each of them again
+    for (size_t i = 0; i < vKeys.size(); i++) {
+        const CNewPoolKey& entry = vKeys[i];
+        mapKeyMetadata[entry.pubkey.GetID()] = meta;
+        bool fAdded;
+        if (fCrypted)
+            fAdded = CCryptoKeyStore::AddCryptedKey(entry.pubkey, entry.vchCryptedSecret);
+        else
+            fAdded = CCryptoKeyStore::AddKeyPubKey(entry.key, entry.pubkey);
+        if (!fAdded)
+            throw std::runtime_error("CWallet::AddKeyPoolBatch(): AddKey failed");
+        setKeyPool.insert(nFirst + i);
+    }
+    if (!nTimeFirstKey || meta.nCreateTime < nTimeFirstKey)
+        nTimeFirstKey = meta.nCreateTime;
+    LogPrintf("keypool added keys %d to %d, size=%u\n", nFirst, nFirst + vKeys.size() - 1, setKeyPool.size());
+    return true;
+}
+
+bool CWallet::FillKeyPool(size_t nSize)
+{
+    AssertLockHeld(cs_wallet);
+    bool fCompressed = CanSupportFeature(FEATURE_COMPRPUBKEY); // default to compressed public keys if we want 0.6.0 wallets
+    while (setKeyPool.size() < nSize) {
+        size_t nCount = std::min<size_t>(nSize - setKeyPool.size(), KEYPOOL_BATCH_SIZE);
+        std::vector<CNewPoolKey> vKeys;
+        if (!GenerateKeyPoolBatch(nCount, fCompressed, IsCrypted(), vKeys))
+            return false;
+        if (!AddKeyPoolBatch(vKeys, IsCrypted()))
+            return false;
+    }
+    return true;
+}
+
 /**
  * Mark old keypool keys as used,
  * and generate all new keys 
@@ -3076,13 +3282,9 @@ bool CWallet::NewKeyPool()
         if (IsLocked())
             return false;
 
-        int64_t nKeys = max(GetArg("-keypool", 100), (int64_t)0);
-        for (int i = 0; i < nKeys; i++)
-        {
-            int64_t nIndex = i+1;
-            walletdb.WritePool(nIndex, CKeyPool(GenerateNewKey()));
-            setKeyPool.insert(nIndex);
-        }
+        int64_t nKeys = GetKeyPoolTargetSize();
+        if (!FillKeyPool(nKeys))
+            return false;
         LogPrintf("CWallet::NewKeyPool wrote %d new keys\n", nKeys);
     }
     return true;
@@ -3096,29 +3298,62 @@ bool CWallet::TopUpKeyPool(unsigned int kpSize)
         if (IsLocked())
             return false;
 
-        CWalletDB walletdb(strWalletFile);
-
         // Top up key pool
         unsigned int nTargetSize;
         if (kpSize > 0)
             nTargetSize = kpSize;
         else
-            nTargetSize = max(GetArg("-keypool", 100), (int64_t) 0);
+            nTargetSize = GetKeyPoolTargetSize();
 
-        while (setKeyPool.size() < (nTargetSize + 1))
-        {
-            int64_t nEnd = 1;
-            if (!setKeyPool.empty())
-                nEnd = *(--setKeyPool.end()) + 1;
-            if (!walletdb.WritePool(nEnd, CKeyPool(GenerateNewKey())))
-                throw runtime_error("TopUpKeyPool(): writing generated key failed");
-            setKeyPool.insert(nEnd);
-            LogPrintf("keypool added key %d, size=%u\n", nEnd, setKeyPool.size());
-        }
+        if (!FillKeyPool(nTargetSize + 1))
+            throw runtime_error("TopUpKeyPool(): writing generated keys failed");
     }
     return true;
 }
 
+void CWallet::SetKeyPoolScheduler(CScheduler* pschedulerIn)
+{
+    LOCK(cs_wallet);
+    pKeyPoolScheduler = pschedulerIn;
+}
+
+void CWallet::TopUpKeyPoolInBackground()
+{
+    try {
+        while (true) {
+            size_t nCount;
+            bool fCompressed, fCrypted;
+            {
+                LOCK(cs_wallet);
+                size_t nTargetSize = GetKeyPoolTargetSize() + 1;
+                if (IsLocked() || setKeyPool.size() >= nTargetSize) {
+                    fKeyPoolTopUpScheduled = false;
+                    return;
+                }
+                nCount = std::min<size_t>(nTargetSize - setKeyPool.size(), KEYPOOL_BATCH_SIZE);
+                fCompressed = CanSupportFeature(FEATURE_COMPRPUBKEY);
+                fCrypted = IsCrypted();
+            }
+
+            // Generate the keys without holding cs_wallet. If the wallet was
+            // locked or encrypted meanwhile, they are dropped.
+            std::vector<CNewPoolKey> vKeys;
+            bool fGenerated = GenerateKeyPoolBatch(nCount, fCompressed, fCrypted, vKeys);
+            {
+                LOCK(cs_wallet);
+                if (!fGenerated || !AddKeyPoolBatch(vKeys, fCrypted)) {
+                    fKeyPoolTopUpScheduled = false;
+                    return;
+                }
+            }
+        }
+    } catch (const std::exception& e) {
+        LogPrintf("%s: %s\n", __func__, e.what());
+        LOCK(cs_wallet);
+        fKeyPoolTopUpScheduled = false;
+    }
+}
+
 void CWallet::ReserveKeyFromKeyPool(int64_t& nIndex, CKeyPool& keypool)
 {
     nIndex = -1;
@@ -3126,8 +3361,16 @@ void CWallet::ReserveKeyFromKeyPool(int64_t& nIndex, CKeyPool& keypool)
     {
         LOCK(cs_wallet);
 
-        if (!IsLocked())
-            TopUpKeyPool();
+        if (!IsLocked()) {
+            // With a scheduler, only top up here if the pool has run dry, and
+            // otherwise leave it to the scheduler once the pool is half empty
+            if (!pKeyPoolScheduler || setKeyPool.empty()) {
+                TopUpKeyPool();
+            } else if (!fKeyPoolTopUpScheduled && setKeyPool.size() <= (GetKeyPoolTargetSize() + 1) / 2) {
+                fKeyPoolTopUpScheduled = true;
+                pKeyPoolScheduler->scheduleFromNow(boost::bind(&CWallet::TopUpKeyPoolInBackground, this), 0, "keypool");
+            }
+        }
 
         // Get the oldest key
         if(setKeyPool.empty())
@@ -3513,7 +3756,30 @@ public:
     void operator()(const CNoDestination &none) {}
 };
 
-void CWallet::GetKeyBirthTimes(std::map<CKeyID, int64_t> &mapKeyBirth) const {
+void CWallet::UpdateKeyFirstBlocks(const CWalletTx& wtx)
+{
+    AssertLockHeld(cs_wallet); // mapKeyFirstBlock
+    if (!fKeyFirstBlocksLoaded || wtx.hashBlock.IsNull())
+        return;
+    BlockMap::const_iterator blit = mapBlockIndex.find(wtx.hashBlock);
+    if (blit == mapBlockIndex.end() || !chainActive.Contains(blit->second))
+        return;
+    CBlockIndex* pindex = blit->second;
+
+    std::vector<CKeyID> vAffected;
+    BOOST_FOREACH(const CTxOut &txout, wtx.vout)
+        CAffectedKeysVisitor(*this, vAffected).Process(txout.scriptPubKey);
+    BOOST_FOREACH(const CKeyID &keyid, vAffected) {
+        std::pair<std::map<CKeyID, CBlockIndex*>::iterator, bool> ret = mapKeyFirstBlock.insert(std::make_pair(keyid, pindex));
+        // Replace blocks that are later in the chain, or that were
+        // reorganised away
+        CBlockIndex*& pindexFirst = ret.first->second;
+        if (!ret.second && (pindex->nHeight < pindexFirst->nHeight || !chainActive.Contains(pindexFirst)))
+            pindexFirst = pindex;
+    }
+}
+
+void CWallet::GetKeyBirthTimes(std::map<CKeyID, int64_t> &mapKeyBirth) {
     AssertLockHeld(cs_wallet); // mapKeyMetadata
     mapKeyBirth.clear();
 
@@ -3522,47 +3788,45 @@ void CWallet::GetKeyBirthTimes(std::map<CKeyID, int64_t> &mapKeyBirth) const {
         if (it->second.nCreateTime)
             mapKeyBirth[it->first] = it->second.nCreateTime;
 
-    // map in which we'll infer heights of other keys
-    CBlockIndex *pindexMax = chainActive[std::max(0, chainActive.Height() - 144)]; // the tip can be reorganised; use a 144-block safety margin
-    std::map<CKeyID, CBlockIndex*> mapKeyFirstBlock;
+    // other keys get the time of the first block that affects them
+    std::vector<CKeyID> vKeys;
     std::set<CKeyID> setKeys;
     GetKeys(setKeys);
     BOOST_FOREACH(const CKeyID &keyid, setKeys) {
         if (mapKeyBirth.count(keyid) == 0)
-            mapKeyFirstBlock[keyid] = pindexMax;
+            vKeys.push_back(keyid);
     }
     setKeys.clear();
 
     // if there are no such keys, we're done
-    if (mapKeyFirstBlock.empty())
+    if (vKeys.empty())
         return;
 
-    // find first block that affects those keys, if there are any left
-    std::vector<CKeyID> vAffected;
-    for (std::map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); it++) {
-        // iterate over all wallet transactions...
-        const CWalletTx &wtx = (*it).second;
-        BlockMap::const_iterator blit = mapBlockIndex.find(wtx.hashBlock);
-        if (blit != mapBlockIndex.end() && chainActive.Contains(blit->second)) {
-            // ... which are already in a block
-            int nHeight = blit->second->nHeight;
-            BOOST_FOREACH(const CTxOut &txout, wtx.vout) {
-                // iterate over all their outputs
-                CAffectedKeysVisitor(*this, vAffected).Process(txout.scriptPubKey);
-                BOOST_FOREACH(const CKeyID &keyid, vAffected) {
-                    // ... and all their affected keys
-                    std::map<CKeyID, CBlockIndex*>::iterator rit = mapKeyFirstBlock.find(keyid);
-                    if (rit != mapKeyFirstBlock.end() && nHeight < rit->second->nHeight)
-                        rit->second = blit->second;
-                }
-                vAffected.clear();
-            }
+    // walk the wallet transactions on first use, and again if the first block
+    // of any of those keys has been reorganised away
+    bool fWalk = !fKeyFirstBlocksLoaded;
+    BOOST_FOREACH(const CKeyID &keyid, vKeys) {
+        std::map<CKeyID, CBlockIndex*>::iterator it = mapKeyFirstBlock.find(keyid);
+        if (it != mapKeyFirstBlock.end() && !chainActive.Contains(it->second)) {
+            mapKeyFirstBlock.erase(it);
+            fWalk = true;
         }
     }
+    if (fWalk) {
+        fKeyFirstBlocksLoaded = true;
+        for (std::map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); it++)
+            UpdateKeyFirstBlocks(it->second);
+    }
 
     // Extract block timestamps for those keys
-    for (std::map<CKeyID, CBlockIndex*>::const_iterator it = mapKeyFirstBlock.begin(); it != mapKeyFirstBlock.end(); it++)
-        mapKeyBirth[it->first] = it->second->GetBlockTime() - 7200; // block times can be 2h off
+    CBlockIndex *pindexMax = chainActive[std::max(0, chainActive.Height() - 144)]; // the tip can be reorganised; use a 144-block safety margin
+    BOOST_FOREACH(const CKeyID &keyid, vKeys) {
+        CBlockIndex* pindex = pindexMax;
+        std::map<CKeyID, CBlockIndex*>::const_iterator it = mapKeyFirstBlock.find(keyid);
+        if (it != mapKeyFirstBlock.end() && it->second->nHeight < pindexMax->nHeight)
+            pindex = it->second;
+        mapKeyBirth[keyid] = pindex->GetBlockTime() - 7200; // block times can be 2h off
+    }
 }
 
 bool CWallet::AddDestData(const CTxDestination &dest, const std::string &key, const std::string &value)
@@ -7,6 +7,7 @@
 #define BITCOIN_WALLET_WALLET_H
 
 #include "amount.h"
+#include "blockfilter.h"
 #include "coins.h"
 #include "key.h"
 #include "keystore.h"
@@ -33,6 +34,8 @@
 #include <utility>
 #include <vector>
 
+#include <boost/function.hpp>
+
 /**
  * Settings
  */
@@ -59,11 +62,16 @@ static const unsigned int MAX_FREE_TRANSACTION_CREATE_SIZE = 1000;
 //  Should be large enough that we can expect not to reorg beyond our cache
 //  unless there is some exceptional network disruption.
 static const unsigned int WITNESS_CACHE_SIZE = MAX_REORG_LENGTH + 1;
+//! -keypool default
+static const unsigned int DEFAULT_KEYPOOL_SIZE = 100;
+//! Most keys generated and written together when the key pool is topped up
+static const unsigned int KEYPOOL_BATCH_SIZE = 1000;
 
 class CBlockIndex;
 class CCoinControl;
 class COutput;
 class CReserveKey;
+class CScheduler;
 class CScript;
 class CTxMemPool;
 class CWalletTx;
@@ -701,6 +709,39 @@ private:
     void AddToSpends(const uint256& nullifier, const uint256& wtxid);
     void AddToSpends(const uint256& wtxid);
 
+    /**
+     * The earliest block in the active chain seen to contain a wallet
+     * transaction paying each of our keys. It is filled in by the first call
+     * to GetKeyBirthTimes that needs it and then kept up to date as
+     * transactions are added, so that later calls don't walk mapWallet.
+     */
+    std::map<CKeyID, CBlockIndex*> mapKeyFirstBlock;
+    bool fKeyFirstBlocksLoaded;
+    void UpdateKeyFirstBlocks(const CWalletTx& wtx);
+
+    /** A key generated for the key pool, with its secret ready to be written */
+    struct CNewPoolKey
+    {
+        CKey key;
+        CPubKey pubkey;
+        //! The secret to write, if the wallet isn't encrypted
+        CPrivKey privkey;
+        //! The encrypted secret, if it is
+        std::vector<unsigned char> vchCryptedSecret;
+    };
+
+    //! Generates (and, if fCrypted, encrypts) keys on several threads. Doesn't need cs_wallet.
+    bool GenerateKeyPoolBatch(size_t nCount, bool fCompressed, bool fCrypted, std::vector<CNewPoolKey>& vKeys);
+    //! Adds generated keys to the wallet and the key pool, writing them in one database transaction
+    bool AddKeyPoolBatch(const std::vector<CNewPoolKey>& vKeys, bool fCrypted);
+    //! Fills the key pool up to nSize keys
+    bool FillKeyPool(size_t nSize);
+
+    //! Runs background key pool top-ups, if set
+    CScheduler* pKeyPoolScheduler;
+    bool fKeyPoolTopUpScheduled;
+    void TopUpKeyPoolInBackground();
+
 public:
     /*
      * Size of the incremental witness cache for the notes in our wallet.
@@ -823,6 +864,9 @@ public:
         nTimeFirstKey = 0;
         fBroadcastTransactions = false;
         nWitnessCacheSize = 0;
+        fKeyFirstBlocksLoaded = false;
+        pKeyPoolScheduler = NULL;
+        fKeyPoolTopUpScheduled = false;
     }
 
     /**
@@ -954,7 +998,7 @@ public:
     bool ChangeWalletPassphrase(const SecureString& strOldWalletPassphrase, const SecureString& strNewWalletPassphrase);
     bool EncryptWallet(const SecureString& strWalletPassphrase);
 
-    void GetKeyBirthTimes(std::map<CKeyID, int64_t> &mapKeyBirth) const;
+    void GetKeyBirthTimes(std::map<CKeyID, int64_t> &mapKeyBirth);
 
     /**
       * ZKeys
@@ -1005,7 +1049,22 @@ public:
          std::vector<uint256> commitments,
          std::vector<boost::optional<ZCIncrementalWitness>>& witnesses,
          uint256 &final_anchor);
-    int ScanForWalletTransactions(CBlockIndex* pindexStart, bool fUpdate = false);
+    /**
+     * Collects the block filter elements that any transaction involving the
+     * wallet would match: its scripts and the outpoints of its outputs.
+     * Returns false if the wallet holds shielded spending or viewing keys,
+     * or notes, which the filters can't match. Bare multisig outputs paying the wallet aren't matched.
+     */
+    bool GetBlockFilterQuery(GCSFilter::ElementSet& query) const;
+    /**
+     * Scans the active chain from pindexStart for transactions involving the
+     * wallet. Each function in pmapImports is called just before the block
+     * at its height is scanned, so keys it adds are only checked against
+     * blocks from that height on. Blocks whose filter in the block filter
+     * index doesn't match the wallet are skipped without being read.
+     */
+    int ScanForWalletTransactions(CBlockIndex* pindexStart, bool fUpdate = false,
+                                  const std::multimap<int, boost::function<void()> >* pmapImports = NULL);
     void ReacceptWalletTransactions();
     void ResendWalletTransactions(int64_t nBestBlockTime);
     std::vector<uint256> ResendWalletTransactionsBefore(int64_t nTime);
@@ -1025,6 +1084,11 @@ public:
 
     bool NewKeyPool();
     bool TopUpKeyPool(unsigned int kpSize = 0);
+    /**
+     * Top up the key pool on the scheduler's threads once it falls below half
+     * of -keypool, instead of on the thread that takes a key from it.
+     */
+    void SetKeyPoolScheduler(CScheduler* pschedulerIn);
     void ReserveKeyFromKeyPool(int64_t& nIndex, CKeyPool& keypool);
     void KeepKey(int64_t nIndex);
     void ReturnKey(int64_t nIndex);
@@ -76,6 +76,10 @@ public:
     r1cs_ppzksnark_processed_verification_key<ppzksnark_ppT> vk_precomp;
     std::string pkPath;
 
+    // Resident proving key, if loaded
+    CCriticalSection cs_pk;
+    std::shared_ptr<const r1cs_ppzksnark_proving_key<ppzksnark_ppT>> pk;
+
     JoinSplitCircuit(const std::string vkPath, const std::string pkPath) : pkPath(pkPath) {
         loadFromFile(vkPath, vk);
         vk_precomp = r1cs_ppzksnark_verifier_process_vk(vk);
@@ -101,6 +105,44 @@ public:
         saveToFile(pkPath, keypair.pk);
     }
 
+    void loadProvingKey() {
+        if (isProvingKeyLoaded()) {
+            return;
+        }
+
+        auto newPk = std::make_shared<r1cs_ppzksnark_proving_key<ppzksnark_ppT>>();
+        {
+            LOCK(cs_ParamsIO);
+
+            // Decode straight from the file rather than through loadFromFile,
+            // to avoid holding a second copy of the key in memory.
+            std::ifstream fh(pkPath, std::ios::binary);
+
+            if(!fh.is_open()) {
+                throw std::runtime_error(strprintf("could not load param file at %s", pkPath));
+            }
+
+            fh >> *newPk;
+
+            if (!fh) {
+                throw std::runtime_error(strprintf("could not decode proving key at %s", pkPath));
+            }
+        }
+
+        LOCK(cs_pk);
+        pk = std::move(newPk);
+    }
+
+    void unloadProvingKey() {
+        LOCK(cs_pk);
+        pk.reset();
+    }
+
+    bool isProvingKeyLoaded() {
+        LOCK(cs_pk);
+        return pk != nullptr;
+    }
+
     bool verify(
         const PHGRProof& proof,
         ProofVerifier& verifier,
@@ -353,6 +395,21 @@ public:
         // estimate that it doesn't matter if we check every time.
         pb.constraint_system.swap_AB_if_beneficial();
 
+        std::shared_ptr<const r1cs_ppzksnark_proving_key<ppzksnark_ppT>> residentPk;
+        {
+            LOCK(cs_pk);
+            residentPk = pk;
+        }
+
+        if (residentPk) {
+            return PHGRProof(r1cs_ppzksnark_prover<ppzksnark_ppT>(
+                *residentPk,
+                primary_input,
+                aux_input,
+                pb.constraint_system
+            ));
+        }
+
         std::ifstream fh(pkPath, std::ios::binary);
 
         if(!fh.is_open()) {
@@ -62,6 +62,15 @@ public:
     static JoinSplit<NumInputs, NumOutputs>* Prepared(const std::string vkPath,
                                                       const std::string pkPath);
 
+    // Decode the PHGR proving key once and keep it in memory, so that later
+    // proofs skip reading and parsing the key file. The decoded key takes
+    // several times the size of the (point-compressed) key file. Concurrent
+    // provers share the key read-only, and unloading it does not affect
+    // proofs already in progress.
+    virtual void loadProvingKey() = 0;
+    virtual void unloadProvingKey() = 0;
+    virtual bool isProvingKeyLoaded() = 0;
+
     static uint256 h_sig(const uint256& randomSeed,
                          const std::array<uint256, NumInputs>& nullifiers,
                          const uint256& joinSplitPubKey
@@ -4,6 +4,7 @@
 #include <thread>
 #include <unistd.h>
 #include <boost/filesystem.hpp>
+#include <boost/thread.hpp>
 
 #include "coins.h"
 #include "util.h"
@@ -13,11 +14,15 @@
 #include "crypto/equihash.h"
 #include "chain.h"
 #include "chainparams.h"
+#include "checkqueue.h"
 #include "consensus/upgrades.h"
 #include "consensus/validation.h"
+#include "crypto/sha256.h"
+#include "key_io.h"
 #include "main.h"
 #include "miner.h"
 #include "pow.h"
+#include "random.h"
 #include "rpcserver.h"
 #include "script/sign.h"
 #include "sodium.h"
@@ -466,3 +471,77 @@ double benchmark_listunspent()
     auto unspent = listunspent(params, false);
     return timer_stop(tv_start);
 }
+
+// A check with a fixed cost comparable to a signature check, so that the
+// benchmark measures queue overhead and scaling rather than script execution.
+class FakeCheck
+{
+private:
+    unsigned char data[32];
+
+public:
+    FakeCheck() { memset(data, 0, sizeof(data)); }
+
+    bool operator()()
+    {
+        for (int i = 0; i < 100; i++) {
+            CSHA256().Write(data, sizeof(data)).Finalize(data);
+        }
+        return true;
+    }
+
+    void swap(FakeCheck& check) { std::swap(data, check.data); }
+};
+
+double benchmark_checkqueue(int nThreads, size_t nChecks)
+{
+    // Batch size matches the script check queue in main.cpp.
+    CCheckQueue<FakeCheck> queue(128);
+    boost::thread_group threadGroup;
+    for (int i = 0; i < nThreads - 1; i++) {
+        threadGroup.create_thread(boost::bind(&CCheckQueue<FakeCheck>::Thread, boost::ref(queue)));
+    }
+
+    struct timeval tv_start;
+    timer_start(tv_start);
+    {
+        CCheckQueueControl<FakeCheck> control(&queue);
+        // Add checks a few at a time, like ConnectBlock does per transaction.
+        for (size_t i = 0; i < nChecks; i += 4) {
+            std::vector<FakeCheck> vChecks(std::min<size_t>(4, nChecks - i));
+            control.Add(vChecks);
+        }
+        control.Wait();
+    }
+    double ret = timer_stop(tv_start);
+
+    threadGroup.interrupt_all();
+    threadGroup.join_all();
+    return ret;
+}
+
+double benchmark_address_encoding(size_t nAddrs)
+{
+    // The address types the wallet RPCs return in bulk
+    std::vector<CTxDestination> dests;
+    std::vector<libzcash::PaymentAddress> zaddrs;
+    for (size_t i = 0; i < nAddrs; i++) {
+        uint160 hash;
+        GetRandBytes(hash.begin(), hash.size());
+        dests.push_back(CKeyID(hash));
+        zaddrs.push_back(libzcash::SproutSpendingKey::random().address());
+        zaddrs.push_back(*libzcash::SaplingSpendingKey::random().default_address());
+    }
+
+    struct timeval tv_start;
+    timer_start(tv_start);
+    std::vector<std::string> vEncoded = EncodeDestinations(dests);
+    for (const std::string& str : vEncoded) {
+        assert(IsValidDestination(DecodeDestination(str)));
+    }
+    std::vector<std::string> vEncodedZ = EncodePaymentAddresses(zaddrs);
+    for (const std::string& str : vEncodedZ) {
+        assert(IsValidPaymentAddress(DecodePaymentAddress(str)));
+    }
+    return timer_stop(tv_start);
+}
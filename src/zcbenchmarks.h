@@ -19,5 +19,7 @@ extern double benchmark_connectblock_slow();
 extern double benchmark_sendtoaddress(CAmount amount);
 extern double benchmark_loadwallet();
 extern double benchmark_listunspent();
+extern double benchmark_checkqueue(int nThreads, size_t nChecks);
+extern double benchmark_address_encoding(size_t nAddrs);
 
 #endif